@@ -0,0 +1,10 @@
+#version 330 core
+in vec3 TexCoord;
+
+uniform sampler2DArray atlas;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(atlas, TexCoord);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aInstance;    // xyz offset, w atlas layer
+layout (location = 3) in vec4 aUvRect;      // xy offset, zw scale
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 TexCoord;
+
+void main() {
+    gl_Position = projection * view * (model * vec4(aPos, 1.0) + vec4(aInstance.xyz, 0.0));
+    TexCoord = vec3(aTexCoord * aUvRect.zw + aUvRect.xy, aInstance.w);
+}
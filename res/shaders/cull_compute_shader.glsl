@@ -0,0 +1,114 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// Must match GpuScene::GpuMesh and GpuScene::GpuObject
+struct Mesh {
+    vec4 sphere;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uint lodCount;
+    int baseVertex;
+    uint reserved[2];
+    uvec4 lods[8];          // First index, index count, error bits, unused
+};
+
+struct Object {
+    mat4 model;
+    uint mesh;
+    uint reserved[3];
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Objects { Object objects[]; };
+layout (std430, binding = 1) readonly buffer Meshes { Mesh meshes[]; };
+layout (std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 3) buffer Counter { uint visibleCount; };
+
+uniform int objectCount;
+uniform mat4 view;
+uniform vec4 frustumPlanes[6];      // World space, normals pointing inwards
+uniform float projectionScale;      // projection[1][1] * viewportHeight / 2
+uniform bool orthographic;
+uniform float maxPixelError;
+
+uniform bool occlusion;
+uniform mat4 occlusionViewProjection;
+uniform sampler2D depthPyramid;     // Farthest depth of each texel's footprint
+uniform int pyramidLevels;
+
+bool occluded(vec3 boundsMin, vec3 boundsMax) {
+    vec2 uvMin = vec2(1.0);
+    vec2 uvMax = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+        // Crosses the near plane: too close to tell
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    // Pick the level where the rectangle covers at most 2x2 texels
+    vec2 size = (uvMax - uvMin) * vec2(textureSize(depthPyramid, 0));
+    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, pyramidLevels - 1);
+    float farthest = max(max(textureLod(depthPyramid, uvMin, level).r,
+                             textureLod(depthPyramid, vec2(uvMax.x, uvMin.y), level).r),
+                         max(textureLod(depthPyramid, vec2(uvMin.x, uvMax.y), level).r,
+                             textureLod(depthPyramid, uvMax, level).r));
+    return nearest > farthest;
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(objectCount)) {
+        return;
+    }
+    Object object = objects[id];
+    Mesh mesh = meshes[object.mesh];
+
+    vec3 center = vec3(object.model * vec4(mesh.sphere.xyz, 1.0));
+    float scale = max(length(object.model[0].xyz), max(length(object.model[1].xyz), length(object.model[2].xyz)));
+    float radius = mesh.sphere.w * scale;
+
+    bool visible = true;
+    for (int i = 0; i < 6; ++i) {
+        visible = visible && dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w > -radius;
+    }
+    if (visible && occlusion) {
+        visible = !occluded(center - vec3(radius), center + vec3(radius));
+    }
+
+    // Coarsest LOD whose error stays under maxPixelError, as LodSelector
+    float pixelsPerUnit = projectionScale * scale;
+    if (!orthographic) {
+        float distance = length(vec3(view * vec4(center, 1.0)));
+        pixelsPerUnit /= max(distance - radius, 1e-4);
+    }
+    uint lod = 0;
+    while (lod + 1 < mesh.lodCount && uintBitsToFloat(mesh.lods[lod + 1].z) * pixelsPerUnit <= maxPixelError) {
+        lod++;
+    }
+
+    commands[id].count = mesh.lods[lod].y;
+    commands[id].instanceCount = visible ? 1 : 0;
+    commands[id].firstIndex = mesh.lods[lod].x;
+    commands[id].baseVertex = mesh.baseVertex;
+    commands[id].baseInstance = id;
+    if (visible) {
+        atomicAdd(visibleCount, 1);
+    }
+}
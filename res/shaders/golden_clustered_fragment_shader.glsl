@@ -0,0 +1,62 @@
+#version 330 core
+in vec3 Normal;
+in vec3 Color;
+in vec3 WorldPos;
+in float ViewDepth;
+
+out vec4 FragColor;
+
+// Must match the material golden_gbuffer_fragment_shader.glsl writes
+const float ROUGHNESS = 0.5;
+
+uniform vec3 cameraPosition;
+
+// Point lights sorted into clusters by ClusteredLights; must match its
+// TILES_X, TILES_Y and SLICES
+const uvec3 CLUSTER_COUNT = uvec3(16u, 9u, 24u);
+
+uniform samplerBuffer clusterLights;        // Position and radius, then color, per light
+uniform usamplerBuffer clusterLightGrid;    // First index and count per cluster
+uniform usamplerBuffer clusterLightIndices;
+uniform vec2 clusterTileScale;              // Tiles per pixel
+uniform vec2 clusterSliceScaleBias;         // slice = log(depth) * x + y
+
+// Light from the point lights of the fragment's cluster: Lambert diffuse
+// and normalized Blinn-Phong specular, metals tinting the specular and
+// losing the diffuse
+vec3 clusteredLight(vec3 position, vec3 normal, vec3 toEye, float viewDepth, vec3 albedo, float roughness,
+                    float metalness) {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterTileScale), CLUSTER_COUNT.xy - 1u);
+    float slice = log(viewDepth) * clusterSliceScaleBias.x + clusterSliceScaleBias.y;
+    uint z = uint(clamp(slice, 0.0, float(CLUSTER_COUNT.z - 1u)));
+    uvec2 range = texelFetch(clusterLightGrid, int((z * CLUSTER_COUNT.y + tile.y) * CLUSTER_COUNT.x + tile.x)).xy;
+
+    vec3 diffuse = albedo * (1.0 - metalness);
+    vec3 specular = mix(vec3(0.04), albedo, metalness);
+    float alpha = roughness * roughness;
+    float shininess = max(2.0 / (alpha * alpha) - 2.0, 1.0);
+    float normalization = (shininess + 8.0) / 25.132741;    // 8 pi
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        vec4 sphere = texelFetch(clusterLights, light * 2);
+        vec3 color = texelFetch(clusterLights, light * 2 + 1).rgb;
+        vec3 toLight = sphere.xyz - position;
+        float distance2 = dot(toLight, toLight);
+        vec3 direction = toLight * inversesqrt(max(distance2, 1e-6));
+        // Inverse square, windowed to reach zero at the radius
+        float window = clamp(1.0 - distance2 / (sphere.w * sphere.w), 0.0, 1.0);
+        float lambert = max(dot(normal, direction), 0.0);
+        float highlight = normalization * pow(max(dot(normal, normalize(direction + toEye)), 0.0), shininess);
+        result += color * (lambert * window * window / (1.0 + distance2)) * (diffuse + specular * highlight);
+    }
+    return result;
+}
+
+void main() {
+    vec3 normal = normalize(Normal);
+    vec3 color = Color * 0.05 +
+                 clusteredLight(WorldPos, normal, normalize(cameraPosition - WorldPos), ViewDepth, Color, ROUGHNESS,
+                                0.0);
+    FragColor = vec4(color, 1.0);
+}
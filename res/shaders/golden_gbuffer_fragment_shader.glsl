@@ -0,0 +1,21 @@
+#version 330 core
+in vec3 Normal;
+in vec3 Color;
+
+// The compact G-buffer of DeferredShading
+layout (location = 0) out vec4 AlbedoMetalness;     // RGBA8
+layout (location = 1) out vec4 NormalRoughness;     // RGB10_A2: octahedral normal, roughness
+
+const float ROUGHNESS = 0.5;
+
+// Octahedral encoding, in [0, 1] for a unorm target
+vec2 octahedralEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+void main() {
+    AlbedoMetalness = vec4(Color, 0.0);
+    NormalRoughness = vec4(octahedralEncode(normalize(Normal)), ROUGHNESS, 0.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+in vec3 Normal;
+in vec3 Color;
+
+out vec4 FragColor;
+
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.4, 0.8, 0.6));
+
+void main() {
+    float diffuse = max(dot(normalize(Normal), LIGHT_DIRECTION), 0.0);
+    FragColor = vec4(Color * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;         // Unorm16x4, dequantized by the model matrix
+layout (location = 1) in vec4 aNormal;      // OctahedralSnorm10
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in vec4 aInstance;    // xyz offset; (0, 0, 0, 1) when unbound
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec3 Color;
+out vec3 WorldPos;
+out float ViewDepth;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+void main() {
+    vec4 world = model * vec4(aPos, 1.0) + vec4(aInstance.xyz, 0.0);
+    vec4 viewPosition = view * world;
+    gl_Position = projection * viewPosition;
+    WorldPos = world.xyz;
+    ViewDepth = -viewPosition.z;
+    // The model matrix only translates and scales, so normals pass through
+    Normal = octDecode(aNormal.xy);
+    Color = aColor.rgb;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+in vec2 TexCoord;
+
+uniform sampler2D texture0;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(texture0, TexCoord);
+}
@@ -0,0 +1,33 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// One level of GpuScene's depth pyramid. Level 0 copies the depth buffer;
+// every other level keeps the farthest depth of the texels it covers in
+// the level above, including the extra row or column of odd sizes.
+
+uniform sampler2D source;
+uniform int sourceLevel;
+uniform bool reduce;
+layout (r32f, binding = 0) uniform writeonly image2D destination;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destination);
+    if (any(greaterThanEqual(texel, size))) {
+        return;
+    }
+    if (!reduce) {
+        imageStore(destination, texel, vec4(texelFetch(source, texel, 0).r));
+        return;
+    }
+    ivec2 sourceSize = textureSize(source, sourceLevel);
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + ivec2(1) + ivec2(equal(texel, size - 1)) * (sourceSize & 1), sourceSize - 1);
+    float farthest = 0.0;
+    for (int y = first.y; y <= last.y; ++y) {
+        for (int x = first.x; x <= last.x; ++x) {
+            farthest = max(farthest, texelFetch(source, ivec2(x, y), sourceLevel).r);
+        }
+    }
+    imageStore(destination, texel, vec4(farthest));
+}
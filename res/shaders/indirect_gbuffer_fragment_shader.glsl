@@ -0,0 +1,31 @@
+#version 430 core
+in vec3 Normal;
+flat in uint ObjectIndex;
+
+// The compact G-buffer of DeferredShading
+layout (location = 0) out vec4 AlbedoMetalness;     // RGBA8
+layout (location = 1) out vec4 NormalRoughness;     // RGB10_A2: octahedral normal, roughness
+
+// A stable material per object, so instances of one mesh tell apart; a
+// quarter of them are metals
+void objectMaterial(uint object, out vec3 albedo, out float roughness, out float metalness) {
+    uint h = object * 2654435761u;
+    albedo = vec3((h >> 8) & 255u, (h >> 16) & 255u, (h >> 24) & 255u) / 255.0 * 0.6 + 0.4;
+    roughness = 0.25 + 0.75 * float((h >> 4) & 15u) / 15.0;
+    metalness = (h & 0x30u) == 0u ? 1.0 : 0.0;
+}
+
+// Octahedral encoding, in [0, 1] for a unorm target
+vec2 octahedralEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+void main() {
+    vec3 albedo;
+    float roughness, metalness;
+    objectMaterial(ObjectIndex, albedo, roughness, metalness);
+    AlbedoMetalness = vec4(albedo, metalness);
+    NormalRoughness = vec4(octahedralEncode(normalize(Normal)), roughness, 0.0);
+}
@@ -0,0 +1,56 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec4 aNormal;
+layout (location = 15) in uint aObject;
+
+// Must match GpuScene::GpuMesh and GpuScene::GpuObject
+struct Mesh {
+    vec4 sphere;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uint lodCount;
+    int baseVertex;
+    uint reserved[2];
+    uvec4 lods[8];
+};
+
+struct Object {
+    mat4 model;
+    uint mesh;
+    uint reserved[3];
+};
+
+layout (std430, binding = 0) readonly buffer Objects { Object objects[]; };
+layout (std430, binding = 1) readonly buffer Meshes { Mesh meshes[]; };
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool octahedralNormals;     // Normals stored as OctahedralSnorm10
+
+out vec3 Normal;
+out vec3 WorldPos;
+out float ViewDepth;
+flat out uint ObjectIndex;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n;
+}
+
+void main() {
+    Object object = objects[aObject];
+    Mesh mesh = meshes[object.mesh];
+    vec3 position = aPos * mesh.positionScale.xyz + mesh.positionOffset.xyz;
+    vec3 normal = octahedralNormals ? octahedralDecode(aNormal.xy) : aNormal.xyz;
+
+    vec4 world = object.model * vec4(position, 1.0);
+    vec4 viewPosition = view * world;
+    gl_Position = projection * viewPosition;
+    WorldPos = world.xyz;
+    ViewDepth = -viewPosition.z;
+    Normal = mat3(object.model) * normal;
+    ObjectIndex = aObject;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+in vec2 TexCoord;
+in vec4 Color;
+
+uniform sampler2D font;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(Color.rgb, Color.a * texture(font, TexCoord).r);
+}
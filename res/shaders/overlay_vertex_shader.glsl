@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec4 aRect;        // xy top left, zw size, in pixels from the top left
+layout (location = 1) in vec4 aUvRect;      // xy top left, zw bottom right in the font texture
+layout (location = 2) in vec4 aColor;
+
+uniform vec2 viewportSize;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+void main() {
+    // Triangle strip of four corners, one quad per instance
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pixel = aRect.xy + corner * aRect.zw;
+    gl_Position = vec4(pixel / viewportSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+    TexCoord = mix(aUvRect.xy, aUvRect.zw, corner);
+    Color = aColor;
+}
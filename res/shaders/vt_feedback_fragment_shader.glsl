@@ -0,0 +1,20 @@
+#version 330 core
+// Writes the virtual texture page each pixel needs; see src/VirtualTexture.h
+in vec2 TexCoord;
+
+uniform ivec4 vtInfo;       // width, height, page size, level count
+uniform float vtLodBias;    // Compensates for the feedback pass resolution
+
+out uvec4 Feedback;         // page x, page y, level, 1
+
+void main() {
+    vec2 texel = TexCoord * vec2(vtInfo.xy);
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtLodBias;
+    int level = clamp(int(floor(lod)), 0, vtInfo.w - 1);
+
+    ivec2 levelSize = max(vtInfo.xy >> level, ivec2(1));
+    vec2 uv = clamp(TexCoord, 0.0, 1.0);
+    ivec2 page = min(ivec2(uv * vec2(levelSize)), levelSize - 1) / vtInfo.z;
+    Feedback = uvec4(uvec2(page), uint(level), 1u);
+}
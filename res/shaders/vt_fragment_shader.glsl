@@ -0,0 +1,39 @@
+#version 330 core
+// Samples a virtual texture through its page table; see src/VirtualTexture.h
+in vec2 TexCoord;
+
+uniform sampler2D vtCache;
+uniform sampler2D vtPageTable;  // cache slot x, y, resident level, valid
+uniform ivec4 vtInfo;           // width, height, page size, level count
+uniform ivec4 vtCacheInfo;      // tile size, border, cache size in texels
+uniform int vtLevelRow[16];     // First page table row of each level
+
+out vec4 FragColor;
+
+ivec2 pageOf(vec2 uv, int level, out vec2 texel) {
+    ivec2 levelSize = max(vtInfo.xy >> level, ivec2(1));
+    texel = uv * vec2(levelSize);
+    return min(ivec2(texel), levelSize - 1) / vtInfo.z;
+}
+
+void main() {
+    vec2 texel = TexCoord * vec2(vtInfo.xy);
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    int level = clamp(int(floor(lod)), 0, vtInfo.w - 1);
+
+    vec2 uv = clamp(TexCoord, 0.0, 1.0);
+    ivec2 page = pageOf(uv, level, texel);
+    vec4 entry = texelFetch(vtPageTable, ivec2(page.x, vtLevelRow[level] + page.y), 0);
+    if (entry.a == 0.0) {
+        FragColor = vec4(1.0);
+        return;
+    }
+    ivec3 resident = ivec3(entry.rgb * 255.0 + 0.5);
+
+    // The entry may belong to a coarser ancestor; find the texel there
+    page = pageOf(uv, resident.z, texel);
+    vec2 inTile = texel - vec2(page * vtInfo.z) + float(vtCacheInfo.y);
+    vec2 cacheTexel = vec2(resident.xy * vtCacheInfo.x) + inTile;
+    FragColor = textureLod(vtCache, cacheTexel / float(vtCacheInfo.z), 0.0);
+}
@@ -0,0 +1,78 @@
+#include "ArchiveFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+std::string normalizeArchivePath(const std::string& path) {
+    std::string normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    while (normalized.compare(0, 2, "./") == 0) {
+        normalized.erase(0, 2);
+    }
+    return normalized;
+}
+
+uint64_t archivePathHash(const std::string& normalizedPath) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : normalizedPath) {
+        hash = (hash ^ uint8_t(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+ArchiveBlob::ArchiveBlob(const uint8_t* data, size_t size) : base(data) {
+    ArchiveHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Archive header is truncated");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != ARCHIVE_FILE_MAGIC) {
+        throw std::runtime_error("Not an asset archive");
+    }
+    if (header.version != ARCHIVE_FILE_VERSION) {
+        throw std::runtime_error("Unsupported archive version " + std::to_string(header.version));
+    }
+    if (header.indexOffset % alignof(ArchiveEntry) != 0 || header.indexOffset > size ||
+        (size - header.indexOffset) / sizeof(ArchiveEntry) < header.entryCount ||
+        header.namesOffset > size || size - header.namesOffset < header.namesSize) {
+        throw std::runtime_error("Archive index is truncated");
+    }
+    count = header.entryCount;
+    entries = reinterpret_cast<const ArchiveEntry*>(data + header.indexOffset);
+    names = reinterpret_cast<const char*>(data + header.namesOffset);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const ArchiveEntry& e = entries[i];
+        if (e.offset > size || size - e.offset < e.storedSize ||
+            uint64_t(e.nameOffset) + e.nameLength > header.namesSize) {
+            throw std::runtime_error("Archive entry " + std::to_string(i) + " is out of bounds");
+        }
+        if (e.compression > uint32_t(ArchiveCompression::Lz4) ||
+            (e.compression == uint32_t(ArchiveCompression::None) && e.storedSize != e.size)) {
+            throw std::runtime_error("Archive entry " + std::to_string(i) + " is inconsistent");
+        }
+        if (i > 0 && entries[i - 1].pathHash > e.pathHash) {
+            throw std::runtime_error("Archive index is not sorted");
+        }
+    }
+}
+
+std::string ArchiveBlob::name(const ArchiveEntry& entry) const {
+    return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+const ArchiveEntry* ArchiveBlob::find(const std::string& path) const {
+    std::string normalized = normalizeArchivePath(path);
+    uint64_t hash = archivePathHash(normalized);
+    const ArchiveEntry* end = entries + count;
+    const ArchiveEntry* it = std::lower_bound(entries, end, hash, [](const ArchiveEntry& e, uint64_t h) {
+        return e.pathHash < h;
+    });
+    for (; it != end && it->pathHash == hash; ++it) {
+        if (it->nameLength == normalized.size() && std::memcmp(names + it->nameOffset, normalized.data(), normalized.size()) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk layout of the .pack asset archives written by tools/asset_packer
+// and mounted by FileSystem. The header, the index and the path names come
+// first, so mounting touches one contiguous range at the front of the file;
+// file data follows, each entry aligned to ARCHIVE_ALIGNMENT so stored
+// entries can be used in place from the memory mapping.
+//
+// The index is sorted by path hash for binary search. Paths are stored too,
+// to resolve the (unlikely) hash collisions and to list the archive.
+
+constexpr uint32_t ARCHIVE_FILE_MAGIC = 0x4B434150;     // "PACK"
+constexpr uint32_t ARCHIVE_FILE_VERSION = 1;
+constexpr uint64_t ARCHIVE_ALIGNMENT = 16;
+
+enum class ArchiveCompression : uint32_t {
+    None,
+    Lz4,        // One raw LZ4 block (see Lz4.h)
+};
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;       // entryCount ArchiveEntry records
+    uint64_t namesOffset;       // Path names, not null-terminated
+    uint64_t namesSize;
+};
+
+struct ArchiveEntry {
+    uint64_t pathHash;
+    uint64_t offset;            // Of the stored data, from the start of the file
+    uint64_t storedSize;
+    uint64_t size;              // Once decompressed
+    uint32_t nameOffset;        // Into the names block
+    uint32_t nameLength;
+    uint32_t compression;       // ArchiveCompression
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ArchiveHeader) == 40, "ArchiveHeader must match the .pack layout");
+static_assert(sizeof(ArchiveEntry) == 48, "ArchiveEntry must match the .pack layout");
+
+// Paths are looked up as written in code, e.g. "res/shaders/x.glsl", with
+// backslashes turned into slashes and any leading "./" dropped.
+std::string normalizeArchivePath(const std::string& path);
+// FNV-1a of the normalized path
+uint64_t archivePathHash(const std::string& normalizedPath);
+
+// Validated, read-only view of a .pack file. Nothing is copied.
+class ArchiveBlob {
+public:
+    // Throws std::runtime_error on malformed or truncated files.
+    ArchiveBlob(const uint8_t* data, size_t size);
+
+    uint32_t entryCount() const { return count; }
+    const ArchiveEntry& entry(uint32_t index) const { return entries[index]; }
+    std::string name(const ArchiveEntry& entry) const;
+    const uint8_t* storedData(const ArchiveEntry& entry) const { return base + entry.offset; }
+
+    // Null if the archive doesn't contain `path`.
+    const ArchiveEntry* find(const std::string& path) const;
+
+private:
+    const uint8_t* base;
+    const ArchiveEntry* entries;
+    const char* names;
+    uint32_t count;
+};
@@ -0,0 +1,207 @@
+#include "AssetManager.h"
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+void TextureAsset::decode(std::vector<uint8_t> bytes) {
+    levels = buildMipChain(decodeImage(bytes.data(), bytes.size()), MipFilter::Box);
+}
+
+size_t TextureAsset::uploadSize() const {
+    size_t size = 0;
+    for (const Image& level : levels) {
+        size += level.byteSize();
+    }
+    return size;
+}
+
+void TextureAsset::upload() {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (uint32_t level = 0; level < levels.size(); ++level) {
+        texture.setLevel(level, levels[level].width, levels[level].height, levels[level].pixels.data());
+    }
+    texture.finalize(uint32_t(levels.size()));
+    std::vector<Image>().swap(levels);
+}
+
+void MeshAsset::decode(std::vector<uint8_t> bytes) {
+    // Validate here so a bad file fails on the worker, not during upload
+    MeshBlob(bytes.data(), bytes.size());
+    data = std::move(bytes);
+}
+
+void MeshAsset::upload() {
+    MeshBlob blob(data.data(), data.size());
+    mesh = pool ? std::make_unique<Mesh>(blob, *pool) : std::make_unique<Mesh>(blob);
+    std::vector<uint8_t>().swap(data);
+}
+
+AssetManager::AssetManager(JobSystem& jobs, size_t uploadBudget, uint32_t maxReadsInFlight)
+    : jobs(jobs), uploadBudget(uploadBudget), maxReadsInFlight(std::max(1u, maxReadsInFlight)) {}
+
+AssetManager::~AssetManager() {
+    for (Request& request : requests) {
+        if (request.stage.load(std::memory_order_acquire) == Reading && io.cancel(request.readId)) {
+            taskFinished();
+        }
+    }
+    std::unique_lock<std::mutex> lock(taskMutex);
+    tasksDone.wait(lock, [this] { return tasksInFlight == 0; });
+}
+
+void AssetManager::enqueue(const std::shared_ptr<Asset>& asset, const std::string& path) {
+    asset->assetPath = path;
+    requests.emplace_back();
+    requests.back().asset = asset;
+}
+
+void AssetManager::cancel(const std::shared_ptr<Asset>& asset) {
+    for (Request& request : requests) {
+        if (request.asset == asset) {
+            request.cancelled = true;
+        }
+    }
+}
+
+void AssetManager::update(const glm::vec3& cameraPos) {
+    auto distance2 = [&cameraPos](const Request* request) {
+        glm::vec3 d = request->asset->position - cameraPos;
+        return glm::dot(d, d);
+    };
+    std::vector<Request*> queued;
+    std::vector<Request*> decoded;
+
+    for (auto it = requests.begin(); it != requests.end();) {
+        Request& request = *it;
+        int stage = request.stage.load(std::memory_order_acquire);
+        if (request.reading && stage != Reading) {
+            request.reading = false;
+            readsInFlight--;
+        }
+        // The manager's own reference is the last one left: nobody wants
+        // the asset anymore
+        if (request.asset.use_count() == 1) {
+            request.cancelled = true;
+        }
+
+        if (request.cancelled) {
+            if (stage == Reading && io.cancel(request.readId)) {
+                taskFinished();
+                request.reading = false;
+                readsInFlight--;
+                stage = Decoded;
+            }
+            // Otherwise the read or decode has to finish first
+            if (stage == Queued || stage == Decoded) {
+                fail(request, "Cancelled");
+                it = requests.erase(it);
+                continue;
+            }
+        } else if (stage == Queued) {
+            queued.push_back(&request);
+        } else if (stage == Decoded) {
+            if (!request.error.empty()) {
+                std::cerr << "Failed to load asset: " << request.error << std::endl;
+                fail(request, request.error);
+                it = requests.erase(it);
+                continue;
+            }
+            decoded.push_back(&request);
+        }
+        ++it;
+    }
+
+    // Closest first, both for reads and for uploads
+    auto closer = [&distance2](const Request* a, const Request* b) { return distance2(a) < distance2(b); };
+    size_t reads = std::min<size_t>(queued.size(), maxReadsInFlight - std::min(maxReadsInFlight, readsInFlight));
+    std::partial_sort(queued.begin(), queued.begin() + reads, queued.end(), closer);
+    for (size_t i = 0; i < reads; ++i) {
+        startRead(*queued[i]);
+    }
+
+    std::sort(decoded.begin(), decoded.end(), closer);
+    size_t budget = uploadBudget;
+    bool startedUpload = false;
+    for (Request* request : decoded) {
+        size_t size = request->asset->uploadSize();
+        // Always upload at least one asset, so one larger than the budget
+        // still gets through
+        if (startedUpload && size > budget) {
+            continue;
+        }
+        budget -= std::min(budget, size);
+        startedUpload = true;
+
+        try {
+            request->asset->upload();
+            request->asset->loadState.store(AssetState::Ready, std::memory_order_release);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load asset: " << request->asset->path() << ": " << e.what() << std::endl;
+            fail(*request, e.what());
+        }
+        requests.remove_if([request](const Request& r) { return &r == request; });
+    }
+}
+
+void AssetManager::startRead(Request& request) {
+    taskStarted();
+    request.stage.store(Reading, std::memory_order_relaxed);
+    request.reading = true;
+    readsInFlight++;
+    Request* r = &request;
+    if (isArchived(request.asset->path())) {
+        // Already mapped: the worker reads the entry, decompressing it if
+        // need be, without a trip through the I/O thread
+        request.stage.store(Decoding, std::memory_order_relaxed);
+        jobs.submit([this, r] {
+            try {
+                r->asset->decode(openFile(r->asset->path()).toVector());
+            } catch (const std::exception& e) {
+                r->error = r->asset->path() + ": " + e.what();
+            }
+            r->stage.store(Decoded, std::memory_order_release);
+            taskFinished();
+        });
+        return;
+    }
+    request.readId = io.read(request.asset->path(), [this, r](std::vector<uint8_t> data, const std::string& error) {
+        if (!error.empty()) {
+            r->error = error;
+            r->stage.store(Decoded, std::memory_order_release);
+            taskFinished();
+            return;
+        }
+        r->stage.store(Decoding, std::memory_order_release);
+        taskStarted();
+        jobs.submit([this, r, data = std::move(data)]() mutable {
+            try {
+                r->asset->decode(std::move(data));
+            } catch (const std::exception& e) {
+                r->error = r->asset->path() + ": " + e.what();
+            }
+            r->stage.store(Decoded, std::memory_order_release);
+            taskFinished();
+        });
+        taskFinished();
+    });
+}
+
+void AssetManager::fail(Request& request, const std::string& error) {
+    request.asset->loadError = error;
+    request.asset->loadState.store(AssetState::Failed, std::memory_order_release);
+}
+
+void AssetManager::taskStarted() {
+    std::lock_guard<std::mutex> lock(taskMutex);
+    tasksInFlight++;
+}
+
+void AssetManager::taskFinished() {
+    std::lock_guard<std::mutex> lock(taskMutex);
+    if (--tasksInFlight == 0) {
+        tasksDone.notify_all();
+    }
+}
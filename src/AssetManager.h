@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Image.h"
+#include "IoThread.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Texture.h"
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+enum class AssetState {
+    Loading,
+    Ready,
+    Failed,     // See error(); also set when the load was cancelled
+};
+
+// Base of everything AssetManager streams. Handles are shared_ptrs to the
+// concrete type; once the last one is dropped, a load still in progress is
+// cancelled and the asset is freed.
+class Asset {
+public:
+    virtual ~Asset() = default;
+
+    AssetState state() const { return loadState.load(std::memory_order_acquire); }
+    bool ready() const { return state() == AssetState::Ready; }
+    const std::string& path() const { return assetPath; }
+    const std::string& error() const { return loadError; }
+
+    // Where the asset is used in the world. Loads closest to the camera run
+    // first; move it to reprioritize a pending load.
+    glm::vec3 position{0.0f};
+
+protected:
+    // Worker thread: turns the file's bytes into something upload() can
+    // pass straight to GL. Throws std::runtime_error on bad data.
+    virtual void decode(std::vector<uint8_t> bytes) = 0;
+    // Bytes upload() will send to the GPU, charged to the frame budget.
+    virtual size_t uploadSize() const = 0;
+    // Main thread: creates the GL objects and frees the decoded data.
+    virtual void upload() = 0;
+
+private:
+    friend class AssetManager;
+
+    std::string assetPath;
+    std::string loadError;
+    std::atomic<AssetState> loadState{AssetState::Loading};
+};
+
+// Texture2D with a box-filtered mip chain. The texture exists from the
+// start as the usual white placeholder.
+class TextureAsset : public Asset {
+public:
+    Texture2D texture;
+
+protected:
+    void decode(std::vector<uint8_t> bytes) override;
+    size_t uploadSize() const override;
+    void upload() override;
+
+private:
+    std::vector<Image> levels;
+};
+
+// Cooked .mesh file; `mesh` is null until the asset is ready.
+class MeshAsset : public Asset {
+public:
+    std::unique_ptr<Mesh> mesh;
+    // Set right after load() to suballocate the mesh from a pool, which
+    // must outlive the asset.
+    MeshPool* pool = nullptr;
+
+protected:
+    void decode(std::vector<uint8_t> bytes) override;
+    size_t uploadSize() const override { return data.size(); }
+    void upload() override;
+
+private:
+    std::vector<uint8_t> data;
+};
+
+// Raw file contents, e.g. shader sources.
+class TextAsset : public Asset {
+public:
+    std::string text;
+
+protected:
+    void decode(std::vector<uint8_t> bytes) override { text.assign(bytes.begin(), bytes.end()); }
+    size_t uploadSize() const override { return 0; }
+    void upload() override {}
+};
+
+// Streams assets in the background so loading never stalls a frame:
+//   1. main:     requests wait in a queue ordered by distance to the camera;
+//                only a few are handed to the I/O thread at a time, so a
+//                nearer request can still overtake the rest
+//   2. I/O:      the file is read (see IoThread); files in a mounted
+//                archive are read by the worker in step 3 instead
+//   3. worker:   the asset decodes the bytes
+//   4. main:     uploads, up to a byte budget per update()
+// Requests for the same path and type share one asset while it is alive.
+class AssetManager {
+public:
+    explicit AssetManager(JobSystem& jobs, size_t uploadBudget = 16 << 20, uint32_t maxReadsInFlight = 4);
+    // Cancels everything still pending and waits for running decodes.
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Returns immediately; the asset becomes ready in a later update().
+    // Must be called on the GL thread, as assets may create GL objects.
+    template <typename T>
+    std::shared_ptr<T> load(const std::string& path, const glm::vec3& position = glm::vec3(0.0f)) {
+        std::string key = std::string(typeid(T).name()) + ":" + path;
+        auto cached = assets.find(key);
+        if (cached != assets.end()) {
+            if (std::shared_ptr<Asset> asset = cached->second.lock()) {
+                return std::static_pointer_cast<T>(asset);
+            }
+        }
+        auto asset = std::make_shared<T>();
+        asset->position = position;
+        enqueue(asset, path);
+        assets[key] = asset;
+        return asset;
+    }
+
+    // Stops a pending load; the asset fails with "Cancelled". Does nothing
+    // once it is ready.
+    void cancel(const std::shared_ptr<Asset>& asset);
+
+    // Starts reads in priority order and uploads decoded assets. Call once
+    // per frame on the GL thread.
+    void update(const glm::vec3& cameraPos);
+
+    // Requests that are not yet ready, failed or cancelled.
+    size_t pending() const { return requests.size(); }
+    const char* ioBackend() const { return io.backend(); }
+
+private:
+    enum Stage : int {
+        Queued,
+        Reading,
+        Decoding,
+        Decoded,
+    };
+
+    struct Request {
+        std::shared_ptr<Asset> asset;
+        std::atomic<int> stage{Queued};
+        uint64_t readId = 0;
+        bool reading = false;       // Counted in readsInFlight
+        bool cancelled = false;
+        std::string error;
+    };
+
+    void enqueue(const std::shared_ptr<Asset>& asset, const std::string& path);
+    void startRead(Request& request);
+    void fail(Request& request, const std::string& error);
+    void taskStarted();
+    void taskFinished();
+
+    JobSystem& jobs;
+    IoThread io;
+    size_t uploadBudget;
+    uint32_t maxReadsInFlight;
+    uint32_t readsInFlight = 0;
+    std::list<Request> requests;
+    std::unordered_map<std::string, std::weak_ptr<Asset>> assets;
+
+    std::mutex taskMutex;
+    std::condition_variable tasksDone;
+    size_t tasksInFlight = 0;       // Guarded by taskMutex
+};
@@ -0,0 +1,115 @@
+#include "Buffers.h"
+#include "GpuFeatures.h"
+#include "RenderStats.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// The element array binding is VAO state, so the bind-based uploads go
+// through GL_COPY_WRITE_BUFFER to avoid clobbering whichever VAO is current
+unsigned int createStaticBuffer(const void* data, size_t size) {
+    unsigned int buffer;
+    countUpload(size);
+    if (gpuFeatures().directStateAccess) {
+        glCreateBuffers(1, &buffer);
+        glNamedBufferData(buffer, size, data, GL_STATIC_DRAW);
+        return buffer;
+    }
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return buffer;
+}
+
+} // namespace
+
+VertexBuffer::VertexBuffer(const void* data, size_t size) : ID(createStaticBuffer(data, size)) {}
+
+VertexBuffer::~VertexBuffer() {
+    glDeleteBuffers(1, &ID);
+}
+
+IndexBuffer::IndexBuffer(const void* data, size_t size) : ID(createStaticBuffer(data, size)) {}
+
+IndexBuffer::~IndexBuffer() {
+    glDeleteBuffers(1, &ID);
+}
+
+VertexArray::VertexArray() {
+    if (gpuFeatures().directStateAccess) {
+        glCreateVertexArrays(1, &ID);
+    } else {
+        glGenVertexArrays(1, &ID);
+    }
+}
+
+VertexArray::~VertexArray() {
+    glDeleteVertexArrays(1, &ID);
+}
+
+void VertexArray::setFormat(const VertexLayout& layout, uint32_t binding, uint32_t divisor) {
+    bool replaced = false;
+    for (Binding& existing : bindings) {
+        if (existing.index == binding) {
+            existing = {binding, layout, divisor};
+            replaced = true;
+        }
+    }
+    if (!replaced) {
+        bindings.push_back({binding, layout, divisor});
+    }
+    if (!gpuFeatures().directStateAccess) {
+        // Attribute pointers capture the buffer; they are set along with it
+        return;
+    }
+    for (const VertexAttribute& attribute : layout.attributes()) {
+        VertexFormatInfo info = vertexFormatInfo(attribute.format);
+        glVertexArrayAttribFormat(ID, attribute.location, info.components, info.type, info.normalized,
+                                  attribute.offset);
+        glVertexArrayAttribBinding(ID, attribute.location, binding);
+        glEnableVertexArrayAttrib(ID, attribute.location);
+    }
+    glVertexArrayBindingDivisor(ID, binding, divisor);
+}
+
+void VertexArray::setVertexBuffer(unsigned int buffer, uint32_t index, size_t offset) {
+    const Binding& format = binding(index);
+    if (gpuFeatures().directStateAccess) {
+        glVertexArrayVertexBuffer(ID, index, buffer, GLintptr(offset), GLsizei(format.layout.stride()));
+        return;
+    }
+    bind();
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (const VertexAttribute& attribute : format.layout.attributes()) {
+        VertexFormatInfo info = vertexFormatInfo(attribute.format);
+        glVertexAttribPointer(attribute.location, info.components, info.type, info.normalized,
+                              format.layout.stride(),
+                              reinterpret_cast<void*>(static_cast<uintptr_t>(offset + attribute.offset)));
+        glVertexAttribDivisor(attribute.location, format.divisor);
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    unbind();
+}
+
+void VertexArray::setIndexBuffer(unsigned int buffer) {
+    if (gpuFeatures().directStateAccess) {
+        glVertexArrayElementBuffer(ID, buffer);
+        return;
+    }
+    bind();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    unbind();
+}
+
+const VertexArray::Binding& VertexArray::binding(uint32_t index) const {
+    for (const Binding& existing : bindings) {
+        if (existing.index == index) {
+            return existing;
+        }
+    }
+    throw std::logic_error("Vertex buffer binding " + std::to_string(index) + " has no format");
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderStats.h"
+#include "VertexLayout.h"
+
+// VBO and IBO wrappers. With direct state access (see GpuFeatures) every
+// method edits the object by name; otherwise it is bound to a target that
+// no VAO records.
+class VertexBuffer {
+public:
+    unsigned int ID;
+
+    VertexBuffer(const void* data, size_t size);
+    ~VertexBuffer();
+
+    VertexBuffer(const VertexBuffer&) = delete;
+    VertexBuffer& operator=(const VertexBuffer&) = delete;
+
+    void bind() const {
+        glBindBuffer(GL_ARRAY_BUFFER, ID);
+    }
+
+    void unbind() const {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+class IndexBuffer {
+public:
+    unsigned int ID;
+
+    IndexBuffer(const void* data, size_t size);
+    ~IndexBuffer();
+
+    IndexBuffer(const IndexBuffer&) = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+    // Records this buffer in the currently bound VAO; prefer
+    // VertexArray::setIndexBuffer.
+    void bind() const {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+    }
+};
+
+// VAO wrapper. The vertex format (which attributes, how they are encoded)
+// is set apart from the buffers feeding it: setFormat() ties a VertexLayout
+// to a numbered buffer binding, and setVertexBuffer() points that binding
+// at a buffer. Swapping buffers is then one cheap call, so meshes sharing a
+// layout can share a VAO instead of each switching to its own.
+//
+// With direct state access this maps onto glVertexArrayAttribFormat and
+// glVertexArrayVertexBuffer and nothing is bound. Without it, the VAO is
+// bound and setVertexBuffer() re-specifies the binding's attribute
+// pointers.
+class VertexArray {
+public:
+    unsigned int ID;
+
+    VertexArray();
+    ~VertexArray();
+
+    VertexArray(const VertexArray&) = delete;
+    VertexArray& operator=(const VertexArray&) = delete;
+
+    void bind() const {
+        glBindVertexArray(ID);
+        countStateChange();
+    }
+
+    void unbind() const {
+        glBindVertexArray(0);
+    }
+
+    // Sources the layout's attributes from buffer binding `binding`. A
+    // divisor of 1 makes them per-instance data, advancing once per
+    // instance instead of once per vertex.
+    void setFormat(const VertexLayout& layout, uint32_t binding = 0, uint32_t divisor = 0);
+    // Feeds binding `binding`, set up by setFormat(), from `buffer`, with
+    // the first vertex `offset` bytes in.
+    void setVertexBuffer(unsigned int buffer, uint32_t binding = 0, size_t offset = 0);
+    void setIndexBuffer(unsigned int buffer);
+    void setIndexBuffer(const IndexBuffer& buffer) { setIndexBuffer(buffer.ID); }
+
+    // setFormat() and setVertexBuffer() on binding 0.
+    void setLayout(const VertexBuffer& buffer, const VertexLayout& layout) {
+        setFormat(layout);
+        setVertexBuffer(buffer.ID);
+    }
+
+private:
+    struct Binding {
+        uint32_t index;
+        VertexLayout layout;
+        uint32_t divisor;
+    };
+
+    const Binding& binding(uint32_t index) const;
+
+    std::vector<Binding> bindings;
+};
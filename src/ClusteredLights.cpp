@@ -0,0 +1,279 @@
+#include "ClusteredLights.h"
+#include "GlDebug.h"
+#include "GpuFeatures.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLUSTERS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Texel formats of the three buffers, in the order of ClusteredLights::buffers
+constexpr GLenum BUFFER_FORMATS[3] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+constexpr const char* BUFFER_LABELS[3] = {"Cluster lights", "Cluster light grid", "Cluster light indices"};
+constexpr const char* SAMPLER_NAMES[3] = {"clusterLights", "clusterLightGrid", "clusterLightIndices"};
+
+constexpr uint32_t clusterIndex(uint32_t x, uint32_t y, uint32_t slice) {
+    return (slice * ClusteredLights::TILES_Y + y) * ClusteredLights::TILES_X + x;
+}
+
+static_assert(ClusteredLights::TILES_X % 4 == 0, "Rows of clusters are tested four at a time");
+static_assert(ClusteredLights::CLUSTER_COUNT <= 1 << 16, "Cluster numbers are packed into 16 bits");
+
+// View-space x or y of normalized device coordinate `ndc` at `depth` in
+// front of the camera, for the projection's scale and offset along it
+float unproject(float ndc, float depth, float scale, float offset) {
+    return depth * (ndc + offset) / scale;
+}
+
+uint32_t tileOf(float ndc, uint32_t tiles) {
+    float tile = std::floor((ndc * 0.5f + 0.5f) * float(tiles));
+    return uint32_t(std::clamp(tile, 0.0f, float(tiles - 1)));
+}
+
+void upload(unsigned int buffer, const void* data, size_t size, size_t capacity) {
+    if (size == 0) {
+        return;
+    }
+    // Orphaning first lets the driver hand out fresh memory while the GPU
+    // still reads last frame's
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    countUpload(size);
+}
+
+} // namespace
+
+ClusteredLights::ClusteredLights(uint32_t maxLights, uint32_t maxIndices)
+    : maxLights(maxLights), maxIndices(maxIndices) {
+    if (maxLights == 0 || maxLights > 1 << 16) {
+        throw std::invalid_argument("ClusteredLights supports 1 to 65536 lights");
+    }
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    size_t capacities[3] = {size_t(maxLights) * 2 * sizeof(glm::vec4), CLUSTER_COUNT * 2 * sizeof(uint32_t),
+                            size_t(maxIndices) * sizeof(uint16_t)};
+    for (int i = 0; i < 3; ++i) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, capacities[i], nullptr, GL_STREAM_DRAW);
+        labelGlObject(GL_BUFFER, buffers[i], BUFFER_LABELS[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, BUFFER_FORMATS[i], buffers[i]);
+        labelGlObject(GL_TEXTURE, textures[i], BUFFER_LABELS[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    grid.resize(CLUSTER_COUNT * 2);
+}
+
+ClusteredLights::~ClusteredLights() {
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+size_t ClusteredLights::capacityBytes() const {
+    return size_t(maxLights) * 2 * sizeof(glm::vec4) + CLUSTER_COUNT * 2 * sizeof(uint32_t) +
+           size_t(maxIndices) * sizeof(uint16_t);
+}
+
+// Each cluster's box is the bounds of its tile's corners on the slice's
+// near and far planes
+void ClusteredLights::buildBounds(const glm::mat4& projection, float nearPlane, float farPlane) {
+    boundsProjection = projection;
+    clusterNear = nearPlane;
+    clusterFar = farPlane;
+    float logRatio = std::log(farPlane / nearPlane);
+    sliceScale = float(SLICES) / logRatio;
+    sliceBias = -float(SLICES) * std::log(nearPlane) / logRatio;
+
+    for (std::vector<float>* v : {&bounds.minX, &bounds.minY, &bounds.minZ, &bounds.maxX, &bounds.maxY, &bounds.maxZ}) {
+        v->resize(CLUSTER_COUNT);
+    }
+    for (uint32_t slice = 0; slice < SLICES; ++slice) {
+        float depths[2] = {nearPlane * std::pow(farPlane / nearPlane, float(slice) / SLICES),
+                           nearPlane * std::pow(farPlane / nearPlane, float(slice + 1) / SLICES)};
+        for (uint32_t y = 0; y < TILES_Y; ++y) {
+            float ndcY[2] = {-1.0f + 2.0f * y / TILES_Y, -1.0f + 2.0f * (y + 1) / TILES_Y};
+            for (uint32_t x = 0; x < TILES_X; ++x) {
+                float ndcX[2] = {-1.0f + 2.0f * x / TILES_X, -1.0f + 2.0f * (x + 1) / TILES_X};
+                glm::vec3 lo(INFINITY), hi(-INFINITY);
+                for (float depth : depths) {
+                    for (float cornerX : ndcX) {
+                        for (float cornerY : ndcY) {
+                            glm::vec3 corner(unproject(cornerX, depth, projection[0][0], projection[2][0]),
+                                             unproject(cornerY, depth, projection[1][1], projection[2][1]), -depth);
+                            lo = glm::min(lo, corner);
+                            hi = glm::max(hi, corner);
+                        }
+                    }
+                }
+                uint32_t c = clusterIndex(x, y, slice);
+                bounds.minX[c] = lo.x;
+                bounds.minY[c] = lo.y;
+                bounds.minZ[c] = lo.z;
+                bounds.maxX[c] = hi.x;
+                bounds.maxY[c] = hi.y;
+                bounds.maxZ[c] = hi.z;
+            }
+        }
+    }
+}
+
+void ClusteredLights::update(const std::vector<PointLight>& lights, const glm::mat4& view,
+                             const glm::mat4& projection, float nearPlane, float farPlane) {
+    if (projection != boundsProjection || nearPlane != clusterNear || farPlane != clusterFar) {
+        buildBounds(projection, nearPlane, farPlane);
+    }
+    lastStats = ClusterStats();
+    lastStats.lights = uint32_t(lights.size());
+    pairs.clear();
+    gpuLights.clear();
+
+    for (const PointLight& light : lights) {
+        if (gpuLights.size() / 2 >= maxLights) {
+            break;
+        }
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        size_t pairsBefore = pairs.size();
+        assign(center, light.radius, uint32_t(gpuLights.size() / 2));
+        if (pairs.size() > pairsBefore) {
+            gpuLights.push_back(glm::vec4(light.position, light.radius));
+            gpuLights.push_back(glm::vec4(light.color * light.intensity, 0.0f));
+        }
+    }
+    lastStats.visibleLights = uint32_t(gpuLights.size() / 2);
+
+    // Counting sort of the pairs by cluster
+    std::fill(grid.begin(), grid.end(), 0u);
+    for (uint32_t pair : pairs) {
+        grid[(pair >> 16) * 2 + 1]++;
+    }
+    uint32_t offset = 0;
+    for (uint32_t c = 0; c < CLUSTER_COUNT; ++c) {
+        grid[c * 2] = offset;
+        offset += grid[c * 2 + 1];
+        lastStats.maxPerCluster = std::max(lastStats.maxPerCluster, grid[c * 2 + 1]);
+        grid[c * 2 + 1] = 0;
+    }
+    indices.resize(pairs.size());
+    for (uint32_t pair : pairs) {
+        uint32_t* cell = &grid[(pair >> 16) * 2];
+        indices[cell[0] + cell[1]++] = uint16_t(pair & 0xffff);
+    }
+    lastStats.indices = uint32_t(indices.size());
+    lastStats.bytes = gpuLights.size() * sizeof(glm::vec4) + grid.size() * sizeof(uint32_t) +
+                      indices.size() * sizeof(uint16_t);
+
+    upload(buffers[0], gpuLights.data(), gpuLights.size() * sizeof(glm::vec4),
+           size_t(maxLights) * 2 * sizeof(glm::vec4));
+    upload(buffers[1], grid.data(), grid.size() * sizeof(uint32_t), grid.size() * sizeof(uint32_t));
+    upload(buffers[2], indices.data(), indices.size() * sizeof(uint16_t), size_t(maxIndices) * sizeof(uint16_t));
+}
+
+// Adds a pair for every cluster the sphere touches, within the tiles and
+// slices its view-space bounding box projects to
+void ClusteredLights::assign(const glm::vec3& center, float radius, uint32_t light) {
+    float nearDepth = -center.z - radius;
+    float farDepth = -center.z + radius;
+    if (farDepth < clusterNear || nearDepth > clusterFar) {
+        return;
+    }
+    // x / depth peaks at a corner of the box's x-z rectangle, as does
+    // y / depth in y-z; depths behind the near plane are clamped to it
+    const glm::mat4& p = boundsProjection;
+    float depths[2] = {std::max(nearDepth, clusterNear), std::max(farDepth, clusterNear)};
+    float ndcMin[2] = {INFINITY, INFINITY}, ndcMax[2] = {-INFINITY, -INFINITY};
+    for (float depth : depths) {
+        for (float side : {-radius, radius}) {
+            float ndcX = (p[0][0] * (center.x + side) - p[2][0] * depth) / depth;
+            float ndcY = (p[1][1] * (center.y + side) - p[2][1] * depth) / depth;
+            ndcMin[0] = std::min(ndcMin[0], ndcX);
+            ndcMax[0] = std::max(ndcMax[0], ndcX);
+            ndcMin[1] = std::min(ndcMin[1], ndcY);
+            ndcMax[1] = std::max(ndcMax[1], ndcY);
+        }
+    }
+    if (ndcMax[0] < -1.0f || ndcMin[0] > 1.0f || ndcMax[1] < -1.0f || ndcMin[1] > 1.0f) {
+        return;
+    }
+    uint32_t x0 = tileOf(ndcMin[0], TILES_X), x1 = tileOf(ndcMax[0], TILES_X);
+    uint32_t y0 = tileOf(ndcMin[1], TILES_Y), y1 = tileOf(ndcMax[1], TILES_Y);
+    auto sliceOf = [this](float depth) {
+        float slice = std::floor(std::log(std::max(depth, clusterNear)) * sliceScale + sliceBias);
+        return uint32_t(std::clamp(slice, 0.0f, float(SLICES - 1)));
+    };
+    uint32_t s0 = sliceOf(nearDepth), s1 = sliceOf(farDepth);
+
+    float radius2 = radius * radius;
+    for (uint32_t slice = s0; slice <= s1; ++slice) {
+        for (uint32_t y = y0; y <= y1; ++y) {
+            uint32_t row = clusterIndex(0, y, slice);
+#ifdef CLUSTERS_SSE2
+            // Squared distance from the center to four boxes at once
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+            const __m128 r2 = _mm_set1_ps(radius2);
+            for (uint32_t x = x0 & ~3u; x <= x1; x += 4) {
+                uint32_t c = row + x;
+                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minX[c]), cx),
+                                                  _mm_sub_ps(cx, _mm_loadu_ps(&bounds.maxX[c]))),
+                                       zero);
+                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minY[c]), cy),
+                                                  _mm_sub_ps(cy, _mm_loadu_ps(&bounds.maxY[c]))),
+                                       zero);
+                __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minZ[c]), cz),
+                                                  _mm_sub_ps(cz, _mm_loadu_ps(&bounds.maxZ[c]))),
+                                       zero);
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                int hits = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+                for (uint32_t i = 0; i < 4; ++i) {
+                    if ((hits >> i & 1) && x + i >= x0 && x + i <= x1) {
+                        if (pairs.size() >= maxIndices) {
+                            lastStats.droppedIndices++;
+                            continue;
+                        }
+                        pairs.push_back((c + i) << 16 | light);
+                    }
+                }
+            }
+#else
+            for (uint32_t x = x0; x <= x1; ++x) {
+                uint32_t c = row + x;
+                float dx = std::max({bounds.minX[c] - center.x, center.x - bounds.maxX[c], 0.0f});
+                float dy = std::max({bounds.minY[c] - center.y, center.y - bounds.maxY[c], 0.0f});
+                float dz = std::max({bounds.minZ[c] - center.z, center.z - bounds.maxZ[c], 0.0f});
+                if (dx * dx + dy * dy + dz * dz <= radius2) {
+                    if (pairs.size() >= maxIndices) {
+                        lastStats.droppedIndices++;
+                        continue;
+                    }
+                    pairs.push_back(c << 16 | light);
+                }
+            }
+#endif
+        }
+    }
+}
+
+void ClusteredLights::bind(const Shader& shader, uint32_t firstUnit, const glm::vec2& viewportSize) const {
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (gpuFeatures().directStateAccess) {
+            glBindTextureUnit(firstUnit + i, textures[i]);
+        } else {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        }
+        shader.setInt(SAMPLER_NAMES[i], int(firstUnit + i));
+    }
+    countStateChange(3);
+    shader.setVec2("clusterTileScale", glm::vec2(TILES_X, TILES_Y) / viewportSize);
+    shader.setVec2("clusterSliceScaleBias", glm::vec2(sliceScale, sliceBias));
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A point light, in world space. It reaches no further than `radius`.
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float intensity;
+};
+
+// What the last ClusteredLights::update() produced.
+struct ClusterStats {
+    uint32_t lights = 0;            // Given
+    uint32_t visibleLights = 0;     // Touching at least one cluster
+    uint32_t indices = 0;           // Light references over all clusters
+    uint32_t droppedIndices = 0;    // Past the index capacity, so unlit
+    uint32_t maxPerCluster = 0;
+    size_t bytes = 0;               // Uploaded
+};
+
+// Clustered forward shading: the view frustum is cut into TILES_X x TILES_Y
+// screen tiles and SLICES depth slices, spaced exponentially so clusters
+// stay roughly cubic, and each cluster gets the list of lights whose sphere
+// touches it. A fragment then only loops over its own cluster's lights, so
+// its cost follows the lights near it, not the lights in the scene.
+//
+// Assignment runs on the CPU each update(): a light's sphere is projected
+// to a conservative range of tiles and slices, and the clusters in it are
+// tested against the sphere four at a time with SSE. The result is three
+// buffer textures, rewritten every frame:
+//   clusterLights        RGBA32F, two texels per visible light: world
+//                        position and radius, then color times intensity
+//   clusterLightGrid     RG32UI per cluster: first index and count
+//   clusterLightIndices  R16UI light numbers, grouped by cluster
+// Fragment shaders read them as res/shaders/indirect_fragment_shader.glsl
+// does, with the same grid size.
+//
+// Buffer textures are core since GL 3.1, so this works wherever the rest of
+// the renderer does.
+class ClusteredLights {
+public:
+    static constexpr uint32_t TILES_X = 16;
+    static constexpr uint32_t TILES_Y = 9;
+    static constexpr uint32_t SLICES = 24;
+    static constexpr uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+    // Up to `maxLights` visible lights (at most 65536, as indices are 16-bit)
+    // and `maxIndices` light references per frame.
+    explicit ClusteredLights(uint32_t maxLights = 4096, uint32_t maxIndices = 1 << 18);
+    ~ClusteredLights();
+
+    ClusteredLights(const ClusteredLights&) = delete;
+    ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+    // Assigns `lights` to the clusters of the frustum of `view` and
+    // `projection`, a perspective projection, between `nearPlane` and
+    // `farPlane`, and uploads the result. Lights past `maxLights` visible
+    // ones are ignored.
+    void update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+                float nearPlane, float farPlane);
+
+    // Binds the buffer textures to units firstUnit to firstUnit + 2 and sets
+    // the shader's cluster uniforms for a viewport of `viewportSize` pixels.
+    // `shader` must be in use.
+    void bind(const Shader& shader, uint32_t firstUnit, const glm::vec2& viewportSize) const;
+
+    const ClusterStats& stats() const { return lastStats; }
+    // GPU memory of the three buffers
+    size_t capacityBytes() const;
+
+private:
+    // View-space cluster bounds, one array per coordinate so a row of
+    // clusters along x loads as vectors
+    struct ClusterBounds {
+        std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    };
+
+    void buildBounds(const glm::mat4& projection, float nearPlane, float farPlane);
+    void assign(const glm::vec3& center, float radius, uint32_t light);
+
+    uint32_t maxLights;
+    uint32_t maxIndices;
+    unsigned int buffers[3] = {};
+    unsigned int textures[3] = {};
+
+    ClusterBounds bounds;
+    glm::mat4 boundsProjection = glm::mat4(0.0f);
+    float clusterNear = 0.0f;
+    float clusterFar = 0.0f;
+    float sliceScale = 0.0f;        // slice = log(depth) * sliceScale + sliceBias
+    float sliceBias = 0.0f;
+
+    // Scratch, kept between updates
+    std::vector<uint32_t> pairs;        // cluster << 16 | light
+    std::vector<uint32_t> grid;         // Offset and count per cluster
+    std::vector<uint16_t> indices;
+    std::vector<glm::vec4> gpuLights;
+    ClusterStats lastStats;
+};
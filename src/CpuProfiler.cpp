@@ -0,0 +1,342 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+#endif
+
+namespace {
+
+constexpr int STREAM_INTERVAL_MS = 50;
+
+#ifdef _WIN32
+constexpr int SEND_FLAGS = 0;
+
+void closeSocket(SocketHandle socket) {
+    closesocket(socket);
+}
+#else
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;    // A closed client must not raise SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+void closeSocket(SocketHandle socket) {
+    close(socket);
+}
+#endif
+
+// Fields are atomic so the exporting thread may read a slot the owner is
+// rewriting; readZones() then throws the torn copy away
+struct Zone {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> end{0};
+};
+
+struct ZoneCopy {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct ThreadRing {
+    Zone zones[CPU_PROFILER_RING_SIZE];
+    std::atomic<uint64_t> head{0};  // Zones ever recorded; the next one goes to head % size
+    uint32_t id = 0;
+    std::string name;               // Guarded by the registry mutex
+    uint64_t streamed = 0;          // ProfilerStream's cursor
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Ticks and traceClock() read together once, at the first zone
+struct ClockOrigin {
+    uint64_t ticks;
+    double clock;
+};
+
+const ClockOrigin& clockOrigin() {
+    static const ClockOrigin origin = {cpuProfilerTicks(), traceClock()};
+    return origin;
+}
+
+// Maps ticks linearly between the origin and now, which also calibrates
+// the unknown rdtsc frequency
+struct TickConversion {
+    uint64_t originTicks;
+    double originClock;
+    double microsecondsPerTick;
+
+    TickConversion() {
+        const ClockOrigin& origin = clockOrigin();
+        uint64_t ticks = cpuProfilerTicks();
+        double clock = traceClock();
+        originTicks = origin.ticks;
+        originClock = origin.clock;
+        microsecondsPerTick = ticks > origin.ticks ? (clock - origin.clock) / double(ticks - origin.ticks) : 0.0;
+    }
+
+    double operator()(uint64_t ticks) const {
+        return originClock + (double(int64_t(ticks - originTicks)) * microsecondsPerTick);
+    }
+};
+
+#ifdef PROFILER_ENABLED
+// The calling thread's ring, registered on first use
+ThreadRing& threadRing() {
+    thread_local std::shared_ptr<ThreadRing> ring = [] {
+        clockOrigin();
+        auto created = std::make_shared<ThreadRing>();
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        created->id = uint32_t(r.rings.size());
+        r.rings.push_back(created);
+        return created;
+    }();
+    return *ring;
+}
+#endif
+
+std::vector<std::shared_ptr<ThreadRing>> allRings() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.rings;
+}
+
+std::string trackName(const ThreadRing& ring) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    return ring.name.empty() ? "Thread " + std::to_string(ring.id) : ring.name;
+}
+
+// Copies the zones recorded since index `from`, or as many of them as the
+// ring still holds, and returns the index to continue from
+uint64_t readZones(const ThreadRing& ring, uint64_t from, std::vector<ZoneCopy>& zones) {
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t first = std::max(from, head > CPU_PROFILER_RING_SIZE ? head - CPU_PROFILER_RING_SIZE : 0);
+    size_t base = zones.size();
+    for (uint64_t i = first; i < head; ++i) {
+        const Zone& zone = ring.zones[i % CPU_PROFILER_RING_SIZE];
+        zones.push_back({zone.name.load(std::memory_order_relaxed), zone.start.load(std::memory_order_relaxed),
+                         zone.end.load(std::memory_order_relaxed)});
+    }
+    // The owner may have lapped us meanwhile, and may be rewriting the slot
+    // after its newest zone: drop whatever could be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = ring.head.load(std::memory_order_relaxed);
+    uint64_t safe = after + 1 > CPU_PROFILER_RING_SIZE ? after + 1 - CPU_PROFILER_RING_SIZE : 0;
+    if (safe > first) {
+        size_t torn = size_t(std::min(safe, head) - first);
+        zones.erase(zones.begin() + base, zones.begin() + base + torn);
+    }
+    return head;
+}
+
+bool sendAll(SocketHandle socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int result = int(send(socket, data.data() + sent, int(data.size() - sent), SEND_FLAGS));
+        if (result <= 0) {
+            return false;
+        }
+        sent += size_t(result);
+    }
+    return true;
+}
+
+// Waits up to `milliseconds` for `socket` to become readable
+bool readable(SocketHandle socket, int milliseconds) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(socket, &set);
+    timeval timeout = {milliseconds / 1000, (milliseconds % 1000) * 1000};
+    return select(int(socket + 1), &set, nullptr, nullptr, &timeout) > 0;
+}
+
+} // namespace
+
+void recordCpuZone(const char* name, uint64_t start, uint64_t end) {
+#ifdef PROFILER_ENABLED
+    ThreadRing& ring = threadRing();
+    uint64_t index = ring.head.load(std::memory_order_relaxed);
+    // Pairs with the fence in readZones(): a reader that sees any of these
+    // stores also sees that `index` was reached
+    std::atomic_thread_fence(std::memory_order_release);
+    Zone& zone = ring.zones[index % CPU_PROFILER_RING_SIZE];
+    zone.name.store(name, std::memory_order_relaxed);
+    zone.start.store(start, std::memory_order_relaxed);
+    zone.end.store(end, std::memory_order_relaxed);
+    ring.head.store(index + 1, std::memory_order_release);
+#else
+    (void)name;
+    (void)start;
+    (void)end;
+#endif
+}
+
+void setProfilerThreadName(const char* name) {
+#ifdef PROFILER_ENABLED
+    ThreadRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    ring.name = name;
+#else
+    (void)name;
+#endif
+}
+
+double cpuTicksToTraceClock(uint64_t ticks) {
+    return TickConversion()(ticks);
+}
+
+void appendCpuTrace(std::vector<TraceEvent>& events) {
+    TickConversion toClock;
+    std::vector<ZoneCopy> zones;
+    for (const std::shared_ptr<ThreadRing>& ring : allRings()) {
+        zones.clear();
+        readZones(*ring, 0, zones);
+        std::string track = trackName(*ring);
+        for (const ZoneCopy& zone : zones) {
+            double start = toClock(zone.start);
+            events.push_back({zone.name, track, start, toClock(zone.end) - start});
+        }
+    }
+}
+
+uint64_t readCpuZones(uint64_t from, std::vector<CpuZoneSample>& zones) {
+#ifdef PROFILER_ENABLED
+    thread_local std::vector<ZoneCopy> copies;
+    copies.clear();
+    uint64_t next = readZones(threadRing(), from, copies);
+    TickConversion toClock;
+    for (const ZoneCopy& zone : copies) {
+        double start = toClock(zone.start);
+        zones.push_back({zone.name, start, toClock(zone.end) - start});
+    }
+    return next;
+#else
+    (void)zones;
+    return from;
+#endif
+}
+
+ProfilerStream::~ProfilerStream() {
+    stop();
+}
+
+bool ProfilerStream::start(uint16_t port) {
+#ifdef PROFILER_ENABLED
+    if (running) {
+        return true;
+    }
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        return false;
+    }
+#endif
+    SocketHandle socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int reuse = 1;
+    setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(socket, 1) != 0) {
+        closeSocket(socket);
+        return false;
+    }
+    listener = intptr_t(socket);
+    running = true;
+    thread = std::thread(&ProfilerStream::run, this);
+    return true;
+#else
+    (void)port;
+    return false;
+#endif
+}
+
+void ProfilerStream::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    thread.join();
+    closeSocket(SocketHandle(listener));
+    listener = -1;
+}
+
+void ProfilerStream::run() {
+    setProfilerThreadName("Profiler stream");
+    SocketHandle listenSocket = SocketHandle(listener);
+    SocketHandle client = SocketHandle(-1);
+    bool connected = false;
+    std::vector<ZoneCopy> zones;
+    while (running) {
+        if (!connected) {
+            if (!readable(listenSocket, STREAM_INTERVAL_MS)) {
+                continue;
+            }
+            client = accept(listenSocket, nullptr, nullptr);
+            connected = client != SocketHandle(-1);
+            // A new client only gets zones from now on, after the row names
+            std::string names;
+            for (const std::shared_ptr<ThreadRing>& ring : allRings()) {
+                ring->streamed = ring->head.load(std::memory_order_acquire);
+                names += "{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(ring->id) +
+                         ",\"name\":\"thread_name\",\"args\":{\"name\":\"" + trackName(*ring) + "\"}}\n";
+            }
+            if (connected && !sendAll(client, names)) {
+                closeSocket(client);
+                connected = false;
+            }
+            continue;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(STREAM_INTERVAL_MS));
+        TickConversion toClock;
+        std::string lines;
+        for (const std::shared_ptr<ThreadRing>& ring : allRings()) {
+            zones.clear();
+            ring->streamed = readZones(*ring, ring->streamed, zones);
+            for (const ZoneCopy& zone : zones) {
+                double start = toClock(zone.start);
+                char line[256];
+                std::snprintf(line, sizeof(line),
+                              "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f}\n", ring->id,
+                              zone.name, start, toClock(zone.end) - start);
+                lines += line;
+            }
+        }
+        if (!lines.empty() && !sendAll(client, lines)) {
+            closeSocket(client);
+            connected = false;
+        }
+    }
+    if (connected) {
+        closeSocket(client);
+    }
+}
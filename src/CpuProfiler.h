@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Trace.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Cheap CPU zones for finding where frame time goes:
+//
+//   void cull() {
+//       PROFILE_SCOPE("Cull");
+//       ...
+//   }
+//
+// A zone costs two timestamp reads (rdtsc on x86) and three relaxed stores
+// into a ring buffer owned by the calling thread, so there are no locks or
+// allocations on the hot path. Each thread keeps its last
+// CPU_PROFILER_RING_SIZE zones; older ones are overwritten. Names must be
+// string literals or otherwise outlive the profiler.
+//
+// Building with PROFILER_DISABLED (shipping builds) compiles every
+// PROFILE_SCOPE out. The functions below still exist but record nothing.
+#ifndef PROFILER_DISABLED
+#define PROFILER_ENABLED
+#endif
+
+constexpr uint32_t CPU_PROFILER_RING_SIZE = 1 << 14;
+
+// Timestamp in profiler ticks; see cpuTicksToTraceClock().
+inline uint64_t cpuProfilerTicks();
+// Records a finished zone for the calling thread.
+void recordCpuZone(const char* name, uint64_t start, uint64_t end);
+// Names the calling thread's row in traces, "Thread N" otherwise.
+void setProfilerThreadName(const char* name);
+// Converts ticks to traceClock() microseconds.
+double cpuTicksToTraceClock(uint64_t ticks);
+
+// Appends every thread's recorded zones, one track per thread.
+void appendCpuTrace(std::vector<TraceEvent>& events);
+
+// One zone of the calling thread, in traceClock() microseconds.
+struct CpuZoneSample {
+    const char* name;
+    double start;
+    double duration;
+};
+
+// Appends the calling thread's zones recorded since index `from`, or as
+// many of them as its ring still holds, in order of completion. Returns
+// the index to continue from; start at 0.
+uint64_t readCpuZones(uint64_t from, std::vector<CpuZoneSample>& zones);
+
+class CpuProfileScope {
+public:
+    explicit CpuProfileScope(const char* name) : name(name), start(cpuProfilerTicks()) {}
+    ~CpuProfileScope() { recordCpuZone(name, start, cpuProfilerTicks()); }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef PROFILER_ENABLED
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+// Live view of the zones: listens on a local TCP port and sends every new
+// zone to the connected client as one Chrome trace event per line, e.g.
+//   {"ph":"X","pid":1,"tid":0,"name":"Cull","ts":1523.125,"dur":84.250}
+// Zones a slow client misses are overwritten and lost, never queued.
+class ProfilerStream {
+public:
+    ProfilerStream() = default;
+    ~ProfilerStream();
+
+    ProfilerStream(const ProfilerStream&) = delete;
+    ProfilerStream& operator=(const ProfilerStream&) = delete;
+
+    // Listens on 127.0.0.1:`port` on a thread of its own. Returns false if
+    // the port can't be opened or profiling is compiled out.
+    bool start(uint16_t port);
+    void stop();
+
+private:
+    void run();
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    intptr_t listener = -1;
+};
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+inline uint64_t cpuProfilerTicks() {
+    return __rdtsc();
+}
+#else
+#include <chrono>
+inline uint64_t cpuProfilerTicks() {
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+#endif
@@ -0,0 +1,66 @@
+#include "DeferredShading.h"
+#include "ClusteredLights.h"
+#include "GpuFeatures.h"
+#include "RenderStats.h"
+
+namespace {
+
+constexpr const char* LIGHTING_VERTEX_SHADER_PATH = "res/shaders/deferred_lighting_vertex_shader.glsl";
+constexpr const char* LIGHTING_FRAGMENT_SHADER_PATH = "res/shaders/deferred_lighting_fragment_shader.glsl";
+// The cluster buffers follow the G-buffer's three textures
+constexpr uint32_t CLUSTER_TEXTURE_UNIT = 3;
+
+void bindTexture2D(unsigned int texture, uint32_t unit) {
+    if (gpuFeatures().directStateAccess) {
+        glBindTextureUnit(unit, texture);
+    } else {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+} // namespace
+
+DeferredShading::DeferredShading() : lightingShader(LIGHTING_VERTEX_SHADER_PATH, LIGHTING_FRAGMENT_SHADER_PATH) {
+    glGenVertexArrays(1, &vao);
+}
+
+DeferredShading::~DeferredShading() {
+    glDeleteVertexArrays(1, &vao);
+}
+
+void DeferredShading::light(const GBufferTextures& gbuffer, const ClusteredLights& lights, const glm::mat4& view,
+                            const glm::mat4& projection, const glm::vec2& viewportSize,
+                            const DeferredLightingSettings& settings) const {
+    lightingShader.use();
+    bindTexture2D(gbuffer.albedo, 0);
+    bindTexture2D(gbuffer.normal, 1);
+    bindTexture2D(gbuffer.depth, 2);
+    countStateChange(3);
+    lightingShader.setInt("gbufferAlbedo", 0);
+    lightingShader.setInt("gbufferNormal", 1);
+    lightingShader.setInt("gbufferDepth", 2);
+    lights.bind(lightingShader, CLUSTER_TEXTURE_UNIT, viewportSize);
+
+    lightingShader.setMat4("inverseViewProjection", glm::inverse(projection * view));
+    lightingShader.setMat4("view", view);
+    lightingShader.setVec3("cameraPosition", glm::vec3(glm::inverse(view)[3]));
+    lightingShader.setVec2("viewportSize", viewportSize);
+    lightingShader.setFloat("ambient", settings.ambient);
+    lightingShader.setFloat("sunIntensity", settings.sunIntensity);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(vao);
+    countStateChange();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    countDraw(1);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    // The G-buffer is usually transient; leave nothing sampling it once its
+    // textures go back to a pool
+    for (uint32_t unit = 0; unit < 3; ++unit) {
+        bindTexture2D(0, unit);
+    }
+    countStateChange(3);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class ClusteredLights;
+
+// The textures of a filled G-buffer.
+struct GBufferTextures {
+    unsigned int albedo;    // DeferredShading::ALBEDO_FORMAT
+    unsigned int normal;    // DeferredShading::NORMAL_FORMAT
+    unsigned int depth;     // Any depth format
+};
+
+struct DeferredLightingSettings {
+    float ambient = 0.1f;           // Times albedo, everywhere
+    float sunIntensity = 0.2f;      // Of the fixed directional light
+};
+
+// Deferred shading over a thin G-buffer, for scenes whose overdraw makes
+// lighting every forward fragment too expensive. Geometry passes write
+// 8 bytes per pixel besides depth:
+//   ALBEDO_FORMAT   albedo, metalness
+//   NORMAL_FORMAT   octahedral normal (10 bits per axis), roughness
+// as res/shaders/indirect_gbuffer_fragment_shader.glsl does. light() then
+// shades every covered pixel once, in a full-screen pass that rebuilds the
+// position from depth and loops over the pixel's cluster of a
+// ClusteredLights, i.e. tiled light accumulation on the same light lists
+// and with the same lighting as the clustered forward path. Pixels left at
+// the far plane are discarded, so the target's clear shows through.
+class DeferredShading {
+public:
+    static constexpr GLenum ALBEDO_FORMAT = GL_RGBA8;
+    static constexpr GLenum NORMAL_FORMAT = GL_RGB10_A2;
+
+    DeferredShading();
+    ~DeferredShading();
+
+    DeferredShading(const DeferredShading&) = delete;
+    DeferredShading& operator=(const DeferredShading&) = delete;
+
+    // Lights `gbuffer`, drawn with `view` and `projection`, into the bound
+    // framebuffer, with `lights` already updated for the same camera. Uses
+    // texture units 0 to 5 and unbinds the G-buffer from units 0 to 2 when
+    // done; depth testing is off while it runs and back on afterwards.
+    void light(const GBufferTextures& gbuffer, const ClusteredLights& lights, const glm::mat4& view,
+               const glm::mat4& projection, const glm::vec2& viewportSize,
+               const DeferredLightingSettings& settings = DeferredLightingSettings()) const;
+
+private:
+    Shader lightingShader;
+    unsigned int vao;       // Empty; the full-screen triangle needs no vertices
+};
@@ -0,0 +1,112 @@
+#include "FileSystem.h"
+#include "ArchiveFormat.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+
+#include <ios>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+struct Archive {
+    explicit Archive(const std::string& path) : file(path), blob(file.data(), file.size()) {}
+
+    MappedFile file;
+    ArchiveBlob blob;
+};
+
+std::shared_mutex mountMutex;
+std::vector<std::shared_ptr<const Archive>> archives;      // Guarded by mountMutex
+bool looseOverride = true;                                  // Guarded by mountMutex
+
+bool looseFileExists(const std::string& path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+#endif
+}
+
+// Null if the path should be read as a loose file
+std::shared_ptr<const Archive> findArchive(const std::string& path, const ArchiveEntry** entry) {
+    std::shared_lock<std::shared_mutex> lock(mountMutex);
+    if (looseOverride && looseFileExists(path)) {
+        return nullptr;
+    }
+    for (auto it = archives.rbegin(); it != archives.rend(); ++it) {
+        if ((*entry = (*it)->blob.find(path))) {
+            return *it;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void mountArchive(const std::string& path) {
+    auto archive = std::make_shared<const Archive>(path);
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    archives.push_back(std::move(archive));
+}
+
+void unmountArchives() {
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    archives.clear();
+}
+
+void setLooseFileOverride(bool enabled) {
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    looseOverride = enabled;
+}
+
+FileData openFile(const std::string& path) {
+    FileData file;
+    const ArchiveEntry* entry = nullptr;
+    std::shared_ptr<const Archive> archive = findArchive(path, &entry);
+    if (!archive) {
+        // Throws if there is no loose file either
+        auto mapped = std::make_shared<const MappedFile>(path);
+        file.bytes = mapped->data();
+        file.length = mapped->size();
+        file.owner = std::move(mapped);
+        return file;
+    }
+
+    const uint8_t* stored = archive->blob.storedData(*entry);
+    if (entry->compression == uint32_t(ArchiveCompression::None)) {
+        file.bytes = stored;
+        file.length = size_t(entry->size);
+        file.owner = std::move(archive);
+        return file;
+    }
+    auto buffer = std::make_shared<std::vector<uint8_t>>(size_t(entry->size));
+    try {
+        lz4Decompress(stored, size_t(entry->storedSize), buffer->data(), buffer->size());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+    file.bytes = buffer->data();
+    file.length = buffer->size();
+    file.owner = std::move(buffer);
+    return file;
+}
+
+bool fileExists(const std::string& path) {
+    const ArchiveEntry* entry = nullptr;
+    return findArchive(path, &entry) || looseFileExists(path);
+}
+
+bool isArchived(const std::string& path) {
+    const ArchiveEntry* entry = nullptr;
+    return findArchive(path, &entry) != nullptr;
+}
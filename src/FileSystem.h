@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only virtual file system that every loader opens files through. A
+// path resolves, in order, to:
+//   1. the loose file on disk, while the loose file override is on, so
+//      edited assets show up during development without repacking
+//   2. the entry in the most recently mounted archive that has it
+//   3. the loose file on disk, for paths no archive contains
+// Shipping builds mount their .pack files (see ArchiveFormat.h) and turn
+// the override off, which leaves one mapping per archive instead of an
+// open and a read per asset.
+//
+// Mounting is meant for startup; opening is safe from any thread.
+
+// Contents of an opened file. Stored archive entries and loose files are
+// memory mapped and keep their mapping alive; compressed entries are
+// decompressed into memory the FileData owns.
+class FileData {
+public:
+    FileData() = default;
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Copies the contents out, e.g. for consumers that keep their input
+    std::vector<uint8_t> toVector() const { return std::vector<uint8_t>(bytes, bytes + length); }
+
+private:
+    friend FileData openFile(const std::string& path);
+
+    std::shared_ptr<const void> owner;      // Mapping or decompressed buffer
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Throws std::ios_base::failure if the archive can't be mapped, or
+// std::runtime_error if it is malformed.
+void mountArchive(const std::string& path);
+void unmountArchives();
+
+// On by default.
+void setLooseFileOverride(bool enabled);
+
+// Throws std::ios_base::failure if the path resolves nowhere, or
+// std::runtime_error if the archive entry doesn't decompress.
+FileData openFile(const std::string& path);
+
+bool fileExists(const std::string& path);
+
+// True if the path resolves to a mounted archive rather than a loose file.
+bool isArchived(const std::string& path);
@@ -0,0 +1,106 @@
+#include "FrameCapture.h"
+#include "GlDebug.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+} // namespace
+
+FrameCapture::FrameCapture(uint32_t width, uint32_t height, FrameCallback callback, uint32_t depth)
+    : frameWidth(width),
+      frameHeight(height),
+      frameSize(size_t(width) * height * 4),
+      callback(std::move(callback)),
+      slots(std::max(depth, 1u)) {
+    for (Slot& slot : slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        labelGlObject(GL_BUFFER, slot.buffer, "Frame capture");
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameCapture::~FrameCapture() {
+    for (Slot& slot : slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+void FrameCapture::capture() {
+    if (pending == slots.size()) {
+        // The ring is full: the oldest frame has to arrive before its
+        // buffer can take another
+        Slot& slot = slots[oldest];
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            stallCount++;
+            do {
+                status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            } while (status == GL_TIMEOUT_EXPIRED);
+        }
+        deliver(slot);
+    }
+    Slot& slot = slots[(oldest + pending) % slots.size()];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, GLsizei(frameWidth), GLsizei(frameHeight), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.index = nextIndex++;
+    pending++;
+}
+
+void FrameCapture::poll() {
+    while (pending > 0) {
+        Slot& slot = slots[oldest];
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            // Frames finish in order; the rest aren't done either
+            return;
+        }
+        deliver(slot);
+    }
+}
+
+void FrameCapture::flush() {
+    while (pending > 0) {
+        Slot& slot = slots[oldest];
+        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS) == GL_TIMEOUT_EXPIRED) {
+        }
+        deliver(slot);
+    }
+}
+
+void FrameCapture::deliver(Slot& slot) {
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    oldest = (oldest + 1) % uint32_t(slots.size());
+    pending--;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, GL_MAP_READ_BIT);
+    if (pixels) {
+        CapturedFrame frame = {slot.index, frameWidth, frameHeight, static_cast<const uint8_t*>(pixels)};
+        try {
+            callback(frame);
+        } catch (...) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            throw;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels) {
+        throw std::runtime_error("Failed to map captured frame " + std::to_string(slot.index));
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// One frame read back by FrameCapture. `pixels` is RGBA8 with rows bottom
+// to top, like Image, and points into a mapped buffer: it is only valid
+// during the callback, so copy whatever has to outlive it.
+struct CapturedFrame {
+    uint64_t index;         // Frames captured before this one
+    uint32_t width;
+    uint32_t height;
+    const uint8_t* pixels;
+};
+
+using FrameCallback = std::function<void(const CapturedFrame&)>;
+
+// Reads rendered frames back without stalling the pipeline. capture()
+// queues a glReadPixels into the next of a ring of GL_PIXEL_PACK_BUFFERs
+// and fences it; the copy then runs on the GPU behind the frame's draws,
+// and poll() hands frames whose fence has signaled to the callback, oldest
+// first, a few frames later. Only if the whole ring is still in flight
+// does capture() wait, counted in stalls(); deepen the ring if it grows.
+//
+// Each frame, on the GL thread:
+//   capture()      with the finished frame in the read framebuffer
+//   poll()         delivers any earlier frames that have arrived
+// flush() waits for and delivers the rest, e.g. before shutting down.
+class FrameCapture {
+public:
+    // Captures the bottom-left `width` x `height` pixels of the read
+    // framebuffer's GL_COLOR_ATTACHMENT0 or back buffer.
+    FrameCapture(uint32_t width, uint32_t height, FrameCallback callback, uint32_t depth = 3);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    void capture();
+    void poll();
+    void flush();
+
+    uint32_t width() const { return frameWidth; }
+    uint32_t height() const { return frameHeight; }
+    uint64_t captured() const { return nextIndex; }
+    uint32_t stalls() const { return stallCount; }
+
+private:
+    struct Slot {
+        unsigned int buffer = 0;
+        GLsync fence = nullptr;
+        uint64_t index = 0;
+    };
+
+    // Maps the slot, runs the callback and frees the slot
+    void deliver(Slot& slot);
+
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    size_t frameSize;
+    FrameCallback callback;
+    std::vector<Slot> slots;
+    uint32_t oldest = 0;            // Next slot to deliver
+    uint32_t pending = 0;           // Slots in flight
+    uint64_t nextIndex = 0;
+    uint32_t stallCount = 0;
+};
@@ -0,0 +1,216 @@
+#include "Framebuffer.h"
+#include "GpuFeatures.h"
+#include "RenderStats.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// glTexImage2D needs a client format matching the internal one, even
+// without data; integer targets reject the normalized ones
+void clientFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+    switch (internalFormat) {
+        case GL_R32UI: format = GL_RED_INTEGER; type = GL_UNSIGNED_INT; break;
+        case GL_RG16UI: format = GL_RG_INTEGER; type = GL_UNSIGNED_SHORT; break;
+        case GL_RGBA16UI: format = GL_RGBA_INTEGER; type = GL_UNSIGNED_SHORT; break;
+        case GL_RG8:
+        case GL_RG16: format = GL_RG; type = GL_UNSIGNED_BYTE; break;
+        case GL_RG16F: format = GL_RG; type = GL_FLOAT; break;
+        case GL_R11F_G11F_B10F: format = GL_RGB; type = GL_FLOAT; break;
+        case GL_RGB10_A2: format = GL_RGBA; type = GL_UNSIGNED_INT_2_10_10_10_REV; break;
+        case GL_RGBA16F:
+        case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; break;
+        case GL_DEPTH_COMPONENT24: format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; break;
+        case GL_DEPTH_COMPONENT32F: format = GL_DEPTH_COMPONENT; type = GL_FLOAT; break;
+        case GL_DEPTH24_STENCIL8: format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; break;
+        default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+    }
+}
+
+} // namespace
+
+uint32_t renderTargetTexelSize(GLenum format) {
+    switch (format) {
+        case GL_R8: return 1;
+        case GL_RG8: return 2;
+        case GL_RG16:
+        case GL_RG16F:
+        case GL_RG16UI:
+        case GL_R32UI:
+        case GL_R32F:
+        case GL_R11F_G11F_B10F:
+        case GL_RGB10_A2:
+        case GL_DEPTH_COMPONENT24:  // Padded to 32 bits in practice
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8: return 4;
+        case GL_RGBA16:
+        case GL_RGBA16F:
+        case GL_RGBA16UI: return 8;
+        case GL_RGBA32F: return 16;
+        default: return 4;
+    }
+}
+
+RenderTarget::RenderTarget(uint32_t width, uint32_t height, GLenum format)
+    : targetWidth(width), targetHeight(height), targetFormat(format) {
+    if (gpuFeatures().directStateAccess) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &ID);
+        glTextureStorage2D(ID, 1, format, width, height);
+        glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(ID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(ID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return;
+    }
+    GLenum clientFormatEnum, type;
+    clientFormat(format, clientFormatEnum, type);
+    glGenTextures(1, &ID);
+    glBindTexture(GL_TEXTURE_2D, ID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, clientFormatEnum, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+RenderTarget::~RenderTarget() {
+    glDeleteTextures(1, &ID);
+}
+
+GLenum RenderTarget::depthAttachment() const {
+    switch (targetFormat) {
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F: return GL_DEPTH_ATTACHMENT;
+        case GL_DEPTH24_STENCIL8:
+        case GL_DEPTH32F_STENCIL8: return GL_DEPTH_STENCIL_ATTACHMENT;
+        default: return 0;
+    }
+}
+
+size_t RenderTarget::byteSize() const {
+    return size_t(targetWidth) * targetHeight * renderTargetTexelSize(targetFormat);
+}
+
+Framebuffer::Framebuffer(uint32_t width, uint32_t height, GLenum colorFormat, bool withDepth)
+    : targetWidth(width), targetHeight(height) {
+    ownedColor = std::make_unique<RenderTarget>(width, height, colorFormat);
+    colors.push_back(ownedColor->ID);
+    if (withDepth) {
+        ownedDepth = std::make_unique<RenderTarget>(width, height, GL_DEPTH_COMPONENT24);
+        depth = ownedDepth->ID;
+    }
+    attach();
+}
+
+Framebuffer::Framebuffer(const std::vector<const RenderTarget*>& colorTargets, const RenderTarget* depthTarget)
+    : targetWidth(0), targetHeight(0) {
+    const RenderTarget* first = colorTargets.empty() ? depthTarget : colorTargets[0];
+    if (first) {
+        targetWidth = first->width();
+        targetHeight = first->height();
+    }
+    for (const RenderTarget* target : colorTargets) {
+        colors.push_back(target->ID);
+    }
+    if (depthTarget) {
+        depth = depthTarget->ID;
+        depthAttachment = depthTarget->depthAttachment();
+    }
+    attach();
+}
+
+void Framebuffer::attach() {
+    std::vector<GLenum> drawBuffers;
+    for (uint32_t i = 0; i < colors.size(); ++i) {
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    GLenum status;
+    if (gpuFeatures().directStateAccess) {
+        glCreateFramebuffers(1, &ID);
+        for (uint32_t i = 0; i < colors.size(); ++i) {
+            glNamedFramebufferTexture(ID, GL_COLOR_ATTACHMENT0 + i, colors[i], 0);
+        }
+        if (depth) {
+            glNamedFramebufferTexture(ID, depthAttachment, depth, 0);
+        }
+        if (drawBuffers.empty()) {
+            glNamedFramebufferDrawBuffer(ID, GL_NONE);
+            glNamedFramebufferReadBuffer(ID, GL_NONE);
+        } else {
+            glNamedFramebufferDrawBuffers(ID, GLsizei(drawBuffers.size()), drawBuffers.data());
+        }
+        status = glCheckNamedFramebufferStatus(ID, GL_FRAMEBUFFER);
+    } else {
+        glGenFramebuffers(1, &ID);
+        glBindFramebuffer(GL_FRAMEBUFFER, ID);
+        for (uint32_t i = 0; i < colors.size(); ++i) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i], 0);
+        }
+        if (depth) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+        }
+        if (drawBuffers.empty()) {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        } else {
+            glDrawBuffers(GLsizei(drawBuffers.size()), drawBuffers.data());
+        }
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &ID);
+        throw std::runtime_error("Framebuffer is incomplete: " + std::to_string(status));
+    }
+}
+
+Framebuffer::~Framebuffer() {
+    glDeleteFramebuffers(1, &ID);
+}
+
+void Framebuffer::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, ID);
+    glViewport(0, 0, targetWidth, targetHeight);
+    countStateChange();
+}
+
+void Framebuffer::unbind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    countStateChange();
+}
+
+void Framebuffer::invalidate(GLbitfield buffers) const {
+    if (!gpuFeatures().invalidateData) {
+        return;
+    }
+    std::vector<GLenum> attachments;
+    if (buffers & GL_COLOR_BUFFER_BIT) {
+        for (uint32_t i = 0; i < colors.size(); ++i) {
+            attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+        }
+    }
+    if (depth) {
+        bool depthBits = (buffers & GL_DEPTH_BUFFER_BIT) != 0;
+        bool stencilBits = (buffers & GL_STENCIL_BUFFER_BIT) != 0 && depthAttachment == GL_DEPTH_STENCIL_ATTACHMENT;
+        if (depthBits && stencilBits) {
+            attachments.push_back(GL_DEPTH_STENCIL_ATTACHMENT);
+        } else if (depthBits) {
+            attachments.push_back(GL_DEPTH_ATTACHMENT);
+        } else if (stencilBits) {
+            attachments.push_back(GL_STENCIL_ATTACHMENT);
+        }
+    }
+    if (attachments.empty()) {
+        return;
+    }
+    if (gpuFeatures().directStateAccess) {
+        glInvalidateNamedFramebufferData(ID, GLsizei(attachments.size()), attachments.data());
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, ID);
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, GLsizei(attachments.size()), attachments.data());
+        countStateChange();
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// One sampleable, unfiltered texture to render into: a color format such
+// as GL_RGBA8, GL_RGBA16F or GL_RGB10_A2, or a depth format, i.e.
+// GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F or GL_DEPTH24_STENCIL8.
+// Short-lived ones should come from a RenderTargetPool instead.
+class RenderTarget {
+public:
+    unsigned int ID;
+
+    RenderTarget(uint32_t width, uint32_t height, GLenum format);
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    uint32_t width() const { return targetWidth; }
+    uint32_t height() const { return targetHeight; }
+    GLenum format() const { return targetFormat; }
+    // GL_DEPTH_ATTACHMENT or GL_DEPTH_STENCIL_ATTACHMENT for depth formats,
+    // 0 for color ones
+    GLenum depthAttachment() const;
+    size_t byteSize() const;
+
+private:
+    uint32_t targetWidth;
+    uint32_t targetHeight;
+    GLenum targetFormat;
+};
+
+// Bytes per texel of a render target format.
+uint32_t renderTargetTexelSize(GLenum format);
+
+// Offscreen render target: color attachments and an optional depth
+// attachment, which can be sampled afterwards, e.g. to build GpuScene's
+// occlusion pyramid.
+class Framebuffer {
+public:
+    unsigned int ID;
+
+    // Creates and owns one color target of the given format and optionally
+    // a 24-bit depth target. Throws std::runtime_error if the driver
+    // rejects the combination, as do the other constructors.
+    Framebuffer(uint32_t width, uint32_t height, GLenum colorFormat, bool depth = true);
+    // Attaches existing targets of one size, which must outlive it: the
+    // colors to GL_COLOR_ATTACHMENT0 onwards, in order, and all of them
+    // drawn to. Either part may be empty.
+    Framebuffer(const std::vector<const RenderTarget*>& colors, const RenderTarget* depth);
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // Binds for drawing and reading and sets the viewport to the target.
+    void bind() const;
+    // Rebinds the default framebuffer; the caller restores the viewport.
+    static void unbind();
+
+    // Tells the driver the contents of the attachments named by `buffers`,
+    // GL_COLOR_BUFFER_BIT, GL_DEPTH_BUFFER_BIT and GL_STENCIL_BUFFER_BIT as
+    // for glClear, are no longer needed: after the last pass reading them,
+    // so nothing is written back, or before a pass that overwrites every
+    // pixel without a clear, so nothing is loaded. Tile-based GPUs save the
+    // most; desktop drivers may reuse the memory. Does nothing without
+    // glInvalidateFramebuffer, and binds the framebuffer without direct
+    // state access.
+    void invalidate(GLbitfield buffers) const;
+
+    unsigned int colorTexture(uint32_t index = 0) const { return index < colors.size() ? colors[index] : 0; }
+    uint32_t colorCount() const { return uint32_t(colors.size()); }
+    // 0 without depth
+    unsigned int depthTexture() const { return depth; }
+    uint32_t width() const { return targetWidth; }
+    uint32_t height() const { return targetHeight; }
+
+private:
+    void attach();
+
+    std::unique_ptr<RenderTarget> ownedColor;
+    std::unique_ptr<RenderTarget> ownedDepth;
+    std::vector<unsigned int> colors;
+    unsigned int depth = 0;
+    GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    uint32_t targetWidth;
+    uint32_t targetHeight;
+};
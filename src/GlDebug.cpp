@@ -0,0 +1,129 @@
+#include "GlDebug.h"
+
+#ifdef GL_DEBUG_ENABLED
+
+#include "GpuFeatures.h"
+
+#include <iostream>
+
+namespace {
+
+bool installed = false;
+
+const char* sourceName(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API: return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+}
+
+const char* typeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    case GL_DEBUG_TYPE_MARKER: return "marker";
+    default: return "other";
+    }
+}
+
+const char* severityName(GLenum severity) {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "notification";
+    }
+}
+
+void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei, const GLchar* message,
+                            const void*) {
+    std::cerr << "OpenGL " << typeName(type) << " (" << sourceName(source) << ", " << severityName(severity)
+              << ", id " << id << "): " << message << std::endl;
+}
+
+const GLenum SOURCES[] = {GL_DEBUG_SOURCE_API,         GL_DEBUG_SOURCE_WINDOW_SYSTEM, GL_DEBUG_SOURCE_SHADER_COMPILER,
+                          GL_DEBUG_SOURCE_THIRD_PARTY, GL_DEBUG_SOURCE_APPLICATION,   GL_DEBUG_SOURCE_OTHER};
+const GLenum TYPES[] = {GL_DEBUG_TYPE_ERROR,       GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR, GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR,
+                        GL_DEBUG_TYPE_PORTABILITY, GL_DEBUG_TYPE_PERFORMANCE,         GL_DEBUG_TYPE_OTHER,
+                        GL_DEBUG_TYPE_MARKER,      GL_DEBUG_TYPE_PUSH_GROUP,          GL_DEBUG_TYPE_POP_GROUP};
+
+// Severities from most to least severe
+const GLenum SEVERITIES[] = {GL_DEBUG_SEVERITY_HIGH, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_LOW,
+                             GL_DEBUG_SEVERITY_NOTIFICATION};
+
+} // namespace
+
+bool installGlDebugOutput(const GlDebugSettings& settings) {
+    if (!gpuFeatures().debugOutput) {
+        return false;
+    }
+    glEnable(GL_DEBUG_OUTPUT);
+    if (settings.synchronous) {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    glDebugMessageCallback(debugCallback, nullptr);
+
+    // Everything at or above the threshold, then the ignored ids; the
+    // driver drops the rest before formatting them
+    bool enabled = true;
+    for (GLenum severity : SEVERITIES) {
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, enabled ? GL_TRUE : GL_FALSE);
+        if (severity == settings.minSeverity) {
+            enabled = false;
+        }
+    }
+    // A list of ids needs a concrete source and type, so each pair gets it
+    if (!settings.ignoredIds.empty()) {
+        for (GLenum source : SOURCES) {
+            for (GLenum type : TYPES) {
+                glDebugMessageControl(source, type, GL_DONT_CARE, GLsizei(settings.ignoredIds.size()),
+                                      settings.ignoredIds.data(), GL_FALSE);
+            }
+        }
+    }
+    installed = true;
+    return true;
+}
+
+bool glDebugOutputInstalled() {
+    return installed;
+}
+
+void labelGlObject(GLenum identifier, GLuint name, const char* label) {
+    if (gpuFeatures().debugOutput && name != 0) {
+        glObjectLabel(identifier, name, -1, label);
+    }
+}
+
+void pushGlDebugGroup(const char* name) {
+    if (gpuFeatures().debugOutput) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+}
+
+void popGlDebugGroup() {
+    if (gpuFeatures().debugOutput) {
+        glPopDebugGroup();
+    }
+}
+
+void checkGlErrors(const char* context) {
+    if (installed) {
+        return;
+    }
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        std::cerr << "OpenGL error in " << context << ": 0x" << std::hex << error << std::dec << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+// Debug layer on top of KHR_debug (core in GL 4.3). Instead of polling
+// glGetError, which is a synchronous round trip to the driver, the driver
+// calls back with a message, a severity and an id whenever something goes
+// wrong or is slow, and tools such as RenderDoc show the object labels and
+// debug groups set here.
+//
+// Debug builds only: defining NDEBUG (the "Build Shipping" task does)
+// compiles every function below down to nothing, so production pays for
+// no error checking at all. Without KHR_debug, a debug build falls back to
+// checkGlErrors() once a frame.
+#ifndef NDEBUG
+#define GL_DEBUG_ENABLED
+#endif
+
+struct GlDebugSettings {
+    // Messages below this are not even generated: GL_DEBUG_SEVERITY_HIGH,
+    // _MEDIUM, _LOW or _NOTIFICATION.
+    GLenum minSeverity = GL_DEBUG_SEVERITY_LOW;
+    // Reported from inside the offending call, so a breakpoint in the
+    // callback stops with the culprit on the stack. Costs some driver
+    // parallelism.
+    bool synchronous = true;
+    // Message ids to drop, e.g. NVIDIA's 131185 "buffer will use video
+    // memory" and 131218 "shader recompiled".
+    std::vector<GLuint> ignoredIds = {131169, 131185, 131204, 131218};
+};
+
+#ifdef GL_DEBUG_ENABLED
+
+// Routes driver messages to std::cerr. Returns false without debug output
+// in the context; request one with GLFW_OPENGL_DEBUG_CONTEXT for the most
+// messages.
+bool installGlDebugOutput(const GlDebugSettings& settings = GlDebugSettings());
+// Whether installGlDebugOutput() succeeded.
+bool glDebugOutputInstalled();
+
+// Names an object in messages and debuggers. `identifier` is GL_BUFFER,
+// GL_TEXTURE, GL_PROGRAM, GL_VERTEX_ARRAY, GL_FRAMEBUFFER and so on; the
+// object must exist, i.e. have been bound or created with glCreate*.
+void labelGlObject(GLenum identifier, GLuint name, const char* label);
+
+// Brackets a pass in captures and prefixes its messages. Pushes and pops
+// must pair up.
+void pushGlDebugGroup(const char* name);
+void popGlDebugGroup();
+
+// Prints and clears any glGetError errors, only when there is no debug
+// output to report them instead. Once a frame, never per draw.
+void checkGlErrors(const char* context);
+
+#else
+
+inline bool installGlDebugOutput(const GlDebugSettings& = GlDebugSettings()) {
+    return false;
+}
+inline bool glDebugOutputInstalled() {
+    return false;
+}
+inline void labelGlObject(GLenum, GLuint, const char*) {}
+inline void pushGlDebugGroup(const char*) {}
+inline void popGlDebugGroup() {}
+inline void checkGlErrors(const char*) {}
+
+#endif
+
+// Debug group for the enclosing block.
+class GlDebugGroup {
+public:
+    explicit GlDebugGroup(const char* name) { pushGlDebugGroup(name); }
+    ~GlDebugGroup() { popGlDebugGroup(); }
+
+    GlDebugGroup(const GlDebugGroup&) = delete;
+    GlDebugGroup& operator=(const GlDebugGroup&) = delete;
+};
@@ -0,0 +1,105 @@
+#include "GpuFeatures.h"
+
+namespace {
+
+GpuFeatures detected;
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+int glInteger(GLenum name) {
+    GLint value = 0;
+    glGetIntegerv(name, &value);
+    return value;
+}
+
+} // namespace
+
+const GpuFeatures& detectGpuFeatures() {
+    GpuFeatures f;
+    f.majorVersion = GLVersion.major;
+    f.minorVersion = GLVersion.minor;
+    f.vendor = glString(GL_VENDOR);
+    f.renderer = glString(GL_RENDERER);
+    f.version = glString(GL_VERSION);
+
+    f.bufferStorage = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    f.directStateAccess = GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_direct_state_access;
+    f.textureStorage = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage;
+    f.multiDrawIndirect = GLAD_GL_VERSION_4_3 ||
+                          (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_draw_indirect && GLAD_GL_ARB_base_instance);
+    f.indirectCount = f.multiDrawIndirect && (GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_indirect_parameters);
+    f.shaderDrawParameters = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_shader_draw_parameters;
+    f.computeShaders = GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_storage_buffer_object &&
+                                               GLAD_GL_ARB_shader_image_load_store);
+    f.debugOutput = GLAD_GL_VERSION_4_3 || GLAD_GL_KHR_debug;
+    f.programBinary = (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) &&
+                      glInteger(GL_NUM_PROGRAM_BINARY_FORMATS) > 0;
+    f.spirvShaders = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_gl_spirv;
+    f.clipControl = GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_clip_control;
+    f.invalidateData = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_invalidate_subdata;
+    f.copyImage = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_copy_image;
+    f.queryBufferObject = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_query_buffer_object;
+    f.pipelineStatistics = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_pipeline_statistics_query;
+    f.parallelShaderCompile = GLAD_GL_ARB_parallel_shader_compile || GLAD_GL_KHR_parallel_shader_compile;
+    f.bindlessTextures = GLAD_GL_ARB_bindless_texture;
+    f.sparseTextures = GLAD_GL_ARB_sparse_texture;
+    f.s3tc = GLAD_GL_EXT_texture_compression_s3tc;
+    f.bptc = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+    f.anisotropicFiltering =
+        GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_texture_filter_anisotropic || GLAD_GL_EXT_texture_filter_anisotropic;
+
+    if (f.anisotropicFiltering) {
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &f.maxAnisotropy);
+    }
+    f.maxTextureSize = glInteger(GL_MAX_TEXTURE_SIZE);
+    f.maxArrayTextureLayers = glInteger(GL_MAX_ARRAY_TEXTURE_LAYERS);
+    f.maxUniformBlockSize = glInteger(GL_MAX_UNIFORM_BLOCK_SIZE);
+    f.uniformBufferOffsetAlignment = glInteger(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT);
+    if (f.computeShaders) {
+        f.shaderStorageBufferOffsetAlignment = glInteger(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT);
+        f.maxShaderStorageBlockSize = glInteger(GL_MAX_SHADER_STORAGE_BLOCK_SIZE);
+        f.maxComputeWorkGroupInvocations = glInteger(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS);
+    }
+    detected = f;
+    return detected;
+}
+
+const GpuFeatures& gpuFeatures() {
+    return detected;
+}
+
+void printGpuFeatures(std::ostream& out, const GpuFeatures& f) {
+    auto flag = [&out](const char* name, bool value) { out << "  " << name << ": " << (value ? "yes" : "no") << "\n"; };
+    out << "OpenGL " << f.majorVersion << "." << f.minorVersion << " (" << f.version << ") on " << f.renderer << ", "
+        << f.vendor << "\n";
+    flag("buffer storage", f.bufferStorage);
+    flag("direct state access", f.directStateAccess);
+    flag("texture storage", f.textureStorage);
+    flag("multi-draw indirect", f.multiDrawIndirect);
+    flag("indirect count", f.indirectCount);
+    flag("shader draw parameters", f.shaderDrawParameters);
+    flag("compute shaders", f.computeShaders);
+    flag("debug output", f.debugOutput);
+    flag("program binaries", f.programBinary);
+    flag("SPIR-V shaders", f.spirvShaders);
+    flag("clip control", f.clipControl);
+    flag("invalidate data", f.invalidateData);
+    flag("copy image", f.copyImage);
+    flag("query buffer objects", f.queryBufferObject);
+    flag("pipeline statistics", f.pipelineStatistics);
+    flag("parallel shader compile", f.parallelShaderCompile);
+    flag("bindless textures", f.bindlessTextures);
+    flag("sparse textures", f.sparseTextures);
+    flag("S3TC (BC1-3)", f.s3tc);
+    flag("BPTC (BC6H, BC7)", f.bptc);
+    if (f.anisotropicFiltering) {
+        out << "  anisotropic filtering: up to " << f.maxAnisotropy << "x\n";
+    } else {
+        flag("anisotropic filtering", false);
+    }
+    out << "  max texture size: " << f.maxTextureSize << ", array layers: " << f.maxArrayTextureLayers << "\n";
+    out.flush();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <ostream>
+#include <string>
+
+// What the current context can do, gathered once after the loader has run
+// so the renderer can pick its fastest path at startup instead of sprinkling
+// version checks. Each flag is set when the feature is core in the context's
+// version or its ARB/KHR/EXT extension is advertised; either way the same
+// unsuffixed entry points work, except where a field notes otherwise.
+struct GpuFeatures {
+    int majorVersion = 0;
+    int minorVersion = 0;
+    std::string vendor;
+    std::string renderer;
+    std::string version;
+
+    bool bufferStorage = false;         // 4.4: immutable and persistently mapped buffers
+    bool directStateAccess = false;     // 4.5: glCreate*/glNamed* without binding
+    bool textureStorage = false;        // 4.2: glTexStorage*
+    bool multiDrawIndirect = false;     // 4.3: glMultiDraw*Indirect, with base instance
+    bool indirectCount = false;         // 4.6: draw count from a buffer; *ARB entry points below 4.6
+    bool shaderDrawParameters = false;  // 4.6: gl_DrawID and gl_BaseInstance in shaders
+    bool computeShaders = false;        // 4.3: compute, shader storage buffers and image load/store
+    bool debugOutput = false;           // 4.3: glDebugMessageCallback, object labels, debug groups
+    bool programBinary = false;         // 4.1: glGetProgramBinary, with at least one binary format
+    bool spirvShaders = false;          // 4.6: glSpecializeShader; *ARB entry point below 4.6
+    bool clipControl = false;           // 4.5: [0, 1] depth range for reversed Z
+    bool invalidateData = false;        // 4.3: glInvalidate* to skip loads and stores
+    bool copyImage = false;             // 4.3: glCopyImageSubData
+    bool queryBufferObject = false;     // 4.4: query results written to buffers
+    bool pipelineStatistics = false;    // 4.6: GL_VERTICES_SUBMITTED and friends
+    bool parallelShaderCompile = false; // glMaxShaderCompilerThreads*, ARB or KHR only
+    bool bindlessTextures = false;      // ARB only, never core
+    bool sparseTextures = false;        // ARB only, never core
+    bool s3tc = false;                  // BC1-BC3
+    bool bptc = false;                  // 4.2: BC6H and BC7
+    bool anisotropicFiltering = false;  // 4.6
+
+    float maxAnisotropy = 1.0f;
+    int maxTextureSize = 0;
+    int maxArrayTextureLayers = 0;
+    int maxUniformBlockSize = 0;
+    // Required alignment of glBindBufferRange offsets
+    int uniformBufferOffsetAlignment = 256;
+    int shaderStorageBufferOffsetAlignment = 256;
+    int maxShaderStorageBlockSize = 0;  // 0 without compute shaders
+    int maxComputeWorkGroupInvocations = 0;
+};
+
+// Queries the current context. Call once after gladLoadGL*(); the result is
+// kept for gpuFeatures().
+const GpuFeatures& detectGpuFeatures();
+// The table from the last detectGpuFeatures() call, all false before it.
+const GpuFeatures& gpuFeatures();
+
+// One line per feature, for the startup log.
+void printGpuFeatures(std::ostream& out, const GpuFeatures& features);
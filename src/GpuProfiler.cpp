@@ -0,0 +1,178 @@
+#include "GpuProfiler.h"
+#include "GlDebug.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// Weight of the newest frame in the moving average
+constexpr double AVERAGE_WEIGHT = 0.05;
+
+} // namespace
+
+GpuProfiler::GpuProfiler(uint32_t frameCount, size_t traceCapacity)
+    : frames(std::max(frameCount, 2u)), traceCapacity(traceCapacity) {}
+
+GpuProfiler::~GpuProfiler() {
+    for (Frame& frame : frames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+        }
+    }
+}
+
+void GpuProfiler::beginFrame() {
+    if (inFrame) {
+        endFrame();
+    }
+    // Collect finished frames oldest first; the GPU runs them in order, so
+    // stop at the first one still in flight
+    uint32_t count = uint32_t(frames.size());
+    for (uint32_t i = 1; i <= count; ++i) {
+        Frame& frame = frames[(current + i) % count];
+        if (frame.pending && !resolve(frame)) {
+            break;
+        }
+    }
+    current = (current + 1) % count;
+    Frame& frame = frames[current];
+    if (frame.pending) {
+        frame.pending = false;
+        dropped++;
+    }
+    frame.queriesUsed = 0;
+    frame.records.clear();
+
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    frame.clockOffset = traceClock() - double(gpuTime) / 1000.0;
+    inFrame = true;
+}
+
+void GpuProfiler::endFrame() {
+    if (!inFrame) {
+        return;
+    }
+    if (!stack.empty()) {
+        throw std::logic_error("GpuProfiler frame ended with " + std::to_string(stack.size()) + " scopes open");
+    }
+    Frame& frame = frames[current];
+    frame.pending = !frame.records.empty();
+    inFrame = false;
+}
+
+void GpuProfiler::push(const char* name) {
+    if (!inFrame) {
+        return;
+    }
+    Frame& frame = frames[current];
+    uint32_t parent = stack.empty() ? NO_PARENT : frame.records[stack.back()].scope;
+    Record record;
+    record.scope = scopeFor(name, parent);
+    record.beginQuery = timestamp(frame);
+    record.endQuery = record.beginQuery;
+    stack.push_back(uint32_t(frame.records.size()));
+    frame.records.push_back(record);
+    pushGlDebugGroup(name);
+}
+
+void GpuProfiler::pop() {
+    if (!inFrame) {
+        return;
+    }
+    if (stack.empty()) {
+        throw std::logic_error("GpuProfiler::pop() without a matching push()");
+    }
+    popGlDebugGroup();
+    Frame& frame = frames[current];
+    frame.records[stack.back()].endQuery = timestamp(frame);
+    stack.pop_back();
+}
+
+void GpuProfiler::appendTrace(std::vector<TraceEvent>& events) const {
+    events.insert(events.end(), trace.begin(), trace.end());
+}
+
+void GpuProfiler::print(std::ostream& out) const {
+    for (uint32_t scope = 0; scope < stats.size(); ++scope) {
+        if (stats[scope].parent == NO_PARENT) {
+            printScope(out, scope);
+        }
+    }
+    out.flush();
+}
+
+uint32_t GpuProfiler::scopeFor(const char* name, uint32_t parent) {
+    for (uint32_t scope = 0; scope < stats.size(); ++scope) {
+        if (stats[scope].parent == parent && stats[scope].name == name) {
+            return scope;
+        }
+    }
+    GpuScopeStats scope;
+    scope.name = name;
+    scope.parent = parent;
+    scope.depth = parent == NO_PARENT ? 0 : stats[parent].depth + 1;
+    stats.push_back(scope);
+    return uint32_t(stats.size() - 1);
+}
+
+uint32_t GpuProfiler::timestamp(Frame& frame) {
+    if (frame.queriesUsed == frame.queries.size()) {
+        size_t grown = std::max<size_t>(frame.queries.size() * 2, 16);
+        size_t old = frame.queries.size();
+        frame.queries.resize(grown);
+        glGenQueries(GLsizei(grown - old), frame.queries.data() + old);
+    }
+    uint32_t query = frame.queriesUsed++;
+    glQueryCounter(frame.queries[query], GL_TIMESTAMP);
+    return query;
+}
+
+bool GpuProfiler::resolve(Frame& frame) {
+    // Queries complete in order, so the last one stands for the frame
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.queriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+    frameTotals.assign(stats.size(), -1.0);
+    for (const Record& record : frame.records) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[record.beginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[record.endQuery], GL_QUERY_RESULT, &end);
+        double duration = end > begin ? double(end - begin) / 1000.0 : 0.0;   // Microseconds
+        frameTotals[record.scope] = std::max(frameTotals[record.scope], 0.0) + duration / 1000.0;
+
+        trace.push_back({stats[record.scope].name, "GPU", double(begin) / 1000.0 + frame.clockOffset, duration});
+        if (trace.size() > traceCapacity) {
+            trace.pop_front();
+        }
+    }
+    for (uint32_t scope = 0; scope < stats.size(); ++scope) {
+        double total = frameTotals[scope];
+        if (total < 0.0) {
+            continue;
+        }
+        GpuScopeStats& s = stats[scope];
+        s.lastMs = total;
+        s.averageMs = s.samples == 0 ? total : s.averageMs + (total - s.averageMs) * AVERAGE_WEIGHT;
+        s.samples++;
+    }
+    frame.pending = false;
+    return true;
+}
+
+void GpuProfiler::printScope(std::ostream& out, uint32_t scope) const {
+    const GpuScopeStats& s = stats[scope];
+    char line[160];
+    std::snprintf(line, sizeof(line), "%*s%-*s %8.3f ms\n", int(s.depth * 2), "", int(32 - s.depth * 2),
+                  s.name.c_str(), s.averageMs);
+    out << line;
+    for (uint32_t child = 0; child < stats.size(); ++child) {
+        if (stats[child].parent == scope) {
+            printScope(out, child);
+        }
+    }
+}
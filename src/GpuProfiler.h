@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Trace.h"
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timing of one named scope, merged over every place it was opened under
+// the same parent in a frame.
+struct GpuScopeStats {
+    std::string name;
+    uint32_t parent;        // Index in GpuProfiler::scopes(), or GpuProfiler::NO_PARENT
+    uint32_t depth;         // 0 for top-level scopes
+    double lastMs = 0.0;    // Latest resolved frame
+    double averageMs = 0.0; // Exponential moving average, about the last 20 frames
+    uint64_t samples = 0;
+};
+
+// Measures where GPU time goes. Each scope is bracketed by a pair of
+// glQueryCounter(GL_TIMESTAMP) queries; scopes nest, and the same name under
+// a different parent is a different scope.
+//
+// Queries are only read back a few frames later: every frame gets its own
+// set, in a ring `frames` deep, and beginFrame() collects the frames whose
+// queries the GPU has finished. Nothing ever waits on the GPU; if it falls
+// a whole ring behind, the oldest frame is dropped instead.
+//
+// Frame protocol, on the GL thread:
+//   beginFrame()
+//   push("Shadows") ... pop()     or a GpuProfileScope
+//   endFrame()
+// Outside a frame, push() and pop() do nothing. In debug builds every scope
+// is also a debug group (see GlDebug.h), so captures show the same passes.
+class GpuProfiler {
+public:
+    static constexpr uint32_t NO_PARENT = ~0u;
+
+    // Keeps up to `traceCapacity` resolved scopes for appendTrace().
+    explicit GpuProfiler(uint32_t frames = 4, size_t traceCapacity = 1 << 14);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    void push(const char* name);
+    void pop();
+
+    // Every scope seen so far, each after its parent.
+    const std::vector<GpuScopeStats>& scopes() const { return stats; }
+    // Frames whose results were discarded because the GPU was too far behind.
+    uint64_t droppedFrames() const { return dropped; }
+
+    // Appends the recent scopes on the "GPU" track, converted to
+    // traceClock() so they line up with CPU events.
+    void appendTrace(std::vector<TraceEvent>& events) const;
+    // Indented tree of the averages.
+    void print(std::ostream& out) const;
+
+private:
+    struct Record {
+        uint32_t scope;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct Frame {
+        std::vector<unsigned int> queries;  // Grows as needed, reused
+        uint32_t queriesUsed = 0;
+        std::vector<Record> records;
+        double clockOffset = 0.0;           // traceClock() minus GPU time, in microseconds
+        bool pending = false;               // Ended, results not read yet
+    };
+
+    uint32_t scopeFor(const char* name, uint32_t parent);
+    uint32_t timestamp(Frame& frame);
+    bool resolve(Frame& frame);
+    void printScope(std::ostream& out, uint32_t scope) const;
+
+    std::vector<Frame> frames;
+    uint32_t current = 0;
+    bool inFrame = false;
+    std::vector<uint32_t> stack;            // Open records of the current frame
+    std::vector<GpuScopeStats> stats;
+    std::vector<double> frameTotals;        // Scratch for resolve()
+    std::deque<TraceEvent> trace;
+    size_t traceCapacity;
+    uint64_t dropped = 0;
+};
+
+// Times the enclosing block as a scope of `profiler`.
+class GpuProfileScope {
+public:
+    GpuProfileScope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.push(name); }
+    ~GpuProfileScope() { profiler.pop(); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler& profiler;
+};
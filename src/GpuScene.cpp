@@ -0,0 +1,341 @@
+#include "GpuScene.h"
+#include "GlDebug.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr const char* CULL_COMPUTE_SHADER_PATH = "res/shaders/cull_compute_shader.glsl";
+constexpr const char* PYRAMID_COMPUTE_SHADER_PATH = "res/shaders/hiz_compute_shader.glsl";
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+constexpr uint32_t PYRAMID_GROUP_SIZE = 8;
+
+// Binding points shared with the shaders
+constexpr GLuint OBJECT_BINDING = 0;
+constexpr GLuint MESH_BINDING = 1;
+constexpr GLuint COMMAND_BINDING = 2;
+constexpr GLuint COUNTER_BINDING = 3;
+
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Indirect commands must be tightly packed");
+
+unsigned int createBuffer(size_t size, GLenum usage, const char* label) {
+    unsigned int buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    labelGlObject(GL_BUFFER, buffer, label);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return buffer;
+}
+
+// Replaces `buffer` with a larger one holding the same first `used` bytes
+void growBuffer(unsigned int& buffer, size_t used, size_t capacity, GLenum usage, const char* label) {
+    unsigned int grown = createBuffer(capacity, usage, label);
+    if (used > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+}
+
+} // namespace
+
+GpuScene::GpuScene() : cullShader(CULL_COMPUTE_SHADER_PATH), pyramidShader(PYRAMID_COMPUTE_SHADER_PATH) {
+    glGenVertexArrays(1, &vao);
+    meshBuffer = createBuffer(0, GL_DYNAMIC_DRAW, "GpuScene meshes");
+    counterBuffer = createBuffer(sizeof(uint32_t), GL_DYNAMIC_READ, "GpuScene draw count");
+    reserveGeometry(1 << 20, 1 << 18);
+    reserveObjects(256);
+}
+
+GpuScene::~GpuScene() {
+    glDeleteVertexArrays(1, &vao);
+    unsigned int buffers[] = {vertexBuffer, indexBuffer, meshBuffer, objectBuffer, objectIdBuffer, commandBuffer,
+                              counterBuffer};
+    glDeleteBuffers(GLsizei(std::size(buffers)), buffers);
+    glDeleteTextures(1, &pyramid);
+}
+
+uint32_t GpuScene::addMesh(const MeshBlob& blob) {
+    const MeshFileHeader& h = blob.header();
+    VertexLayout layout = blob.layout();
+    if (meshes.empty()) {
+        // The VAO was set up before the layout was known
+        vertexLayout = layout;
+        bindLayout();
+    } else if (layout != vertexLayout) {
+        throw std::runtime_error("Mesh vertex layout doesn't match the scene's");
+    }
+
+    // Everything is drawn with 32-bit indices
+    std::vector<uint32_t> indices(h.indexCount);
+    if (h.indexType == GL_UNSIGNED_SHORT) {
+        const uint16_t* source = static_cast<const uint16_t*>(blob.indexData());
+        std::copy(source, source + h.indexCount, indices.begin());
+    } else {
+        std::memcpy(indices.data(), blob.indexData(), indices.size() * sizeof(uint32_t));
+    }
+    reserveGeometry(vertexSize + h.vertexDataSize, indexCount + indices.size());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexSize, h.vertexDataSize, blob.vertexData());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexCount * sizeof(uint32_t), indices.size() * sizeof(uint32_t),
+                    indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    countUpload(h.vertexDataSize + indices.size() * sizeof(uint32_t));
+
+    GpuMesh mesh = {};
+    mesh.sphere = glm::vec4(h.bounds.center[0], h.bounds.center[1], h.bounds.center[2], h.bounds.radius);
+    mesh.positionScale = glm::vec4(1.0f);
+    mesh.positionOffset = glm::vec4(0.0f);
+    if (h.flags & MESH_FLAG_QUANTIZED_POSITIONS) {
+        PositionQuantization quantization(glm::vec3(h.bounds.min[0], h.bounds.min[1], h.bounds.min[2]),
+                                          glm::vec3(h.bounds.max[0], h.bounds.max[1], h.bounds.max[2]));
+        mesh.positionScale = glm::vec4(quantization.scale, 1.0f);
+        mesh.positionOffset = glm::vec4(quantization.offset, 0.0f);
+    }
+    mesh.lodCount = h.lodCount;
+    mesh.baseVertex = int32_t(vertexSize / h.vertexStride);
+    for (uint32_t lod = 0; lod < h.lodCount; ++lod) {
+        mesh.lods[lod][0] = uint32_t(indexCount) + h.lods[lod].indexOffset;
+        mesh.lods[lod][1] = h.lods[lod].indexCount;
+        std::memcpy(&mesh.lods[lod][2], &h.lods[lod].error, sizeof(float));
+    }
+    meshes.push_back(mesh);
+    meshesDirty = true;
+
+    vertexSize += h.vertexDataSize;
+    indexCount += indices.size();
+    return uint32_t(meshes.size() - 1);
+}
+
+uint32_t GpuScene::addObject(uint32_t mesh, const glm::mat4& model) {
+    if (mesh >= meshes.size()) {
+        throw std::out_of_range("Mesh " + std::to_string(mesh) + " is not in the scene");
+    }
+    reserveObjects(objects.size() + 1);
+    GpuObject object = {};
+    object.model = model;
+    object.mesh = mesh;
+    objects.push_back(object);
+    return uint32_t(objects.size() - 1);
+}
+
+void GpuScene::setTransform(uint32_t object, const glm::mat4& model) {
+    objects[object].model = model;
+    firstDirty = std::min(firstDirty, size_t(object));
+}
+
+void GpuScene::reserveGeometry(size_t vertexBytes, size_t indices) {
+    bool grown = false;
+    if (vertexBytes > vertexCapacity) {
+        vertexCapacity = std::max(vertexBytes, vertexCapacity * 2);
+        if (vertexBuffer) {
+            growBuffer(vertexBuffer, vertexSize, vertexCapacity, GL_STATIC_DRAW, "GpuScene vertices");
+        } else {
+            vertexBuffer = createBuffer(vertexCapacity, GL_STATIC_DRAW, "GpuScene vertices");
+        }
+        grown = true;
+    }
+    if (indices > indexCapacity) {
+        indexCapacity = std::max(indices, indexCapacity * 2);
+        if (indexBuffer) {
+            growBuffer(indexBuffer, indexCount * sizeof(uint32_t), indexCapacity * sizeof(uint32_t), GL_STATIC_DRAW,
+                       "GpuScene indices");
+        } else {
+            indexBuffer = createBuffer(indexCapacity * sizeof(uint32_t), GL_STATIC_DRAW, "GpuScene indices");
+        }
+        grown = true;
+    }
+    if (grown) {
+        bindLayout();
+    }
+}
+
+void GpuScene::reserveObjects(size_t count) {
+    if (count <= objectCapacity) {
+        return;
+    }
+    objectCapacity = std::max(count, objectCapacity * 2);
+    glDeleteBuffers(1, &objectBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &objectIdBuffer);
+    objectBuffer = createBuffer(objectCapacity * sizeof(GpuObject), GL_DYNAMIC_DRAW, "GpuScene objects");
+    commandBuffer = createBuffer(objectCapacity * sizeof(DrawElementsIndirectCommand), GL_DYNAMIC_COPY,
+                                 "GpuScene draw commands");
+    std::vector<uint32_t> ids(objectCapacity);
+    for (uint32_t i = 0; i < ids.size(); ++i) {
+        ids[i] = i;
+    }
+    objectIdBuffer = createBuffer(ids.size() * sizeof(uint32_t), GL_STATIC_DRAW, "GpuScene object ids");
+    glBindBuffer(GL_COPY_WRITE_BUFFER, objectIdBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, ids.size() * sizeof(uint32_t), ids.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    countUpload(ids.size() * sizeof(uint32_t));
+    firstDirty = 0;
+    bindLayout();
+}
+
+void GpuScene::bindLayout() {
+    if (!vertexBuffer || !indexBuffer || !objectIdBuffer) {
+        return;
+    }
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    for (const VertexAttribute& attribute : vertexLayout.attributes()) {
+        VertexFormatInfo info = vertexFormatInfo(attribute.format);
+        glVertexAttribPointer(attribute.location, info.components, info.type, info.normalized, vertexLayout.stride(),
+                              reinterpret_cast<void*>(static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(attribute.location);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, objectIdBuffer);
+    glVertexAttribIPointer(GPU_SCENE_OBJECT_LOCATION, 1, GL_UNSIGNED_INT, 0, nullptr);
+    glVertexAttribDivisor(GPU_SCENE_OBJECT_LOCATION, 1);
+    glEnableVertexAttribArray(GPU_SCENE_OBJECT_LOCATION);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuScene::updateOcclusion(unsigned int depthTexture, uint32_t width, uint32_t height,
+                               const glm::mat4& viewProjection) {
+    if (width != pyramidWidth || height != pyramidHeight) {
+        glDeleteTextures(1, &pyramid);
+        pyramidWidth = width;
+        pyramidHeight = height;
+        pyramidLevels = 1;
+        while ((std::max(width, height) >> pyramidLevels) > 0) {
+            pyramidLevels++;
+        }
+        glGenTextures(1, &pyramid);
+        glBindTexture(GL_TEXTURE_2D, pyramid);
+        glTexStorage2D(GL_TEXTURE_2D, pyramidLevels, GL_R32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    buildPyramid(depthTexture, width, height);
+    occlusionViewProjection = viewProjection;
+    occlusionReady = true;
+}
+
+void GpuScene::buildPyramid(unsigned int depthTexture, uint32_t width, uint32_t height) {
+    // Level 0 copies the depth; every further level keeps the farthest
+    // depth of the texels it covers
+    pyramidShader.use();
+    pyramidShader.setInt("source", 0);
+    glActiveTexture(GL_TEXTURE0);
+    for (uint32_t level = 0; level < pyramidLevels; ++level) {
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : pyramid);
+        pyramidShader.setInt("sourceLevel", level == 0 ? 0 : int(level) - 1);
+        pyramidShader.setInt("reduce", level > 0);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        uint32_t levelWidth = std::max(width >> level, 1u);
+        uint32_t levelHeight = std::max(height >> level, 1u);
+        glDispatchCompute((levelWidth + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+                          (levelHeight + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuScene::cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                    const LodSettings& settings) {
+    if (meshesDirty) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, meshBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, meshes.size() * sizeof(GpuMesh), meshes.data(), GL_DYNAMIC_DRAW);
+        countUpload(meshes.size() * sizeof(GpuMesh));
+        meshesDirty = false;
+    }
+    if (firstDirty < objects.size()) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, objectBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, firstDirty * sizeof(GpuObject),
+                        (objects.size() - firstDirty) * sizeof(GpuObject), objects.data() + firstDirty);
+        countUpload((objects.size() - firstDirty) * sizeof(GpuObject));
+    }
+    firstDirty = objects.size();
+    uint32_t zero = 0;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, counterBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(zero), &zero);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    countUpload(sizeof(zero));
+    if (objects.empty()) {
+        return;
+    }
+
+    // Gribb-Hartmann: world-space planes straight from the matrix rows,
+    // normals pointing inwards
+    glm::mat4 viewProjection = projection * view;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    glm::vec4 planes[6] = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+                           rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2]};
+
+    cullShader.use();
+    for (int i = 0; i < 6; ++i) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+        cullShader.setVec4("frustumPlanes[" + std::to_string(i) + "]", planes[i]);
+    }
+    cullShader.setMat4("view", view);
+    cullShader.setInt("objectCount", int(objects.size()));
+    cullShader.setFloat("projectionScale", projection[1][1] * viewportHeight * 0.5f);
+    cullShader.setInt("orthographic", projection[3][3] == 1.0f);
+    cullShader.setFloat("maxPixelError", settings.maxPixelError);
+    cullShader.setInt("occlusion", occlusionReady);
+    if (occlusionReady) {
+        cullShader.setMat4("occlusionViewProjection", occlusionViewProjection);
+        cullShader.setInt("depthPyramid", 0);
+        cullShader.setInt("pyramidLevels", int(pyramidLevels));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, pyramid);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, meshBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, counterBuffer);
+    glDispatchCompute((uint32_t(objects.size()) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuScene::draw() const {
+    if (objects.empty()) {
+        return;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BINDING, meshBuffer);
+    glBindVertexArray(vao);
+    countStateChange();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, GLsizei(objects.size()), 0);
+    countDraw(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+uint32_t GpuScene::visibleCount() const {
+    uint32_t count = 0;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(count), &count);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return count;
+}
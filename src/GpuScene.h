@@ -0,0 +1,129 @@
+#pragma once
+
+#include "LodSelector.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex attribute location of the object index GpuScene feeds its draws;
+// past any location the mesh cooker uses.
+constexpr uint32_t GPU_SCENE_OBJECT_LOCATION = 15;
+
+// GPU-driven renderer for many objects: the CPU only uploads transforms,
+// and one compute dispatch plus one glMultiDrawElementsIndirect draw the
+// whole scene, however many objects it holds.
+//
+//   - Every mesh lives in one shared vertex buffer and one 32-bit index
+//     buffer, so all draws share a VAO. Meshes must therefore share a
+//     vertex layout, i.e. be cooked with the same options.
+//   - Per-mesh data (bounds, LOD ranges, position dequantization) and
+//     per-object data (transform, mesh) live in shader storage buffers.
+//   - cull() runs res/shaders/cull_compute_shader.glsl with one thread per
+//     object: frustum test, LOD pick by projected error (as LodSelector,
+//     without hysteresis), and optionally a test against a Hi-Z pyramid of
+//     an earlier frame's depth. Each object writes its own
+//     DrawElementsIndirectCommand, with no instances if culled.
+//   - draw() issues the commands. Each one's baseInstance is its object, so
+//     the instanced attribute at GPU_SCENE_OBJECT_LOCATION hands shaders
+//     (see res/shaders/indirect_vertex_shader.glsl) the object index.
+//
+// Needs GL 4.3; check GLAD_GL_VERSION_4_3 first.
+class GpuScene {
+public:
+    GpuScene();
+    ~GpuScene();
+
+    GpuScene(const GpuScene&) = delete;
+    GpuScene& operator=(const GpuScene&) = delete;
+
+    // Copies the mesh into the shared buffers and returns its index. Throws
+    // std::runtime_error if its vertex layout differs from the first mesh's.
+    uint32_t addMesh(const MeshBlob& blob);
+
+    uint32_t addObject(uint32_t mesh, const glm::mat4& model);
+    void setTransform(uint32_t object, const glm::mat4& model);
+
+    // Occlusion culling against `depthTexture`, which holds the depth of a
+    // frame rendered with `viewProjection`, usually the previous one. The
+    // pyramid is rebuilt from it on every call. Objects that just came out
+    // from behind an occluder can show up a frame late.
+    void updateOcclusion(unsigned int depthTexture, uint32_t width, uint32_t height, const glm::mat4& viewProjection);
+    void disableOcclusion() { occlusionReady = false; }
+
+    // Uploads changed objects and writes this frame's draw commands.
+    void cull(const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+              const LodSettings& settings = LodSettings());
+    // Draws with the current program, which must read the scene's buffers
+    // like indirect_vertex_shader.glsl does.
+    void draw() const;
+
+    // Objects drawn by the last cull(). Reads a counter back, stalling the
+    // pipeline; meant for statistics and tests.
+    uint32_t visibleCount() const;
+
+    uint32_t meshCount() const { return uint32_t(meshes.size()); }
+    uint32_t objectCount() const { return uint32_t(objects.size()); }
+    const VertexLayout& layout() const { return vertexLayout; }
+
+private:
+    // std430 layouts of the shader storage buffers
+    struct GpuMesh {
+        glm::vec4 sphere;               // Bounds center and radius, in mesh units
+        glm::vec4 positionScale;        // Dequantization: position * scale + offset
+        glm::vec4 positionOffset;
+        uint32_t lodCount;
+        int32_t baseVertex;
+        uint32_t reserved[2];
+        uint32_t lods[MESH_MAX_LODS][4];    // First index, index count, error bits, unused
+    };
+
+    struct GpuObject {
+        glm::mat4 model;
+        uint32_t mesh;
+        uint32_t reserved[3];
+    };
+
+    static_assert(sizeof(GpuMesh) == 192, "GpuMesh must match the std430 layout in the shaders");
+    static_assert(sizeof(GpuObject) == 80, "GpuObject must match the std430 layout in the shaders");
+
+    void reserveGeometry(size_t vertexBytes, size_t indexCount);
+    void reserveObjects(size_t count);
+    void bindLayout();
+    void buildPyramid(unsigned int depthTexture, uint32_t width, uint32_t height);
+
+    Shader cullShader;
+    Shader pyramidShader;
+
+    unsigned int vao = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    unsigned int meshBuffer = 0;
+    unsigned int objectBuffer = 0;
+    unsigned int objectIdBuffer = 0;    // 0, 1, 2, ... read per instance
+    unsigned int commandBuffer = 0;
+    unsigned int counterBuffer = 0;
+    size_t vertexCapacity = 0;          // Bytes
+    size_t vertexSize = 0;
+    size_t indexCapacity = 0;           // Indices
+    size_t indexCount = 0;
+    size_t objectCapacity = 0;
+
+    VertexLayout vertexLayout;
+    std::vector<GpuMesh> meshes;
+    std::vector<GpuObject> objects;
+    size_t firstDirty = 0;              // Objects from here on need uploading
+    bool meshesDirty = false;
+
+    unsigned int pyramid = 0;
+    uint32_t pyramidWidth = 0;
+    uint32_t pyramidHeight = 0;
+    uint32_t pyramidLevels = 0;
+    glm::mat4 occlusionViewProjection{1.0f};
+    bool occlusionReady = false;
+};
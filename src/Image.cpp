@@ -0,0 +1,141 @@
+#include "Image.h"
+#include "FileSystem.h"
+
+#include <cstring>
+#include <stdexcept>
+
+Image decodeImage(const uint8_t* data, size_t size) {
+    static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size >= 8 && std::memcmp(data, PNG_SIGNATURE, 8) == 0) {
+        return decodePng(data, size);
+    }
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+        return decodeJpeg(data, size);
+    }
+    // TGA has no signature; its decoder validates the header instead
+    return decodeTga(data, size);
+}
+
+Image loadImage(const std::string& path) {
+    FileData file = openFile(path);
+    try {
+        return decodeImage(file.data(), file.size());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+Image decodeTga(const uint8_t* data, size_t size) {
+    if (size < 18) {
+        throw std::runtime_error("TGA header is truncated");
+    }
+    uint32_t idLength = data[0];
+    uint32_t colorMapType = data[1];
+    uint32_t imageType = data[2];
+    uint32_t colorMapLength = data[5] | (data[6] << 8);
+    uint32_t colorMapDepth = data[7];
+    uint32_t width = data[12] | (data[13] << 8);
+    uint32_t height = data[14] | (data[15] << 8);
+    uint32_t depth = data[16];
+    uint32_t descriptor = data[17];
+
+    bool rle = imageType == 10 || imageType == 11;
+    bool gray = imageType == 3 || imageType == 11;
+    bool trueColor = imageType == 2 || imageType == 10;
+    if (colorMapType > 1 || (!gray && !trueColor) || width == 0 || height == 0 ||
+        (gray && depth != 8) || (trueColor && depth != 16 && depth != 24 && depth != 32)) {
+        throw std::runtime_error("Unsupported TGA image type");
+    }
+
+    // True-color images may still carry a color map; skip it
+    size_t pos = 18 + idLength + (colorMapType ? colorMapLength * ((colorMapDepth + 7) / 8) : 0);
+    uint32_t pixelSize = depth / 8;
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+
+    bool topDown = (descriptor & 0x20) != 0;
+    bool rightToLeft = (descriptor & 0x10) != 0;
+    uint8_t packet[4] = {};
+    uint32_t packetLeft = 0;
+    bool packetRepeats = false;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* row = &image.pixels[size_t(topDown ? height - 1 - y : y) * width * 4];
+        for (uint32_t i = 0; i < width; ++i) {
+            const uint8_t* src;
+            if (rle) {
+                if (packetLeft == 0) {
+                    if (pos >= size) {
+                        throw std::runtime_error("TGA pixel data is truncated");
+                    }
+                    packetRepeats = (data[pos] & 0x80) != 0;
+                    packetLeft = (data[pos] & 0x7F) + 1;
+                    pos++;
+                    if (packetRepeats) {
+                        if (pos + pixelSize > size) {
+                            throw std::runtime_error("TGA pixel data is truncated");
+                        }
+                        std::memcpy(packet, data + pos, pixelSize);
+                        pos += pixelSize;
+                    }
+                }
+                packetLeft--;
+                if (packetRepeats) {
+                    src = packet;
+                } else {
+                    if (pos + pixelSize > size) {
+                        throw std::runtime_error("TGA pixel data is truncated");
+                    }
+                    src = data + pos;
+                    pos += pixelSize;
+                }
+            } else {
+                if (pos + pixelSize > size) {
+                    throw std::runtime_error("TGA pixel data is truncated");
+                }
+                src = data + pos;
+                pos += pixelSize;
+            }
+
+            uint8_t* dst = row + (rightToLeft ? width - 1 - i : i) * 4;
+            if (depth == 8) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+            } else if (depth == 16) {
+                uint32_t v = src[0] | (src[1] << 8);
+                dst[0] = uint8_t(((v >> 10) & 31) * 255 / 31);
+                dst[1] = uint8_t(((v >> 5) & 31) * 255 / 31);
+                dst[2] = uint8_t((v & 31) * 255 / 31);
+                dst[3] = 255;
+            } else {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
+                dst[3] = depth == 32 ? src[3] : 255;
+            }
+        }
+    }
+    return image;
+}
+
+std::vector<uint8_t> encodeTga(const Image& image) {
+    std::vector<uint8_t> file(18 + image.pixels.size());
+    file[2] = 2;                            // Uncompressed true-color
+    file[12] = uint8_t(image.width);
+    file[13] = uint8_t(image.width >> 8);
+    file[14] = uint8_t(image.height);
+    file[15] = uint8_t(image.height >> 8);
+    file[16] = 32;
+    file[17] = 8;                           // 8 alpha bits, bottom-left origin
+    uint8_t* out = &file[18];
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        out[i] = image.pixels[i + 2];       // TGA stores BGRA
+        out[i + 1] = image.pixels[i + 1];
+        out[i + 2] = image.pixels[i];
+        out[i + 3] = image.pixels[i + 3];
+    }
+    return file;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decoded 8-bit RGBA image. Rows are stored bottom to top, the order
+// glTexImage2D expects, so UV (0, 0) maps to the bottom-left corner.
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    size_t byteSize() const { return pixels.size(); }
+};
+
+// Decodes a PNG, JPEG or TGA file from memory, picking the decoder from the
+// file signature. Every format is expanded to RGBA8. Throws
+// std::runtime_error on malformed or unsupported input.
+Image decodeImage(const uint8_t* data, size_t size);
+
+// Opens the file through the FileSystem and decodes it. Safe to call from worker threads.
+Image loadImage(const std::string& path);
+
+// PNG: all color types and bit depths, including Adam7 interlacing and
+// tRNS transparency. 16-bit samples are truncated to 8 bits.
+Image decodePng(const uint8_t* data, size_t size);
+
+// JPEG: baseline and extended sequential Huffman, grayscale or YCbCr, any
+// chroma subsampling and restart intervals. Progressive files are rejected.
+Image decodeJpeg(const uint8_t* data, size_t size);
+
+// TGA: uncompressed and RLE true-color or grayscale, 8/16/24/32 bits.
+Image decodeTga(const uint8_t* data, size_t size);
+
+// Encodes an RGBA8 PNG, rows flipped to PNG's top-to-bottom order. Filtered
+// and deflated with fixed Huffman codes: small enough to commit, e.g. as
+// golden images, and quick to write.
+std::vector<uint8_t> encodePng(const Image& image);
+
+// Encodes an uncompressed 32-bit TGA, rows bottom to top as stored. Meant for
+// dumping frames quickly, not for small files.
+std::vector<uint8_t> encodeTga(const Image& image);
@@ -0,0 +1,446 @@
+#include "IoThread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define IO_THREAD_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <atomic>
+#endif
+
+namespace {
+
+constexpr size_t CHUNK_BYTES = 1 << 20;
+constexpr unsigned QUEUE_DEPTH = 32;
+
+} // namespace
+
+struct IoThread::File {
+    uint64_t id;
+    std::string path;
+    Callback done;
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int handle = -1;
+#endif
+    std::vector<uint8_t> data;
+    size_t chunksLeft = 0;
+    std::string error;
+    bool cancelled = false;     // Guarded by IoThread::mutex
+};
+
+struct IoThread::Chunk {
+    File* file;
+    size_t offset;
+    size_t length;
+#ifdef IO_THREAD_URING
+    iovec vector = {};
+#endif
+};
+
+// Submits chunk reads and reports them back with the number of bytes read,
+// or a negative errno.
+class IoThread::Backend {
+public:
+    virtual ~Backend() = default;
+    virtual const char* name() const = 0;
+    virtual void submit(Chunk* chunk) = 0;
+    // Blocks until at least one submitted chunk has completed.
+    virtual void complete(std::vector<std::pair<Chunk*, int64_t>>& done) = 0;
+};
+
+// Reads each chunk right away; complete() only hands the results back.
+class IoThread::PreadBackend : public Backend {
+public:
+    const char* name() const override { return "pread"; }
+
+    void submit(Chunk* chunk) override {
+        uint8_t* target = chunk->file->data.data() + chunk->offset;
+#ifdef _WIN32
+        OVERLAPPED position = {};
+        position.Offset = DWORD(chunk->offset);
+        position.OffsetHigh = DWORD(uint64_t(chunk->offset) >> 32);
+        DWORD bytes = 0;
+        if (!ReadFile(chunk->file->handle, target, DWORD(chunk->length), &bytes, &position)) {
+            completed.push_back({chunk, -int64_t(EIO)});
+            return;
+        }
+        completed.push_back({chunk, int64_t(bytes)});
+#else
+        ssize_t bytes;
+        do {
+            bytes = pread(chunk->file->handle, target, chunk->length, off_t(chunk->offset));
+        } while (bytes < 0 && errno == EINTR);
+        completed.push_back({chunk, bytes < 0 ? -int64_t(errno) : int64_t(bytes)});
+#endif
+    }
+
+    void complete(std::vector<std::pair<Chunk*, int64_t>>& done) override {
+        done.insert(done.end(), completed.begin(), completed.end());
+        completed.clear();
+    }
+
+private:
+    std::vector<std::pair<Chunk*, int64_t>> completed;
+};
+
+#ifdef IO_THREAD_URING
+// Minimal io_uring driver on raw system calls, so there is no liburing
+// dependency. One submission per chunk, IORING_OP_READV for kernels back
+// to 5.1.
+class IoThread::UringBackend : public Backend {
+public:
+    // Returns null if the kernel or a seccomp filter refuses io_uring.
+    static std::unique_ptr<Backend> create() {
+        std::unique_ptr<UringBackend> ring(new UringBackend());
+        return ring->ringFd >= 0 ? std::move(ring) : nullptr;
+    }
+
+    ~UringBackend() override {
+        if (sqes) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+    }
+
+    const char* name() const override { return "io_uring"; }
+
+    void submit(Chunk* chunk) override {
+        unsigned tail = sqTail->load(std::memory_order_relaxed);
+        unsigned index = tail & sqMask;
+        chunk->vector.iov_base = chunk->file->data.data() + chunk->offset;
+        chunk->vector.iov_len = chunk->length;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = chunk->file->handle;
+        sqe.addr = reinterpret_cast<uint64_t>(&chunk->vector);
+        sqe.len = 1;
+        sqe.off = chunk->offset;
+        sqe.user_data = reinterpret_cast<uint64_t>(chunk);
+        sqArray[index] = index;
+        sqTail->store(tail + 1, std::memory_order_release);
+        ++unsubmitted;
+    }
+
+    void complete(std::vector<std::pair<Chunk*, int64_t>>& done) override {
+        for (;;) {
+            unsigned head = cqHead->load(std::memory_order_relaxed);
+            unsigned tail = cqTail->load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                done.push_back({reinterpret_cast<Chunk*>(cqe.user_data), int64_t(cqe.res)});
+            }
+            cqHead->store(head, std::memory_order_release);
+            if (!done.empty() && !unsubmitted) {
+                return;
+            }
+            // Submits what is queued and sleeps until something completes
+            unsigned wait = done.empty() ? 1 : 0;
+            long submitted = syscall(__NR_io_uring_enter, ringFd, unsubmitted, wait, IORING_ENTER_GETEVENTS,
+                                     nullptr, 0);
+            if (submitted < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                // The ring is unusable; fail whatever is still queued
+                failUnsubmitted(done, -int64_t(errno));
+                return;
+            }
+            unsubmitted -= unsigned(submitted);
+        }
+    }
+
+private:
+    UringBackend() {
+        io_uring_params params = {};
+        ringFd = int(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (ringFd < 0) {
+            return;
+        }
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing : mapRing(cqRingSize, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mapRing(sqesSize, IORING_OFF_SQES));
+        if (!sqRing || !cqRing || !sqes) {
+            close(ringFd);
+            ringFd = -1;
+            return;
+        }
+        uint8_t* sq = static_cast<uint8_t*>(sqRing);
+        uint8_t* cq = static_cast<uint8_t*>(cqRing);
+        sqTail = reinterpret_cast<std::atomic<unsigned>*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<std::atomic<unsigned>*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    void* mapRing(size_t size, off_t offset) {
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        return mapping == MAP_FAILED ? nullptr : mapping;
+    }
+
+    void failUnsubmitted(std::vector<std::pair<Chunk*, int64_t>>& done, int64_t error) {
+        unsigned tail = sqTail->load(std::memory_order_relaxed);
+        for (unsigned i = tail - unsubmitted; i != tail; ++i) {
+            done.push_back({reinterpret_cast<Chunk*>(sqes[sqArray[i & sqMask]].user_data), error});
+        }
+        sqTail->store(tail - unsubmitted, std::memory_order_release);
+        unsubmitted = 0;
+    }
+
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    std::atomic<unsigned>* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    std::atomic<unsigned>* cqHead = nullptr;
+    std::atomic<unsigned>* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;
+};
+#endif
+
+IoThread::IoThread() {
+#ifdef IO_THREAD_URING
+    io = UringBackend::create();
+#endif
+    if (!io) {
+        io = std::make_unique<PreadBackend>();
+    }
+    thread = std::thread(&IoThread::threadLoop, this);
+}
+
+IoThread::~IoThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+        for (auto& entry : active) {
+            entry.second->cancelled = true;
+        }
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+const char* IoThread::backend() const {
+    return io->name();
+}
+
+uint64_t IoThread::read(const std::string& path, Callback done) {
+    auto file = std::make_unique<File>();
+    file->path = path;
+    file->done = std::move(done);
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextId++;
+        file->id = id;
+        queue.push_back(std::move(file));
+    }
+    wake.notify_one();
+    return id;
+}
+
+bool IoThread::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+        if ((*it)->id == id) {
+            queue.erase(it);
+            return true;
+        }
+    }
+    auto it = active.find(id);
+    if (it == active.end()) {
+        return false;
+    }
+    it->second->cancelled = true;
+    return true;
+}
+
+void IoThread::threadLoop() {
+    std::vector<std::unique_ptr<File>> files;
+    std::deque<std::unique_ptr<Chunk>> waiting;         // Not yet submitted
+    std::vector<std::unique_ptr<Chunk>> submitted;
+    std::vector<std::pair<Chunk*, int64_t>> done;
+
+    for (;;) {
+        // Start new files while there is room in the queue
+        std::vector<std::unique_ptr<File>> opened;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (files.empty()) {
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            }
+            if (stopping) {
+                break;
+            }
+            while (!queue.empty() && waiting.size() + submitted.size() + opened.size() < QUEUE_DEPTH) {
+                opened.push_back(std::move(queue.front()));
+                queue.pop_front();
+                active[opened.back()->id] = opened.back().get();
+            }
+        }
+        for (std::unique_ptr<File>& file : opened) {
+            if (!open(*file)) {
+                finish(*file);
+                continue;
+            }
+            for (size_t offset = 0; offset < file->data.size(); offset += CHUNK_BYTES) {
+                auto chunk = std::make_unique<Chunk>();
+                chunk->file = file.get();
+                chunk->offset = offset;
+                chunk->length = std::min(CHUNK_BYTES, file->data.size() - offset);
+                waiting.push_back(std::move(chunk));
+                file->chunksLeft++;
+            }
+            if (file->chunksLeft == 0) {
+                finish(*file);
+                continue;
+            }
+            files.push_back(std::move(file));
+        }
+
+        while (!waiting.empty() && submitted.size() < QUEUE_DEPTH) {
+            io->submit(waiting.front().get());
+            submitted.push_back(std::move(waiting.front()));
+            waiting.pop_front();
+        }
+        if (submitted.empty()) {
+            continue;
+        }
+
+        done.clear();
+        io->complete(done);
+        for (const std::pair<Chunk*, int64_t>& result : done) {
+            Chunk* chunk = result.first;
+            File& file = *chunk->file;
+            bool retry = false;
+            if (result.second < 0) {
+                file.error = std::strerror(int(-result.second));
+            } else if (result.second == 0) {
+                file.error = "Unexpected end of file";
+            } else if (size_t(result.second) < chunk->length) {
+                // Short read; ask for the rest
+                chunk->offset += size_t(result.second);
+                chunk->length -= size_t(result.second);
+                retry = true;
+            }
+            auto it = std::find_if(submitted.begin(), submitted.end(),
+                                   [chunk](const std::unique_ptr<Chunk>& c) { return c.get() == chunk; });
+            if (retry) {
+                waiting.push_front(std::move(*it));
+            } else {
+                file.chunksLeft--;
+            }
+            submitted.erase(it);
+        }
+        for (auto it = files.begin(); it != files.end();) {
+            if ((*it)->chunksLeft == 0) {
+                finish(**it);
+                it = files.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+    }
+
+    // Let the kernel finish with the buffers before they are freed
+    while (!submitted.empty()) {
+        done.clear();
+        io->complete(done);
+        for (const std::pair<Chunk*, int64_t>& result : done) {
+            submitted.erase(std::find_if(submitted.begin(), submitted.end(),
+                                         [&](const std::unique_ptr<Chunk>& c) { return c.get() == result.first; }));
+        }
+    }
+    for (std::unique_ptr<File>& file : files) {
+        finish(*file);
+    }
+}
+
+bool IoThread::open(File& file) {
+#ifdef _WIN32
+    file.handle = CreateFileA(file.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (file.handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file.handle, &size)) {
+        file.error = "Failed to open file";
+        return false;
+    }
+    file.data.resize(size_t(size.QuadPart));
+#else
+    file.handle = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (file.handle < 0 || fstat(file.handle, &info) != 0) {
+        file.error = std::strerror(errno);
+        return false;
+    }
+    file.data.resize(size_t(info.st_size));
+#endif
+    return true;
+}
+
+// Closes the file and runs its callback unless the read was cancelled.
+void IoThread::finish(File& file) {
+#ifdef _WIN32
+    if (file.handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file.handle);
+    }
+#else
+    if (file.handle >= 0) {
+        ::close(file.handle);
+    }
+#endif
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active.erase(file.id);
+        cancelled = file.cancelled;
+    }
+    if (!cancelled) {
+        if (!file.error.empty()) {
+            file.data.clear();
+        }
+        file.done(std::move(file.data), file.error.empty() ? file.error : file.path + ": " + file.error);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Dedicated thread that reads whole files into memory, so disk latency
+// never lands on the main thread or blocks a worker. Files are split into
+// chunks that are kept in flight together: through io_uring on Linux when
+// the kernel allows it, and with positioned reads (pread, or ReadFile at an
+// offset on Windows) otherwise.
+//
+// Reads run in submission order; callers that care about priority, like
+// AssetManager, keep their own queue and only submit a few at a time.
+class IoThread {
+public:
+    // Runs on the I/O thread, so keep it short, e.g. hand the bytes to a
+    // job. `error` is empty on success.
+    using Callback = std::function<void(std::vector<uint8_t> data, const std::string& error)>;
+
+    IoThread();
+    // Drops queued reads and waits for the in-flight ones without calling
+    // their callbacks.
+    ~IoThread();
+
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    uint64_t read(const std::string& path, Callback done);
+
+    // Returns true if the callback will not run, false if it already has or
+    // is running right now.
+    bool cancel(uint64_t id);
+
+    // "io_uring" or "pread"
+    const char* backend() const;
+
+private:
+    struct File;
+    struct Chunk;
+    class Backend;
+    class PreadBackend;
+    class UringBackend;
+
+    void threadLoop();
+    bool open(File& file);
+    void finish(File& file);
+
+    std::unique_ptr<Backend> io;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<File>> queue;                    // Guarded by mutex
+    std::unordered_map<uint64_t, File*> active;                 // Guarded by mutex
+    uint64_t nextId = 1;                                        // Guarded by mutex
+    bool stopping = false;                                      // Guarded by mutex
+};
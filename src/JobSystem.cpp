@@ -0,0 +1,70 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+JobSystem::JobSystem(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+void JobSystem::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return queue.empty() && running == 0; });
+}
+
+void JobSystem::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+            running++;
+        }
+
+        // Jobs report their own errors; this only keeps a worker alive
+        try {
+            job();
+        } catch (const std::exception& e) {
+            std::cerr << "Unhandled exception in job: " << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            if (queue.empty() && running == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+}
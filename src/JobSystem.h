@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads fed from one FIFO queue. Jobs must not touch
+// GL; anything that needs the context is handed back to the main thread by
+// the job's owner (see TextureLoader::update).
+class JobSystem {
+public:
+    // 0 picks one thread per hardware thread, minus the main thread.
+    explicit JobSystem(unsigned threadCount = 0);
+    // Finishes every queued job before joining the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(std::function<void()> job);
+
+    // Blocks until the queue is empty and no job is running.
+    void wait();
+
+    unsigned threadCount() const { return unsigned(workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable idle;
+    size_t running = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,505 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr int JPEG_FAST_BITS = 9;
+constexpr int JPEG_MAX_COMPONENTS = 3;
+
+const uint8_t ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Scale factors of the AAN IDCT, folded into the dequantization tables.
+const float AAN_SCALE[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                            1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+uint32_t readBE16(const uint8_t* p) {
+    return (uint32_t(p[0]) << 8) | p[1];
+}
+
+// MSB-first entropy-coded segment reader. Stuffed 0xFF00 pairs are
+// unescaped; on reaching a marker it feeds zeros and stays put.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size, size_t pos) : data(data), size(size), pos(pos) {}
+
+    uint32_t peek(int count) {
+        while (bitCount < count) {
+            uint32_t byte = 0;
+            if (pos < size && !atMarker) {
+                byte = data[pos];
+                if (byte == 0xFF) {
+                    uint8_t next = pos + 1 < size ? data[pos + 1] : 0;
+                    if (next == 0x00) {
+                        pos += 2;
+                    } else {
+                        atMarker = true;
+                        byte = 0;
+                    }
+                } else {
+                    pos++;
+                }
+            }
+            buffer |= byte << (24 - bitCount);
+            bitCount += 8;
+        }
+        return buffer >> (32 - count);
+    }
+
+    void consume(int count) {
+        buffer <<= count;
+        bitCount -= count;
+    }
+
+    uint32_t bits(int count) {
+        if (count == 0) {
+            return 0;
+        }
+        uint32_t value = peek(count);
+        consume(count);
+        return value;
+    }
+
+    // Skips to the byte after the next RSTn marker and clears the buffer.
+    void restart() {
+        buffer = 0;
+        bitCount = 0;
+        atMarker = false;
+        while (pos + 1 < size && !(data[pos] == 0xFF && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7)) {
+            pos++;
+        }
+        pos = std::min(pos + 2, size);
+    }
+
+    // Position of the marker that ended the segment.
+    size_t position() const { return pos; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint32_t buffer = 0;
+    int bitCount = 0;
+    bool atMarker = false;
+};
+
+class Huffman {
+public:
+    bool defined = false;
+
+    // counts[i] codes of length i + 1, followed by the symbols in code order.
+    void build(const uint8_t* counts, const uint8_t* values) {
+        std::memset(fast, 0xFF, sizeof(fast));
+        int code = 0, k = 0;
+        for (int len = 1; len <= 16; ++len) {
+            valueOffset[len] = k - code;
+            for (int i = 0; i < counts[len - 1]; ++i, ++k, ++code) {
+                symbols[k] = values[k];
+                if (len <= JPEG_FAST_BITS) {
+                    int shift = JPEG_FAST_BITS - len;
+                    for (int j = 0; j < (1 << shift); ++j) {
+                        fast[(code << shift) | j] = uint16_t((len << 8) | values[k]);
+                    }
+                }
+            }
+            maxCode[len] = counts[len - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        defined = true;
+    }
+
+    uint32_t decode(BitReader& reader) const {
+        uint16_t entry = fast[reader.peek(JPEG_FAST_BITS)];
+        if (entry != 0xFFFF) {
+            reader.consume(entry >> 8);
+            return entry & 0xFF;
+        }
+        uint32_t bits = reader.peek(16);
+        for (int len = JPEG_FAST_BITS + 1; len <= 16; ++len) {
+            int code = int(bits >> (16 - len));
+            if (code <= maxCode[len]) {
+                reader.consume(len);
+                return symbols[valueOffset[len] + code];
+            }
+        }
+        throw std::runtime_error("Invalid JPEG Huffman code");
+    }
+
+private:
+    uint8_t symbols[256];
+    int maxCode[17];
+    int valueOffset[17];
+    uint16_t fast[1 << JPEG_FAST_BITS];        // (length << 8) | symbol, 0xFFFF if longer
+};
+
+struct Component {
+    uint32_t id;
+    uint32_t h, v;              // Sampling factors
+    uint32_t quantTable;
+    uint32_t dcTable, acTable;
+    uint32_t blocksX, blocksY;  // Blocks covering the padded MCU grid
+    int dcPredictor;
+    std::vector<uint8_t> plane; // blocksX * 8 wide
+};
+
+// Extends a `size`-bit magnitude category to a signed coefficient.
+int extend(uint32_t value, int size) {
+    return value < (1u << (size - 1)) ? int(value) - (1 << size) + 1 : int(value);
+}
+
+// Separable AAN float IDCT (Arai, Agui, Nakajima) with dequantization.
+void idct(const short* coefficients, const float* quant, uint8_t* out, size_t outStride) {
+    float workspace[64];
+    for (int col = 0; col < 8; ++col) {
+        const short* in = coefficients + col;
+        const float* q = quant + col;
+        float* ws = workspace + col;
+        if (!in[8] && !in[16] && !in[24] && !in[32] && !in[40] && !in[48] && !in[56]) {
+            float dc = in[0] * q[0];
+            for (int i = 0; i < 8; ++i) {
+                ws[i * 8] = dc;
+            }
+            continue;
+        }
+
+        float tmp0 = in[0] * q[0], tmp1 = in[16] * q[16], tmp2 = in[32] * q[32], tmp3 = in[48] * q[48];
+        float tmp10 = tmp0 + tmp2, tmp11 = tmp0 - tmp2;
+        float tmp13 = tmp1 + tmp3, tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+        tmp0 = tmp10 + tmp13; tmp3 = tmp10 - tmp13;
+        tmp1 = tmp11 + tmp12; tmp2 = tmp11 - tmp12;
+
+        float tmp4 = in[8] * q[8], tmp5 = in[24] * q[24], tmp6 = in[40] * q[40], tmp7 = in[56] * q[56];
+        float z13 = tmp6 + tmp5, z10 = tmp6 - tmp5, z11 = tmp4 + tmp7, z12 = tmp4 - tmp7;
+        tmp7 = z11 + z13;
+        tmp11 = (z11 - z13) * 1.414213562f;
+        float z5 = (z10 + z12) * 1.847759065f;
+        tmp10 = z5 - z12 * 1.082392200f;
+        tmp12 = z5 - z10 * 2.613125930f;
+        tmp6 = tmp12 - tmp7;
+        tmp5 = tmp11 - tmp6;
+        tmp4 = tmp10 - tmp5;
+
+        ws[0] = tmp0 + tmp7;  ws[56] = tmp0 - tmp7;
+        ws[8] = tmp1 + tmp6;  ws[48] = tmp1 - tmp6;
+        ws[16] = tmp2 + tmp5; ws[40] = tmp2 - tmp5;
+        ws[24] = tmp3 + tmp4; ws[32] = tmp3 - tmp4;
+    }
+
+    for (int row = 0; row < 8; ++row) {
+        const float* ws = workspace + row * 8;
+        uint8_t* dst = out + row * outStride;
+
+        float tmp10 = ws[0] + ws[4], tmp11 = ws[0] - ws[4];
+        float tmp13 = ws[2] + ws[6], tmp12 = (ws[2] - ws[6]) * 1.414213562f - tmp13;
+        float tmp0 = tmp10 + tmp13, tmp3 = tmp10 - tmp13;
+        float tmp1 = tmp11 + tmp12, tmp2 = tmp11 - tmp12;
+
+        float z13 = ws[5] + ws[3], z10 = ws[5] - ws[3], z11 = ws[1] + ws[7], z12 = ws[1] - ws[7];
+        float tmp7 = z11 + z13;
+        tmp11 = (z11 - z13) * 1.414213562f;
+        float z5 = (z10 + z12) * 1.847759065f;
+        tmp10 = z5 - z12 * 1.082392200f;
+        tmp12 = z5 - z10 * 2.613125930f;
+        float tmp6 = tmp12 - tmp7;
+        float tmp5 = tmp11 - tmp6;
+        float tmp4 = tmp10 - tmp5;
+
+        // Outputs carry a factor of 8; undo it and level shift by 128
+        float values[8] = {tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 + tmp4,
+                           tmp3 - tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7};
+        for (int i = 0; i < 8; ++i) {
+            int v = int(values[i] * 0.125f + 128.5f);
+            dst[i] = uint8_t(std::min(std::max(v, 0), 255));
+        }
+    }
+}
+
+uint8_t clampByte(float v) {
+    return uint8_t(std::min(std::max(v + 0.5f, 0.0f), 255.0f));
+}
+
+} // namespace
+
+Image decodeJpeg(const uint8_t* data, size_t size) {
+    float quantTables[4][64];
+    bool quantDefined[4] = {};
+    Huffman dcTables[4], acTables[4];
+    Component components[JPEG_MAX_COMPONENTS] = {};
+    uint32_t componentCount = 0;
+    uint32_t width = 0, height = 0;
+    uint32_t maxH = 1, maxV = 1;
+    uint32_t mcusX = 0, mcusY = 0;
+    uint32_t restartInterval = 0;
+    bool adobeRgb = false;
+    bool seenFrame = false;
+    bool done = false;
+
+    size_t pos = 2;
+    while (!done) {
+        // Markers may be preceded by any number of 0xFF fill bytes
+        while (pos < size && data[pos] == 0xFF && pos + 1 < size && data[pos + 1] == 0xFF) {
+            pos++;
+        }
+        if (pos + 2 > size || data[pos] != 0xFF) {
+            throw std::runtime_error("JPEG marker is truncated");
+        }
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xD9) {
+            break;
+        }
+        if (pos + 4 > size) {
+            throw std::runtime_error("JPEG segment is truncated");
+        }
+        size_t length = readBE16(data + pos + 2);
+        const uint8_t* segment = data + pos + 4;
+        if (length < 2 || pos + 2 + length > size) {
+            throw std::runtime_error("JPEG segment is truncated");
+        }
+        size_t segmentSize = length - 2;
+        pos += 2 + length;
+
+        switch (marker) {
+            case 0xDB: {    // DQT
+                for (size_t i = 0; i < segmentSize;) {
+                    uint32_t precision = segment[i] >> 4;
+                    uint32_t id = segment[i] & 15;
+                    size_t tableSize = precision ? 128 : 64;
+                    if (id > 3 || i + 1 + tableSize > segmentSize) {
+                        throw std::runtime_error("Invalid JPEG quantization table");
+                    }
+                    for (int k = 0; k < 64; ++k) {
+                        uint32_t q = precision ? readBE16(segment + i + 1 + k * 2) : segment[i + 1 + k];
+                        uint32_t natural = ZIGZAG[k];
+                        quantTables[id][natural] = float(q) * AAN_SCALE[natural / 8] * AAN_SCALE[natural % 8];
+                    }
+                    quantDefined[id] = true;
+                    i += 1 + tableSize;
+                }
+                break;
+            }
+            case 0xC4: {    // DHT
+                for (size_t i = 0; i < segmentSize;) {
+                    if (i + 17 > segmentSize) {
+                        throw std::runtime_error("Invalid JPEG Huffman table");
+                    }
+                    uint32_t tableClass = segment[i] >> 4;
+                    uint32_t id = segment[i] & 15;
+                    const uint8_t* counts = segment + i + 1;
+                    size_t total = 0;
+                    for (int k = 0; k < 16; ++k) {
+                        total += counts[k];
+                    }
+                    if (tableClass > 1 || id > 3 || total > 256 || i + 17 + total > segmentSize) {
+                        throw std::runtime_error("Invalid JPEG Huffman table");
+                    }
+                    (tableClass ? acTables : dcTables)[id].build(counts, segment + i + 17);
+                    i += 17 + total;
+                }
+                break;
+            }
+            case 0xDD:      // DRI
+                if (segmentSize < 2) {
+                    throw std::runtime_error("Invalid JPEG restart interval");
+                }
+                restartInterval = readBE16(segment);
+                break;
+            case 0xEE:      // APP14: Adobe files may store RGB instead of YCbCr
+                if (segmentSize >= 12 && std::memcmp(segment, "Adobe", 5) == 0) {
+                    adobeRgb = segment[11] == 0;
+                }
+                break;
+            case 0xC0:      // SOF0 baseline
+            case 0xC1: {    // SOF1 extended sequential
+                if (segmentSize < 6 || segment[0] != 8) {
+                    throw std::runtime_error("Unsupported JPEG sample precision");
+                }
+                height = readBE16(segment + 1);
+                width = readBE16(segment + 3);
+                componentCount = segment[5];
+                if (width == 0 || height == 0 || (componentCount != 1 && componentCount != 3) ||
+                    segmentSize < 6 + componentCount * 3) {
+                    throw std::runtime_error("Unsupported JPEG frame");
+                }
+                for (uint32_t c = 0; c < componentCount; ++c) {
+                    const uint8_t* spec = segment + 6 + c * 3;
+                    Component& component = components[c];
+                    component.id = spec[0];
+                    component.h = spec[1] >> 4;
+                    component.v = spec[1] & 15;
+                    component.quantTable = spec[2];
+                    if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 ||
+                        component.quantTable > 3) {
+                        throw std::runtime_error("Invalid JPEG component");
+                    }
+                    maxH = std::max(maxH, component.h);
+                    maxV = std::max(maxV, component.v);
+                }
+                mcusX = (width + maxH * 8 - 1) / (maxH * 8);
+                mcusY = (height + maxV * 8 - 1) / (maxV * 8);
+                for (uint32_t c = 0; c < componentCount; ++c) {
+                    Component& component = components[c];
+                    component.blocksX = mcusX * component.h;
+                    component.blocksY = mcusY * component.v;
+                    component.plane.assign(size_t(component.blocksX) * component.blocksY * 64, 0);
+                }
+                seenFrame = true;
+                break;
+            }
+            case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+            case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+                throw std::runtime_error("Progressive, lossless and arithmetic JPEGs are not supported");
+            case 0xDA: {    // SOS
+                if (!seenFrame || segmentSize < 1) {
+                    throw std::runtime_error("JPEG scan precedes its frame");
+                }
+                uint32_t scanCount = segment[0];
+                if (scanCount < 1 || scanCount > componentCount || segmentSize < 4 + scanCount * 2) {
+                    throw std::runtime_error("Invalid JPEG scan");
+                }
+                Component* scan[JPEG_MAX_COMPONENTS];
+                for (uint32_t s = 0; s < scanCount; ++s) {
+                    uint32_t id = segment[1 + s * 2];
+                    scan[s] = nullptr;
+                    for (uint32_t c = 0; c < componentCount; ++c) {
+                        if (components[c].id == id) {
+                            scan[s] = &components[c];
+                        }
+                    }
+                    if (!scan[s]) {
+                        throw std::runtime_error("JPEG scan references an unknown component");
+                    }
+                    scan[s]->dcTable = segment[2 + s * 2] >> 4;
+                    scan[s]->acTable = segment[2 + s * 2] & 15;
+                    scan[s]->dcPredictor = 0;
+                    if (scan[s]->dcTable > 3 || scan[s]->acTable > 3 || !dcTables[scan[s]->dcTable].defined ||
+                        !acTables[scan[s]->acTable].defined || !quantDefined[scan[s]->quantTable]) {
+                        throw std::runtime_error("JPEG scan references an undefined table");
+                    }
+                }
+
+                BitReader reader(data, size, pos);
+                short coefficients[64];
+                auto decodeBlock = [&](Component& component, uint32_t bx, uint32_t by) {
+                    std::memset(coefficients, 0, sizeof(coefficients));
+                    uint32_t category = dcTables[component.dcTable].decode(reader);
+                    if (category > 11) {
+                        throw std::runtime_error("Invalid JPEG DC coefficient");
+                    }
+                    if (category) {
+                        component.dcPredictor += extend(reader.bits(int(category)), int(category));
+                    }
+                    coefficients[0] = short(component.dcPredictor);
+                    const Huffman& ac = acTables[component.acTable];
+                    for (int k = 1; k < 64;) {
+                        uint32_t rs = ac.decode(reader);
+                        uint32_t run = rs >> 4, sizeBits = rs & 15;
+                        if (sizeBits == 0) {
+                            if (run != 15) {
+                                break;      // End of block
+                            }
+                            k += 16;
+                            continue;
+                        }
+                        k += int(run);
+                        if (k > 63) {
+                            throw std::runtime_error("Invalid JPEG AC coefficient");
+                        }
+                        coefficients[ZIGZAG[k++]] = short(extend(reader.bits(int(sizeBits)), int(sizeBits)));
+                    }
+                    size_t stride = size_t(component.blocksX) * 8;
+                    idct(coefficients, quantTables[component.quantTable],
+                         &component.plane[size_t(by) * 8 * stride + size_t(bx) * 8], stride);
+                };
+
+                // Interleaved scans walk MCUs; a single-component scan walks
+                // that component's blocks, clipped to the image
+                bool interleaved = scanCount > 1;
+                uint32_t unitsX = mcusX, unitsY = mcusY;
+                if (!interleaved) {
+                    unitsX = ((width * scan[0]->h + maxH - 1) / maxH + 7) / 8;
+                    unitsY = ((height * scan[0]->v + maxV - 1) / maxV + 7) / 8;
+                }
+                uint32_t untilRestart = restartInterval;
+                for (uint32_t uy = 0; uy < unitsY; ++uy) {
+                    for (uint32_t ux = 0; ux < unitsX; ++ux) {
+                        if (restartInterval && untilRestart == 0) {
+                            reader.restart();
+                            for (uint32_t s = 0; s < scanCount; ++s) {
+                                scan[s]->dcPredictor = 0;
+                            }
+                            untilRestart = restartInterval;
+                        }
+                        if (interleaved) {
+                            for (uint32_t s = 0; s < scanCount; ++s) {
+                                for (uint32_t v = 0; v < scan[s]->v; ++v) {
+                                    for (uint32_t h = 0; h < scan[s]->h; ++h) {
+                                        decodeBlock(*scan[s], ux * scan[s]->h + h, uy * scan[s]->v + v);
+                                    }
+                                }
+                            }
+                        } else {
+                            decodeBlock(*scan[0], ux, uy);
+                        }
+                        untilRestart--;
+                    }
+                }
+
+                // Resume marker parsing after the entropy-coded data
+                pos = reader.position();
+                while (pos + 1 < size && !(data[pos] == 0xFF && data[pos + 1] != 0x00 &&
+                                           (data[pos + 1] < 0xD0 || data[pos + 1] > 0xD7))) {
+                    pos++;
+                }
+                break;
+            }
+            default:
+                break;      // APPn, COM and friends
+        }
+        done = pos >= size;
+    }
+    if (!seenFrame) {
+        throw std::runtime_error("JPEG has no frame");
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t* dst = &image.pixels[size_t(height - 1 - y) * width * 4];
+        // Chroma is upsampled by replication
+        const uint8_t* rows[JPEG_MAX_COMPONENTS];
+        for (uint32_t c = 0; c < componentCount; ++c) {
+            const Component& component = components[c];
+            rows[c] = &component.plane[size_t(y * component.v / maxV) * component.blocksX * 8];
+        }
+        for (uint32_t x = 0; x < width; ++x, dst += 4) {
+            if (componentCount == 1) {
+                dst[0] = dst[1] = dst[2] = rows[0][x];
+            } else {
+                float c0 = rows[0][x * components[0].h / maxH];
+                float c1 = rows[1][x * components[1].h / maxH];
+                float c2 = rows[2][x * components[2].h / maxH];
+                if (adobeRgb) {
+                    dst[0] = uint8_t(c0);
+                    dst[1] = uint8_t(c1);
+                    dst[2] = uint8_t(c2);
+                } else {
+                    float cb = c1 - 128.0f, cr = c2 - 128.0f;
+                    dst[0] = clampByte(c0 + 1.402f * cr);
+                    dst[1] = clampByte(c0 - 0.344136f * cb - 0.714136f * cr);
+                    dst[2] = clampByte(c0 + 1.772f * cb);
+                }
+            }
+            dst[3] = 255;
+        }
+    }
+    return image;
+}
@@ -0,0 +1,36 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+
+LodSelector::LodSelector(const glm::mat4& projection, float viewportHeight, const LodSettings& settings)
+    : projectionScale(projection[1][1] * viewportHeight * 0.5f),
+      orthographic(projection[3][3] == 1.0f),
+      settings(settings) {}
+
+float LodSelector::pixelsPerUnit(const Mesh& mesh, const glm::mat4& modelView) const {
+    const MeshBounds& bounds = mesh.bounds();
+    glm::vec3 center = glm::vec3(modelView * glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], 1.0f));
+    float scale = std::max(glm::length(glm::vec3(modelView[0])),
+                           std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+    if (orthographic) {
+        return projectionScale * scale;
+    }
+    float distance = std::max(glm::length(center) - bounds.radius * scale, 1e-4f);
+    return projectionScale * scale / distance;
+}
+
+uint32_t LodSelector::select(const Mesh& mesh, const glm::mat4& modelView, uint32_t& currentLod) const {
+    uint32_t last = mesh.lodCount() - 1;
+    currentLod = std::min(currentLod, last);
+    float scale = pixelsPerUnit(mesh, modelView);
+    float coarser = settings.maxPixelError * (1.0f - settings.hysteresis);
+    float finer = settings.maxPixelError * (1.0f + settings.hysteresis);
+
+    while (currentLod > 0 && mesh.lodError(currentLod) * scale > finer) {
+        currentLod--;
+    }
+    while (currentLod < last && mesh.lodError(currentLod + 1) * scale <= coarser) {
+        currentLod++;
+    }
+    return currentLod;
+}
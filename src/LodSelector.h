@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+struct LodSettings {
+    float maxPixelError = 1.0f;     // Largest tolerated error on screen
+    float hysteresis = 0.25f;       // Fraction of maxPixelError around each switch point
+};
+
+// Picks the coarsest mesh LOD whose simplification error projects to at most
+// maxPixelError pixels. Build one per frame from the current projection.
+class LodSelector {
+public:
+    LodSelector(const glm::mat4& projection, float viewportHeight, const LodSettings& settings = LodSettings());
+
+    // Projected size of one mesh unit, in pixels, at the bounding sphere's
+    // closest point to the camera.
+    float pixelsPerUnit(const Mesh& mesh, const glm::mat4& modelView) const;
+
+    // Updates and returns currentLod. The LOD only changes once the error
+    // leaves the hysteresis band, so meshes near a switch point don't flicker.
+    uint32_t select(const Mesh& mesh, const glm::mat4& modelView, uint32_t& currentLod) const;
+
+private:
+    float projectionScale;      // Pixels per unit at distance 1
+    bool orthographic;
+    LodSettings settings;
+};
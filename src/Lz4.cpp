@@ -0,0 +1,79 @@
+#include "Lz4.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+
+// Lengths of 15 continue in following bytes, each adding up to 255
+size_t readLength(const uint8_t*& src, const uint8_t* end, size_t length) {
+    if (length != 15) {
+        return length;
+    }
+    uint8_t byte;
+    do {
+        if (src == end) {
+            throw std::runtime_error("LZ4 block is truncated");
+        }
+        byte = *src++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+} // namespace
+
+void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* srcEnd = src + srcSize;
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + dstSize;
+
+    while (src < srcEnd) {
+        uint8_t token = *src++;
+
+        size_t literals = readLength(src, srcEnd, token >> 4);
+        if (literals > size_t(srcEnd - src) || literals > size_t(outEnd - out)) {
+            throw std::runtime_error("LZ4 literals overrun the block");
+        }
+        std::memcpy(out, src, literals);
+        src += literals;
+        out += literals;
+        // The last sequence has literals only
+        if (src == srcEnd) {
+            break;
+        }
+
+        if (srcEnd - src < 2) {
+            throw std::runtime_error("LZ4 block is truncated");
+        }
+        size_t offset = size_t(src[0]) | (size_t(src[1]) << 8);
+        src += 2;
+        if (offset == 0 || offset > size_t(out - dst)) {
+            throw std::runtime_error("LZ4 match offset is out of range");
+        }
+        size_t length = readLength(src, srcEnd, token & 15) + MIN_MATCH;
+        if (length > size_t(outEnd - out)) {
+            throw std::runtime_error("LZ4 match overruns the output");
+        }
+        // Matches may overlap their own output, e.g. offset 1 repeats a byte
+        const uint8_t* match = out - offset;
+        if (offset >= length) {
+            std::memcpy(out, match, length);
+            out += length;
+        } else if (offset >= 8) {
+            for (size_t i = 0; i < length; i += 8) {
+                std::memcpy(out + i, match + i, length - i < 8 ? length - i : 8);
+            }
+            out += length;
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                *out++ = *match++;
+            }
+        }
+    }
+    if (out != outEnd) {
+        throw std::runtime_error("LZ4 block decodes to the wrong size");
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decodes one raw LZ4 block (no frame header) into exactly dstSize bytes.
+// LZ4 gives up some ratio for decoding speed, so reading fewer bytes from
+// disk isn't paid back in decompression time. Throws
+// std::runtime_error if the block is malformed or doesn't decode to
+// dstSize bytes.
+void lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
@@ -0,0 +1,117 @@
+#include "Mesh.h"
+#include "RenderStats.h"
+
+#include <cstring>
+#include <stdexcept>
+
+MeshBlob::MeshBlob(const uint8_t* data, size_t size) : base(data) {
+    if (size < sizeof(MeshFileHeader) || reinterpret_cast<uintptr_t>(data) % alignof(MeshFileHeader) != 0) {
+        throw std::runtime_error("Mesh blob is truncated or misaligned");
+    }
+    fileHeader = reinterpret_cast<const MeshFileHeader*>(data);
+    const MeshFileHeader& h = *fileHeader;
+    if (h.magic != MESH_FILE_MAGIC) {
+        throw std::runtime_error("Not a mesh blob");
+    }
+    if (h.version != MESH_FILE_VERSION) {
+        throw std::runtime_error("Unsupported mesh blob version " + std::to_string(h.version));
+    }
+    if (h.attributeCount == 0 || h.attributeCount > MESH_MAX_ATTRIBUTES ||
+        h.lodCount == 0 || h.lodCount > MESH_MAX_LODS) {
+        throw std::runtime_error("Mesh blob has an invalid layout or LOD table");
+    }
+    if (h.indexType != GL_UNSIGNED_SHORT && h.indexType != GL_UNSIGNED_INT) {
+        throw std::runtime_error("Mesh blob has an invalid index type");
+    }
+
+    uint64_t indexSize = h.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    bool streamsFit =
+        h.vertexDataOffset % MESH_STREAM_ALIGNMENT == 0 &&
+        h.indexDataOffset % MESH_STREAM_ALIGNMENT == 0 &&
+        h.vertexDataSize == uint64_t(h.vertexCount) * h.vertexStride &&
+        h.indexDataSize == uint64_t(h.indexCount) * indexSize &&
+        h.vertexDataOffset >= sizeof(MeshFileHeader) && h.vertexDataOffset <= size &&
+        h.vertexDataSize <= size - h.vertexDataOffset &&
+        h.indexDataOffset >= sizeof(MeshFileHeader) && h.indexDataOffset <= size &&
+        h.indexDataSize <= size - h.indexDataOffset;
+    if (!streamsFit) {
+        throw std::runtime_error("Mesh blob streams are out of bounds");
+    }
+    for (uint32_t i = 0; i < h.attributeCount; ++i) {
+        const MeshAttribute& attribute = h.attributes[i];
+        VertexFormat format;
+        if (!vertexFormatFromGL(attribute.type, attribute.components, attribute.normalized != 0, format) ||
+            attribute.offset + vertexFormatInfo(format).size > h.vertexStride) {
+            throw std::runtime_error("Mesh blob has an invalid vertex attribute");
+        }
+    }
+    for (uint32_t i = 0; i < h.lodCount; ++i) {
+        if (uint64_t(h.lods[i].indexOffset) + h.lods[i].indexCount > h.indexCount) {
+            throw std::runtime_error("Mesh blob LOD range is out of bounds");
+        }
+    }
+}
+
+VertexLayout MeshBlob::layout() const {
+    VertexLayout layout;
+    for (uint32_t i = 0; i < fileHeader->attributeCount; ++i) {
+        const MeshAttribute& attribute = fileHeader->attributes[i];
+        VertexFormat format = VertexFormat::Float3;
+        vertexFormatFromGL(attribute.type, attribute.components, attribute.normalized != 0, format);
+        layout.add(attribute.location, format, attribute.offset);
+    }
+    layout.setStride(fileHeader->vertexStride);
+    return layout;
+}
+
+Mesh::Mesh(const std::string& path) : Mesh(openFile(path)) {}
+
+Mesh::Mesh(const FileData& file) : Mesh(MeshBlob(file.data(), file.size())) {}
+
+Mesh::Mesh(const MeshBlob& blob)
+    : vao(std::make_unique<VertexArray>()),
+      vbo(std::make_unique<VertexBuffer>(blob.vertexData(), blob.header().vertexDataSize)),
+      ibo(std::make_unique<IndexBuffer>(blob.indexData(), blob.header().indexDataSize)) {
+    readHeader(blob);
+    vao->setLayout(*vbo, vertexLayout);
+    vao->setIndexBuffer(*ibo);
+}
+
+Mesh::Mesh(const MeshBlob& blob, MeshPool& pool) : pool(&pool), poolMesh(pool.add(blob)) {
+    readHeader(blob);
+}
+
+Mesh::~Mesh() {
+    if (pool) {
+        pool->remove(poolMesh);
+    }
+}
+
+void Mesh::readHeader(const MeshBlob& blob) {
+    const MeshFileHeader& h = blob.header();
+    indexType = h.indexType;
+    indexSize = h.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    numLods = h.lodCount;
+    std::memcpy(lods, h.lods, sizeof(lods));
+    meshBounds = h.bounds;
+    vertexLayout = blob.layout();
+
+    dequantize = glm::mat4(1.0f);
+    if (h.flags & MESH_FLAG_QUANTIZED_POSITIONS) {
+        PositionQuantization quantization(glm::vec3(h.bounds.min[0], h.bounds.min[1], h.bounds.min[2]),
+                                          glm::vec3(h.bounds.max[0], h.bounds.max[1], h.bounds.max[2]));
+        dequantize = quantization.dequantizeMatrix();
+    }
+}
+
+void Mesh::draw(uint32_t lod) const {
+    const MeshLod& range = lods[lod < numLods ? lod : numLods - 1];
+    if (pool) {
+        pool->draw(poolMesh, range.indexOffset, range.indexCount);
+        return;
+    }
+    vao->bind();
+    glDrawElements(GL_TRIANGLES, range.indexCount, indexType,
+                   reinterpret_cast<void*>(static_cast<uintptr_t>(range.indexOffset) * indexSize));
+    countDraw(range.indexCount / 3);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Buffers.h"
+#include "FileSystem.h"
+#include "MeshFormat.h"
+#include "MeshPool.h"
+#include "VertexLayout.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Validated, read-only view of a cooked mesh blob. Nothing is copied; the
+// stream pointers point into the memory passed to the constructor.
+class MeshBlob {
+public:
+    MeshBlob(const uint8_t* data, size_t size);
+
+    const MeshFileHeader& header() const { return *fileHeader; }
+    const void* vertexData() const { return base + fileHeader->vertexDataOffset; }
+    const void* indexData() const { return base + fileHeader->indexDataOffset; }
+    VertexLayout layout() const;
+
+private:
+    const uint8_t* base;
+    const MeshFileHeader* fileHeader;
+};
+
+// GPU mesh created from a cooked .mesh file. The file is opened through the
+// FileSystem, memory mapped unless it is compressed in an archive, and its
+// streams are uploaded as-is, without any per-vertex processing.
+//
+// By default the mesh gets a vertex buffer, index buffer and VAO of its own.
+// Scenes with many small meshes should pass a MeshPool instead, which packs
+// them into a few shared buffers.
+class Mesh {
+public:
+    explicit Mesh(const std::string& path);
+    explicit Mesh(const MeshBlob& blob);
+    // Suballocates the streams from `pool`, which must outlive the mesh.
+    Mesh(const MeshBlob& blob, MeshPool& pool);
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    void draw(uint32_t lod = 0) const;
+
+    const MeshBounds& bounds() const { return meshBounds; }
+    uint32_t lodCount() const { return numLods; }
+    uint32_t indexCount(uint32_t lod = 0) const { return lods[lod].indexCount; }
+    // Geometric error of a LOD in mesh units; 0 for the full detail mesh.
+    float lodError(uint32_t lod) const { return lods[lod].error; }
+    const VertexLayout& layout() const { return vertexLayout; }
+
+    // Maps stored positions to mesh space; fold it into the model matrix.
+    // Identity unless the positions were quantized by the cooker.
+    const glm::mat4& positionTransform() const { return dequantize; }
+
+private:
+    Mesh(const FileData& file);
+    void readHeader(const MeshBlob& blob);
+
+    // Either its own buffers or a range of a pool's
+    std::unique_ptr<VertexArray> vao;
+    std::unique_ptr<VertexBuffer> vbo;
+    std::unique_ptr<IndexBuffer> ibo;
+    MeshPool* pool = nullptr;
+    uint32_t poolMesh = 0;
+    uint32_t indexType;
+    uint32_t indexSize;
+    uint32_t numLods;
+    MeshLod lods[MESH_MAX_LODS];
+    MeshBounds meshBounds;
+    VertexLayout vertexLayout;
+    glm::mat4 dequantize;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of cooked .mesh files written by tools/mesh_cooker.
+// A file is a fixed-size header followed by the vertex and index streams,
+// each aligned to MESH_STREAM_ALIGNMENT so the runtime can hand the mapped
+// bytes straight to glBufferData. All values are little-endian and GL enums
+// are stored by value.
+
+constexpr uint32_t MESH_FILE_MAGIC = 0x4853454D; // "MESH"
+constexpr uint32_t MESH_FILE_VERSION = 1;
+constexpr uint32_t MESH_STREAM_ALIGNMENT = 16;
+constexpr uint32_t MESH_MAX_ATTRIBUTES = 8;
+constexpr uint32_t MESH_MAX_LODS = 8;
+
+// Header flags
+constexpr uint32_t MESH_FLAG_QUANTIZED_POSITIONS = 1u << 0; // Positions are unorm relative to bounds min/max
+
+struct MeshAttribute {
+    uint32_t location;
+    uint32_t type;          // GL component type, e.g. GL_FLOAT
+    uint32_t components;
+    uint32_t normalized;
+    uint32_t offset;        // Byte offset inside one vertex
+};
+
+struct MeshLod {
+    uint32_t indexOffset;   // First index of this LOD in the index stream
+    uint32_t indexCount;
+    float error;            // Simplification error in mesh units, 0 for LOD 0
+    uint32_t reserved;
+};
+
+struct MeshBounds {
+    float min[3];
+    float max[3];
+    float center[3];
+    float radius;
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t vertexStride;
+    uint32_t indexCount;
+    uint32_t indexType;     // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t attributeCount;
+    uint32_t lodCount;
+    uint32_t flags;         // MESH_FLAG_* bits
+    uint32_t reserved;
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+    MeshBounds bounds;
+    MeshAttribute attributes[MESH_MAX_ATTRIBUTES];
+    MeshLod lods[MESH_MAX_LODS];
+};
+
+static_assert(sizeof(MeshAttribute) == 20, "MeshAttribute layout changed");
+static_assert(sizeof(MeshLod) == 16, "MeshLod layout changed");
+static_assert(sizeof(MeshFileHeader) % MESH_STREAM_ALIGNMENT == 0, "MeshFileHeader must keep streams aligned");
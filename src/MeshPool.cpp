@@ -0,0 +1,238 @@
+#include "MeshPool.h"
+#include "GlDebug.h"
+#include "GpuFeatures.h"
+#include "Mesh.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Meshes compact() may find no lower hole for before it gives up until the
+// next call
+constexpr uint32_t DEFRAGMENT_ATTEMPTS = 8;
+
+constexpr const char* VERTEX_BUFFER_LABEL = "MeshPool vertices";
+constexpr const char* INDEX_BUFFER_LABEL = "MeshPool indices";
+
+unsigned int createBuffer(size_t size, const char* label) {
+    unsigned int buffer;
+    if (gpuFeatures().directStateAccess) {
+        glCreateBuffers(1, &buffer);
+        glNamedBufferData(buffer, size, nullptr, GL_STATIC_DRAW);
+    } else {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    labelGlObject(GL_BUFFER, buffer, label);
+    return buffer;
+}
+
+void uploadBuffer(unsigned int buffer, size_t offset, size_t size, const void* data) {
+    countUpload(size);
+    if (gpuFeatures().directStateAccess) {
+        glNamedBufferSubData(buffer, offset, size, data);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// `source` and `target` may be the same buffer if the ranges don't overlap
+void copyBuffer(unsigned int source, unsigned int target, size_t sourceOffset, size_t targetOffset, size_t size) {
+    if (gpuFeatures().directStateAccess) {
+        glCopyNamedBufferSubData(source, target, sourceOffset, targetOffset, size);
+        return;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, targetOffset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void addStats(RangeAllocatorStats& total, const RangeAllocatorStats& arena, uint32_t unit) {
+    total.capacity += arena.capacity * unit;
+    total.used += arena.used * unit;
+    total.largestFree += arena.largestFree * unit;
+    total.allocations += arena.allocations;
+    total.freeRanges += arena.freeRanges;
+}
+
+} // namespace
+
+MeshPool::MeshPool(uint32_t arenaVertices, uint32_t arenaIndices)
+    : arenaVertices(std::max(arenaVertices, 1u)), arenaIndices(std::max(arenaIndices, 1u)) {}
+
+MeshPool::~MeshPool() {
+    for (const std::unique_ptr<Arena>& arena : arenas) {
+        unsigned int buffers[] = {arena->vertexBuffer, arena->indexBuffer};
+        glDeleteBuffers(2, buffers);
+    }
+}
+
+uint32_t MeshPool::add(const MeshBlob& blob) {
+    const MeshFileHeader& h = blob.header();
+    Entry entry;
+    entry.arena = arenaFor(blob.layout(), h.indexType);
+    Arena& arena = *arenas[entry.arena];
+    uint32_t stride = arena.layout.stride();
+
+    unsigned int vertexBuffer = arena.vertexBuffer;
+    unsigned int indexBuffer = arena.indexBuffer;
+    entry.vertexRange = allocate(arena.vertices, arena.vertexBuffer, h.vertexCount, stride, VERTEX_BUFFER_LABEL);
+    entry.indexRange = allocate(arena.indices, arena.indexBuffer, h.indexCount, arena.indexSize, INDEX_BUFFER_LABEL);
+    // Growing replaced the buffers; point the VAO at the new ones
+    if (arena.vertexBuffer != vertexBuffer) {
+        arena.vao.setVertexBuffer(arena.vertexBuffer);
+    }
+    if (arena.indexBuffer != indexBuffer) {
+        arena.vao.setIndexBuffer(arena.indexBuffer);
+    }
+    uploadBuffer(arena.vertexBuffer, size_t(arena.vertices.offset(entry.vertexRange)) * stride, h.vertexDataSize,
+                 blob.vertexData());
+    uploadBuffer(arena.indexBuffer, size_t(arena.indices.offset(entry.indexRange)) * arena.indexSize,
+                 h.indexDataSize, blob.indexData());
+
+    if (!freeEntries.empty()) {
+        uint32_t mesh = freeEntries.back();
+        freeEntries.pop_back();
+        entries[mesh] = entry;
+        return mesh;
+    }
+    entries.push_back(entry);
+    return uint32_t(entries.size() - 1);
+}
+
+void MeshPool::remove(uint32_t mesh) {
+    Entry& entry = entries[mesh];
+    Arena& arena = *arenas[entry.arena];
+    arena.vertices.free(entry.vertexRange);
+    arena.indices.free(entry.indexRange);
+    entry.vertexRange = entry.indexRange = RangeAllocator::INVALID;
+    freeEntries.push_back(mesh);
+}
+
+void MeshPool::draw(uint32_t mesh, uint32_t firstIndex, uint32_t indexCount) const {
+    const Entry& entry = entries[mesh];
+    const Arena& arena = *arenas[entry.arena];
+    size_t indexOffset = (size_t(arena.indices.offset(entry.indexRange)) + firstIndex) * arena.indexSize;
+    // Consecutive draws from one arena rebind the same VAO, which drivers
+    // skip
+    arena.vao.bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(indexCount), arena.indexType,
+                             reinterpret_cast<void*>(static_cast<uintptr_t>(indexOffset)),
+                             GLint(arena.vertices.offset(entry.vertexRange)));
+    countDraw(indexCount / 3);
+}
+
+size_t MeshPool::defragment(size_t maxBytes) {
+    size_t moved = 0;
+    for (uint32_t arena = 0; arena < arenas.size() && moved < maxBytes; ++arena) {
+        moved += compact(arena, false, maxBytes - moved);
+        if (moved < maxBytes) {
+            moved += compact(arena, true, maxBytes - moved);
+        }
+    }
+    bytesMoved += moved;
+    return moved;
+}
+
+MeshPoolStats MeshPool::stats() const {
+    MeshPoolStats stats;
+    stats.arenas = uint32_t(arenas.size());
+    stats.meshes = uint32_t(entries.size() - freeEntries.size());
+    for (const std::unique_ptr<Arena>& arena : arenas) {
+        addStats(stats.vertices, arena->vertices.stats(), arena->layout.stride());
+        addStats(stats.indices, arena->indices.stats(), arena->indexSize);
+    }
+    stats.bytesMoved = bytesMoved;
+    return stats;
+}
+
+uint32_t MeshPool::arenaFor(const VertexLayout& layout, GLenum indexType) {
+    for (uint32_t arena = 0; arena < arenas.size(); ++arena) {
+        if (arenas[arena]->layout == layout && arenas[arena]->indexType == indexType) {
+            return arena;
+        }
+    }
+    auto arena = std::make_unique<Arena>();
+    arena->layout = layout;
+    arena->indexType = indexType;
+    arena->indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    arena->vertices.grow(arenaVertices);
+    arena->indices.grow(arenaIndices);
+    arena->vertexBuffer = createBuffer(size_t(arenaVertices) * layout.stride(), VERTEX_BUFFER_LABEL);
+    arena->indexBuffer = createBuffer(size_t(arenaIndices) * arena->indexSize, INDEX_BUFFER_LABEL);
+    arena->vao.setFormat(layout);
+    arena->vao.setVertexBuffer(arena->vertexBuffer);
+    arena->vao.setIndexBuffer(arena->indexBuffer);
+    arenas.push_back(std::move(arena));
+    return uint32_t(arenas.size() - 1);
+}
+
+uint32_t MeshPool::allocate(RangeAllocator& ranges, unsigned int& buffer, uint32_t count, uint32_t unit,
+                            const char* label) {
+    count = std::max(count, 1u);
+    uint32_t range = ranges.allocate(count);
+    while (range == RangeAllocator::INVALID) {
+        uint64_t capacity = std::max<uint64_t>(uint64_t(ranges.capacity()) * 2, uint64_t(ranges.capacity()) + count);
+        if (capacity * unit > UINT32_MAX) {
+            throw std::runtime_error("Mesh pool arena is full");
+        }
+        unsigned int grown = createBuffer(size_t(capacity) * unit, label);
+        copyBuffer(buffer, grown, 0, 0, size_t(ranges.capacity()) * unit);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+        ranges.grow(uint32_t(capacity));
+        range = ranges.allocate(count);
+    }
+    return range;
+}
+
+// Moves the mesh highest up the stream into a hole further down that fits
+// it, then the next one, skipping those for which there is none
+size_t MeshPool::compact(uint32_t arenaIndex, bool indexStream, size_t maxBytes) {
+    Arena& arena = *arenas[arenaIndex];
+    RangeAllocator& ranges = indexStream ? arena.indices : arena.vertices;
+    unsigned int buffer = indexStream ? arena.indexBuffer : arena.vertexBuffer;
+    uint32_t unit = indexStream ? arena.indexSize : arena.layout.stride();
+
+    size_t moved = 0;
+    uint32_t attempts = 0;
+    uint32_t below = UINT32_MAX;        // Meshes at or above this already stayed put
+    while (moved < maxBytes && attempts < DEFRAGMENT_ATTEMPTS) {
+        Entry* top = nullptr;
+        for (Entry& entry : entries) {
+            uint32_t range = indexStream ? entry.indexRange : entry.vertexRange;
+            if (entry.arena == arenaIndex && range != RangeAllocator::INVALID && ranges.offset(range) < below &&
+                (!top || ranges.offset(range) > ranges.offset(indexStream ? top->indexRange : top->vertexRange))) {
+                top = &entry;
+            }
+        }
+        if (!top) {
+            break;
+        }
+        uint32_t& range = indexStream ? top->indexRange : top->vertexRange;
+        uint32_t target = ranges.allocate(ranges.size(range));
+        if (target == RangeAllocator::INVALID || ranges.offset(target) > ranges.offset(range)) {
+            if (target != RangeAllocator::INVALID) {
+                ranges.free(target);
+            }
+            // Nothing this size fits below; smaller meshes further down may
+            below = ranges.offset(range);
+            attempts++;
+            continue;
+        }
+        size_t size = size_t(ranges.size(range)) * unit;
+        copyBuffer(buffer, buffer, size_t(ranges.offset(range)) * unit, size_t(ranges.offset(target)) * unit, size);
+        ranges.free(range);
+        range = target;
+        moved += size;
+    }
+    return moved;
+}
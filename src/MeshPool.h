@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Buffers.h"
+#include "RangeAllocator.h"
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class MeshBlob;
+
+// Totals over all of a pool's arenas, in bytes. `largestFree` sums each
+// arena's largest free range, so fragmentation() is 0 as long as every
+// arena's free space is in one piece.
+struct MeshPoolStats {
+    uint32_t arenas = 0;
+    uint32_t meshes = 0;
+    RangeAllocatorStats vertices;
+    RangeAllocatorStats indices;
+    uint64_t bytesMoved = 0;            // By defragment(), since creation
+};
+
+// Packs the streams of many meshes into a few large buffers instead of a
+// vertex and an index buffer each. Meshes with the same vertex layout and
+// index type share an arena: one vertex buffer, one index buffer and one
+// VAO, with ranges handed out by a RangeAllocator. Draws use
+// glDrawElementsBaseVertex, so the cooked indices are uploaded unchanged,
+// and switching between meshes of an arena binds nothing new.
+//
+// Arenas grow by doubling, copying their contents on the GPU. Removing
+// meshes leaves holes; defragment() moves meshes from the top of an arena
+// down into them a few at a time with GPU-side copies, so calling it once
+// a frame keeps free space in one piece without a visible hitch.
+class MeshPool {
+public:
+    // Initial size of each new arena, in vertices and indices.
+    explicit MeshPool(uint32_t arenaVertices = 1 << 16, uint32_t arenaIndices = 1 << 18);
+    ~MeshPool();
+
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    // Uploads the blob's streams and returns a handle for draw(). The
+    // handle stays valid when defragment() moves the mesh.
+    uint32_t add(const MeshBlob& blob);
+    void remove(uint32_t mesh);
+
+    // Draws `indexCount` indices starting `firstIndex` into the mesh's own
+    // index stream, e.g. one LOD, with the current program.
+    void draw(uint32_t mesh, uint32_t firstIndex, uint32_t indexCount) const;
+
+    // Moves meshes down into holes until about `maxBytes` have been copied
+    // or nothing can move any lower. Returns the bytes copied.
+    size_t defragment(size_t maxBytes = 1 << 20);
+
+    MeshPoolStats stats() const;
+
+private:
+    struct Arena {
+        VertexLayout layout;
+        GLenum indexType;
+        uint32_t indexSize;
+        VertexArray vao;
+        unsigned int vertexBuffer = 0;
+        unsigned int indexBuffer = 0;
+        RangeAllocator vertices;        // In vertices, so offsets are base vertices
+        RangeAllocator indices;         // In indices
+    };
+
+    struct Entry {
+        uint32_t arena;
+        uint32_t vertexRange = RangeAllocator::INVALID;
+        uint32_t indexRange = RangeAllocator::INVALID;
+    };
+
+    uint32_t arenaFor(const VertexLayout& layout, GLenum indexType);
+    // Allocates from `ranges`, growing `buffer` along with it if needed
+    uint32_t allocate(RangeAllocator& ranges, unsigned int& buffer, uint32_t count, uint32_t unit,
+                      const char* label);
+    size_t compact(uint32_t arena, bool indexStream, size_t maxBytes);
+
+    uint32_t arenaVertices;
+    uint32_t arenaIndices;
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeEntries;
+    uint64_t bytesMoved = 0;
+};
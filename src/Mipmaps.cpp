@@ -0,0 +1,201 @@
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAPS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int KAISER_TAPS = 6;
+constexpr float KAISER_BETA = 4.0f;
+
+#ifdef MIPMAPS_SSE2
+using Float4 = __m128;
+
+inline Float4 loadPixel(const uint8_t* p) {
+    int32_t packed;
+    std::memcpy(&packed, p, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+    return _mm_cvtepi32_ps(wide);
+}
+
+inline void storePixel(uint8_t* p, Float4 v) {
+    __m128i i = _mm_cvtps_epi32(v);
+    i = _mm_packs_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+    int32_t packed = _mm_cvtsi128_si32(i);
+    std::memcpy(p, &packed, 4);
+}
+
+inline Float4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+inline Float4 zero4() { return _mm_setzero_ps(); }
+inline Float4 madd(Float4 acc, Float4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#else
+struct Float4 {
+    float v[4];
+};
+
+inline Float4 loadPixel(const uint8_t* p) { return {{float(p[0]), float(p[1]), float(p[2]), float(p[3])}}; }
+
+inline void storePixel(uint8_t* p, Float4 v) {
+    for (int c = 0; c < 4; ++c) {
+        p[c] = uint8_t(std::min(std::max(std::lround(v.v[c]), 0l), 255l));
+    }
+}
+
+inline Float4 load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float* p, Float4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline Float4 zero4() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+inline Float4 madd(Float4 acc, Float4 v, float w) {
+    for (int c = 0; c < 4; ++c) {
+        acc.v[c] += v.v[c] * w;
+    }
+    return acc;
+}
+#endif
+
+// Zeroth-order modified Bessel function of the first kind.
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Taps sit at source offsets -2.5 .. 2.5 from the output pixel center,
+// which is the same for every output pixel when halving.
+struct KaiserKernel {
+    float weights[KAISER_TAPS];
+
+    KaiserKernel() {
+        const double pi = 3.14159265358979323846;
+        double radius = KAISER_TAPS / 2.0;
+        double total = 0.0;
+        double w[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; ++k) {
+            double t = k - radius + 0.5;
+            double x = pi * t / 2.0;
+            double sinc = std::sin(x) / x;
+            double r = t / radius;
+            w[k] = sinc * besselI0(KAISER_BETA * std::sqrt(1.0 - r * r)) / besselI0(KAISER_BETA);
+            total += w[k];
+        }
+        for (int k = 0; k < KAISER_TAPS; ++k) {
+            weights[k] = float(w[k] / total);
+        }
+    }
+};
+
+void downsampleBox(const Image& src, Image& dst) {
+    for (uint32_t y = 0; y < dst.height; ++y) {
+        const uint8_t* row0 = &src.pixels[size_t(std::min(2 * y, src.height - 1)) * src.width * 4];
+        const uint8_t* row1 = &src.pixels[size_t(std::min(2 * y + 1, src.height - 1)) * src.width * 4];
+        uint8_t* out = &dst.pixels[size_t(y) * dst.width * 4];
+        for (uint32_t x = 0; x < dst.width; ++x) {
+            uint32_t x0 = std::min(2 * x, src.width - 1) * 4;
+            uint32_t x1 = std::min(2 * x + 1, src.width - 1) * 4;
+#ifdef MIPMAPS_SSE2
+            if (x1 == x0 + 4) {
+                // Both pixels of each row in one 8-byte load, widened to 16 bits
+                __m128i zero = _mm_setzero_si128();
+                __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row0 + x0)), zero);
+                __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row1 + x0)), zero);
+                __m128i sum = _mm_add_epi16(a, b);
+                sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+                int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+                std::memcpy(out + x * 4, &packed, 4);
+                continue;
+            }
+#endif
+            for (int c = 0; c < 4; ++c) {
+                out[x * 4 + c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+void downsampleKaiser(const Image& src, Image& dst) {
+    static const KaiserKernel kernel;
+    const float* w = kernel.weights;
+
+    // Horizontal pass into a float image of dst.width x src.height
+    std::vector<float> horizontal(size_t(dst.width) * src.height * 4);
+    std::vector<float> sourceRow(size_t(src.width) * 4);
+    for (uint32_t y = 0; y < src.height; ++y) {
+        const uint8_t* row = &src.pixels[size_t(y) * src.width * 4];
+        for (uint32_t x = 0; x < src.width; ++x) {
+            store(&sourceRow[x * 4], loadPixel(row + x * 4));
+        }
+        float* out = &horizontal[size_t(y) * dst.width * 4];
+        for (uint32_t x = 0; x < dst.width; ++x) {
+            Float4 acc = zero4();
+            for (int k = 0; k < KAISER_TAPS; ++k) {
+                int sx = std::min(std::max(int(2 * x) + k - KAISER_TAPS / 2 + 1, 0), int(src.width) - 1);
+                acc = madd(acc, load(&sourceRow[size_t(sx) * 4]), w[k]);
+            }
+            store(out + x * 4, acc);
+        }
+    }
+
+    // Vertical pass, rounding and saturating back to bytes
+    for (uint32_t y = 0; y < dst.height; ++y) {
+        const float* rows[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; ++k) {
+            int sy = std::min(std::max(int(2 * y) + k - KAISER_TAPS / 2 + 1, 0), int(src.height) - 1);
+            rows[k] = &horizontal[size_t(sy) * dst.width * 4];
+        }
+        uint8_t* out = &dst.pixels[size_t(y) * dst.width * 4];
+        for (uint32_t x = 0; x < dst.width; ++x) {
+            Float4 acc = zero4();
+            for (int k = 0; k < KAISER_TAPS; ++k) {
+                acc = madd(acc, load(rows[k] + x * 4), w[k]);
+            }
+            storePixel(out + x * 4, acc);
+        }
+    }
+}
+
+} // namespace
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
+Image downsample(const Image& source, MipFilter filter) {
+    Image result;
+    result.width = std::max(source.width / 2, 1u);
+    result.height = std::max(source.height / 2, 1u);
+    result.pixels.resize(size_t(result.width) * result.height * 4);
+    if (filter == MipFilter::Kaiser) {
+        downsampleKaiser(source, result);
+    } else {
+        downsampleBox(source, result);
+    }
+    return result;
+}
+
+std::vector<Image> buildMipChain(Image base, MipFilter filter) {
+    std::vector<Image> levels;
+    levels.reserve(mipLevelCount(base.width, base.height));
+    levels.push_back(std::move(base));
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        levels.push_back(downsample(levels.back(), filter));
+    }
+    return levels;
+}
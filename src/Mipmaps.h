@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Image.h"
+
+#include <cstdint>
+#include <vector>
+
+// Downsampling filters for CPU mip generation. Both use SSE2 when the
+// target has it and fall back to scalar code otherwise.
+//   Box     2x2 average, cheap and slightly blurry
+//   Kaiser  6-tap Kaiser-windowed sinc, sharper and with less aliasing;
+//           the negative lobes can ring on hard edges
+enum class MipFilter {
+    Box,
+    Kaiser,
+};
+
+// Number of levels in a full chain down to 1x1.
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// Halves each dimension (down to 1), clamping at the image edges.
+Image downsample(const Image& source, MipFilter filter);
+
+// Returns the full chain: the base image followed by every smaller level.
+std::vector<Image> buildMipChain(Image base, MipFilter filter);
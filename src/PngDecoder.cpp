@@ -0,0 +1,494 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr int HUFFMAN_FAST_BITS = 9;
+
+uint32_t readBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// LSB-first bit stream used by deflate. Reads past the end return zeros so
+// refills stay branch-light; overruns are detected when bits are consumed.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint32_t peek(int count) {
+        while (bitCount < count) {
+            buffer |= uint64_t(pos < size ? data[pos] : 0) << bitCount;
+            pos++;
+            bitCount += 8;
+        }
+        return uint32_t(buffer & ((uint64_t(1) << count) - 1));
+    }
+
+    void consume(int count) {
+        buffer >>= count;
+        bitCount -= count;
+        consumed += count;
+        if (consumed > uint64_t(size) * 8) {
+            throw std::runtime_error("Deflate stream is truncated");
+        }
+    }
+
+    uint32_t bits(int count) {
+        uint32_t value = peek(count);
+        consume(count);
+        return value;
+    }
+
+    // Stored blocks start on a byte boundary.
+    void alignToByte() { consume(bitCount & 7); }
+
+    size_t bytePosition() const { return size_t(consumed / 8); }
+
+    // Drops any buffered bits and continues reading at a byte offset.
+    void seek(size_t byte) {
+        pos = byte;
+        buffer = 0;
+        bitCount = 0;
+        consumed = uint64_t(byte) * 8;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t buffer = 0;
+    int bitCount = 0;
+    uint64_t consumed = 0;
+};
+
+// Canonical Huffman decoder with a lookup table for short codes and the
+// bit-by-bit canonical walk for the rest.
+class Huffman {
+public:
+    void build(const uint8_t* lengths, int count) {
+        std::memset(counts, 0, sizeof(counts));
+        std::memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < count; ++i) {
+            counts[lengths[i]]++;
+        }
+        counts[0] = 0;
+
+        uint16_t offsets[16];
+        uint32_t nextCode[16];
+        offsets[1] = 0;
+        nextCode[1] = 0;
+        for (int len = 1; len < 15; ++len) {
+            offsets[len + 1] = offsets[len] + counts[len];
+            nextCode[len + 1] = (nextCode[len] + counts[len]) << 1;
+        }
+        for (int symbol = 0; symbol < count; ++symbol) {
+            int len = lengths[symbol];
+            if (len == 0) {
+                continue;
+            }
+            symbols[offsets[len]++] = uint16_t(symbol);
+            uint32_t code = nextCode[len]++;
+            if (len <= HUFFMAN_FAST_BITS) {
+                uint32_t reversed = 0;
+                for (int i = 0; i < len; ++i) {
+                    reversed |= ((code >> i) & 1) << (len - 1 - i);
+                }
+                for (uint32_t j = reversed; j < (1u << HUFFMAN_FAST_BITS); j += 1u << len) {
+                    fast[j] = uint16_t((len << 12) | symbol);
+                }
+            }
+        }
+    }
+
+    uint32_t decode(BitReader& reader) const {
+        uint16_t entry = fast[reader.peek(HUFFMAN_FAST_BITS)];
+        if (entry != 0) {
+            reader.consume(entry >> 12);
+            return entry & 0xFFF;
+        }
+        uint32_t bits = reader.peek(15);
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= 15; ++len) {
+            code |= (bits >> (len - 1)) & 1;
+            int count = counts[len];
+            if (code - first < count) {
+                reader.consume(len);
+                return symbols[index + code - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        throw std::runtime_error("Invalid deflate Huffman code");
+    }
+
+private:
+    uint16_t counts[16];
+    uint16_t symbols[288];
+    uint16_t fast[1 << HUFFMAN_FAST_BITS];     // (length << 12) | symbol, 0 if longer
+};
+
+const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                    513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                    8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Inflates a zlib stream (RFC 1950/1951) into a buffer of known size.
+std::vector<uint8_t> inflateZlib(const uint8_t* data, size_t size, size_t expectedSize) {
+    if (size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) {
+        throw std::runtime_error("Invalid zlib header");
+    }
+    BitReader reader(data + 2, size - 2);
+    std::vector<uint8_t> out(expectedSize);
+    size_t outPos = 0;
+    Huffman literals, distances;
+
+    bool last = false;
+    while (!last) {
+        last = reader.bits(1) != 0;
+        uint32_t type = reader.bits(2);
+        if (type == 0) {
+            reader.alignToByte();
+            uint32_t len = reader.bits(16);
+            uint32_t nlen = reader.bits(16);
+            if ((len ^ 0xFFFF) != nlen) {
+                throw std::runtime_error("Invalid stored deflate block");
+            }
+            size_t start = reader.bytePosition();
+            if (start + len > size - 2 || outPos + len > out.size()) {
+                throw std::runtime_error("Stored deflate block overruns its buffer");
+            }
+            std::memcpy(&out[outPos], data + 2 + start, len);
+            outPos += len;
+            reader.seek(start + len);
+            continue;
+        }
+
+        if (type == 1) {
+            uint8_t lengths[288 + 32];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            std::memset(lengths + 288, 5, 32);
+            literals.build(lengths, 288);
+            distances.build(lengths + 288, 32);
+        } else if (type == 2) {
+            uint32_t literalCount = reader.bits(5) + 257;
+            uint32_t distanceCount = reader.bits(5) + 1;
+            uint32_t codeLengthCount = reader.bits(4) + 4;
+            uint8_t codeLengths[19] = {};
+            for (uint32_t i = 0; i < codeLengthCount; ++i) {
+                codeLengths[CODE_LENGTH_ORDER[i]] = uint8_t(reader.bits(3));
+            }
+            Huffman codeLengthCodes;
+            codeLengthCodes.build(codeLengths, 19);
+
+            uint8_t lengths[288 + 32] = {};
+            uint32_t total = literalCount + distanceCount;
+            for (uint32_t i = 0; i < total;) {
+                uint32_t symbol = codeLengthCodes.decode(reader);
+                uint32_t repeat;
+                uint8_t value = 0;
+                if (symbol < 16) {
+                    lengths[i++] = uint8_t(symbol);
+                    continue;
+                } else if (symbol == 16) {
+                    if (i == 0) {
+                        throw std::runtime_error("Invalid deflate code length repeat");
+                    }
+                    value = lengths[i - 1];
+                    repeat = 3 + reader.bits(2);
+                } else if (symbol == 17) {
+                    repeat = 3 + reader.bits(3);
+                } else {
+                    repeat = 11 + reader.bits(7);
+                }
+                if (i + repeat > total) {
+                    throw std::runtime_error("Invalid deflate code length repeat");
+                }
+                std::memset(lengths + i, value, repeat);
+                i += repeat;
+            }
+            literals.build(lengths, literalCount);
+            distances.build(lengths + literalCount, distanceCount);
+        } else {
+            throw std::runtime_error("Invalid deflate block type");
+        }
+
+        for (;;) {
+            uint32_t symbol = literals.decode(reader);
+            if (symbol < 256) {
+                if (outPos >= out.size()) {
+                    throw std::runtime_error("Deflate stream overruns its buffer");
+                }
+                out[outPos++] = uint8_t(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+            symbol -= 257;
+            if (symbol >= 29) {
+                throw std::runtime_error("Invalid deflate length code");
+            }
+            uint32_t length = LENGTH_BASE[symbol] + reader.bits(LENGTH_EXTRA[symbol]);
+            uint32_t distanceSymbol = distances.decode(reader);
+            if (distanceSymbol >= 30) {
+                throw std::runtime_error("Invalid deflate distance code");
+            }
+            uint32_t distance = DISTANCE_BASE[distanceSymbol] + reader.bits(DISTANCE_EXTRA[distanceSymbol]);
+            if (distance > outPos || outPos + length > out.size()) {
+                throw std::runtime_error("Deflate back reference is out of bounds");
+            }
+            // Byte by byte: the source may overlap the bytes being written
+            const uint8_t* src = &out[outPos - distance];
+            uint8_t* dst = &out[outPos];
+            for (uint32_t i = 0; i < length; ++i) {
+                dst[i] = src[i];
+            }
+            outPos += length;
+        }
+    }
+
+    if (outPos != out.size()) {
+        throw std::runtime_error("Deflate stream is shorter than the image");
+    }
+    return out;
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return uint8_t(a);
+    }
+    return uint8_t(pb <= pc ? b : c);
+}
+
+struct PngHeader {
+    uint32_t width;
+    uint32_t height;
+    uint32_t bitDepth;
+    uint32_t colorType;
+    uint32_t channels;
+    bool interlaced;
+};
+
+// Undoes the per-row filters in place. `rows` points at height rows of
+// (1 + stride) bytes each; the filtered rows are packed to `stride` bytes.
+void unfilter(uint8_t* rows, uint8_t* out, uint32_t height, size_t stride, size_t bytesPerPixel) {
+    const uint8_t* previous = nullptr;
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t filter = rows[y * (stride + 1)];
+        const uint8_t* src = rows + y * (stride + 1) + 1;
+        uint8_t* dst = out + y * stride;
+        for (size_t i = 0; i < stride; ++i) {
+            int a = i >= bytesPerPixel ? dst[i - bytesPerPixel] : 0;
+            int b = previous ? previous[i] : 0;
+            int c = previous && i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+            switch (filter) {
+                case 0: dst[i] = src[i]; break;
+                case 1: dst[i] = uint8_t(src[i] + a); break;
+                case 2: dst[i] = uint8_t(src[i] + b); break;
+                case 3: dst[i] = uint8_t(src[i] + ((a + b) >> 1)); break;
+                case 4: dst[i] = uint8_t(src[i] + paeth(a, b, c)); break;
+                default: throw std::runtime_error("Invalid PNG row filter");
+            }
+        }
+        previous = dst;
+    }
+}
+
+uint32_t sampleAt(const uint8_t* row, size_t index, uint32_t bitDepth) {
+    switch (bitDepth) {
+        case 8: return row[index];
+        case 16: return (uint32_t(row[index * 2]) << 8) | row[index * 2 + 1];
+        default: {
+            size_t bit = index * bitDepth;
+            uint32_t shift = 8 - bitDepth - uint32_t(bit & 7);
+            return (row[bit >> 3] >> shift) & ((1u << bitDepth) - 1);
+        }
+    }
+}
+
+// Expands one unfiltered pass to RGBA8, writing pixel (x, y) of the pass to
+// image pixel (x0 + x * dx, y0 + y * dy).
+void expandPass(const PngHeader& png, const uint8_t* rows, uint32_t width, uint32_t height, size_t stride,
+                const uint8_t* palette, uint32_t paletteSize, const uint8_t* paletteAlpha,
+                const uint32_t* colorKey, Image& image,
+                uint32_t x0, uint32_t y0, uint32_t dx, uint32_t dy) {
+    uint32_t maxSample = (1u << png.bitDepth) - 1;
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = rows + y * stride;
+        uint32_t imageY = y0 + y * dy;
+        uint8_t* dstRow = &image.pixels[size_t(image.height - 1 - imageY) * image.width * 4];
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* dst = dstRow + size_t(x0 + x * dx) * 4;
+            uint32_t s[4];
+            for (uint32_t c = 0; c < png.channels; ++c) {
+                s[c] = sampleAt(row, size_t(x) * png.channels + c, png.bitDepth);
+            }
+            auto to8 = [&](uint32_t v) {
+                return uint8_t(png.bitDepth == 16 ? v >> 8 : png.bitDepth == 8 ? v : v * 255 / maxSample);
+            };
+            switch (png.colorType) {
+                case 0:
+                    dst[0] = dst[1] = dst[2] = to8(s[0]);
+                    dst[3] = colorKey && s[0] == colorKey[0] ? 0 : 255;
+                    break;
+                case 2:
+                    dst[0] = to8(s[0]);
+                    dst[1] = to8(s[1]);
+                    dst[2] = to8(s[2]);
+                    dst[3] = colorKey && s[0] == colorKey[0] && s[1] == colorKey[1] && s[2] == colorKey[2] ? 0 : 255;
+                    break;
+                case 3:
+                    if (s[0] >= paletteSize) {
+                        throw std::runtime_error("PNG palette index is out of range");
+                    }
+                    std::memcpy(dst, palette + s[0] * 3, 3);
+                    dst[3] = paletteAlpha[s[0]];
+                    break;
+                case 4:
+                    dst[0] = dst[1] = dst[2] = to8(s[0]);
+                    dst[3] = to8(s[1]);
+                    break;
+                default:
+                    dst[0] = to8(s[0]);
+                    dst[1] = to8(s[1]);
+                    dst[2] = to8(s[2]);
+                    dst[3] = to8(s[3]);
+                    break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+Image decodePng(const uint8_t* data, size_t size) {
+    PngHeader png = {};
+    std::vector<uint8_t> compressed;
+    uint8_t palette[256 * 3] = {};
+    uint8_t paletteAlpha[256];
+    std::memset(paletteAlpha, 255, sizeof(paletteAlpha));
+    uint32_t paletteSize = 0;
+    uint32_t colorKey[3] = {};
+    bool hasColorKey = false;
+    bool seenHeader = false;
+
+    size_t pos = 8;
+    for (;;) {
+        if (pos + 12 > size) {
+            throw std::runtime_error("PNG chunk is truncated");
+        }
+        uint32_t length = readBE32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* chunk = data + pos + 8;
+        if (length > size - pos - 12) {
+            throw std::runtime_error("PNG chunk is truncated");
+        }
+        pos += 12 + size_t(length);
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) {
+                throw std::runtime_error("Invalid PNG header");
+            }
+            png.width = readBE32(chunk);
+            png.height = readBE32(chunk + 4);
+            png.bitDepth = chunk[8];
+            png.colorType = chunk[9];
+            png.interlaced = chunk[12] == 1;
+            static const uint32_t CHANNELS[7] = {1, 0, 3, 1, 2, 0, 4};
+            png.channels = png.colorType < 7 ? CHANNELS[png.colorType] : 0;
+            bool depthValid = png.colorType == 0 ? (png.bitDepth & (png.bitDepth - 1)) == 0 && png.bitDepth <= 16
+                            : png.colorType == 3 ? png.bitDepth <= 8 && (png.bitDepth & (png.bitDepth - 1)) == 0
+                            : png.bitDepth == 8 || png.bitDepth == 16;
+            if (png.channels == 0 || !depthValid || png.bitDepth == 0 || png.width == 0 || png.height == 0 ||
+                png.width > (1u << 24) || png.height > (1u << 24) || chunk[10] != 0 || chunk[11] != 0 ||
+                chunk[12] > 1) {
+                throw std::runtime_error("Unsupported PNG format");
+            }
+            seenHeader = true;
+        } else if (!seenHeader) {
+            throw std::runtime_error("PNG is missing its header");
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            paletteSize = std::min<uint32_t>(length / 3, 256);
+            std::memcpy(palette, chunk, paletteSize * 3);
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (png.colorType == 3) {
+                std::memcpy(paletteAlpha, chunk, std::min<uint32_t>(length, 256));
+            } else if (png.colorType == 0 && length >= 2) {
+                colorKey[0] = (chunk[0] << 8) | chunk[1];
+                hasColorKey = true;
+            } else if (png.colorType == 2 && length >= 6) {
+                for (int c = 0; c < 3; ++c) {
+                    colorKey[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1];
+                }
+                hasColorKey = true;
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if ((type[0] & 0x20) == 0) {
+            throw std::runtime_error("PNG has an unknown critical chunk");
+        }
+    }
+    if (png.colorType == 3 && paletteSize == 0) {
+        throw std::runtime_error("PNG is missing its palette");
+    }
+
+    // Pass origins and steps; a non-interlaced image is a single pass
+    static const uint32_t ADAM7[7][4] = {
+        {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2},
+    };
+    static const uint32_t SINGLE_PASS[1][4] = {{0, 0, 1, 1}};
+    const uint32_t (*passes)[4] = png.interlaced ? ADAM7 : SINGLE_PASS;
+    uint32_t passCount = png.interlaced ? 7 : 1;
+
+    size_t bitsPerPixel = size_t(png.channels) * png.bitDepth;
+    size_t bytesPerPixel = (bitsPerPixel + 7) / 8;
+    size_t filteredSize = 0;
+    for (uint32_t p = 0; p < passCount; ++p) {
+        uint32_t w = (png.width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        uint32_t h = (png.height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        if (png.width > passes[p][0] && png.height > passes[p][1]) {
+            filteredSize += size_t(h) * (1 + (w * bitsPerPixel + 7) / 8);
+        }
+    }
+    std::vector<uint8_t> filtered = inflateZlib(compressed.data(), compressed.size(), filteredSize);
+
+    Image image;
+    image.width = png.width;
+    image.height = png.height;
+    image.pixels.resize(size_t(png.width) * png.height * 4);
+
+    std::vector<uint8_t> rows;
+    size_t offset = 0;
+    for (uint32_t p = 0; p < passCount; ++p) {
+        if (png.width <= passes[p][0] || png.height <= passes[p][1]) {
+            continue;
+        }
+        uint32_t w = (png.width - passes[p][0] + passes[p][2] - 1) / passes[p][2];
+        uint32_t h = (png.height - passes[p][1] + passes[p][3] - 1) / passes[p][3];
+        size_t stride = (w * bitsPerPixel + 7) / 8;
+        rows.resize(stride * h);
+        unfilter(&filtered[offset], rows.data(), h, stride, bytesPerPixel);
+        expandPass(png, rows.data(), w, h, stride, palette, paletteSize, paletteAlpha,
+                   hasColorKey ? colorKey : nullptr, image,
+                   passes[p][0], passes[p][1], passes[p][2], passes[p][3]);
+        offset += h * (stride + 1);
+    }
+    return image;
+}
@@ -0,0 +1,268 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t WINDOW_SIZE = 32768;
+constexpr uint32_t HASH_BITS = 15;
+constexpr uint32_t MAX_CHAIN = 64;
+constexpr uint32_t MIN_MATCH = 3;
+constexpr uint32_t MAX_MATCH = 258;
+
+const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DISTANCE_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// LSB-first bit stream, the counterpart of the decoder's BitReader
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void bits(uint32_t value, int count) {
+        buffer |= uint64_t(value) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back(uint8_t(buffer));
+            buffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    // Huffman codes are stored most significant bit first
+    void code(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        bits(reversed, length);
+    }
+
+    void finish() {
+        if (bitCount > 0) {
+            out.push_back(uint8_t(buffer));
+            buffer = 0;
+            bitCount = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t buffer = 0;
+    int bitCount = 0;
+};
+
+// Literal/length symbol with the fixed Huffman code of RFC 1951 3.2.6
+void writeSymbol(BitWriter& writer, uint32_t symbol) {
+    if (symbol < 144) {
+        writer.code(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.code(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.code(symbol - 256, 7);
+    } else {
+        writer.code(0xC0 + symbol - 280, 8);
+    }
+}
+
+void writeMatch(BitWriter& writer, uint32_t length, uint32_t distance) {
+    uint32_t l = 0;
+    while (l < 28 && LENGTH_BASE[l + 1] <= length) {
+        ++l;
+    }
+    writeSymbol(writer, 257 + l);
+    writer.bits(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+    uint32_t d = 0;
+    while (d < 29 && DISTANCE_BASE[d + 1] <= distance) {
+        ++d;
+    }
+    writer.code(d, 5);
+    writer.bits(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+}
+
+// One fixed-Huffman block with greedy hash-chain matching. Dynamic tables
+// would save another 10-20%; rendered frames compress well enough without
+void deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+    BitWriter writer(out);
+    writer.bits(1, 1);      // Final block
+    writer.bits(1, 2);      // Fixed Huffman codes
+
+    std::vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+    std::vector<int32_t> prev(WINDOW_SIZE, -1);
+    size_t size = data.size();
+    auto hash = [&](size_t i) {
+        uint32_t key = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+        return (key * 2654435761u) >> (32 - HASH_BITS);
+    };
+    auto insert = [&](size_t i) {
+        if (i + MIN_MATCH <= size) {
+            uint32_t h = hash(i);
+            prev[i % WINDOW_SIZE] = head[h];
+            head[h] = int32_t(i);
+        }
+    };
+
+    size_t i = 0;
+    while (i < size) {
+        uint32_t bestLength = 0;
+        uint32_t bestDistance = 0;
+        if (i + MIN_MATCH <= size) {
+            uint32_t maxLength = uint32_t(std::min<size_t>(MAX_MATCH, size - i));
+            int32_t candidate = head[hash(i)];
+            // Positions further back than the window have had their prev
+            // slot reused, so the walk stops there
+            for (uint32_t chain = 0; candidate >= 0 && i - size_t(candidate) <= WINDOW_SIZE && chain < MAX_CHAIN;
+                 ++chain) {
+                const uint8_t* a = &data[size_t(candidate)];
+                const uint8_t* b = &data[i];
+                uint32_t length = 0;
+                while (length < maxLength && a[length] == b[length]) {
+                    ++length;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = uint32_t(i - size_t(candidate));
+                    if (length == maxLength) {
+                        break;
+                    }
+                }
+                candidate = prev[size_t(candidate) % WINDOW_SIZE];
+            }
+        }
+        if (bestLength >= MIN_MATCH) {
+            writeMatch(writer, bestLength, bestDistance);
+            for (uint32_t k = 0; k < bestLength; ++k) {
+                insert(i + k);
+            }
+            i += bestLength;
+        } else {
+            writeSymbol(writer, data[i]);
+            insert(i);
+            ++i;
+        }
+    }
+    writeSymbol(writer, 256);
+    writer.finish();
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < data.size();) {
+        // 5552 bytes is the most that can be summed before b overflows
+        size_t end = std::min(data.size(), i + 5552);
+        for (; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendBE32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(uint8_t(value >> 24));
+    out.push_back(uint8_t(value >> 16));
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    appendBE32(out, uint32_t(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBE32(out, crc32(&out[start], out.size() - start));
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return uint8_t(a);
+    }
+    return uint8_t(pb <= pc ? b : c);
+}
+
+} // namespace
+
+std::vector<uint8_t> encodePng(const Image& image) {
+    const size_t rowSize = size_t(image.width) * 4;
+    // Each row gets whichever filter leaves the smallest residuals, the
+    // usual heuristic; PNG rows run top to bottom, Image rows the other way
+    std::vector<uint8_t> filtered;
+    filtered.reserve((rowSize + 1) * image.height);
+    std::vector<uint8_t> candidate(rowSize), best(rowSize);
+    std::vector<uint8_t> zeroRow(rowSize, 0);
+    for (uint32_t y = 0; y < image.height; ++y) {
+        const uint8_t* row = &image.pixels[(image.height - 1 - y) * rowSize];
+        const uint8_t* above = y > 0 ? row + rowSize : zeroRow.data();
+        uint64_t bestCost = UINT64_MAX;
+        uint8_t bestFilter = 0;
+        for (uint8_t filter = 0; filter < 5; ++filter) {
+            uint64_t cost = 0;
+            for (size_t x = 0; x < rowSize; ++x) {
+                int a = x >= 4 ? row[x - 4] : 0;
+                int b = above[x];
+                int c = x >= 4 ? above[x - 4] : 0;
+                uint8_t predicted = 0;
+                switch (filter) {
+                    case 1: predicted = uint8_t(a); break;
+                    case 2: predicted = uint8_t(b); break;
+                    case 3: predicted = uint8_t((a + b) / 2); break;
+                    case 4: predicted = paeth(a, b, c); break;
+                    default: break;
+                }
+                candidate[x] = uint8_t(row[x] - predicted);
+                cost += uint64_t(std::abs(int(int8_t(candidate[x]))));
+            }
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestFilter = filter;
+                best.swap(candidate);
+            }
+        }
+        filtered.push_back(bestFilter);
+        filtered.insert(filtered.end(), best.begin(), best.end());
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    deflate(filtered, zlib);
+    appendBE32(zlib, adler32(filtered));
+
+    std::vector<uint8_t> header;
+    appendBE32(header, image.width);
+    appendBE32(header, image.height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});     // 8-bit RGBA, no interlacing
+
+    static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> file(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+    appendChunk(file, "IHDR", header);
+    appendChunk(file, "IDAT", zlib);
+    appendChunk(file, "IEND", {});
+    return file;
+}
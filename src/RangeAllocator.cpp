@@ -0,0 +1,207 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t highestBit(uint32_t value) {
+    return 31 - __builtin_clz(value);
+}
+
+uint32_t lowestBit(uint32_t value) {
+    return __builtin_ctz(value);
+}
+
+} // namespace
+
+RangeAllocator::RangeAllocator(uint32_t capacity) {
+    std::fill(&bins[0][0], &bins[0][0] + FL_COUNT * SL_COUNT, NONE);
+    grow(capacity);
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size) {
+    uint32_t node = findFree(size);
+    if (node == NONE) {
+        return INVALID;
+    }
+    removeFree(node);
+    if (nodes[node].size > size) {
+        // Split off the tail and return it to the bins
+        uint32_t rest = newNode();
+        Node& head = nodes[node];
+        Node& tail = nodes[rest];
+        tail.offset = head.offset + size;
+        tail.size = head.size - size;
+        tail.prevPhysical = node;
+        tail.nextPhysical = head.nextPhysical;
+        if (head.nextPhysical != NONE) {
+            nodes[head.nextPhysical].prevPhysical = rest;
+        } else {
+            lastNode = rest;
+        }
+        head.nextPhysical = rest;
+        head.size = size;
+        insertFree(rest);
+    }
+    nodes[node].free = false;
+    usedSize += size;
+    allocationCount++;
+    return node;
+}
+
+void RangeAllocator::free(uint32_t allocation) {
+    uint32_t node = allocation;
+    usedSize -= nodes[node].size;
+    allocationCount--;
+
+    uint32_t prev = nodes[node].prevPhysical;
+    if (prev != NONE && nodes[prev].free) {
+        removeFree(prev);
+        nodes[prev].size += nodes[node].size;
+        nodes[prev].nextPhysical = nodes[node].nextPhysical;
+        if (nodes[node].nextPhysical != NONE) {
+            nodes[nodes[node].nextPhysical].prevPhysical = prev;
+        } else {
+            lastNode = prev;
+        }
+        releaseNode(node);
+        node = prev;
+    }
+    uint32_t next = nodes[node].nextPhysical;
+    if (next != NONE && nodes[next].free) {
+        removeFree(next);
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhysical = nodes[next].nextPhysical;
+        if (nodes[next].nextPhysical != NONE) {
+            nodes[nodes[next].nextPhysical].prevPhysical = node;
+        } else {
+            lastNode = node;
+        }
+        releaseNode(next);
+    }
+    insertFree(node);
+}
+
+void RangeAllocator::grow(uint32_t capacity) {
+    if (capacity <= totalSize) {
+        return;
+    }
+    uint32_t extra = capacity - totalSize;
+    if (lastNode != NONE && nodes[lastNode].free) {
+        removeFree(lastNode);
+        nodes[lastNode].size += extra;
+        insertFree(lastNode);
+    } else {
+        uint32_t node = newNode();
+        nodes[node].offset = totalSize;
+        nodes[node].size = extra;
+        nodes[node].prevPhysical = lastNode;
+        if (lastNode != NONE) {
+            nodes[lastNode].nextPhysical = node;
+        }
+        lastNode = node;
+        insertFree(node);
+    }
+    totalSize = capacity;
+}
+
+RangeAllocatorStats RangeAllocator::stats() const {
+    RangeAllocatorStats stats;
+    stats.capacity = totalSize;
+    stats.used = usedSize;
+    stats.allocations = allocationCount;
+    for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+        for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+            for (uint32_t node = bins[fl][sl]; node != NONE; node = nodes[node].nextFree) {
+                stats.freeRanges++;
+                stats.largestFree = std::max<uint64_t>(stats.largestFree, nodes[node].size);
+            }
+        }
+    }
+    return stats;
+}
+
+uint32_t RangeAllocator::newNode() {
+    if (!unusedNodes.empty()) {
+        uint32_t node = unusedNodes.back();
+        unusedNodes.pop_back();
+        nodes[node] = Node();
+        return node;
+    }
+    nodes.emplace_back();
+    return uint32_t(nodes.size() - 1);
+}
+
+void RangeAllocator::releaseNode(uint32_t node) {
+    unusedNodes.push_back(node);
+}
+
+void RangeAllocator::binOf(uint32_t size, uint32_t& fl, uint32_t& sl) {
+    if (size < SL_COUNT) {
+        fl = 0;
+        sl = size;
+    } else {
+        uint32_t top = highestBit(size);
+        fl = top - SL_BITS + 1;
+        sl = (size >> (top - SL_BITS)) - SL_COUNT;
+    }
+}
+
+void RangeAllocator::insertFree(uint32_t node) {
+    uint32_t fl, sl;
+    binOf(nodes[node].size, fl, sl);
+    Node& n = nodes[node];
+    n.free = true;
+    n.prevFree = NONE;
+    n.nextFree = bins[fl][sl];
+    if (n.nextFree != NONE) {
+        nodes[n.nextFree].prevFree = node;
+    }
+    bins[fl][sl] = node;
+    flBitmap |= 1u << fl;
+    slBitmap[fl] |= 1u << sl;
+}
+
+void RangeAllocator::removeFree(uint32_t node) {
+    uint32_t fl, sl;
+    binOf(nodes[node].size, fl, sl);
+    Node& n = nodes[node];
+    if (n.prevFree != NONE) {
+        nodes[n.prevFree].nextFree = n.nextFree;
+    } else {
+        bins[fl][sl] = n.nextFree;
+    }
+    if (n.nextFree != NONE) {
+        nodes[n.nextFree].prevFree = n.prevFree;
+    }
+    n.free = false;
+    if (bins[fl][sl] == NONE) {
+        slBitmap[fl] &= ~(1u << sl);
+        if (!slBitmap[fl]) {
+            flBitmap &= ~(1u << fl);
+        }
+    }
+}
+
+uint32_t RangeAllocator::findFree(uint32_t size) const {
+    // Round up to the next bin so any range in the bin found fits
+    uint64_t rounded = size;
+    if (size >= SL_COUNT) {
+        rounded += (uint64_t(1) << (highestBit(size) - SL_BITS)) - 1;
+    }
+    if (size == 0 || rounded > UINT32_MAX) {
+        return NONE;
+    }
+    uint32_t fl, sl;
+    binOf(uint32_t(rounded), fl, sl);
+    uint32_t slMap = slBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+        uint32_t flMap = fl + 1 < 32 ? flBitmap & (~0u << (fl + 1)) : 0;
+        if (!flMap) {
+            return NONE;
+        }
+        fl = lowestBit(flMap);
+        slMap = slBitmap[fl];
+    }
+    return bins[fl][lowestBit(slMap)];
+}
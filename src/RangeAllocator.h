@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct RangeAllocatorStats {
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    uint64_t largestFree = 0;
+    uint32_t allocations = 0;
+    uint32_t freeRanges = 0;
+
+    // 0 when all free space is one range, approaching 1 as it splinters
+    // into many small ones.
+    float fragmentation() const {
+        uint64_t free = capacity - used;
+        return free ? 1.0f - float(largestFree) / float(free) : 0.0f;
+    }
+};
+
+// Hands out ranges of [0, capacity) in whatever unit the caller uses, e.g.
+// vertices or indices of a large GPU buffer. Only bookkeeping; nothing is
+// stored in the managed memory itself.
+//
+// A two-level segregated fit (TLSF) allocator: free ranges are binned by
+// the log2 of their size and then linearly into 16 subranges, with a bitmap
+// per level, so allocate() and free() are O(1) however many ranges there
+// are. Allocations are rounded up to the next bin boundary for the search
+// (wasting at most 1/16 of a request while it is free), and freed ranges
+// merge with free neighbours straight away.
+class RangeAllocator {
+public:
+    static constexpr uint32_t INVALID = ~0u;
+
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    // Returns a handle for offset() and free(), or INVALID if no free range
+    // is large enough; grow() and try again. `size` must be non-zero.
+    uint32_t allocate(uint32_t size);
+    void free(uint32_t allocation);
+
+    uint32_t offset(uint32_t allocation) const { return nodes[allocation].offset; }
+    uint32_t size(uint32_t allocation) const { return nodes[allocation].size; }
+
+    // Extends the managed range to `capacity`; never shrinks it.
+    void grow(uint32_t capacity);
+    uint32_t capacity() const { return totalSize; }
+
+    RangeAllocatorStats stats() const;
+
+private:
+    static constexpr uint32_t SL_BITS = 4;
+    static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+    static constexpr uint32_t FL_COUNT = 32 - SL_BITS + 1;
+    static constexpr uint32_t NONE = ~0u;
+
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t prevPhysical = NONE;   // Neighbouring ranges by offset
+        uint32_t nextPhysical = NONE;
+        uint32_t prevFree = NONE;       // Bin list, while free
+        uint32_t nextFree = NONE;
+        bool free = false;
+    };
+
+    // Sizes below SL_COUNT get a bin each, larger ones the bin of their top
+    // SL_BITS + 1 bits
+    static void binOf(uint32_t size, uint32_t& fl, uint32_t& sl);
+    uint32_t newNode();
+    void releaseNode(uint32_t node);
+    void insertFree(uint32_t node);
+    void removeFree(uint32_t node);
+    uint32_t findFree(uint32_t size) const;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+    uint32_t flBitmap = 0;
+    uint32_t slBitmap[FL_COUNT] = {};
+    uint32_t bins[FL_COUNT][SL_COUNT];
+    uint32_t lastNode = NONE;           // Highest offset
+    uint32_t totalSize = 0;
+    uint64_t usedSize = 0;
+    uint32_t allocationCount = 0;
+};
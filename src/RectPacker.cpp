@@ -0,0 +1,104 @@
+#include "RectPacker.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+bool contains(const PackedRect& outer, const PackedRect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+bool overlaps(const PackedRect& a, const PackedRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+} // namespace
+
+RectPacker::RectPacker(uint32_t width, uint32_t height) : binWidth(width), binHeight(height) {
+    reset();
+}
+
+void RectPacker::reset() {
+    usedArea = 0;
+    freeRects.assign(1, PackedRect{0, 0, binWidth, binHeight});
+}
+
+float RectPacker::occupancy() const {
+    return float(double(usedArea) / (double(binWidth) * binHeight));
+}
+
+bool RectPacker::insert(uint32_t width, uint32_t height, PackedRect& placed) {
+    uint32_t bestShort = std::numeric_limits<uint32_t>::max();
+    uint32_t bestLong = std::numeric_limits<uint32_t>::max();
+    bool found = false;
+    for (const PackedRect& free : freeRects) {
+        if (free.width < width || free.height < height) {
+            continue;
+        }
+        uint32_t leftoverX = free.width - width;
+        uint32_t leftoverY = free.height - height;
+        uint32_t shortSide = std::min(leftoverX, leftoverY);
+        uint32_t longSide = std::max(leftoverX, leftoverY);
+        if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+            placed = {free.x, free.y, width, height};
+            bestShort = shortSide;
+            bestLong = longSide;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    splitFreeRects(placed);
+    pruneFreeRects();
+    usedArea += uint64_t(width) * height;
+    return true;
+}
+
+// Replaces every free rectangle the new one overlaps by the up to four
+// maximal rectangles left around it.
+void RectPacker::splitFreeRects(const PackedRect& used) {
+    std::vector<PackedRect> split;
+    split.reserve(freeRects.size() + 4);
+    for (const PackedRect& free : freeRects) {
+        if (!overlaps(free, used)) {
+            split.push_back(free);
+            continue;
+        }
+        if (used.x > free.x) {
+            split.push_back({free.x, free.y, used.x - free.x, free.height});
+        }
+        if (used.x + used.width < free.x + free.width) {
+            uint32_t right = used.x + used.width;
+            split.push_back({right, free.y, free.x + free.width - right, free.height});
+        }
+        if (used.y > free.y) {
+            split.push_back({free.x, free.y, free.width, used.y - free.y});
+        }
+        if (used.y + used.height < free.y + free.height) {
+            uint32_t top = used.y + used.height;
+            split.push_back({free.x, top, free.width, free.y + free.height - top});
+        }
+    }
+    freeRects.swap(split);
+}
+
+// Drops free rectangles that lie inside another one.
+void RectPacker::pruneFreeRects() {
+    for (size_t i = 0; i < freeRects.size(); ++i) {
+        for (size_t j = i + 1; j < freeRects.size();) {
+            if (contains(freeRects[j], freeRects[i])) {
+                freeRects.erase(freeRects.begin() + i);
+                --i;
+                break;
+            }
+            if (contains(freeRects[i], freeRects[j])) {
+                freeRects.erase(freeRects.begin() + j);
+            } else {
+                ++j;
+            }
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct PackedRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+// MaxRects bin packer. It keeps the maximal free rectangles of the bin and
+// places each new rectangle in the one that leaves the shortest leftover
+// side (best short side fit). Rectangles are never rotated, since a rotated
+// texture would need rotated UVs too.
+//
+// Inserting in order of decreasing height packs noticeably tighter, so
+// offline callers should sort first; runtime callers can insert as they go.
+class RectPacker {
+public:
+    RectPacker(uint32_t width, uint32_t height);
+
+    // Places a width x height rectangle. Returns false, leaving the bin
+    // unchanged, if there is no room for it.
+    bool insert(uint32_t width, uint32_t height, PackedRect& placed);
+
+    // Empties the bin.
+    void reset();
+
+    // Fraction of the bin covered by placed rectangles.
+    float occupancy() const;
+
+    uint32_t width() const { return binWidth; }
+    uint32_t height() const { return binHeight; }
+
+private:
+    void splitFreeRects(const PackedRect& used);
+    void pruneFreeRects();
+
+    uint32_t binWidth;
+    uint32_t binHeight;
+    uint64_t usedArea = 0;
+    std::vector<PackedRect> freeRects;
+};
@@ -0,0 +1,261 @@
+#include "RenderGraph.h"
+#include "CpuProfiler.h"
+#include "Framebuffer.h"
+#include "GpuFeatures.h"
+#include "GpuProfiler.h"
+#include "RenderStats.h"
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::color(Resource resource, RenderGraphLoad load,
+                                                          const glm::vec4& clearColor) {
+    graph.passes[pass].colors.push_back({resource, load, clearColor});
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::depth(Resource resource, RenderGraphLoad load, float clearDepth) {
+    graph.passes[pass].depth = {resource, load, glm::vec4(clearDepth)};
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(Resource resource) {
+    graph.passes[pass].reads.push_back(resource);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect() {
+    graph.passes[pass].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph(RenderTargetPool& pool, GpuProfiler* profiler) : pool(pool), profiler(profiler) {}
+
+RenderGraph::Resource RenderGraph::create(const char* name, uint32_t width, uint32_t height, GLenum format) {
+    resources.push_back({name, width, height, format, 0});
+    return Resource(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importFramebuffer(const char* name, unsigned int framebuffer, uint32_t width,
+                                                     uint32_t height) {
+    resources.push_back({name, width, height, 0, framebuffer});
+    return Resource(resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name, Execute execute) {
+    passes.emplace_back();
+    passes.back().name = name;
+    passes.back().execute = std::move(execute);
+    return PassBuilder(*this, uint32_t(passes.size() - 1));
+}
+
+void RenderGraph::execute() {
+    {
+        PROFILE_SCOPE("Compile graph");
+        compile();
+    }
+    size_t liveBytes = 0;
+    for (uint32_t i = 0; i < passes.size(); ++i) {
+        if (passes[i].culled) {
+            continue;
+        }
+        // Textures start living at their first pass...
+        auto acquire = [&](Resource r) {
+            ResourceNode& resource = resources[r];
+            if (resource.format && resource.firstPass == i && !resource.target) {
+                resource.target = &pool.acquire(resource.width, resource.height, resource.format);
+                liveBytes += resource.target->byteSize();
+                lastStats.peakBytes = std::max(lastStats.peakBytes, liveBytes);
+            }
+        };
+        // ...and end after their last, without storing anything
+        auto release = [&](Resource r) {
+            ResourceNode& resource = resources[r];
+            if (resource.format && resource.lastPass == i && resource.target) {
+                if (gpuFeatures().invalidateData) {
+                    glInvalidateTexImage(resource.target->ID, 0);
+                }
+                liveBytes -= resource.target->byteSize();
+                pool.release(*resource.target);
+                resource.target = nullptr;
+            }
+        };
+        PassNode& pass = passes[i];
+        for (const Attachment& attachment : pass.colors) {
+            acquire(attachment.resource);
+        }
+        if (pass.depth.resource != NO_RESOURCE) {
+            acquire(pass.depth.resource);
+        }
+        for (Resource r : pass.reads) {
+            acquire(r);
+        }
+
+        runPass(i);
+
+        for (const Attachment& attachment : pass.colors) {
+            release(attachment.resource);
+        }
+        if (pass.depth.resource != NO_RESOURCE) {
+            release(pass.depth.resource);
+        }
+        for (Resource r : pass.reads) {
+            release(r);
+        }
+    }
+    passes.clear();
+    resources.clear();
+}
+
+// Walks the passes backwards from the ones that must run, keeping each pass
+// that writes something a kept pass needs, then takes the lifetimes of the
+// transient textures from the passes left
+void RenderGraph::compile() {
+    lastStats = RenderGraphStats();
+    lastStats.passes = uint32_t(passes.size());
+    needed.assign(resources.size(), 0);
+    for (uint32_t i = uint32_t(passes.size()); i-- > 0;) {
+        PassNode& pass = passes[i];
+        std::vector<Attachment> attachments = pass.colors;
+        if (pass.depth.resource != NO_RESOURCE) {
+            attachments.push_back(pass.depth);
+        }
+        bool keep = pass.sideEffect;
+        for (const Attachment& attachment : attachments) {
+            const ResourceNode& resource = resources[attachment.resource];
+            keep = keep || resource.format == 0 || needed[attachment.resource];
+        }
+        pass.culled = !keep;
+        if (!keep) {
+            lastStats.culledPasses++;
+            continue;
+        }
+        // An overwritten attachment no longer needs earlier writers; a
+        // loaded one does
+        for (const Attachment& attachment : attachments) {
+            needed[attachment.resource] = attachment.load == RenderGraphLoad::Load;
+        }
+        for (Resource r : pass.reads) {
+            needed[r] = 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < passes.size(); ++i) {
+        const PassNode& pass = passes[i];
+        if (pass.culled) {
+            continue;
+        }
+        auto use = [&](Resource r) {
+            ResourceNode& resource = resources[r];
+            resource.firstPass = std::min(resource.firstPass, i);
+            resource.lastPass = std::max(resource.lastPass, i);
+        };
+        for (const Attachment& attachment : pass.colors) {
+            use(attachment.resource);
+        }
+        if (pass.depth.resource != NO_RESOURCE) {
+            use(pass.depth.resource);
+        }
+        for (Resource r : pass.reads) {
+            use(r);
+        }
+    }
+    for (const ResourceNode& resource : resources) {
+        if (resource.format && resource.firstPass != ~0u) {
+            lastStats.textures++;
+            lastStats.unaliasedBytes += size_t(resource.width) * resource.height * renderTargetTexelSize(resource.format);
+        }
+    }
+}
+
+void RenderGraph::runPass(uint32_t index) {
+    PassNode& pass = passes[index];
+    PROFILE_SCOPE(pass.name);
+    if (profiler) {
+        profiler->push(pass.name);
+    }
+    beginAttachments(pass, index);
+    pass.execute(*this);
+    if (profiler) {
+        profiler->pop();
+    }
+}
+
+void RenderGraph::beginAttachments(const PassNode& pass, uint32_t index) {
+    if (pass.colors.empty() && pass.depth.resource == NO_RESOURCE) {
+        return;
+    }
+    std::vector<Resource> colors;
+    for (const Attachment& attachment : pass.colors) {
+        colors.push_back(attachment.resource);
+    }
+    const ResourceNode& first = resources[colors.empty() ? pass.depth.resource : colors[0]];
+    unsigned int target = framebuffer(colors, pass.depth.resource);
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, first.width, first.height);
+    countStateChange();
+
+    // Clears where asked for, invalidates where the pass overwrites what is
+    // there; a transient texture's first pass has nothing to do either way
+    std::vector<GLenum> dropped;
+    for (uint32_t i = 0; i < pass.colors.size(); ++i) {
+        const Attachment& attachment = pass.colors[i];
+        const ResourceNode& resource = resources[attachment.resource];
+        if (attachment.load == RenderGraphLoad::Clear) {
+            glClearBufferfv(GL_COLOR, GLint(i), &attachment.clearValue[0]);
+        } else if (attachment.load == RenderGraphLoad::DontCare && !(resource.format && resource.firstPass == index)) {
+            dropped.push_back(target == 0 ? GL_COLOR : GL_COLOR_ATTACHMENT0 + i);
+        }
+    }
+    if (pass.depth.resource != NO_RESOURCE) {
+        const Attachment& attachment = pass.depth;
+        const ResourceNode& resource = resources[attachment.resource];
+        GLenum attachmentPoint = resource.target->depthAttachment();
+        if (attachment.load == RenderGraphLoad::Clear) {
+            glDepthMask(GL_TRUE);
+            if (attachmentPoint == GL_DEPTH_STENCIL_ATTACHMENT) {
+                glClearBufferfi(GL_DEPTH_STENCIL, 0, attachment.clearValue.x, 0);
+            } else {
+                glClearBufferfv(GL_DEPTH, 0, &attachment.clearValue.x);
+            }
+        } else if (attachment.load == RenderGraphLoad::DontCare && resource.firstPass != index) {
+            dropped.push_back(attachmentPoint);
+        }
+    }
+    if (!dropped.empty() && gpuFeatures().invalidateData) {
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, GLsizei(dropped.size()), dropped.data());
+    }
+}
+
+unsigned int RenderGraph::texture(Resource resource) const {
+    const RenderTarget* target = resources[resource].target;
+    return target ? target->ID : 0;
+}
+
+unsigned int RenderGraph::framebuffer(const std::vector<Resource>& colors, Resource depth) const {
+    bool imported = false;
+    std::vector<const RenderTarget*> colorTargets;
+    for (Resource r : colors) {
+        imported = imported || resources[r].format == 0;
+        colorTargets.push_back(resources[r].target);
+    }
+    if (imported) {
+        if (colors.size() != 1 || depth != NO_RESOURCE) {
+            throw std::logic_error(std::string("Imported framebuffer ") + resources[colors[0]].name +
+                                   " attached together with other resources");
+        }
+        return resources[colors[0]].importedFramebuffer;
+    }
+    const RenderTarget* depthTarget = depth != NO_RESOURCE ? resources[depth].target : nullptr;
+    for (const RenderTarget* target : colorTargets) {
+        if (!target) {
+            throw std::logic_error("Render graph resource used outside of its lifetime");
+        }
+    }
+    if (depth != NO_RESOURCE && (!depthTarget || resources[depth].format == 0)) {
+        throw std::logic_error("Render graph depth resource is not a live transient texture");
+    }
+    return pool.framebuffer(colorTargets, depthTarget).ID;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class GpuProfiler;
+class RenderTarget;
+class RenderTargetPool;
+
+// What happens to an attachment's contents when a pass starts.
+enum class RenderGraphLoad {
+    Load,       // Keeps what earlier passes wrote
+    Clear,      // Clears to the pass's clear value
+    DontCare,   // Every pixel is overwritten, so the old contents are dropped
+};
+
+// Per-frame totals of the last execute().
+struct RenderGraphStats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t textures = 0;          // Transient textures used by the passes that ran
+    size_t peakBytes = 0;           // Most transient texture memory live at once
+    size_t unaliasedBytes = 0;      // What the textures would take without sharing
+};
+
+// Frame graph: each frame, passes declare the virtual textures they render
+// into and read, in execution order, and the graph works out the rest:
+//   - passes whose results nothing reads are culled, unless they write an
+//     imported target (the window, say) or are marked sideEffect()
+//   - a transient texture exists only from the first to the last pass that
+//     uses it; it is acquired from a RenderTargetPool just before and
+//     released right after, so textures of the same format and size whose
+//     lifetimes don't overlap share one allocation
+//   - a transient texture is invalidated after its last use, so its
+//     contents are never written back, and its first pass never loads
+//     them: it clears if it asks to and otherwise starts from nothing.
+//     Later passes load what earlier ones wrote; DontCare invalidates
+//     instead, and clears happen only where a pass asks for one
+// Each pass that runs is a GPU and CPU profiler scope of its name.
+//
+// OpenGL has no way to place textures of different shapes in one memory
+// block, so aliasing here means reusing texture objects; keep formats and
+// sizes uniform where lifetimes allow to get the most out of it.
+//
+// Each frame, on the GL thread:
+//   create/importFramebuffer()   the frame's resources
+//   addPass()                    in execution order, with its attachments
+//   execute()                    compiles, runs and resets for the next frame
+// Names are kept by pointer and must outlive the frame, e.g. literals.
+class RenderGraph {
+public:
+    using Resource = uint32_t;
+    static constexpr Resource NO_RESOURCE = ~0u;
+
+    // Passes run with their attachments bound, the viewport set to them and
+    // `graph` answering texture() and framebuffer() for their resources.
+    using Execute = std::function<void(RenderGraph& graph)>;
+
+    // Declares a pass's attachments and inputs, in any order.
+    class PassBuilder {
+    public:
+        // Renders into `resource` as the next color attachment.
+        PassBuilder& color(Resource resource, RenderGraphLoad load = RenderGraphLoad::Load,
+                           const glm::vec4& clearColor = glm::vec4(0.0f));
+        PassBuilder& depth(Resource resource, RenderGraphLoad load = RenderGraphLoad::Load, float clearDepth = 1.0f);
+        // Samples, blits or otherwise reads `resource`; binding it is up to
+        // the pass.
+        PassBuilder& read(Resource resource);
+        // Never culled, e.g. for readbacks or uploads.
+        PassBuilder& sideEffect();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        RenderGraph& graph;
+        uint32_t pass;
+    };
+
+    // Pass timings go to `profiler` if given.
+    explicit RenderGraph(RenderTargetPool& pool, GpuProfiler* profiler = nullptr);
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // A texture that lives within this frame.
+    Resource create(const char* name, uint32_t width, uint32_t height, GLenum format);
+    // A framebuffer made outside the graph, 0 for the window's. Its
+    // contents outlast the frame, so passes writing it are never culled.
+    // It can only be attached on its own, as a pass's single color
+    // attachment.
+    Resource importFramebuffer(const char* name, unsigned int framebuffer, uint32_t width, uint32_t height);
+
+    PassBuilder addPass(const char* name, Execute execute);
+
+    void execute();
+
+    // Inside a pass: the texture behind a transient resource the pass uses.
+    unsigned int texture(Resource resource) const;
+    // Inside a pass: a framebuffer with these attachments, e.g. to blit
+    // from. Imported resources give back their own framebuffer.
+    unsigned int framebuffer(const std::vector<Resource>& colors, Resource depth = NO_RESOURCE) const;
+
+    const RenderGraphStats& stats() const { return lastStats; }
+
+private:
+    struct ResourceNode {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+        GLenum format;                  // 0 when imported
+        unsigned int importedFramebuffer;
+        const RenderTarget* target = nullptr;   // Pooled, while live
+        uint32_t firstPass = ~0u;               // Lifetime among the passes that run
+        uint32_t lastPass = 0;
+    };
+
+    struct Attachment {
+        Resource resource;
+        RenderGraphLoad load;
+        glm::vec4 clearValue;
+    };
+
+    struct PassNode {
+        const char* name;
+        Execute execute;
+        std::vector<Attachment> colors;
+        Attachment depth = {NO_RESOURCE, RenderGraphLoad::Load, glm::vec4(1.0f)};
+        std::vector<Resource> reads;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+
+    void compile();
+    void runPass(uint32_t index);
+    void beginAttachments(const PassNode& pass, uint32_t index);
+
+    RenderTargetPool& pool;
+    GpuProfiler* profiler;
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<uint8_t> needed;        // Scratch for compile(), per resource
+    RenderGraphStats lastStats;
+};
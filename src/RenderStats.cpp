@@ -0,0 +1,17 @@
+#include "RenderStats.h"
+
+namespace {
+
+RenderStats current;
+
+} // namespace
+
+RenderStats& renderStats() {
+    return current;
+}
+
+RenderStats takeRenderStats() {
+    RenderStats frame = current;
+    current = RenderStats();
+    return frame;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// What one frame asked of the driver. The GL wrappers count their own
+// calls: draws in Mesh, MeshPool and GpuScene, binds of programs, VAOs,
+// textures and framebuffers as state changes, and every byte they hand to
+// glBufferSubData, glTexImage and friends, or write into a StreamBuffer, as
+// uploads. Raw GL calls elsewhere count themselves with the functions below.
+//
+// Indirect draws count as one call; how many triangles they submit is only
+// decided on the GPU, so those are not counted.
+//
+// Plain counters, GL thread only.
+struct RenderStats {
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+    uint32_t stateChanges = 0;
+    uint64_t uploadBytes = 0;
+};
+
+// The frame being recorded.
+RenderStats& renderStats();
+// Returns the frame recorded so far and starts counting a new one.
+RenderStats takeRenderStats();
+
+inline void countDraw(uint64_t triangles, uint32_t calls = 1) {
+    RenderStats& stats = renderStats();
+    stats.drawCalls += calls;
+    stats.triangles += triangles;
+}
+
+inline void countStateChange(uint32_t changes = 1) {
+    renderStats().stateChanges += changes;
+}
+
+inline void countUpload(size_t bytes) {
+    renderStats().uploadBytes += bytes;
+}
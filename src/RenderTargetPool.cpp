@@ -0,0 +1,94 @@
+#include "RenderTargetPool.h"
+#include "GlDebug.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+RenderTargetPool::RenderTargetPool(uint32_t unusedFrames) : unusedFrames(unusedFrames) {}
+
+// Framebuffers go before the targets they attach
+RenderTargetPool::~RenderTargetPool() {
+    framebuffers.clear();
+}
+
+void RenderTargetPool::beginFrame() {
+    ++frame;
+    lastPeakBytes = peakBytes;
+    peakBytes = heldBytes;
+    for (Entry& entry : entries) {
+        if (entry.acquired || frame - entry.lastUsed <= unusedFrames) {
+            continue;
+        }
+        const RenderTarget* target = entry.target.get();
+        framebuffers.erase(std::remove_if(framebuffers.begin(), framebuffers.end(),
+                                          [target](const CachedFramebuffer& cached) {
+                                              return std::find(cached.attachments.begin(), cached.attachments.end(),
+                                                               target) != cached.attachments.end();
+                                          }),
+                           framebuffers.end());
+        totalBytes -= target->byteSize();
+        entry.target.reset();
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) { return !entry.target; }),
+                  entries.end());
+}
+
+const RenderTarget& RenderTargetPool::acquire(uint32_t width, uint32_t height, GLenum format) {
+    for (Entry& entry : entries) {
+        const RenderTarget& target = *entry.target;
+        if (!entry.acquired && target.width() == width && target.height() == height && target.format() == format) {
+            entry.acquired = true;
+            entry.lastUsed = frame;
+            heldBytes += target.byteSize();
+            peakBytes = std::max(peakBytes, heldBytes);
+            return target;
+        }
+    }
+    Entry entry;
+    entry.target = std::make_unique<RenderTarget>(width, height, format);
+    entry.acquired = true;
+    entry.lastUsed = frame;
+    labelGlObject(GL_TEXTURE, entry.target->ID, "Pooled render target");
+    totalBytes += entry.target->byteSize();
+    heldBytes += entry.target->byteSize();
+    peakBytes = std::max(peakBytes, heldBytes);
+    allocationCount++;
+    entries.push_back(std::move(entry));
+    return *entries.back().target;
+}
+
+void RenderTargetPool::release(const RenderTarget& target) {
+    Entry* entry = find(target);
+    if (!entry || !entry->acquired) {
+        throw std::logic_error("Render target released without being acquired");
+    }
+    entry->acquired = false;
+    entry->lastUsed = frame;
+    heldBytes -= target.byteSize();
+}
+
+const Framebuffer& RenderTargetPool::framebuffer(const std::vector<const RenderTarget*>& colors,
+                                                 const RenderTarget* depth) {
+    std::vector<const RenderTarget*> attachments = colors;
+    attachments.push_back(depth);
+    for (const CachedFramebuffer& cached : framebuffers) {
+        if (cached.attachments == attachments) {
+            return *cached.framebuffer;
+        }
+    }
+    CachedFramebuffer cached;
+    cached.attachments = std::move(attachments);
+    cached.framebuffer = std::make_unique<Framebuffer>(colors, depth);
+    labelGlObject(GL_FRAMEBUFFER, cached.framebuffer->ID, "Pooled framebuffer");
+    framebuffers.push_back(std::move(cached));
+    return *framebuffers.back().framebuffer;
+}
+
+RenderTargetPool::Entry* RenderTargetPool::find(const RenderTarget& target) {
+    for (Entry& entry : entries) {
+        if (entry.target.get() == &target) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Framebuffer.h"
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Transient render targets reused across passes and frames. A pass
+// acquires the targets it renders into, by format and size, and releases
+// them once the last pass reading them has run; the next acquire of the
+// same format and size, in this frame or a later one, gets the same
+// texture back instead of a new allocation. Framebuffers over pooled
+// targets are cached as well, so a frame of post-processing or shadow
+// passes that settles into the same shapes allocates nothing.
+//
+// Targets nobody has acquired for a few frames, e.g. after a resize, are
+// freed in beginFrame(). A released target's contents are undefined:
+// clear it, or invalidate() it before a pass that overwrites all of it.
+//
+// Each frame, on the GL thread:
+//   beginFrame()
+//   acquire() / framebuffer() / release()   per pass
+class RenderTargetPool {
+public:
+    explicit RenderTargetPool(uint32_t unusedFrames = 3);
+    ~RenderTargetPool();
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    void beginFrame();
+
+    // A target of this format and size that nobody else holds.
+    const RenderTarget& acquire(uint32_t width, uint32_t height, GLenum format);
+    void release(const RenderTarget& target);
+
+    // A framebuffer over these pooled targets, created on first use and
+    // kept until one of them is freed.
+    const Framebuffer& framebuffer(const std::vector<const RenderTarget*>& colors, const RenderTarget* depth = nullptr);
+
+    // Memory of every pooled target, and of those currently acquired
+    size_t allocatedBytes() const { return totalBytes; }
+    size_t acquiredBytes() const { return heldBytes; }
+    // Most held at once during the last whole frame, the memory the frame
+    // actually needs
+    size_t peakAcquiredBytes() const { return lastPeakBytes; }
+    // Targets created so far; flat once the frame's shapes repeat
+    uint64_t allocations() const { return allocationCount; }
+
+private:
+    struct Entry {
+        std::unique_ptr<RenderTarget> target;
+        bool acquired = false;
+        uint64_t lastUsed = 0;
+    };
+
+    struct CachedFramebuffer {
+        std::vector<const RenderTarget*> attachments;   // Colors, then depth or null
+        std::unique_ptr<Framebuffer> framebuffer;
+    };
+
+    Entry* find(const RenderTarget& target);
+
+    uint32_t unusedFrames;
+    uint64_t frame = 0;
+    std::vector<Entry> entries;
+    std::vector<CachedFramebuffer> framebuffers;
+    size_t totalBytes = 0;
+    size_t heldBytes = 0;
+    size_t peakBytes = 0;
+    size_t lastPeakBytes = 0;
+    uint64_t allocationCount = 0;
+};
@@ -0,0 +1,106 @@
+#include "Shader.h"
+#include "FileSystem.h"
+#include "GlDebug.h"
+#include "RenderStats.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <ios>
+#include <iostream>
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+    unsigned int vertexShader = compileShader(vertexPath, GL_VERTEX_SHADER);
+    unsigned int fragmentShader = compileShader(fragmentPath, GL_FRAGMENT_SHADER);
+
+    ID = glCreateProgram();
+    glAttachShader(ID, vertexShader);
+    glAttachShader(ID, fragmentShader);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+    labelGlObject(GL_PROGRAM, ID, fragmentPath);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+}
+
+Shader::Shader(const char* computePath) {
+    unsigned int computeShader = compileShader(computePath, GL_COMPUTE_SHADER);
+
+    ID = glCreateProgram();
+    glAttachShader(ID, computeShader);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+    labelGlObject(GL_PROGRAM, ID, computePath);
+
+    glDeleteShader(computeShader);
+}
+
+Shader::~Shader() {
+    glDeleteProgram(ID);
+}
+
+void Shader::use() const {
+    glUseProgram(ID);
+    countStateChange();
+}
+
+void Shader::setMat4(const std::string& name, const glm::mat4& value) const {
+    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
+    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
+    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
+void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
+    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
+void Shader::setFloat(const std::string& name, float value) const {
+    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+}
+
+void Shader::setInt(const std::string& name, int value) const {
+    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+}
+
+unsigned int Shader::compileShader(const char* path, GLenum type) const {
+    std::string code = readFile(path);
+    const char* source = code.c_str();
+    unsigned int shader = glCreateShader(type);
+    labelGlObject(GL_SHADER, shader, path);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    checkCompileErrors(shader, type == GL_VERTEX_SHADER ? "VERTEX" : type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "COMPUTE");
+    return shader;
+}
+
+void Shader::checkCompileErrors(unsigned int shader, const std::string& type) const {
+    int success;
+    char infoLog[1024];
+    if (type == "PROGRAM") {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+            std::cerr << "Program Linking Error: " << infoLog << std::endl;
+        }
+    } else {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+            std::cerr << type << " Shader Compilation Error: " << infoLog << std::endl;
+        }
+    }
+}
+
+std::string Shader::readFile(const char* filepath) {
+    try {
+        FileData file = openFile(filepath);
+        return std::string(reinterpret_cast<const char*>(file.data()), file.size());
+    } catch (const std::ios_base::failure&) {
+        throw std::ios_base::failure("Failed to read shader file: " + std::string(filepath));
+    }
+}
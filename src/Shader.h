@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+
+// Shader program built from GLSL files opened through the FileSystem.
+// Compile and link errors are printed to std::cerr; a missing file throws
+// std::ios_base::failure.
+class Shader {
+public:
+    unsigned int ID;
+
+    Shader(const char* vertexPath, const char* fragmentPath);
+    // Compute program; needs GL 4.3.
+    explicit Shader(const char* computePath);
+    ~Shader();
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    void use() const;
+
+    void setMat4(const std::string& name, const glm::mat4& value) const;
+    void setVec2(const std::string& name, const glm::vec2& value) const;
+    void setVec3(const std::string& name, const glm::vec3& value) const;
+    void setVec4(const std::string& name, const glm::vec4& value) const;
+    void setFloat(const std::string& name, float value) const;
+    void setInt(const std::string& name, int value) const;
+
+private:
+    unsigned int compileShader(const char* path, GLenum type) const;
+    void checkCompileErrors(unsigned int shader, const std::string& type) const;
+    static std::string readFile(const char* filepath);
+};
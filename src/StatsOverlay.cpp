@@ -0,0 +1,390 @@
+#include "StatsOverlay.h"
+#include "GlDebug.h"
+#include "GpuProfiler.h"
+#include "StreamBuffer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr const char* OVERLAY_VERTEX_SHADER_PATH = "res/shaders/overlay_vertex_shader.glsl";
+constexpr const char* OVERLAY_FRAGMENT_SHADER_PATH = "res/shaders/overlay_fragment_shader.glsl";
+
+// Layout, in font pixels
+constexpr uint32_t GLYPH_WIDTH = 5;
+constexpr uint32_t GLYPH_HEIGHT = 7;
+constexpr uint32_t CELL_WIDTH = 6;
+constexpr uint32_t CELL_HEIGHT = 8;
+constexpr uint32_t LINE_HEIGHT = 9;
+constexpr uint32_t MARGIN = 4;
+constexpr uint32_t GRAPH_FRAMES = 120;
+constexpr uint32_t GRAPH_BAR_WIDTH = 2;
+constexpr uint32_t GRAPH_HEIGHT = 40;
+constexpr uint32_t GRAPH_GAP = 4;
+constexpr int NAME_COLUMNS = 18;
+
+constexpr double GRAPH_MAX_MS = 100.0 / 3.0;    // Top of the graph, 30 FPS
+constexpr double TARGET_MS = 50.0 / 3.0;        // 60 FPS, marked with a line
+constexpr double REBUILD_INTERVAL_US = 250000.0;
+// Weight of the newest frame in the moving average, as in GpuProfiler
+constexpr double AVERAGE_WEIGHT = 0.05;
+
+// ASCII 32 to 95, five columns per glyph with the top row in bit 0. Lower
+// case is drawn as upper case. The font texture has one more, solid cell
+// after these for plain quads.
+constexpr uint32_t FONT_GLYPHS = 64;
+constexpr uint32_t SOLID_CELL = FONT_GLYPHS;
+constexpr uint32_t FONT_WIDTH = (FONT_GLYPHS + 1) * CELL_WIDTH;
+constexpr uint8_t FONT[FONT_GLYPHS][GLYPH_WIDTH] = {
+    // Space to /
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x00, 0x07, 0x00, 0x00},
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    // 0 to ?
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    // @ to O
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    // P to _
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+};
+
+const glm::vec4 TEXT_COLOR(1.0f, 1.0f, 1.0f, 1.0f);
+const glm::vec4 HEADING_COLOR(1.0f, 0.85f, 0.4f, 1.0f);
+const glm::vec4 BACKDROP_COLOR(0.0f, 0.0f, 0.0f, 0.6f);
+const glm::vec4 TARGET_COLOR(1.0f, 1.0f, 1.0f, 0.35f);
+const glm::vec4 FAST_COLOR(0.3f, 0.85f, 0.3f, 1.0f);
+const glm::vec4 SLOW_COLOR(0.95f, 0.75f, 0.2f, 1.0f);
+const glm::vec4 STALL_COLOR(0.95f, 0.25f, 0.2f, 1.0f);
+
+glm::vec4 cellRect(uint32_t cell, uint32_t width, uint32_t height) {
+    return glm::vec4(float(cell * CELL_WIDTH) / FONT_WIDTH, 0.0f, float(cell * CELL_WIDTH + width) / FONT_WIDTH,
+                     float(height) / CELL_HEIGHT);
+}
+
+const glm::vec4 SOLID_RECT = cellRect(SOLID_CELL, CELL_WIDTH, CELL_HEIGHT);
+
+// Top of text line `line`; the graph sits between the first and second
+float lineY(uint32_t line) {
+    return float(MARGIN + line * LINE_HEIGHT + (line > 0 ? GRAPH_HEIGHT + GRAPH_GAP : 0));
+}
+
+void formatBytes(double bytes, char* out, size_t size) {
+    if (bytes >= 1024.0 * 1024.0 * 1024.0) {
+        std::snprintf(out, size, "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+    } else if (bytes >= 1024.0 * 1024.0) {
+        std::snprintf(out, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024.0) {
+        std::snprintf(out, size, "%.1f KB", bytes / 1024.0);
+    } else {
+        std::snprintf(out, size, "%.0f B", bytes);
+    }
+}
+
+void formatCount(double count, char* out, size_t size) {
+    if (count >= 1e6) {
+        std::snprintf(out, size, "%.2fM", count / 1e6);
+    } else if (count >= 1e4) {
+        std::snprintf(out, size, "%.1fK", count / 1e3);
+    } else {
+        std::snprintf(out, size, "%.0f", count);
+    }
+}
+
+// Indices of `scopes` depth first, each parent before its children
+template <typename Scope>
+void treeOrder(const std::vector<Scope>& scopes, uint32_t parent, std::vector<uint32_t>& order) {
+    for (uint32_t i = 0; i < scopes.size(); ++i) {
+        if (scopes[i].parent == parent) {
+            order.push_back(i);
+            treeOrder(scopes, i, order);
+        }
+    }
+}
+
+} // namespace
+
+StatsOverlay::StatsOverlay(const GpuProfiler& gpuProfiler, uint32_t scale)
+    : gpuProfiler(gpuProfiler),
+      scale(float(std::max(scale, 1u))),
+      shader(OVERLAY_VERTEX_SHADER_PATH, OVERLAY_FRAGMENT_SHADER_PATH),
+      frameTimes(GRAPH_FRAMES, 0.0f) {
+    // Rectangle, font UVs and color per quad; the corners come from
+    // gl_VertexID
+    instanceLayout.add(0, VertexFormat::Float4).add(1, VertexFormat::Unorm16x4).add(2, VertexFormat::Unorm8x4);
+    vao.setFormat(instanceLayout, 0, 1);
+
+    std::vector<uint8_t> pixels(size_t(FONT_WIDTH) * CELL_HEIGHT, 0);
+    for (uint32_t glyph = 0; glyph < FONT_GLYPHS; ++glyph) {
+        for (uint32_t x = 0; x < GLYPH_WIDTH; ++x) {
+            for (uint32_t y = 0; y < GLYPH_HEIGHT; ++y) {
+                if (FONT[glyph][x] & (1u << y)) {
+                    pixels[y * FONT_WIDTH + glyph * CELL_WIDTH + x] = 255;
+                }
+            }
+        }
+    }
+    for (uint32_t y = 0; y < CELL_HEIGHT; ++y) {
+        std::fill_n(&pixels[y * FONT_WIDTH + SOLID_CELL * CELL_WIDTH], CELL_WIDTH, uint8_t(255));
+    }
+    glGenTextures(1, &font);
+    glBindTexture(GL_TEXTURE_2D, font);
+    labelGlObject(GL_TEXTURE, font, "Overlay font");
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, FONT_WIDTH, CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countUpload(pixels.size());
+}
+
+StatsOverlay::~StatsOverlay() {
+    glDeleteTextures(1, &font);
+}
+
+void StatsOverlay::addMemorySource(std::string name, std::function<MemoryUsage()> usage) {
+    memorySources.push_back({std::move(name), std::move(usage)});
+}
+
+void StatsOverlay::beginFrame() {
+    double now = traceClock();
+    if (lastFrameStart >= 0.0) {
+        frameTimes[nextFrameTime] = float((now - lastFrameStart) / 1000.0);
+        nextFrameTime = (nextFrameTime + 1) % GRAPH_FRAMES;
+    }
+    lastFrameStart = now;
+
+    // Counters are averaged from when the overlay is shown
+    if (!shown) {
+        counterTotals = RenderStats();
+        counterFrames = 0;
+        lastRebuild = -1.0;
+    }
+    RenderStats frame = takeRenderStats();
+    counterTotals.drawCalls += frame.drawCalls;
+    counterTotals.triangles += frame.triangles;
+    counterTotals.stateChanges += frame.stateChanges;
+    counterTotals.uploadBytes += frame.uploadBytes;
+    counterFrames++;
+
+    collectCpuPasses();
+}
+
+// Zones nest within a thread, so sorted by start each one's parent is the
+// latest zone still open when it starts
+void StatsOverlay::collectCpuPasses() {
+    zones.clear();
+    zoneCursor = readCpuZones(zoneCursor, zones);
+    std::sort(zones.begin(), zones.end(), [](const CpuZoneSample& a, const CpuZoneSample& b) {
+        return a.start != b.start ? a.start < b.start : a.duration > b.duration;
+    });
+    passTotals.assign(cpuPasses.size(), 0.0);
+    openPasses.clear();
+    for (const CpuZoneSample& zone : zones) {
+        while (!openPasses.empty() && zone.start >= openPasses.back().first) {
+            openPasses.pop_back();
+        }
+        uint32_t pass = passFor(zone.name, openPasses.empty() ? GpuProfiler::NO_PARENT : openPasses.back().second);
+        passTotals.resize(cpuPasses.size(), 0.0);
+        passTotals[pass] += zone.duration / 1000.0;
+        openPasses.push_back({zone.start + zone.duration, pass});
+    }
+    if (zones.empty()) {
+        return;
+    }
+    for (uint32_t i = 0; i < cpuPasses.size(); ++i) {
+        CpuPass& pass = cpuPasses[i];
+        pass.lastMs = passTotals[i];
+        pass.averageMs =
+            pass.samples == 0 ? pass.lastMs : pass.averageMs + (pass.lastMs - pass.averageMs) * AVERAGE_WEIGHT;
+        pass.samples++;
+    }
+}
+
+uint32_t StatsOverlay::passFor(const char* name, uint32_t parent) {
+    for (uint32_t pass = 0; pass < cpuPasses.size(); ++pass) {
+        if (cpuPasses[pass].parent == parent && std::strcmp(cpuPasses[pass].name, name) == 0) {
+            return pass;
+        }
+    }
+    CpuPass pass;
+    pass.name = name;
+    pass.parent = parent;
+    pass.depth = parent == GpuProfiler::NO_PARENT ? 0 : cpuPasses[parent].depth + 1;
+    cpuPasses.push_back(pass);
+    return uint32_t(cpuPasses.size() - 1);
+}
+
+void StatsOverlay::rebuildText() {
+    text.clear();
+    textLines = 0;
+    textWidth = 0.0f;
+    char line[128];
+
+    double total = 0.0, best = std::numeric_limits<double>::max(), worst = 0.0;
+    uint32_t frames = 0;
+    for (float ms : frameTimes) {
+        if (ms > 0.0f) {
+            total += ms;
+            best = std::min(best, double(ms));
+            worst = std::max(worst, double(ms));
+            frames++;
+        }
+    }
+    if (frames > 0) {
+        double average = total / frames;
+        std::snprintf(line, sizeof(line), "FPS %.1f  %.2f ms  (%.2f - %.2f)", 1000.0 / average, average, best,
+                      worst);
+    } else {
+        std::snprintf(line, sizeof(line), "FPS -");
+    }
+    addLine(line, TEXT_COLOR);
+
+    std::vector<uint32_t> order;
+    addLine("CPU ms", HEADING_COLOR);
+    treeOrder(cpuPasses, GpuProfiler::NO_PARENT, order);
+    for (uint32_t pass : order) {
+        const CpuPass& p = cpuPasses[pass];
+        std::snprintf(line, sizeof(line), " %*s%-*s %6.2f", int(p.depth), "", NAME_COLUMNS - int(p.depth), p.name,
+                      p.averageMs);
+        addLine(line, TEXT_COLOR);
+    }
+    addLine("GPU ms", HEADING_COLOR);
+    order.clear();
+    const std::vector<GpuScopeStats>& gpuScopes = gpuProfiler.scopes();
+    treeOrder(gpuScopes, GpuProfiler::NO_PARENT, order);
+    for (uint32_t scope : order) {
+        const GpuScopeStats& s = gpuScopes[scope];
+        std::snprintf(line, sizeof(line), " %*s%-*s %6.2f", int(s.depth), "", NAME_COLUMNS - int(s.depth),
+                      s.name.c_str(), s.averageMs);
+        addLine(line, TEXT_COLOR);
+    }
+
+    // Per frame, averaged since the last rebuild
+    double counted = std::max(counterFrames, 1u);
+    char triangles[32], uploads[32];
+    formatCount(counterTotals.triangles / counted, triangles, sizeof(triangles));
+    formatBytes(counterTotals.uploadBytes / counted, uploads, sizeof(uploads));
+    addLine("Per frame", HEADING_COLOR);
+    std::snprintf(line, sizeof(line), " Draws %.0f  Tris %s", counterTotals.drawCalls / counted, triangles);
+    addLine(line, TEXT_COLOR);
+    std::snprintf(line, sizeof(line), " State changes %.0f", counterTotals.stateChanges / counted);
+    addLine(line, TEXT_COLOR);
+    std::snprintf(line, sizeof(line), " Uploads %s", uploads);
+    addLine(line, TEXT_COLOR);
+    counterTotals = RenderStats();
+    counterFrames = 0;
+
+    if (!memorySources.empty()) {
+        addLine("Memory", HEADING_COLOR);
+    }
+    for (const MemorySource& source : memorySources) {
+        MemoryUsage usage = source.usage();
+        char used[32], capacity[32];
+        formatBytes(double(usage.used), used, sizeof(used));
+        formatBytes(double(usage.capacity), capacity, sizeof(capacity));
+        std::snprintf(line, sizeof(line), " %-*s %s / %s", NAME_COLUMNS, source.name.c_str(), used, capacity);
+        addLine(line, TEXT_COLOR);
+    }
+}
+
+void StatsOverlay::addLine(const char* line, const glm::vec4& color) {
+    float x = float(MARGIN), y = lineY(textLines);
+    uint32_t stride = instanceLayout.stride();
+    size_t length = 0;
+    for (const char* c = line; *c; ++c, ++length, x += CELL_WIDTH) {
+        int code = std::toupper(static_cast<unsigned char>(*c));
+        if (code == ' ') {
+            continue;
+        }
+        if (code < 32 || code >= 32 + int(FONT_GLYPHS)) {
+            code = '?';
+        }
+        text.resize(text.size() + stride);
+        writeQuad(&text[text.size() - stride], glm::vec4(x, y, GLYPH_WIDTH, GLYPH_HEIGHT),
+                  cellRect(uint32_t(code - 32), GLYPH_WIDTH, GLYPH_HEIGHT), color);
+    }
+    textWidth = std::max(textWidth, float(length * CELL_WIDTH));
+    textLines++;
+}
+
+void StatsOverlay::writeQuad(uint8_t* instance, const glm::vec4& rect, const glm::vec4& uvRect,
+                             const glm::vec4& color) const {
+    instanceLayout.write(instance, 0, rect * scale);
+    instanceLayout.write(instance, 1, uvRect);
+    instanceLayout.write(instance, 2, color);
+}
+
+void StatsOverlay::draw(StreamBuffer& stream, uint32_t width, uint32_t height) {
+    if (!shown || width == 0 || height == 0) {
+        return;
+    }
+    double now = traceClock();
+    if (lastRebuild < 0.0 || now - lastRebuild >= REBUILD_INTERVAL_US) {
+        rebuildText();
+        lastRebuild = now;
+    }
+
+    // Backdrop, then the graph and its target line, then the text
+    uint32_t stride = instanceLayout.stride();
+    size_t quads = 2 + GRAPH_FRAMES + text.size() / stride;
+    StreamAllocation instances = stream.allocate(quads * stride, stride);
+    if (!instances) {
+        return;
+    }
+    uint8_t* instance = static_cast<uint8_t*>(instances.data);
+    float panelWidth = std::max(textWidth, float(GRAPH_FRAMES * GRAPH_BAR_WIDTH)) + 2 * MARGIN;
+    float panelHeight = lineY(std::max(textLines, 1u)) + MARGIN;
+    writeQuad(instance, glm::vec4(0.0f, 0.0f, panelWidth, panelHeight), SOLID_RECT, BACKDROP_COLOR);
+    instance += stride;
+
+    float graphTop = float(MARGIN + LINE_HEIGHT);
+    for (uint32_t i = 0; i < GRAPH_FRAMES; ++i, instance += stride) {
+        double ms = frameTimes[(nextFrameTime + i) % GRAPH_FRAMES];
+        float barHeight = float(std::min(ms / GRAPH_MAX_MS, 1.0) * GRAPH_HEIGHT);
+        // A little slack for vsync jitter
+        const glm::vec4& color = ms <= TARGET_MS * 1.05 ? FAST_COLOR : ms < GRAPH_MAX_MS ? SLOW_COLOR : STALL_COLOR;
+        writeQuad(instance, glm::vec4(MARGIN + i * GRAPH_BAR_WIDTH, graphTop + GRAPH_HEIGHT - barHeight,
+                                      GRAPH_BAR_WIDTH, barHeight), SOLID_RECT, color);
+    }
+    float targetY = graphTop + float(GRAPH_HEIGHT * (1.0 - TARGET_MS / GRAPH_MAX_MS));
+    writeQuad(instance, glm::vec4(MARGIN, targetY, GRAPH_FRAMES * GRAPH_BAR_WIDTH, 1.0f), SOLID_RECT,
+              TARGET_COLOR);
+    instance += stride;
+    std::memcpy(instance, text.data(), text.size());
+    stream.flush();
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    shader.use();
+    shader.setVec2("viewportSize", glm::vec2(float(width), float(height)));
+    shader.setInt("font", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, font);
+    countStateChange();
+    vao.setVertexBuffer(stream.ID, 0, instances.offset);
+    vao.bind();
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(quads));
+    countDraw(quads * 2);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Buffers.h"
+#include "CpuProfiler.h"
+#include "RenderStats.h"
+#include "Shader.h"
+#include "VertexLayout.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class GpuProfiler;
+class StreamBuffer;
+
+// Bytes an allocator has handed out of what it has reserved.
+struct MemoryUsage {
+    uint64_t used = 0;
+    uint64_t capacity = 0;
+};
+
+// Runtime stats drawn over the frame: FPS and a graph of recent frame
+// times, CPU and GPU milliseconds per pass, the RenderStats counters and
+// memory per allocator.
+//
+// All of it is one instanced draw of screen-space quads (glyphs of a
+// built-in 5x7 font, the graph's bars and a backdrop) from a single
+// StreamBuffer allocation. The text is only rebuilt a few times a second,
+// which also keeps the numbers readable, with the counters averaged over
+// that interval; in between a frame copies it and writes the graph, so the
+// overlay's own cost stays far below 0.1 ms. Time it like any other pass to
+// see it in its own list.
+//
+// Each frame, on the GL thread:
+//   beginFrame()    before anything else, including the frame's first
+//                   PROFILE_SCOPE; collects the previous frame
+//   draw()          last, over the finished frame
+// CPU passes are the PROFILE_SCOPE zones of the thread calling beginFrame().
+class StatsOverlay {
+public:
+    // Text and graph are drawn `scale` screen pixels per font pixel.
+    explicit StatsOverlay(const GpuProfiler& gpuProfiler, uint32_t scale = 1);
+    ~StatsOverlay();
+
+    StatsOverlay(const StatsOverlay&) = delete;
+    StatsOverlay& operator=(const StatsOverlay&) = delete;
+
+    // Adds a row to the memory section; `usage` is called whenever the text
+    // is rebuilt.
+    void addMemorySource(std::string name, std::function<MemoryUsage()> usage);
+
+    // Hidden, beginFrame() still keeps the history but draw() does nothing.
+    void setVisible(bool visible) { shown = visible; }
+    bool visible() const { return shown; }
+
+    void beginFrame();
+    // Draws into the current framebuffer, `width` x `height` pixels.
+    // Leaves depth testing enabled and blending disabled.
+    void draw(StreamBuffer& stream, uint32_t width, uint32_t height);
+
+private:
+    // Same shape as GpuScopeStats, built from the CPU zones
+    struct CpuPass {
+        const char* name;
+        uint32_t parent;
+        uint32_t depth;
+        double lastMs = 0.0;
+        double averageMs = 0.0;
+        uint64_t samples = 0;
+    };
+
+    struct MemorySource {
+        std::string name;
+        std::function<MemoryUsage()> usage;
+    };
+
+    void collectCpuPasses();
+    uint32_t passFor(const char* name, uint32_t parent);
+    void rebuildText();
+    void addLine(const char* line, const glm::vec4& color);
+    // `rect` is x, y, width and height in font pixels from the top left
+    void writeQuad(uint8_t* instance, const glm::vec4& rect, const glm::vec4& uvRect, const glm::vec4& color) const;
+
+    const GpuProfiler& gpuProfiler;
+    float scale;
+    bool shown = false;
+
+    Shader shader;
+    VertexArray vao;
+    VertexLayout instanceLayout;
+    unsigned int font;
+
+    std::vector<float> frameTimes;          // Ring of recent frame times, in ms
+    uint32_t nextFrameTime = 0;
+    double lastFrameStart = -1.0;
+
+    uint64_t zoneCursor = 0;
+    std::vector<CpuZoneSample> zones;       // Scratch for collectCpuPasses()
+    std::vector<double> passTotals;         // Scratch, ms per pass this frame
+    std::vector<std::pair<double, uint32_t>> openPasses;   // Scratch, end and pass of the enclosing zones
+    std::vector<CpuPass> cpuPasses;
+
+    RenderStats counterTotals;              // Summed since the text was rebuilt
+    uint32_t counterFrames = 0;
+    std::vector<MemorySource> memorySources;
+
+    double lastRebuild = -1.0;
+    std::vector<uint8_t> text;              // Glyph instances, rebuilt by rebuildText()
+    uint32_t textLines = 0;
+    float textWidth = 0.0f;
+};
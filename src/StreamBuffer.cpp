@@ -0,0 +1,104 @@
+#include "StreamBuffer.h"
+#include "GlDebug.h"
+#include "GpuFeatures.h"
+#include "RenderStats.h"
+
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t FRAME_ALIGNMENT = 256;
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+} // namespace
+
+StreamBuffer::StreamBuffer(size_t frameCapacity, uint32_t frames)
+    : capacity((frameCapacity + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT),
+      frameCount(std::max(frames, 1u)),
+      fences(frameCount, nullptr) {
+    size_t size = capacity * frameCount;
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    labelGlObject(GL_BUFFER, ID, "Stream buffer");
+    if (gpuFeatures().bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        if (!mapped) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &ID);
+            throw std::runtime_error("Failed to map stream buffer persistently");
+        }
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        shadow.resize(size);
+        mapped = shadow.data();
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    // Deleting the buffer also unmaps it
+    glDeleteBuffers(1, &ID);
+}
+
+void StreamBuffer::beginFrame() {
+    if (frameStarted) {
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        current = (current + 1) % frameCount;
+    }
+    frameStarted = true;
+    head.store(0, std::memory_order_relaxed);
+    flushed = 0;
+
+    GLsync fence = fences[current];
+    if (!fence) {
+        return;
+    }
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        stallCount++;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fences[current] = nullptr;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment) {
+    alignment = std::max<size_t>(alignment, 1);
+    size_t base = current * capacity;
+    size_t used = head.load(std::memory_order_relaxed);
+    size_t start, end;
+    do {
+        start = (base + used + alignment - 1) / alignment * alignment - base;
+        end = start + size;
+        if (end > capacity) {
+            return {};
+        }
+    } while (!head.compare_exchange_weak(used, end, std::memory_order_relaxed));
+    return {mapped + base + start, base + start, size};
+}
+
+void StreamBuffer::flush() {
+    size_t used = frameSize();
+    if (used <= flushed) {
+        return;
+    }
+    countUpload(used - flushed);
+    // A coherent mapping needs no call: writes are visible to every command
+    // issued after them
+    if (!persistent()) {
+        size_t offset = current * capacity + flushed;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, used - flushed, mapped + offset);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    flushed = used;
+}
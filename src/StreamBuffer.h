@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A slice of a StreamBuffer handed out for the current frame. `offset` is
+// from the start of the buffer, ready for glBindBufferRange or an attribute
+// pointer; `data` is where the CPU writes it. Empty when the frame is full.
+struct StreamAllocation {
+    void* data = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// Per-frame dynamic data (instances, uniforms, vertices) written straight
+// into GPU-visible memory. The buffer is split into `frames` regions used
+// round-robin, so the CPU fills one while the GPU still reads the previous
+// ones; a fence per region makes beginFrame() wait in the rare case the GPU
+// is a whole ring behind.
+//
+// With GL 4.4 or ARB_buffer_storage the buffer is created with
+// glBufferStorage and mapped once, persistent and coherent: allocate() is a
+// lock-free bump of an offset and writes need no GL call at all, so jobs on
+// worker threads can fill their allocations directly. Without it the
+// regions live in CPU memory and flush() copies the used part with one
+// glBufferSubData per frame. The path comes from gpuFeatures(), so
+// detectGpuFeatures() must have run.
+//
+// Frame protocol, on the GL thread:
+//   beginFrame()            before the frame's first allocate()
+//   allocate() / writes     any thread, until flush()
+//   flush()                 after all writes, before draws read the data
+class StreamBuffer {
+public:
+    unsigned int ID;
+
+    // `frameCapacity` bytes per frame, rounded up to 256.
+    explicit StreamBuffer(size_t frameCapacity, uint32_t frames = 3);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Fences the previous frame's region and moves on to the next one,
+    // waiting for the GPU if it is still reading it.
+    void beginFrame();
+    // Thread-safe. `alignment` needn't be a power of two, so a vertex stride
+    // works too, e.g. to address the data by baseInstance or baseVertex.
+    StreamAllocation allocate(size_t size, size_t alignment = 16);
+    // Makes the frame's writes since the last flush() visible to the GPU,
+    // so several passes can each fill and flush their own allocations.
+    void flush();
+
+    bool persistent() const { return mapped != nullptr && shadow.empty(); }
+    size_t frameCapacity() const { return capacity; }
+    // Bytes allocated so far this frame.
+    size_t frameSize() const { return std::min(head.load(std::memory_order_relaxed), capacity); }
+    // How often beginFrame() had to wait for the GPU; if it keeps growing,
+    // add frames.
+    uint32_t stalls() const { return stallCount; }
+
+private:
+    size_t capacity;
+    uint32_t frameCount;
+    uint8_t* mapped = nullptr;          // Whole buffer: the persistent mapping or `shadow`
+    std::vector<uint8_t> shadow;        // Fallback copy of the buffer
+    std::vector<GLsync> fences;
+    uint32_t current = 0;
+    bool frameStarted = false;
+    std::atomic<size_t> head{0};        // Bytes used in the current region
+    size_t flushed = 0;                 // Bytes of it flush() has already made visible
+    uint32_t stallCount = 0;
+};
@@ -0,0 +1,187 @@
+#include "Texture.h"
+#include "GpuFeatures.h"
+#include "Mipmaps.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+
+namespace {
+
+unsigned int createTexture(GLenum target) {
+    unsigned int texture;
+    if (gpuFeatures().directStateAccess) {
+        glCreateTextures(target, 1, &texture);
+    } else {
+        glGenTextures(1, &texture);
+    }
+    return texture;
+}
+
+// By name with direct state access, otherwise through the current unit
+void textureParameter(unsigned int texture, GLenum target, GLenum name, GLint value) {
+    if (gpuFeatures().directStateAccess) {
+        glTextureParameteri(texture, name, value);
+    } else {
+        glBindTexture(target, texture);
+        glTexParameteri(target, name, value);
+    }
+}
+
+void bindTexture(unsigned int texture, GLenum target, unsigned int unit) {
+    countStateChange();
+    if (gpuFeatures().directStateAccess) {
+        glBindTextureUnit(unit, texture);
+    } else {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+    }
+}
+
+} // namespace
+
+// Texture2D redefines its levels once the real data arrives, so its storage
+// stays mutable. glTexImage2D has no by-name equivalent, which makes level
+// definitions bind even with direct state access; everything else doesn't.
+Texture2D::Texture2D() {
+    const uint8_t white[4] = {255, 255, 255, 255};
+    ID = createTexture(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, ID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+Texture2D::~Texture2D() {
+    glDeleteTextures(1, &ID);
+}
+
+void Texture2D::bind(unsigned int unit) const {
+    bindTexture(ID, GL_TEXTURE_2D, unit);
+}
+
+void Texture2D::setLevel(uint32_t level, uint32_t width, uint32_t height, const void* pixels) {
+    glBindTexture(GL_TEXTURE_2D, ID);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    countUpload(size_t(width) * height * 4);
+    if (level == 0) {
+        levelWidth = width;
+        levelHeight = height;
+    }
+}
+
+void Texture2D::finalize(uint32_t count) {
+    levelCount = count;
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    isReady = true;
+}
+
+void Texture2D::generateMipmaps() {
+    uint32_t count = mipLevelCount(levelWidth, levelHeight);
+    textureParameter(ID, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+    if (gpuFeatures().directStateAccess) {
+        glGenerateTextureMipmap(ID);
+    } else {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    finalize(count);
+}
+
+void Texture2D::upload(const DdsBlob& blob) {
+    GLenum format = blockFormatInfo(blob.format()).glFormat;
+    glBindTexture(GL_TEXTURE_2D, ID);
+    for (uint32_t level = 0; level < blob.levelCount(); ++level) {
+        DdsBlob::Level data = blob.level(level);
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, format, data.width, data.height, 0,
+                               GLsizei(data.size), data.data);
+        countUpload(data.size);
+    }
+    levelWidth = blob.width();
+    levelHeight = blob.height();
+    finalize(blob.levelCount());
+}
+
+Texture2DArray::Texture2DArray(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels)
+    : levelWidth(width), levelHeight(height), layerCount(layers), levelCount(levels) {
+    ID = createTexture(GL_TEXTURE_2D_ARRAY);
+    if (gpuFeatures().directStateAccess) {
+        glTextureStorage3D(ID, levels, GL_RGBA8, width, height, layers);
+    } else {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        for (uint32_t level = 0; level < levels; ++level) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(width >> level, 1u),
+                         std::max(height >> level, 1u), layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    setSampling();
+}
+
+Texture2DArray::Texture2DArray(const DdsBlob& blob)
+    : levelWidth(blob.width()), levelHeight(blob.height()), layerCount(blob.layerCount()),
+      levelCount(blob.levelCount()) {
+    GLenum format = blockFormatInfo(blob.format()).glFormat;
+    bool dsa = gpuFeatures().directStateAccess;
+    ID = createTexture(GL_TEXTURE_2D_ARRAY);
+    if (dsa) {
+        glTextureStorage3D(ID, levelCount, format, levelWidth, levelHeight, layerCount);
+    } else {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    }
+    // The file stores layers one after another, but GL wants a level of
+    // every layer at once: allocate each level, then fill it layer by layer
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        DdsBlob::Level first = blob.level(level);
+        if (!dsa) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, first.width, first.height, layerCount, 0,
+                                   GLsizei(first.size * layerCount), nullptr);
+        }
+        for (uint32_t layer = 0; layer < layerCount; ++layer) {
+            DdsBlob::Level data = blob.level(level, layer);
+            if (dsa) {
+                glCompressedTextureSubImage3D(ID, level, 0, 0, layer, data.width, data.height, 1, format,
+                                              GLsizei(data.size), data.data);
+            } else {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, data.width, data.height, 1,
+                                          format, GLsizei(data.size), data.data);
+            }
+        }
+    }
+    setSampling();
+}
+
+Texture2DArray::~Texture2DArray() {
+    glDeleteTextures(1, &ID);
+}
+
+void Texture2DArray::bind(unsigned int unit) const {
+    bindTexture(ID, GL_TEXTURE_2D_ARRAY, unit);
+}
+
+void Texture2DArray::setLayer(uint32_t layer, uint32_t level, const void* pixels) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    uint32_t width = std::max(levelWidth >> level, 1u);
+    uint32_t height = std::max(levelHeight >> level, 1u);
+    countUpload(size_t(width) * height * 4);
+    if (gpuFeatures().directStateAccess) {
+        glTextureSubImage3D(ID, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        pixels);
+    }
+}
+
+void Texture2DArray::setSampling() {
+    textureParameter(ID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    textureParameter(ID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                     levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    textureParameter(ID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Atlas regions wrap by themselves in the shader, if at all; repeating
+    // the whole page would only bleed the opposite edge in
+    textureParameter(ID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    textureParameter(ID, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "TextureFormat.h"
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// 2D texture, RGBA8 or block compressed. It starts out as a 1x1 white
+// placeholder so it can be bound and sampled before its real data has been
+// loaded.
+class Texture2D {
+public:
+    unsigned int ID;
+
+    Texture2D();
+    ~Texture2D();
+
+    Texture2D(const Texture2D&) = delete;
+    Texture2D& operator=(const Texture2D&) = delete;
+
+    void bind(unsigned int unit = 0) const;
+
+    // Defines one mip level. `pixels` is client memory, or an offset into
+    // the pixel unpack buffer if one is bound.
+    void setLevel(uint32_t level, uint32_t width, uint32_t height, const void* pixels);
+
+    // Call once levels [0, levelCount) are defined: limits sampling to them,
+    // picks the matching filters and marks the texture ready.
+    void finalize(uint32_t levelCount);
+
+    // Builds levels 1..n from level 0 on the GPU, then finalizes.
+    void generateMipmaps();
+
+    // Defines every level from a block-compressed file, straight from the
+    // blob's memory, then finalizes. Compressed formats can't use
+    // generateMipmaps, so the file has to carry its own mip chain.
+    void upload(const DdsBlob& blob);
+
+    uint32_t width() const { return levelWidth; }
+    uint32_t height() const { return levelHeight; }
+    uint32_t levels() const { return levelCount; }
+    bool ready() const { return isReady; }
+
+private:
+    uint32_t levelWidth = 1;
+    uint32_t levelHeight = 1;
+    uint32_t levelCount = 1;
+    bool isReady = false;
+};
+
+// 2D array texture, RGBA8 or block compressed, e.g. the pages of a
+// TextureAtlas. Shaders pick the layer with the third texture coordinate of
+// a sampler2DArray, so objects using different layers can be drawn together
+// without rebinding.
+class Texture2DArray {
+public:
+    unsigned int ID;
+
+    // Allocates RGBA8 storage for every layer and level; fill it with
+    // setLayer().
+    Texture2DArray(uint32_t width, uint32_t height, uint32_t layers, uint32_t levels);
+    // Defines every layer and level from a block-compressed file.
+    explicit Texture2DArray(const DdsBlob& blob);
+    ~Texture2DArray();
+
+    Texture2DArray(const Texture2DArray&) = delete;
+    Texture2DArray& operator=(const Texture2DArray&) = delete;
+
+    void bind(unsigned int unit = 0) const;
+
+    // Replaces one level of one layer with RGBA8 pixels.
+    void setLayer(uint32_t layer, uint32_t level, const void* pixels);
+
+    uint32_t width() const { return levelWidth; }
+    uint32_t height() const { return levelHeight; }
+    uint32_t layers() const { return layerCount; }
+    uint32_t levels() const { return levelCount; }
+
+private:
+    void setSampling();
+
+    uint32_t levelWidth;
+    uint32_t levelHeight;
+    uint32_t layerCount;
+    uint32_t levelCount;
+};
@@ -0,0 +1,115 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t padding) : size(pageSize), padding(padding), alignment(4) {
+    while (alignment < padding) {
+        alignment *= 2;
+    }
+}
+
+uint32_t TextureAtlas::usableLevels() const {
+    uint32_t levels = 1;
+    while ((2u << (levels - 1)) <= padding) {
+        ++levels;
+    }
+    return std::min(levels, mipLevelCount(size, size));
+}
+
+AtlasRegion TextureAtlas::add(const Image& image) {
+    // The reserved cell is the image plus its gutter, rounded up to the
+    // alignment; the gutter fills all of it
+    uint32_t cellWidth = (image.width + 2 * padding + alignment - 1) / alignment * alignment;
+    uint32_t cellHeight = (image.height + 2 * padding + alignment - 1) / alignment * alignment;
+    if (image.width == 0 || image.height == 0 || cellWidth > size || cellHeight > size) {
+        throw std::runtime_error("Image of " + std::to_string(image.width) + "x" + std::to_string(image.height) +
+                                 " does not fit an atlas page of " + std::to_string(size));
+    }
+
+    // Packers work in units of the alignment, so every cell stays aligned
+    PackedRect cell;
+    uint32_t layer = 0;
+    while (layer < packers.size() && !packers[layer].insert(cellWidth / alignment, cellHeight / alignment, cell)) {
+        ++layer;
+    }
+    if (layer == packers.size()) {
+        packers.emplace_back(size / alignment, size / alignment);
+        packers.back().insert(cellWidth / alignment, cellHeight / alignment, cell);
+        Image page;
+        page.width = size;
+        page.height = size;
+        page.pixels.assign(size_t(size) * size * 4, 0);
+        pages.push_back(std::move(page));
+    }
+
+    Image& page = pages[layer];
+    uint32_t cellX = cell.x * alignment, cellY = cell.y * alignment;
+    uint32_t imageX = cellX + padding, imageY = cellY + padding;
+    for (uint32_t y = 0; y < cellHeight; ++y) {
+        int64_t sourceY = std::min<int64_t>(std::max<int64_t>(int64_t(cellY + y) - imageY, 0), image.height - 1);
+        const uint8_t* source = &image.pixels[size_t(sourceY) * image.width * 4];
+        uint8_t* row = &page.pixels[(size_t(cellY + y) * size + cellX) * 4];
+        for (uint32_t x = 0; x < cellWidth; ++x) {
+            int64_t sourceX = std::min<int64_t>(std::max<int64_t>(int64_t(cellX + x) - imageX, 0), image.width - 1);
+            std::memcpy(row + x * 4, source + sourceX * 4, 4);
+        }
+    }
+
+    float scale = 1.0f / size;
+    return {glm::vec4(imageX * scale, imageY * scale, image.width * scale, image.height * scale), layer};
+}
+
+std::vector<std::vector<Image>> TextureAtlas::buildMipChains(MipFilter filter) const {
+    std::vector<std::vector<Image>> chains;
+    for (const Image& page : pages) {
+        std::vector<Image> chain(1, page);
+        while (chain.size() < usableLevels()) {
+            chain.push_back(downsample(chain.back(), filter));
+        }
+        chains.push_back(std::move(chain));
+    }
+    return chains;
+}
+
+std::vector<AtlasEntry> loadAtlasIndex(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::ios_base::failure("Failed to open atlas index: " + path);
+    }
+    std::vector<AtlasEntry> entries;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream stream(line);
+        AtlasEntry entry;
+        glm::vec4& rect = entry.region.uvRect;
+        if (!(stream >> entry.region.layer >> rect.x >> rect.y >> rect.z >> rect.w)) {
+            throw std::runtime_error("Malformed line in atlas index " + path + ": " + line);
+        }
+        std::getline(stream >> std::ws, entry.name);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+void saveAtlasIndex(const std::string& path, const std::vector<AtlasEntry>& entries) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::ios_base::failure("Failed to open output file: " + path);
+    }
+    file.precision(9);
+    for (const AtlasEntry& entry : entries) {
+        const glm::vec4& rect = entry.region.uvRect;
+        file << entry.region.layer << " " << rect.x << " " << rect.y << " " << rect.z << " " << rect.w << " "
+             << entry.name << "\n";
+    }
+    if (!file) {
+        throw std::ios_base::failure("Failed to write output file: " + path);
+    }
+}
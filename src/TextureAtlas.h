@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Image.h"
+#include "Mipmaps.h"
+#include "RectPacker.h"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where an image ended up in an atlas. Shaders remap a UV in [0, 1] with
+// `uv * uvRect.zw + uvRect.xy` and sample that layer of the array texture.
+struct AtlasRegion {
+    glm::vec4 uvRect;   // xy offset, zw scale
+    uint32_t layer;
+};
+
+// Packs images into square pages of RGBA8 pixels, one page per layer of a
+// GL_TEXTURE_2D_ARRAY, so objects with different textures can share one
+// bind and one instanced draw call.
+//
+// Every image gets `padding` pixels of its own edge pixels around it, and
+// starts on a multiple of the padding rounded up to a power of two (and at
+// least 4, so block compression never mixes two images in one block). That
+// keeps bilinear filtering and the first usableLevels() mips of each image
+// free of its neighbours with the box filter; the wider Kaiser filter can
+// pull in a little of the gutter's duplicated edge.
+class TextureAtlas {
+public:
+    explicit TextureAtlas(uint32_t pageSize, uint32_t padding = 4);
+
+    // Copies the image into the first page with room, opening a new page if
+    // none has any. Throws std::runtime_error if it can't fit an empty page.
+    AtlasRegion add(const Image& image);
+
+    uint32_t pageSize() const { return size; }
+    uint32_t pageCount() const { return uint32_t(pages.size()); }
+    const Image& page(uint32_t index) const { return pages[index]; }
+
+    // Mip levels that keep the images apart, including the base level.
+    uint32_t usableLevels() const;
+
+    // Builds usableLevels() levels for every page.
+    std::vector<std::vector<Image>> buildMipChains(MipFilter filter) const;
+
+private:
+    uint32_t size;
+    uint32_t padding;
+    uint32_t alignment;
+    std::vector<Image> pages;
+    std::vector<RectPacker> packers;
+};
+
+// One line per image in the .atlas files written next to atlases cooked by
+// tools/texture_cooker: "<layer> <u> <v> <u scale> <v scale> <name>".
+struct AtlasEntry {
+    std::string name;
+    AtlasRegion region;
+};
+
+// Throws std::ios_base::failure if the file can't be opened and
+// std::runtime_error on malformed lines.
+std::vector<AtlasEntry> loadAtlasIndex(const std::string& path);
+void saveAtlasIndex(const std::string& path, const std::vector<AtlasEntry>& entries);
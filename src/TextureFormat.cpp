@@ -0,0 +1,95 @@
+#include "TextureFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+BlockFormatInfo blockFormatInfo(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, 71, DDS_FOURCC_DXT1, "BC1"};
+        case BlockFormat::BC3: return {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, 77, DDS_FOURCC_DXT5, "BC3"};
+        case BlockFormat::BC5: return {GL_COMPRESSED_RG_RGTC2, 16, 83, DDS_FOURCC_ATI2, "BC5"};
+        case BlockFormat::BC7: return {GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, 16, 98, 0, "BC7"};
+    }
+    return {0, 0, 0, 0, ""};
+}
+
+size_t compressedLevelSize(BlockFormat format, uint32_t width, uint32_t height) {
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockFormatInfo(format).blockBytes;
+}
+
+bool blockFormatSupported(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC3: return GLAD_GL_EXT_texture_compression_s3tc != 0;
+        case BlockFormat::BC5: return GLAD_GL_VERSION_3_0 != 0;
+        case BlockFormat::BC7: return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+    }
+    return false;
+}
+
+DdsBlob::DdsBlob(const uint8_t* data, size_t size) {
+    uint32_t magic;
+    DdsHeader header;
+    if (size < sizeof(magic) + sizeof(header)) {
+        throw std::runtime_error("DDS header is truncated");
+    }
+    std::memcpy(&magic, data, sizeof(magic));
+    std::memcpy(&header, data + sizeof(magic), sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat)) {
+        throw std::runtime_error("Not a DDS file");
+    }
+    if (!(header.pixelFormat.flags & DDPF_FOURCC)) {
+        throw std::runtime_error("Uncompressed DDS files are not supported");
+    }
+
+    size_t offset = sizeof(magic) + sizeof(header);
+    uint32_t fourCC = header.pixelFormat.fourCC;
+    if (fourCC == DDS_FOURCC_DX10) {
+        DdsHeaderDx10 dx10;
+        if (size < offset + sizeof(dx10)) {
+            throw std::runtime_error("DDS header is truncated");
+        }
+        std::memcpy(&dx10, data + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+        if (dx10.resourceDimension != DDS_DIMENSION_TEXTURE2D) {
+            throw std::runtime_error("Only 2D DDS textures are supported");
+        }
+        numLayers = std::max(dx10.arraySize, 1u);
+        switch (dx10.dxgiFormat) {
+            case 71: blockFormat = BlockFormat::BC1; break;
+            case 77: blockFormat = BlockFormat::BC3; break;
+            case 83: blockFormat = BlockFormat::BC5; break;
+            case 98: blockFormat = BlockFormat::BC7; break;
+            default: throw std::runtime_error("Unsupported DDS DXGI format " + std::to_string(dx10.dxgiFormat));
+        }
+    } else if (fourCC == DDS_FOURCC_DXT1) {
+        blockFormat = BlockFormat::BC1;
+    } else if (fourCC == DDS_FOURCC_DXT5) {
+        blockFormat = BlockFormat::BC3;
+    } else if (fourCC == DDS_FOURCC_ATI2 || fourCC == DDS_FOURCC_BC5U) {
+        blockFormat = BlockFormat::BC5;
+    } else {
+        throw std::runtime_error("Unsupported DDS compression format");
+    }
+    if (header.width == 0 || header.height == 0 || (header.caps2 & DDSCAPS2_CUBEMAP) || (header.flags & DDSD_DEPTH)) {
+        throw std::runtime_error("Only 2D DDS textures are supported");
+    }
+
+    numLevels = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(header.mipMapCount, 1u) : 1;
+    if (numLevels > MAX_LEVELS) {
+        throw std::runtime_error("DDS file has too many mip levels");
+    }
+    uint32_t w = header.width, h = header.height;
+    for (uint32_t i = 0; i < numLevels; ++i) {
+        size_t levelSize = compressedLevelSize(blockFormat, w, h);
+        levels[i] = {w, h, data + offset + layerSize, levelSize};
+        layerSize += levelSize;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+    if (layerSize * numLayers > size - offset || layerSize * numLayers / numLayers != layerSize) {
+        throw std::runtime_error("DDS mip level is truncated");
+    }
+}
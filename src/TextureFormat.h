@@ -0,0 +1,138 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+// Block-compressed texture formats and the on-disk layout of the .dds files
+// written by tools/texture_cooker. Every format encodes 4x4 pixel blocks:
+//   BC1  RGB with 1-bit alpha, 8 bytes per block (S3TC DXT1)
+//   BC3  RGBA, BC1 color plus interpolated alpha, 16 bytes (S3TC DXT5)
+//   BC5  two channels, e.g. normal map XY, 16 bytes (RGTC2, core in GL 3.0)
+//   BC7  RGBA at much higher quality than BC3, 16 bytes (BPTC)
+//
+// The cooker stores rows bottom to top like Image, so levels upload without
+// flipping; other DDS viewers will show the textures upside down.
+enum class BlockFormat {
+    BC1,
+    BC3,
+    BC5,
+    BC7,
+};
+
+struct BlockFormatInfo {
+    GLenum glFormat;
+    uint32_t blockBytes;
+    uint32_t dxgiFormat;    // DXGI_FORMAT_*_UNORM
+    uint32_t fourCC;        // Legacy DDS code, 0 if only DX10 headers can express it
+    const char* name;
+};
+
+BlockFormatInfo blockFormatInfo(BlockFormat format);
+
+// Bytes in one level of the given size; partial blocks count as whole.
+size_t compressedLevelSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// Whether the current context can sample the format. Needs a loaded context.
+bool blockFormatSupported(BlockFormat format);
+
+constexpr uint32_t DDS_MAGIC = 0x20534444;              // "DDS "
+constexpr uint32_t DDS_FOURCC_DXT1 = 0x31545844;
+constexpr uint32_t DDS_FOURCC_DXT5 = 0x35545844;
+constexpr uint32_t DDS_FOURCC_ATI2 = 0x32495441;
+constexpr uint32_t DDS_FOURCC_BC5U = 0x55354342;
+constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844;
+
+// DDS_HEADER flags and caps
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDSD_DEPTH = 0x800000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+struct DdsPixelFormat {
+    uint32_t size;          // 32
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader {
+    uint32_t size;          // 124
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsPixelFormat) == 32, "DdsPixelFormat must match the DDS layout");
+static_assert(sizeof(DdsHeader) == 124, "DdsHeader must match the DDS layout");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DdsHeaderDx10 must match the DDS layout");
+
+// Validated, read-only view of a block-compressed .dds file. Nothing is
+// copied; level data points into the memory passed to the constructor.
+class DdsBlob {
+public:
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // Throws std::runtime_error for anything but a 2D BC1/3/5/7 texture or
+    // texture array.
+    DdsBlob(const uint8_t* data, size_t size);
+
+    BlockFormat format() const { return blockFormat; }
+    uint32_t width() const { return levels[0].width; }
+    uint32_t height() const { return levels[0].height; }
+    uint32_t levelCount() const { return numLevels; }
+    // Array layers, 1 for a plain 2D texture. Each layer stores its whole
+    // mip chain before the next one starts.
+    uint32_t layerCount() const { return numLayers; }
+
+    Level level(uint32_t index, uint32_t layer = 0) const {
+        Level result = levels[index];
+        result.data += layer * layerSize;
+        return result;
+    }
+
+private:
+    BlockFormat blockFormat;
+    uint32_t numLevels;
+    uint32_t numLayers = 1;
+    size_t layerSize = 0;
+    Level levels[MAX_LEVELS];
+};
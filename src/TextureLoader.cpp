@@ -0,0 +1,215 @@
+#include "TextureLoader.h"
+#include "GlDebug.h"
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+size_t chainSize(const std::vector<Image>& levels) {
+    size_t size = 0;
+    for (const Image& level : levels) {
+        size += size_t(level.width) * level.height * 4;
+    }
+    return size;
+}
+
+} // namespace
+
+TextureLoader::TextureLoader(JobSystem& jobs, size_t uploadBudget) : jobs(jobs), uploadBudget(uploadBudget) {}
+
+TextureLoader::~TextureLoader() {
+    {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobsDone.wait(lock, [this] { return jobsInFlight == 0; });
+    }
+    for (Request& request : requests) {
+        if (request.mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[request.pixelBuffer].ID);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (request.fence) {
+            glDeleteSync(request.fence);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    for (PixelBuffer& buffer : pixelBuffers) {
+        glDeleteBuffers(1, &buffer.ID);
+    }
+}
+
+std::shared_ptr<Texture2D> TextureLoader::load(const std::string& path, MipmapMode mode) {
+    auto texture = std::make_shared<Texture2D>();
+    labelGlObject(GL_TEXTURE, texture->ID, path.c_str());
+    requests.emplace_back();
+    Request& request = requests.back();
+    request.texture = texture;
+    request.path = path;
+    request.mode = mode;
+
+    runJob(&request, [](Request& r) {
+        try {
+            FileData file = openFile(r.path);
+            if (file.size() >= 4 && std::memcmp(file.data(), "DDS ", 4) == 0) {
+                auto blob = std::make_unique<DdsBlob>(file.data(), file.size());
+                if (blob->layerCount() > 1) {
+                    throw std::runtime_error("Texture arrays need a Texture2DArray");
+                }
+                r.compressed = std::move(blob);
+                // Fault the pages in here rather than inside the GL call
+                volatile uint8_t sink = 0;
+                for (size_t i = 0; i < file.size(); i += 4096) {
+                    sink ^= file.data()[i];
+                }
+                r.file = std::move(file);
+                r.stage.store(Decoded, std::memory_order_release);
+                return;
+            }
+            Image image = decodeImage(file.data(), file.size());
+            if (r.mode == MipmapMode::Box || r.mode == MipmapMode::Kaiser) {
+                r.levels = buildMipChain(std::move(image), r.mode == MipmapMode::Box ? MipFilter::Box : MipFilter::Kaiser);
+            } else {
+                r.levels.push_back(std::move(image));
+            }
+        } catch (const std::exception& e) {
+            r.error = r.path + ": " + e.what();
+        }
+        r.stage.store(Decoded, std::memory_order_release);
+    });
+    return texture;
+}
+
+void TextureLoader::update() {
+    size_t budget = uploadBudget;
+    bool startedUpload = false;
+
+    for (auto it = requests.begin(); it != requests.end();) {
+        Request& request = *it;
+        int stage = request.stage.load(std::memory_order_acquire);
+
+        if (stage == Decoded) {
+            if (!request.error.empty()) {
+                std::cerr << "Failed to load texture: " << request.error << std::endl;
+                it = requests.erase(it);
+                continue;
+            }
+            if (request.texture.expired()) {
+                it = requests.erase(it);
+                continue;
+            }
+            size_t size = request.compressed ? request.file.size() : chainSize(request.levels);
+            if (startedUpload && size > budget) {
+                ++it;
+                continue;
+            }
+            budget -= std::min(budget, size);
+            startedUpload = true;
+
+            if (request.compressed) {
+                if (blockFormatSupported(request.compressed->format())) {
+                    request.texture.lock()->upload(*request.compressed);
+                } else {
+                    std::cerr << "Failed to load texture: " << request.path << ": "
+                              << blockFormatInfo(request.compressed->format()).name
+                              << " is not supported by this GL context" << std::endl;
+                }
+                it = requests.erase(it);
+                continue;
+            }
+
+            request.pixelBuffer = acquirePixelBuffer(size);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[request.pixelBuffer].ID);
+            // The pool only hands out buffers whose previous upload has
+            // completed, so there is nothing to synchronize with
+            request.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                                              GL_MAP_UNSYNCHRONIZED_BIT);
+            if (!request.mapped) {
+                std::cerr << "Failed to map pixel buffer for " << request.path << std::endl;
+                pixelBuffers[request.pixelBuffer].busy = false;
+                it = requests.erase(it);
+                continue;
+            }
+            request.stage.store(Copying, std::memory_order_relaxed);
+            runJob(&request, [](Request& r) {
+                uint8_t* dst = static_cast<uint8_t*>(r.mapped);
+                for (Image& level : r.levels) {
+                    std::memcpy(dst, level.pixels.data(), level.pixels.size());
+                    dst += level.pixels.size();
+                    std::vector<uint8_t>().swap(level.pixels);
+                }
+                r.stage.store(Copied, std::memory_order_release);
+            });
+        } else if (stage == Copied) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[request.pixelBuffer].ID);
+            bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+            request.mapped = nullptr;
+            std::shared_ptr<Texture2D> texture = request.texture.lock();
+            if (!intact) {
+                std::cerr << "Pixel buffer for " << request.path << " was lost while mapped" << std::endl;
+            } else if (texture) {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                size_t offset = 0;
+                for (uint32_t level = 0; level < request.levels.size(); ++level) {
+                    const Image& image = request.levels[level];
+                    texture->setLevel(level, image.width, image.height, reinterpret_cast<const void*>(offset));
+                    offset += size_t(image.width) * image.height * 4;
+                }
+                if (request.mode == MipmapMode::Gpu) {
+                    texture->generateMipmaps();
+                } else {
+                    texture->finalize(uint32_t(request.levels.size()));
+                }
+            }
+            request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            request.stage.store(Uploaded, std::memory_order_relaxed);
+        } else if (stage == Uploaded) {
+            GLenum status = glClientWaitSync(request.fence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                glDeleteSync(request.fence);
+                pixelBuffers[request.pixelBuffer].busy = false;
+                it = requests.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureLoader::runJob(Request* request, void (*work)(Request&)) {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        jobsInFlight++;
+    }
+    jobs.submit([this, request, work] {
+        work(*request);
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if (--jobsInFlight == 0) {
+            jobsDone.notify_all();
+        }
+    });
+}
+
+size_t TextureLoader::acquirePixelBuffer(size_t size) {
+    size_t best = pixelBuffers.size();
+    for (size_t i = 0; i < pixelBuffers.size(); ++i) {
+        if (!pixelBuffers[i].busy && pixelBuffers[i].capacity >= size &&
+            (best == pixelBuffers.size() || pixelBuffers[i].capacity < pixelBuffers[best].capacity)) {
+            best = i;
+        }
+    }
+    if (best == pixelBuffers.size()) {
+        PixelBuffer buffer = {0, size, false};
+        glGenBuffers(1, &buffer.ID);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.ID);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        pixelBuffers.push_back(buffer);
+    }
+    pixelBuffers[best].busy = true;
+    return best;
+}
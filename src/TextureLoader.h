@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Image.h"
+#include "JobSystem.h"
+#include "FileSystem.h"
+#include "Texture.h"
+#include "TextureFormat.h"
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Where a loaded texture's mip chain comes from.
+enum class MipmapMode {
+    None,       // Base level only
+    Box,        // CPU, on the worker thread (see Mipmaps.h)
+    Kaiser,     // CPU, on the worker thread
+    Gpu,        // glGenerateMipmap after the base level is uploaded
+};
+
+// Loads PNG/JPEG/TGA files into Texture2Ds without stalling the main thread.
+//
+// A request moves through these stages:
+//   1. worker:  read, decode and build CPU mips
+//   2. main:    map a pixel unpack buffer (PBO) from the pool
+//   3. worker:  copy the mip chain into the mapped PBO
+//   4. main:    unmap and define the levels from the PBO, so the transfer
+//               runs asynchronously on the driver side; fence it
+//   5. main:    recycle the PBO once the fence has signaled
+// The main thread only issues GL calls and never touches pixel data.
+//
+// Block-compressed .dds files (see TextureFormat.h) skip decoding and the
+// PBO: the worker maps and validates the file and faults its pages in, and
+// the main thread passes the mapped levels to glCompressedTexImage2D.
+class TextureLoader {
+public:
+    // At most uploadBudget bytes start uploading per update(), though one
+    // texture always may, however large.
+    explicit TextureLoader(JobSystem& jobs, size_t uploadBudget = 32 << 20);
+    // Waits for this loader's jobs and releases its PBOs.
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // Returns immediately with a placeholder texture that is filled in by a
+    // later update(). Load errors are reported to std::cerr. The mipmap
+    // mode is ignored for .dds files, which bring their own levels.
+    std::shared_ptr<Texture2D> load(const std::string& path, MipmapMode mode = MipmapMode::Box);
+
+    // Advances pending requests. Call once per frame on the GL thread.
+    void update();
+
+    // Requests that have not yet released their PBO.
+    size_t pending() const { return requests.size(); }
+
+private:
+    enum Stage : int {
+        Decoding,
+        Decoded,
+        Copying,
+        Copied,
+        Uploaded,
+    };
+
+    struct Request {
+        std::weak_ptr<Texture2D> texture;
+        std::string path;
+        MipmapMode mode = MipmapMode::None;
+        std::vector<Image> levels;      // Pixels are freed once copied to the PBO
+        FileData file;
+        std::unique_ptr<DdsBlob> compressed;
+        std::string error;
+        std::atomic<int> stage{Decoding};
+        size_t pixelBuffer = 0;
+        void* mapped = nullptr;
+        GLsync fence = nullptr;
+    };
+
+    struct PixelBuffer {
+        unsigned int ID;
+        size_t capacity;
+        bool busy;
+    };
+
+    void runJob(Request* request, void (*work)(Request&));
+    size_t acquirePixelBuffer(size_t size);
+
+    JobSystem& jobs;
+    size_t uploadBudget;
+    std::list<Request> requests;
+    std::vector<PixelBuffer> pixelBuffers;
+
+    std::mutex jobMutex;
+    std::condition_variable jobsDone;
+    size_t jobsInFlight = 0;
+};
@@ -0,0 +1,61 @@
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+void writeString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+double traceClock() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void writeChromeTrace(std::ostream& out, const std::vector<TraceEvent>& events) {
+    std::vector<const std::string*> tracks;
+    auto trackId = [&tracks](const std::string& track) {
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            if (*tracks[i] == track) {
+                return i;
+            }
+        }
+        tracks.push_back(&track);
+        return tracks.size() - 1;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const TraceEvent& event : events) {
+        out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << trackId(event.track) << ",\"name\":";
+        writeString(out, event.name);
+        char times[64];
+        std::snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f}", event.start, event.duration);
+        out << times;
+        first = false;
+    }
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        out << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+            << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        writeString(out, *tracks[i]);
+        out << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
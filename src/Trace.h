@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One timed span for a Chrome trace (chrome://tracing, Perfetto). Profilers
+// append theirs to a shared vector so CPU and GPU work line up in one file.
+struct TraceEvent {
+    std::string name;
+    std::string track;      // A row in the viewer, e.g. "GPU" or a thread name
+    double start;           // Microseconds on traceClock()
+    double duration;        // Microseconds
+};
+
+// Microseconds since the first call, from a steady clock. Every profiler
+// converts its timestamps to this timeline.
+double traceClock();
+
+// Writes `events` as Chrome trace JSON, one viewer row per distinct track
+// in order of first appearance.
+void writeChromeTrace(std::ostream& out, const std::vector<TraceEvent>& events);
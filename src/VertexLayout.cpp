@@ -0,0 +1,160 @@
+#include "VertexLayout.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const VertexFormat ALL_FORMATS[] = {
+    VertexFormat::Float2, VertexFormat::Float3, VertexFormat::Float4, VertexFormat::Half2,
+    VertexFormat::Half4, VertexFormat::Unorm8x4, VertexFormat::Unorm16x4, VertexFormat::OctahedralSnorm10,
+};
+
+uint32_t quantizeSnorm(float value, int bits) {
+    float maxValue = float((1 << (bits - 1)) - 1);
+    int quantized = int(std::lround(glm::clamp(value, -1.0f, 1.0f) * maxValue));
+    return uint32_t(quantized) & ((1u << bits) - 1);
+}
+
+} // namespace
+
+VertexFormatInfo vertexFormatInfo(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Float2: return {GL_FLOAT, 2, GL_FALSE, 8};
+    case VertexFormat::Float3: return {GL_FLOAT, 3, GL_FALSE, 12};
+    case VertexFormat::Float4: return {GL_FLOAT, 4, GL_FALSE, 16};
+    case VertexFormat::Half2: return {GL_HALF_FLOAT, 2, GL_FALSE, 4};
+    case VertexFormat::Half4: return {GL_HALF_FLOAT, 4, GL_FALSE, 8};
+    case VertexFormat::Unorm8x4: return {GL_UNSIGNED_BYTE, 4, GL_TRUE, 4};
+    case VertexFormat::Unorm16x4: return {GL_UNSIGNED_SHORT, 4, GL_TRUE, 8};
+    case VertexFormat::OctahedralSnorm10: return {GL_INT_2_10_10_10_REV, 4, GL_TRUE, 4};
+    }
+    throw std::invalid_argument("Unknown vertex format");
+}
+
+bool vertexFormatFromGL(GLenum type, uint32_t components, bool normalized, VertexFormat& format) {
+    for (VertexFormat candidate : ALL_FORMATS) {
+        VertexFormatInfo info = vertexFormatInfo(candidate);
+        if (info.type == type && uint32_t(info.components) == components && (info.normalized == GL_TRUE) == normalized) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+VertexLayout& VertexLayout::add(uint32_t location, VertexFormat format) {
+    uint32_t end = 0;
+    for (const VertexAttribute& attribute : vertexAttributes) {
+        end = std::max(end, attribute.offset + vertexFormatInfo(attribute.format).size);
+    }
+    return add(location, format, (end + 3) & ~3u);
+}
+
+VertexLayout& VertexLayout::add(uint32_t location, VertexFormat format, uint32_t offset) {
+    vertexAttributes.push_back({location, format, offset});
+    vertexStride = std::max(vertexStride, (offset + vertexFormatInfo(format).size + 3) & ~3u);
+    return *this;
+}
+
+const VertexAttribute* VertexLayout::find(uint32_t location) const {
+    for (const VertexAttribute& attribute : vertexAttributes) {
+        if (attribute.location == location) {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    if (vertexStride != other.vertexStride || vertexAttributes.size() != other.vertexAttributes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < vertexAttributes.size(); ++i) {
+        const VertexAttribute& a = vertexAttributes[i];
+        const VertexAttribute& b = other.vertexAttributes[i];
+        if (a.location != b.location || a.format != b.format || a.offset != b.offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VertexLayout::write(void* vertex, uint32_t location, const glm::vec4& value) const {
+    const VertexAttribute* attribute = find(location);
+    if (!attribute) {
+        throw std::invalid_argument("Vertex layout has no attribute at location " + std::to_string(location));
+    }
+    uint8_t* out = static_cast<uint8_t*>(vertex) + attribute->offset;
+
+    switch (attribute->format) {
+    case VertexFormat::Float2:
+    case VertexFormat::Float3:
+    case VertexFormat::Float4:
+        std::memcpy(out, &value[0], vertexFormatInfo(attribute->format).size);
+        break;
+    case VertexFormat::Half2:
+    case VertexFormat::Half4: {
+        uint16_t halves[4];
+        for (int i = 0; i < 4; ++i) {
+            halves[i] = glm::packHalf1x16(value[i]);
+        }
+        std::memcpy(out, halves, vertexFormatInfo(attribute->format).size);
+        break;
+    }
+    case VertexFormat::Unorm8x4: {
+        uint8_t bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = uint8_t(std::lround(glm::clamp(value[i], 0.0f, 1.0f) * 255.0f));
+        }
+        std::memcpy(out, bytes, sizeof(bytes));
+        break;
+    }
+    case VertexFormat::Unorm16x4: {
+        uint16_t shorts[4];
+        for (int i = 0; i < 4; ++i) {
+            shorts[i] = uint16_t(std::lround(glm::clamp(value[i], 0.0f, 1.0f) * 65535.0f));
+        }
+        std::memcpy(out, shorts, sizeof(shorts));
+        break;
+    }
+    case VertexFormat::OctahedralSnorm10: {
+        uint32_t packed = packOctahedralSnorm10(glm::vec3(value), value.w);
+        std::memcpy(out, &packed, sizeof(packed));
+        break;
+    }
+    }
+}
+
+PositionQuantization::PositionQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    : offset(boundsMin) {
+    // Flat axes still need a non-zero scale to stay invertible.
+    scale = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+}
+
+glm::mat4 PositionQuantization::dequantizeMatrix() const {
+    return glm::scale(glm::translate(glm::mat4(1.0f), offset), scale);
+}
+
+glm::vec2 octahedralEncode(const glm::vec3& unitVector) {
+    float l1 = std::abs(unitVector.x) + std::abs(unitVector.y) + std::abs(unitVector.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec3 n = unitVector / l1;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f) {
+        glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        e = (glm::vec2(1.0f) - glm::abs(glm::vec2(n.y, n.x))) * signs;
+    }
+    return e;
+}
+
+uint32_t packOctahedralSnorm10(const glm::vec3& unitVector, float sign) {
+    glm::vec2 e = octahedralEncode(unitVector);
+    return quantizeSnorm(e.x, 10) | (quantizeSnorm(e.y, 10) << 10) | (quantizeSnorm(sign < 0.0f ? -1.0f : 1.0f, 2) << 30);
+}
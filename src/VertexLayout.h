@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Storage formats for vertex attributes. The compact ones trade precision
+// for bandwidth:
+//   Unorm16x4          positions normalized to the mesh bounds (see
+//                      PositionQuantization), 8 bytes instead of 12
+//   Half2 / Half4      UVs and other small-range data as half floats
+//   OctahedralSnorm10  unit vectors octahedrally encoded into the x/y fields
+//                      of GL_INT_2_10_10_10_REV, with a sign in w (tangent
+//                      handedness). Decode in GLSL with:
+//
+//     vec3 octDecode(vec2 e) {
+//         vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+//         float t = max(-n.z, 0.0);
+//         n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+//         return normalize(n);
+//     }
+enum class VertexFormat {
+    Float2,
+    Float3,
+    Float4,
+    Half2,
+    Half4,
+    Unorm8x4,
+    Unorm16x4,
+    OctahedralSnorm10,
+};
+
+struct VertexFormatInfo {
+    GLenum type;
+    GLint components;
+    GLboolean normalized;
+    uint32_t size;
+};
+
+VertexFormatInfo vertexFormatInfo(VertexFormat format);
+
+// Maps a GL (type, components, normalized) triple back to a VertexFormat.
+// Returns false when the combination is not one of the formats above.
+bool vertexFormatFromGL(GLenum type, uint32_t components, bool normalized, VertexFormat& format);
+
+struct VertexAttribute {
+    uint32_t location;
+    VertexFormat format;
+    uint32_t offset;
+};
+
+// Describes one interleaved vertex stream. VertexArray::setFormat turns it
+// into attribute pointers, and write() encodes float data into it, so the
+// CPU packing and the GL setup cannot drift apart.
+class VertexLayout {
+public:
+    VertexLayout() = default;
+
+    // Appends an attribute after the previous one, keeping 4-byte alignment.
+    VertexLayout& add(uint32_t location, VertexFormat format);
+
+    // Places an attribute at an explicit offset; the stride grows to fit.
+    VertexLayout& add(uint32_t location, VertexFormat format, uint32_t offset);
+
+    void setStride(uint32_t bytes) { vertexStride = bytes; }
+    uint32_t stride() const { return vertexStride; }
+    const std::vector<VertexAttribute>& attributes() const { return vertexAttributes; }
+    const VertexAttribute* find(uint32_t location) const;
+
+    // Same stride and the same attributes in the same order
+    bool operator==(const VertexLayout& other) const;
+    bool operator!=(const VertexLayout& other) const { return !(*this == other); }
+
+    // Encodes `value` into the attribute at `location` of the vertex at
+    // `vertex`. Unused components are ignored; for OctahedralSnorm10, xyz is
+    // the unit vector and w its sign.
+    void write(void* vertex, uint32_t location, const glm::vec4& value) const;
+
+private:
+    std::vector<VertexAttribute> vertexAttributes;
+    uint32_t vertexStride = 0;
+};
+
+// Maps positions inside an AABB to [0, 1]^3 for Unorm16x4 storage. The
+// inverse is folded into the model matrix, so shaders need no changes.
+struct PositionQuantization {
+    glm::vec3 offset;
+    glm::vec3 scale;
+
+    PositionQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    glm::vec3 normalize(const glm::vec3& position) const { return (position - offset) / scale; }
+    glm::mat4 dequantizeMatrix() const;
+};
+
+glm::vec2 octahedralEncode(const glm::vec3& unitVector);
+uint32_t packOctahedralSnorm10(const glm::vec3& unitVector, float sign);
@@ -0,0 +1,336 @@
+#include "VirtualTexture.h"
+#include "GlDebug.h"
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Feedback texels: page x, page y, level and 1 where the texture was seen
+constexpr size_t FEEDBACK_TEXEL_SHORTS = 4;
+
+VirtualTextureBlob openBlob(const FileData& file, const std::string& path) {
+    try {
+        return VirtualTextureBlob(file.data(), file.size());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+} // namespace
+
+VirtualTexture::VirtualTexture(const std::string& path, JobSystem& jobs, uint32_t viewportWidth,
+                               uint32_t viewportHeight, const VirtualTextureSettings& settings)
+    : file(openFile(path)), blob(openBlob(file, path)), jobs(jobs), settings(settings) {
+    if (!blockFormatSupported(blob.format())) {
+        throw std::runtime_error(path + ": " + blockFormatInfo(blob.format()).name +
+                                 " is not supported by this GL context");
+    }
+    // Slot coordinates go into 8-bit page table channels
+    this->settings.cacheTiles = std::min(std::max(settings.cacheTiles, 1u), 256u);
+    this->settings.feedbackDivisor = std::max(settings.feedbackDivisor, 1u);
+    const VirtualTextureLayout& pages = blob.layout();
+    uint32_t cacheSize = this->settings.cacheTiles * pages.tileSize();
+
+    glGenTextures(1, &cache);
+    glBindTexture(GL_TEXTURE_2D, cache);
+    labelGlObject(GL_TEXTURE, cache, "Virtual texture cache");
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, blockFormatInfo(blob.format()).glFormat, cacheSize, cacheSize, 0,
+                           GLsizei(compressedLevelSize(blob.format(), cacheSize, cacheSize)), nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Levels of the page table are stacked in one texture rather than
+    // stored as mips, since the page grid of a level isn't always half of
+    // the one below it
+    uint32_t rows = 0;
+    for (uint32_t level = 0; level < pages.levelCount(); ++level) {
+        levelRows.push_back(rows);
+        rows += pages.pagesY(level);
+    }
+    pageTableData.assign(size_t(pages.pagesX(0)) * rows * 4, 0);
+    glGenTextures(1, &pageTable);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    labelGlObject(GL_TEXTURE, pageTable, "Virtual texture page table");
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pages.pagesX(0), rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    feedback = std::make_unique<Framebuffer>(std::max(viewportWidth / this->settings.feedbackDivisor, 1u),
+                                             std::max(viewportHeight / this->settings.feedbackDivisor, 1u),
+                                             GL_RGBA16UI);
+    for (Readback& readback : readbacks) {
+        glGenBuffers(1, &readback.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size_t(feedback->width()) * feedback->height() * FEEDBACK_TEXEL_SHORTS * 2,
+                     nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pageStates.assign(pages.pageCount(), Absent);
+    pageSlots.assign(pages.pageCount(), -1);
+    pageRequested.assign(pages.pageCount(), 0);
+    slots.resize(size_t(this->settings.cacheTiles) * this->settings.cacheTiles);
+    // The coarsest level is the fallback for everything else
+    startLoad(pages.pageCount() - 1);
+}
+
+VirtualTexture::~VirtualTexture() {
+    {
+        std::unique_lock<std::mutex> lock(loadMutex);
+        loadsDone.wait(lock, [this] { return jobsInFlight == 0; });
+    }
+    for (Readback& readback : readbacks) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    glDeleteTextures(1, &pageTable);
+    glDeleteTextures(1, &cache);
+}
+
+void VirtualTexture::beginFeedback(unsigned int program) {
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+    feedback->bind();
+    const GLuint nothing[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, nothing);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    const VirtualTextureLayout& pages = blob.layout();
+    glUniform4i(glGetUniformLocation(program, "vtInfo"), pages.width(), pages.height(), pages.pageSize(),
+                pages.levelCount());
+    // Derivatives are divisor times larger at the lower resolution
+    glUniform1f(glGetUniformLocation(program, "vtLodBias"), -std::log2(float(settings.feedbackDivisor)));
+}
+
+void VirtualTexture::endFeedback() {
+    // Skip the readback if both buffers are still in flight; feedback is
+    // only a hint and the next frame will ask again
+    Readback& readback = readbacks[nextReadback];
+    if (!readback.fence) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glReadPixels(0, 0, feedback->width(), feedback->height(), GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextReadback = (nextReadback + 1) % 2;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(savedFramebuffer));
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+void VirtualTexture::update() {
+    ++frame;
+
+    // Oldest readback first; never wait for the GPU
+    for (uint32_t i = 0; i < 2; ++i) {
+        Readback& readback = readbacks[(nextReadback + i) % 2];
+        if (!readback.fence) {
+            continue;
+        }
+        GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        size_t count = size_t(feedback->width()) * feedback->height();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        const void* texels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * FEEDBACK_TEXEL_SHORTS * 2,
+                                              GL_MAP_READ_BIT);
+        if (texels) {
+            processFeedback(static_cast<const uint16_t*>(texels), count);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Coarse pages first: they cover more of the screen and are the
+    // fallback for the finer ones. Later pages in the file are coarser.
+    std::sort(wanted.begin(), wanted.end(), [](uint32_t a, uint32_t b) { return a > b; });
+    for (uint32_t page : wanted) {
+        if (loadsInFlight >= settings.maxLoadsInFlight) {
+            break;
+        }
+        startLoad(page);
+    }
+    wanted.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        for (Load& load : finished) {
+            loaded.push_back(std::move(load));
+        }
+        finished.clear();
+    }
+    std::sort(loaded.begin(), loaded.end(), [](const Load& a, const Load& b) { return a.page > b.page; });
+    size_t uploads = std::min<size_t>(loaded.size(), settings.maxUploadsPerFrame);
+    for (size_t i = 0; i < uploads; ++i) {
+        upload(loaded[i]);
+    }
+    loaded.erase(loaded.begin(), loaded.begin() + uploads);
+
+    if (pageTableDirty) {
+        rebuildPageTable();
+    }
+}
+
+void VirtualTexture::bind(unsigned int program, unsigned int cacheUnit, unsigned int pageTableUnit) const {
+    glActiveTexture(GL_TEXTURE0 + cacheUnit);
+    glBindTexture(GL_TEXTURE_2D, cache);
+    glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    countStateChange(2);
+
+    const VirtualTextureLayout& pages = blob.layout();
+    glUniform1i(glGetUniformLocation(program, "vtCache"), cacheUnit);
+    glUniform1i(glGetUniformLocation(program, "vtPageTable"), pageTableUnit);
+    glUniform4i(glGetUniformLocation(program, "vtInfo"), pages.width(), pages.height(), pages.pageSize(),
+                pages.levelCount());
+    glUniform4i(glGetUniformLocation(program, "vtCacheInfo"), pages.tileSize(), pages.border(),
+                settings.cacheTiles * pages.tileSize(), 0);
+    std::vector<GLint> rows(levelRows.begin(), levelRows.end());
+    glUniform1iv(glGetUniformLocation(program, "vtLevelRow"), GLsizei(rows.size()), rows.data());
+}
+
+void VirtualTexture::processFeedback(const uint16_t* texels, size_t count) {
+    const VirtualTextureLayout& pages = blob.layout();
+    for (size_t i = 0; i < count; ++i) {
+        const uint16_t* texel = texels + i * FEEDBACK_TEXEL_SHORTS;
+        if (texel[3] == 0) {
+            continue;
+        }
+        uint32_t level = texel[2];
+        if (level < pages.levelCount() && texel[0] < pages.pagesX(level) && texel[1] < pages.pagesY(level)) {
+            request(level, texel[0], texel[1]);
+        }
+    }
+}
+
+void VirtualTexture::request(uint32_t level, uint32_t x, uint32_t y) {
+    const VirtualTextureLayout& pages = blob.layout();
+    uint32_t page = pages.pageIndex(level, x, y);
+    if (pageRequested[page] == frame) {
+        return;
+    }
+    pageRequested[page] = frame;
+    if (pageStates[page] == Resident) {
+        slots[pageSlots[page]].lastUsed = frame;
+    } else if (pageStates[page] == Absent) {
+        wanted.push_back(page);
+    }
+    // Ancestors are the fallback while a page is missing, so keep them too
+    if (level + 1 < pages.levelCount()) {
+        request(level + 1, x / 2, y / 2);
+    }
+}
+
+void VirtualTexture::startLoad(uint32_t page) {
+    pageStates[page] = Loading;
+    ++loadsInFlight;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        jobsInFlight++;
+    }
+    jobs.submit([this, page] {
+        // The copy is where the file is actually read
+        const uint8_t* tile = blob.tile(page);
+        Load load{page, std::vector<uint8_t>(tile, tile + blob.tileBytes())};
+        std::lock_guard<std::mutex> lock(loadMutex);
+        finished.push_back(std::move(load));
+        if (--jobsInFlight == 0) {
+            loadsDone.notify_all();
+        }
+    });
+}
+
+void VirtualTexture::upload(const Load& load) {
+    --loadsInFlight;
+    int32_t slot = acquireSlot();
+    if (slot < 0) {
+        // Every slot was seen this frame; the cache is too small for the
+        // view. Drop the page and let feedback ask for it again.
+        pageStates[load.page] = Absent;
+        return;
+    }
+    const VirtualTextureLayout& pages = blob.layout();
+    uint32_t tile = pages.tileSize();
+    glBindTexture(GL_TEXTURE_2D, cache);
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, (slot % settings.cacheTiles) * tile,
+                              (slot / settings.cacheTiles) * tile, tile, tile,
+                              blockFormatInfo(blob.format()).glFormat, GLsizei(load.tile.size()),
+                              load.tile.data());
+    countUpload(load.tile.size());
+    slots[slot].page = int32_t(load.page);
+    slots[slot].lastUsed = frame;
+    pageStates[load.page] = Resident;
+    pageSlots[load.page] = slot;
+    ++resident;
+    pageTableDirty = true;
+}
+
+// Returns a free slot, or evicts the least recently used page. Pages seen
+// this frame and the coarsest page stay.
+int32_t VirtualTexture::acquireSlot() {
+    uint32_t pinned = blob.layout().pageCount() - 1;
+    int32_t victim = -1;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        const Slot& slot = slots[i];
+        if (slot.page < 0) {
+            return int32_t(i);
+        }
+        if (slot.lastUsed < frame && uint32_t(slot.page) != pinned &&
+            (victim < 0 || slot.lastUsed < slots[victim].lastUsed)) {
+            victim = int32_t(i);
+        }
+    }
+    if (victim >= 0) {
+        uint32_t page = uint32_t(slots[victim].page);
+        pageStates[page] = Absent;
+        pageSlots[page] = -1;
+        slots[victim].page = -1;
+        --resident;
+    }
+    return victim;
+}
+
+// Every entry points at the page itself if it is resident, or else at the
+// same entry of its parent, so lookups always land on the finest resident
+// ancestor. Alpha is 0 until the coarsest page has arrived.
+void VirtualTexture::rebuildPageTable() {
+    const VirtualTextureLayout& pages = blob.layout();
+    uint32_t tableWidth = pages.pagesX(0);
+    for (uint32_t level = pages.levelCount(); level-- > 0;) {
+        for (uint32_t y = 0; y < pages.pagesY(level); ++y) {
+            for (uint32_t x = 0; x < pages.pagesX(level); ++x) {
+                uint8_t* entry = &pageTableData[(size_t(levelRows[level] + y) * tableWidth + x) * 4];
+                int32_t slot = pageSlots[pages.pageIndex(level, x, y)];
+                if (slot >= 0) {
+                    entry[0] = uint8_t(slot % settings.cacheTiles);
+                    entry[1] = uint8_t(slot / settings.cacheTiles);
+                    entry[2] = uint8_t(level);
+                    entry[3] = 255;
+                } else if (level + 1 < pages.levelCount()) {
+                    const uint8_t* parent =
+                        &pageTableData[(size_t(levelRows[level + 1] + y / 2) * tableWidth + x / 2) * 4];
+                    std::copy(parent, parent + 4, entry);
+                } else {
+                    std::fill(entry, entry + 4, uint8_t(0));
+                }
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tableWidth, GLsizei(pageTableData.size() / 4 / tableWidth), GL_RGBA,
+                    GL_UNSIGNED_BYTE, pageTableData.data());
+    countUpload(pageTableData.size());
+    pageTableDirty = false;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Framebuffer.h"
+#include "JobSystem.h"
+#include "FileSystem.h"
+#include "VirtualTextureFormat.h"
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct VirtualTextureSettings {
+    uint32_t cacheTiles = 16;           // Physical cache is cacheTiles x cacheTiles pages
+    uint32_t feedbackDivisor = 8;       // Feedback pass runs at 1/divisor of the viewport
+    uint32_t maxLoadsInFlight = 32;
+    uint32_t maxUploadsPerFrame = 8;
+};
+
+// Sparse virtual texture streamed from a .vtex file (see
+// VirtualTextureFormat.h). Only the pages that are actually visible live in
+// GPU memory: a fixed-size physical cache texture holds them, with the least
+// recently used page evicted when a new one needs its slot, so memory stays
+// bounded however large the virtual texture is.
+//
+// Each frame:
+//   1. beginFeedback() binds a low-resolution target; draw the virtually
+//      textured geometry with res/shaders/vt_feedback_fragment_shader.glsl,
+//      which writes the page and mip level each pixel wants
+//   2. endFeedback() starts an asynchronous readback of that target
+//   3. update() reads back an earlier frame's feedback once its fence has
+//      signaled, loads missing pages on worker threads, uploads finished
+//      ones into the cache and refreshes the page table
+//   4. bind() and draw with res/shaders/vt_fragment_shader.glsl, which maps
+//      virtual UVs through the page table into the cache
+// A page that isn't resident yet falls back to the finest resident
+// ancestor; the single-page coarsest level is loaded first and never
+// evicted. Sampling is bilinear within one level, not trilinear.
+class VirtualTexture {
+public:
+    // Throws std::runtime_error if the file can't be mapped or parsed, or if
+    // the context can't sample its format.
+    VirtualTexture(const std::string& path, JobSystem& jobs, uint32_t viewportWidth, uint32_t viewportHeight,
+                   const VirtualTextureSettings& settings = VirtualTextureSettings());
+    // Waits for this texture's page loads.
+    ~VirtualTexture();
+
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    // Binds the feedback target and sets the feedback uniforms of `program`,
+    // which must be current.
+    void beginFeedback(unsigned int program);
+    // Queues the readback and rebinds the framebuffer and viewport that
+    // were current at beginFeedback().
+    void endFeedback();
+
+    // Call once per frame on the GL thread.
+    void update();
+
+    // Binds the cache and page table and sets the sampling uniforms of
+    // `program`, which must be current.
+    void bind(unsigned int program, unsigned int cacheUnit = 0, unsigned int pageTableUnit = 1) const;
+
+    const VirtualTextureLayout& layout() const { return blob.layout(); }
+    uint32_t residentPages() const { return resident; }
+    uint32_t pendingLoads() const { return loadsInFlight; }
+
+private:
+    enum PageState : uint8_t {
+        Absent,
+        Loading,        // On a worker, or read and waiting for an upload
+        Resident,
+    };
+
+    struct Slot {
+        int32_t page = -1;
+        uint64_t lastUsed = 0;
+    };
+
+    struct Load {
+        uint32_t page;
+        std::vector<uint8_t> tile;
+    };
+
+    struct Readback {
+        unsigned int buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    void processFeedback(const uint16_t* texels, size_t count);
+    void request(uint32_t level, uint32_t x, uint32_t y);
+    void startLoad(uint32_t page);
+    void upload(const Load& load);
+    int32_t acquireSlot();
+    void rebuildPageTable();
+
+    FileData file;
+    VirtualTextureBlob blob;
+    JobSystem& jobs;
+    VirtualTextureSettings settings;
+
+    unsigned int cache;
+    unsigned int pageTable;
+    std::vector<uint32_t> levelRows;    // First page table row of each level
+    std::vector<uint8_t> pageTableData;
+    bool pageTableDirty = true;
+
+    std::unique_ptr<Framebuffer> feedback;
+    Readback readbacks[2];
+    uint32_t nextReadback = 0;
+    GLint savedViewport[4] = {};
+    GLint savedFramebuffer = 0;
+
+    std::vector<PageState> pageStates;
+    std::vector<int32_t> pageSlots;
+    std::vector<uint64_t> pageRequested;    // Frame of the last feedback request
+    std::vector<uint32_t> wanted;           // Missing pages requested this frame
+    std::vector<Load> loaded;               // Read, waiting for an upload
+    std::vector<Slot> slots;
+    uint64_t frame = 1;
+    uint32_t resident = 0;
+    uint32_t loadsInFlight = 0;
+
+    std::mutex loadMutex;
+    std::condition_variable loadsDone;
+    std::vector<Load> finished;             // Guarded by loadMutex
+    size_t jobsInFlight = 0;                // Guarded by loadMutex
+};
@@ -0,0 +1,59 @@
+#include "VirtualTextureFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+VirtualTextureLayout::VirtualTextureLayout(uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border)
+    : baseWidth(width), baseHeight(height), page(pageSize), tileBorder(border) {
+    if (width == 0 || height == 0 || pageSize == 0 || (pageSize + 2 * border) % 4 != 0 || pageSize % 2 != 0) {
+        throw std::runtime_error("Virtual texture pages must be even and tiles a multiple of 4 texels");
+    }
+    // Halve until one page covers the whole level
+    levels = 1;
+    while (levelWidth(levels - 1) > page || levelHeight(levels - 1) > page) {
+        if (levels == VTEX_MAX_LEVELS) {
+            throw std::runtime_error("Virtual texture is too large for its page size");
+        }
+        ++levels;
+    }
+    for (uint32_t level = 0; level < levels; ++level) {
+        firstPage[level + 1] = firstPage[level] + pagesX(level) * pagesY(level);
+    }
+}
+
+uint32_t VirtualTextureLayout::levelWidth(uint32_t level) const {
+    return std::max(baseWidth >> level, 1u);
+}
+
+uint32_t VirtualTextureLayout::levelHeight(uint32_t level) const {
+    return std::max(baseHeight >> level, 1u);
+}
+
+VirtualTextureBlob::VirtualTextureBlob(const uint8_t* data, size_t size) {
+    VirtualTextureHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Virtual texture header is truncated");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != VTEX_FILE_MAGIC) {
+        throw std::runtime_error("Not a virtual texture file");
+    }
+    if (header.version != VTEX_FILE_VERSION) {
+        throw std::runtime_error("Unsupported virtual texture version " + std::to_string(header.version));
+    }
+    if (header.format > uint32_t(BlockFormat::BC7)) {
+        throw std::runtime_error("Unknown virtual texture format");
+    }
+    blockFormat = BlockFormat(header.format);
+    pageLayout = VirtualTextureLayout(header.width, header.height, header.pageSize, header.border);
+    tileSize = compressedLevelSize(blockFormat, pageLayout.tileSize(), pageLayout.tileSize());
+    if (header.levelCount != pageLayout.levelCount() || header.tileBytes != tileSize) {
+        throw std::runtime_error("Virtual texture header is inconsistent");
+    }
+    if (header.tileDataOffset > size || (size - header.tileDataOffset) / tileSize < pageLayout.pageCount()) {
+        throw std::runtime_error("Virtual texture tiles are truncated");
+    }
+    tiles = data + header.tileDataOffset;
+}
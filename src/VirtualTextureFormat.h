@@ -0,0 +1,89 @@
+#pragma once
+
+#include "TextureFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of the tiled .vtex files written by tools/texture_cooker
+// --virtual, streamed by VirtualTexture. The texture is cut into pages of
+// pageSize x pageSize texels at every mip level, down to the first level
+// that fits in a single page. Each page is stored as a tile with `border`
+// extra texels copied from its neighbours on every side, so bilinear
+// filtering never reads past the tile, and block-compressed as a whole.
+//
+// All tiles have the same size, so a page's offset follows from its index:
+// levels from finest to coarsest, pages row by row from the bottom, like
+// Image. Edge tiles repeat the level's last row and column.
+
+constexpr uint32_t VTEX_FILE_MAGIC = 0x58455456;   // "VTEX"
+constexpr uint32_t VTEX_FILE_VERSION = 1;
+constexpr uint32_t VTEX_MAX_LEVELS = 16;
+
+struct VirtualTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;         // Level 0, in texels
+    uint32_t height;
+    uint32_t pageSize;      // Texels per page side, without the border
+    uint32_t border;
+    uint32_t levelCount;
+    uint32_t format;        // BlockFormat
+    uint64_t tileDataOffset;
+    uint64_t tileBytes;     // Compressed size of one tile
+};
+
+static_assert(sizeof(VirtualTextureHeader) == 48, "VirtualTextureHeader must match the .vtex layout");
+
+// Page grid of a virtual texture, shared by the cooker and the runtime.
+class VirtualTextureLayout {
+public:
+    VirtualTextureLayout() = default;
+    // Throws std::runtime_error unless pageSize and border keep tiles a
+    // whole number of 4x4 blocks.
+    VirtualTextureLayout(uint32_t width, uint32_t height, uint32_t pageSize, uint32_t border);
+
+    uint32_t width() const { return levelWidth(0); }
+    uint32_t height() const { return levelHeight(0); }
+    uint32_t pageSize() const { return page; }
+    uint32_t border() const { return tileBorder; }
+    uint32_t tileSize() const { return page + 2 * tileBorder; }
+    uint32_t levelCount() const { return levels; }
+
+    uint32_t levelWidth(uint32_t level) const;
+    uint32_t levelHeight(uint32_t level) const;
+    uint32_t pagesX(uint32_t level) const { return (levelWidth(level) + page - 1) / page; }
+    uint32_t pagesY(uint32_t level) const { return (levelHeight(level) + page - 1) / page; }
+
+    // Pages of all levels, and the index of a page among them
+    uint32_t pageCount() const { return firstPage[levels]; }
+    uint32_t pageIndex(uint32_t level, uint32_t x, uint32_t y) const {
+        return firstPage[level] + y * pagesX(level) + x;
+    }
+
+private:
+    uint32_t baseWidth = 0;
+    uint32_t baseHeight = 0;
+    uint32_t page = 0;
+    uint32_t tileBorder = 0;
+    uint32_t levels = 0;
+    uint32_t firstPage[VTEX_MAX_LEVELS + 1] = {};
+};
+
+// Validated, read-only view of a .vtex file. Nothing is copied.
+class VirtualTextureBlob {
+public:
+    // Throws std::runtime_error on malformed or truncated files.
+    VirtualTextureBlob(const uint8_t* data, size_t size);
+
+    const VirtualTextureLayout& layout() const { return pageLayout; }
+    BlockFormat format() const { return blockFormat; }
+    size_t tileBytes() const { return tileSize; }
+    const uint8_t* tile(uint32_t pageIndex) const { return tiles + pageIndex * tileSize; }
+
+private:
+    VirtualTextureLayout pageLayout;
+    BlockFormat blockFormat;
+    size_t tileSize;
+    const uint8_t* tiles;
+};
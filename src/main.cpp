@@ -3,18 +3,70 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <random>
+
+#include "AssetManager.h"
+#include "Buffers.h"
+#include "ClusteredLights.h"
+#include "CpuProfiler.h"
+#include "DeferredShading.h"
+#include "FileSystem.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "GlDebug.h"
+#include "GpuFeatures.h"
+#include "GpuProfiler.h"
+#include "GpuScene.h"
+#include "Image.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "Mesh.h"
+#include "MeshPool.h"
+#include "RenderGraph.h"
+#include "RenderStats.h"
+#include "RenderTargetPool.h"
+#include "Shader.h"
+#include "StatsOverlay.h"
+#include "StreamBuffer.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include "VertexLayout.h"
+#include "VirtualTexture.h"
 
 // Constants
 constexpr int WINDOW_WIDTH = 800;
 constexpr int WINDOW_HEIGHT = 600;
 constexpr const char* WINDOW_TITLE = "3D World";
+constexpr const char* ASSET_ARCHIVE_PATH = "res.pack";
 constexpr const char* VERTEX_SHADER_PATH = "res/shaders/vertex_shader.glsl";
 constexpr const char* FRAGMENT_SHADER_PATH = "res/shaders/fragment_shader.glsl";
+constexpr const char* ATLAS_VERTEX_SHADER_PATH = "res/shaders/atlas_vertex_shader.glsl";
+constexpr const char* ATLAS_FRAGMENT_SHADER_PATH = "res/shaders/atlas_fragment_shader.glsl";
+constexpr uint32_t ATLAS_PAGE_SIZE = 2048;
+constexpr size_t STREAM_BUFFER_FRAME_SIZE = 1 << 20;
+constexpr size_t MESH_POOL_DEFRAGMENT_BUDGET = 1 << 20;
+constexpr const char* TRACE_PATH = "trace.json";
+constexpr const char* VT_VERTEX_SHADER_PATH = "res/shaders/vt_vertex_shader.glsl";
+constexpr const char* VT_FRAGMENT_SHADER_PATH = "res/shaders/vt_fragment_shader.glsl";
+constexpr const char* VT_FEEDBACK_FRAGMENT_SHADER_PATH = "res/shaders/vt_feedback_fragment_shader.glsl";
+constexpr const char* INDIRECT_VERTEX_SHADER_PATH = "res/shaders/indirect_vertex_shader.glsl";
+constexpr const char* INDIRECT_FRAGMENT_SHADER_PATH = "res/shaders/indirect_fragment_shader.glsl";
+constexpr const char* INDIRECT_GBUFFER_FRAGMENT_SHADER_PATH = "res/shaders/indirect_gbuffer_fragment_shader.glsl";
+constexpr int GPU_SCENE_GRID_SIZE = 16;
+constexpr uint32_t POINT_LIGHT_COUNT = 4096;
+constexpr float CAMERA_NEAR = 0.1f;
+constexpr float CAMERA_FAR = 100.0f;
+constexpr uint32_t FRAME_CAPTURE_DEPTH = 3;
 
 // Camera settings
 glm::vec3 cameraPos(0.0f, 0.0f, 3.0f);
@@ -26,137 +78,12 @@ float lastX = WINDOW_WIDTH / 2, lastY = WINDOW_HEIGHT / 2;
 bool firstMouse = true;
 float sensitivity = 0.1f;
 
-// Utility to check OpenGL errors
-void checkOpenGLError(const std::string& context) {
-    GLenum err;
-    while ((err = glGetError()) != GL_NO_ERROR) {
-        std::cerr << "OpenGL Error in " << context << ": " << err << std::endl;
-    }
-}
-
-// Shader class for encapsulating shader program
-class Shader {
-public:
-    unsigned int ID;
-
-    Shader(const char* vertexPath, const char* fragmentPath) {
-        ID = createShaderProgram(vertexPath, fragmentPath);
-    }
-
-    ~Shader() {
-        glDeleteProgram(ID);
-    }
-
-    void use() const {
-        glUseProgram(ID);
-    }
-
-    void setMat4(const std::string& name, const glm::mat4& value) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
-    }
-
-private:
-    unsigned int createShaderProgram(const char* vertexPath, const char* fragmentPath) {
-        std::string vertexCode = readFile(vertexPath);
-        std::string fragmentCode = readFile(fragmentPath);
-        unsigned int vertexShader = compileShader(vertexCode.c_str(), GL_VERTEX_SHADER);
-        unsigned int fragmentShader = compileShader(fragmentCode.c_str(), GL_FRAGMENT_SHADER);
-
-        unsigned int program = glCreateProgram();
-        glAttachShader(program, vertexShader);
-        glAttachShader(program, fragmentShader);
-        glLinkProgram(program);
-        checkCompileErrors(program, "PROGRAM");
-
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-
-        return program;
-    }
-
-    unsigned int compileShader(const char* code, GLenum type) {
-        unsigned int shader = glCreateShader(type);
-        glShaderSource(shader, 1, &code, nullptr);
-        glCompileShader(shader);
-        checkCompileErrors(shader, type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT");
-        return shader;
-    }
-
-    void checkCompileErrors(unsigned int shader, const std::string& type) const {
-        int success;
-        char infoLog[1024];
-        if (type == "PROGRAM") {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if (!success) {
-                glGetProgramInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
-                std::cerr << "Program Linking Error: " << infoLog << std::endl;
-            }
-        } else {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if (!success) {
-                glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
-                std::cerr << type << " Shader Compilation Error: " << infoLog << std::endl;
-            }
-        }
-    }
-
-    static std::string readFile(const char* filepath) {
-        std::ifstream file(filepath);
-        std::stringstream buffer;
-        if (file) {
-            buffer << file.rdbuf();
-            file.close();
-        } else {
-            throw std::ios_base::failure("Failed to read shader file: " + std::string(filepath));
-        }
-        return buffer.str();
-    }
-};
-
-// VAO and VBO wrapper
-class VertexArray {
-public:
-    unsigned int ID;
-
-    VertexArray() {
-        glGenVertexArrays(1, &ID);
-    }
-
-    ~VertexArray() {
-        glDeleteVertexArrays(1, &ID);
-    }
-
-    void bind() const {
-        glBindVertexArray(ID);
-    }
-
-    void unbind() const {
-        glBindVertexArray(0);
-    }
-};
-
-class VertexBuffer {
-public:
-    unsigned int ID;
-
-    VertexBuffer(const void* data, size_t size) {
-        glGenBuffers(1, &ID);
-        glBindBuffer(GL_ARRAY_BUFFER, ID);
-        glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
-    }
-
-    ~VertexBuffer() {
-        glDeleteBuffers(1, &ID);
-    }
-
-    void bind() const {
-        glBindBuffer(GL_ARRAY_BUFFER, ID);
-    }
-
-    void unbind() const {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-};
+// F3 toggles the stats overlay
+bool showStats = false;
+bool statsKeyDown = false;
+// F4 switches the grid between clustered forward and deferred shading
+bool deferredShading = false;
+bool deferredKeyDown = false;
 
 // Callback for resizing window
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -190,9 +117,20 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 
 // Input processing
 void processInput(GLFWwindow* window) {
+    PROFILE_SCOPE("Input");
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    bool statsKey = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (statsKey && !statsKeyDown)
+        showStats = !showStats;
+    statsKeyDown = statsKey;
+
+    bool deferredKey = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+    if (deferredKey && !deferredKeyDown)
+        deferredShading = !deferredShading;
+    deferredKeyDown = deferredKey;
+
     float velocity = cameraSpeed;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         cameraPos += velocity * cameraFront;
@@ -205,12 +143,26 @@ void processInput(GLFWwindow* window) {
 }
 
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
     // Initialize GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef GL_DEBUG_ENABLED
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+    // OFFSCREEN=<frames> renders into an FBO instead of the window and reads
+    // every frame back (see FrameCapture.h), e.g. on headless nodes; 0 runs
+    // until closed. CAPTURE_DIR additionally writes the frames there as TGAs
+    const char* offscreenFrames = std::getenv("OFFSCREEN");
+    bool offscreen = offscreenFrames != nullptr;
+    if (offscreen) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    // RENDER_PATH=deferred starts with the grid deferred shaded, as F4 does
+    const char* renderPath = std::getenv("RENDER_PATH");
+    deferredShading = renderPath && std::strcmp(renderPath, "deferred") == 0;
 
     GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
     if (!window) {
@@ -222,60 +174,525 @@ int main() {
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!offscreen) {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    printGpuFeatures(std::cout, detectGpuFeatures());
+    // Driver messages in debug builds; nothing in shipping ones
+    installGlDebugOutput();
 
     glEnable(GL_DEPTH_TEST);
 
-    Shader shader(VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH);
-
-    // Square vertices
-    float squareVertices[] = {
-        -0.5f, -0.5f, 0.0f,    0.0f, 0.0f,
-         0.5f, -0.5f, 0.0f,    1.0f, 0.0f,
-         0.5f,  0.5f, 0.0f,    1.0f, 1.0f,
-         0.5f,  0.5f, 0.0f,    1.0f, 1.0f,
-        -0.5f,  0.5f, 0.0f,    0.0f, 1.0f,
-        -0.5f, -0.5f, 0.0f,    0.0f, 0.0f,
-    };
-
-    // Create and bind VAOs and VBOs
-    VertexArray squareVAO;
-    VertexBuffer squareVBO(squareVertices, sizeof(squareVertices));
-
-    // Square Setup
-    squareVAO.bind();
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    squareVAO.unbind();
-
-    while (!glfwWindowShouldClose(window)) {
-        processInput(window);
-
-        glClearColor(0.5f, 0.5f, 0.5f, 0.5f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shader.use();
-
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 100.0f);
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-
-        // Render Square
-        glm::mat4 squareModel = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -3.0f)); // Position the square
-        shader.setMat4("model", squareModel);
-        squareVAO.bind();
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    // Packed assets, if tools/asset_packer has been run. Debug builds let
+    // loose files under res/ take precedence, so edits show up without
+    // repacking; shipping ones only read loose files the archive lacks
+    if (fileExists(ASSET_ARCHIVE_PATH)) {
+        try {
+            mountArchive(ASSET_ARCHIVE_PATH);
+#ifdef NDEBUG
+            setLooseFileOverride(false);
+#endif
+        } catch (const std::exception& e) {
+            std::cerr << "Asset archive disabled, using loose files: " << e.what() << std::endl;
+        }
+    }
+
+    // Every GL object lives in this scope, so all of them are deleted while
+    // the context still exists, before glfwTerminate() below
+    {
+        Shader shader(VERTEX_SHADER_PATH, FRAGMENT_SHADER_PATH);
+
+        // Square vertices
+        float squareVertices[] = {
+            -0.5f, -0.5f, 0.0f,    0.0f, 0.0f,
+             0.5f, -0.5f, 0.0f,    1.0f, 0.0f,
+             0.5f,  0.5f, 0.0f,    1.0f, 1.0f,
+             0.5f,  0.5f, 0.0f,    1.0f, 1.0f,
+            -0.5f,  0.5f, 0.0f,    0.0f, 1.0f,
+            -0.5f, -0.5f, 0.0f,    0.0f, 0.0f,
+        };
+
+        // Pack the square compactly: 16-bit positions relative to its bounds and
+        // half-float UVs, 12 bytes per vertex instead of 20
+        VertexLayout squareLayout;
+        squareLayout.add(0, VertexFormat::Unorm16x4).add(1, VertexFormat::Half2);
+        PositionQuantization squareQuantization(glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f));
+        std::vector<uint8_t> squarePacked(6 * squareLayout.stride());
+        for (size_t i = 0; i < 6; ++i) {
+            const float* v = &squareVertices[i * 5];
+            uint8_t* vertex = &squarePacked[i * squareLayout.stride()];
+            squareLayout.write(vertex, 0, glm::vec4(squareQuantization.normalize(glm::vec3(v[0], v[1], v[2])), 0.0f));
+            squareLayout.write(vertex, 1, glm::vec4(v[3], v[4], 0.0f, 0.0f));
+        }
+
+        // Create VAOs and VBOs
+        VertexArray squareVAO;
+        VertexBuffer squareVBO(squarePacked.data(), squarePacked.size());
+
+        // Square Setup
+        squareVAO.setLayout(squareVBO, squareLayout);
+
+        // Streamed meshes share a few large buffers instead of owning their own
+        MeshPool meshPool;
+        JobSystem jobs;
+        AssetManager assets(jobs);
+
+        // Optional cooked mesh passed on the command line, streamed in the
+        // background and drawn once it is ready
+        std::shared_ptr<MeshAsset> mesh;
+        uint32_t meshLod = 0;
+        if (argc > 1) {
+            mesh = assets.load<MeshAsset>(argv[1], glm::vec3(0.0f));
+            mesh->pool = &meshPool;
+        }
+
+        // With GL 4.3, a grid of copies of that mesh behind it, culled on the
+        // GPU and drawn with one multi-draw indirect call, and lit by point
+        // lights circling above it with clustered forward shading, or deferred
+        // shading over the same clusters
+        std::unique_ptr<GpuScene> gpuScene;
+        std::unique_ptr<Shader> indirectShader, gbufferShader;
+        std::unique_ptr<DeferredShading> deferredLighting;
+        std::unique_ptr<ClusteredLights> clusteredLights;
+        std::vector<PointLight> pointLights;
+        std::vector<glm::vec4> lightOrbits;     // Center and phase of each light's circle
+        float lightOrbitRadius = 0.0f;
+        if (argc > 1 && GLAD_GL_VERSION_4_3) {
+            try {
+                FileData file = openFile(argv[1]);
+                gpuScene = std::make_unique<GpuScene>();
+                MeshBlob blob(file.data(), file.size());
+                uint32_t gridMesh = gpuScene->addMesh(blob);
+                float spacing = std::max(blob.header().bounds.radius * 2.5f, 1.0f);
+                for (int z = 0; z < GPU_SCENE_GRID_SIZE; ++z) {
+                    for (int x = 0; x < GPU_SCENE_GRID_SIZE; ++x) {
+                        glm::vec3 offset((x - GPU_SCENE_GRID_SIZE / 2) * spacing, 0.0f, -(z + 2) * spacing);
+                        gpuScene->addObject(gridMesh, glm::translate(glm::mat4(1.0f), offset));
+                    }
+                }
+                indirectShader = std::make_unique<Shader>(INDIRECT_VERTEX_SHADER_PATH, INDIRECT_FRAGMENT_SHADER_PATH);
+                gbufferShader =
+                    std::make_unique<Shader>(INDIRECT_VERTEX_SHADER_PATH, INDIRECT_GBUFFER_FRAGMENT_SHADER_PATH);
+                deferredLighting = std::make_unique<DeferredShading>();
+
+                clusteredLights = std::make_unique<ClusteredLights>(POINT_LIGHT_COUNT);
+                std::mt19937 random(1);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                lightOrbitRadius = spacing * 0.5f;
+                for (uint32_t i = 0; i < POINT_LIGHT_COUNT; ++i) {
+                    float x = (unit(random) * GPU_SCENE_GRID_SIZE - GPU_SCENE_GRID_SIZE / 2) * spacing;
+                    float z = -(unit(random) * GPU_SCENE_GRID_SIZE + 1.5f) * spacing;
+                    lightOrbits.push_back(glm::vec4(x, unit(random) * spacing, z, unit(random) * 6.2831853f));
+                    PointLight light;
+                    light.radius = spacing * (0.75f + 0.5f * unit(random));
+                    light.color = glm::vec3(unit(random), unit(random), unit(random));
+                    light.intensity = 2.0f;
+                    pointLights.push_back(light);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "GPU scene disabled: " << e.what() << std::endl;
+                gpuScene.reset();
+                clusteredLights.reset();
+            }
+        }
+
+        // Optional texture for the square, decoded in the background; it shows
+        // up white until the upload has finished
+        TextureLoader textureLoader(jobs);
+        std::shared_ptr<Texture2D> squareTexture;
+        // A .vtex texture is streamed page by page instead (see VirtualTexture.h)
+        std::unique_ptr<VirtualTexture> squareVirtualTexture;
+        std::unique_ptr<Shader> vtShader, vtFeedbackShader;
+        if (argc > 2) {
+            std::string path = argv[2];
+            if (path.size() > 5 && path.compare(path.size() - 5, 5, ".vtex") == 0) {
+                squareVirtualTexture = std::make_unique<VirtualTexture>(path, jobs, WINDOW_WIDTH, WINDOW_HEIGHT);
+                vtShader = std::make_unique<Shader>(VT_VERTEX_SHADER_PATH, VT_FRAGMENT_SHADER_PATH);
+                vtFeedbackShader = std::make_unique<Shader>(VT_VERTEX_SHADER_PATH, VT_FEEDBACK_FRAGMENT_SHADER_PATH);
+            } else {
+                squareTexture = textureLoader.load(path, MipmapMode::Kaiser);
+            }
+        }
+
+        // Optional images packed into an atlas at startup and drawn as a row of
+        // squares in one instanced call; each instance carries its offset, page
+        // and UV rectangle. The instances are rewritten every frame, straight
+        // into GPU-visible memory, to make the row bob
+        StreamBuffer streamBuffer(STREAM_BUFFER_FRAME_SIZE);
+        VertexArray atlasVAO;
+        VertexLayout atlasInstanceLayout;
+        std::vector<uint8_t> atlasInstances;
+        std::vector<glm::vec4> atlasOffsets;   // Offset and layer of each instance
+        std::unique_ptr<Texture2DArray> atlasTexture;
+        std::unique_ptr<Shader> atlasShader;
+        GLsizei atlasInstanceCount = 0;
+        if (argc > 3) {
+            TextureAtlas atlas(ATLAS_PAGE_SIZE);
+            atlasInstanceLayout.add(2, VertexFormat::Float4).add(3, VertexFormat::Unorm16x4);
+            for (int i = 3; i < argc; ++i) {
+                AtlasRegion region = atlas.add(loadImage(argv[i]));
+                atlasInstances.resize(atlasInstances.size() + atlasInstanceLayout.stride());
+                uint8_t* instance = &atlasInstances[atlasInstances.size() - atlasInstanceLayout.stride()];
+                atlasOffsets.push_back(glm::vec4(1.2f * (i - 3), -1.5f, 0.0f, float(region.layer)));
+                atlasInstanceLayout.write(instance, 2, atlasOffsets.back());
+                atlasInstanceLayout.write(instance, 3, region.uvRect);
+            }
+            std::vector<std::vector<Image>> pages = atlas.buildMipChains(MipFilter::Box);
+            atlasTexture = std::make_unique<Texture2DArray>(atlas.pageSize(), atlas.pageSize(), atlas.pageCount(),
+                                                            atlas.usableLevels());
+            for (uint32_t layer = 0; layer < pages.size(); ++layer) {
+                for (uint32_t level = 0; level < pages[layer].size(); ++level) {
+                    atlasTexture->setLayer(layer, level, pages[layer][level].pixels.data());
+                }
+            }
+            // The square on binding 0, instances on binding 1; only the latter
+            // moves each frame
+            atlasVAO.setLayout(squareVBO, squareLayout);
+            atlasVAO.setFormat(atlasInstanceLayout, 1, 1);
+            atlasShader = std::make_unique<Shader>(ATLAS_VERTEX_SHADER_PATH, ATLAS_FRAGMENT_SHADER_PATH);
+            atlasInstanceCount = GLsizei(argc - 3);
+        }
+
+        // GPU time per pass; P prints the averages and writes a Chrome trace
+        // of both the CPU and GPU scopes
+        GpuProfiler gpuProfiler;
+        bool profileKeyDown = false;
+        setProfilerThreadName("Main");
+        ProfilerStream profilerStream;
+        if (const char* port = std::getenv("PROFILER_PORT")) {
+            if (!profilerStream.start(uint16_t(std::atoi(port)))) {
+                std::cerr << "Failed to start the profiler stream on port " << port << std::endl;
+            }
+        }
+
+        // FPS, pass times, counters and memory drawn over the frame
+        StatsOverlay statsOverlay(gpuProfiler);
+        statsOverlay.addMemorySource("Mesh vertices", [&meshPool] {
+            MeshPoolStats stats = meshPool.stats();
+            return MemoryUsage{stats.vertices.used, stats.vertices.capacity};
+        });
+        statsOverlay.addMemorySource("Mesh indices", [&meshPool] {
+            MeshPoolStats stats = meshPool.stats();
+            return MemoryUsage{stats.indices.used, stats.indices.capacity};
+        });
+        statsOverlay.addMemorySource("Stream buffer", [&streamBuffer] {
+            return MemoryUsage{streamBuffer.frameSize(), streamBuffer.frameCapacity()};
+        });
+        if (clusteredLights) {
+            statsOverlay.addMemorySource("Light clusters", [&clusteredLights] {
+                return MemoryUsage{clusteredLights->stats().bytes, clusteredLights->capacityBytes()};
+            });
+        }
+
+        // Each frame is a render graph of passes over transient targets, taken
+        // from the pool as the passes need them and shared between passes whose
+        // targets are never live at the same time
+        RenderTargetPool renderTargets;
+        RenderGraph renderGraph(renderTargets, &gpuProfiler);
+        statsOverlay.addMemorySource("Render targets", [&renderTargets] {
+            return MemoryUsage{renderTargets.peakAcquiredBytes(), renderTargets.allocatedBytes()};
+        });
+        statsOverlay.addMemorySource("Render graph", [&renderGraph] {
+            return MemoryUsage{renderGraph.stats().peakBytes, renderGraph.stats().unaliasedBytes};
+        });
+
+        // Offscreen target and its readback; frames arrive a few frames late and
+        // are copied out, then encoded and written on the job system
+        std::unique_ptr<Framebuffer> offscreenTarget;
+        std::unique_ptr<FrameCapture> frameCapture;
+        uint64_t offscreenFrameLimit = 0;
+        if (offscreen) {
+            offscreenFrameLimit = std::strtoull(offscreenFrames, nullptr, 10);
+            offscreenTarget = std::make_unique<Framebuffer>(WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA8);
+            labelGlObject(GL_FRAMEBUFFER, offscreenTarget->ID, "Offscreen target");
+            const char* captureDir = std::getenv("CAPTURE_DIR");
+            std::string directory = captureDir ? captureDir : "";
+            frameCapture = std::make_unique<FrameCapture>(
+                WINDOW_WIDTH, WINDOW_HEIGHT,
+                [&jobs, directory](const CapturedFrame& frame) {
+                    if (directory.empty()) {
+                        return;
+                    }
+                    auto image = std::make_shared<Image>();
+                    image->width = frame.width;
+                    image->height = frame.height;
+                    image->pixels.assign(frame.pixels, frame.pixels + size_t(frame.width) * frame.height * 4);
+                    char name[32];
+                    std::snprintf(name, sizeof(name), "/frame_%05llu.tga",
+                                  static_cast<unsigned long long>(frame.index));
+                    std::string path = directory + name;
+                    jobs.submit([image, path] {
+                        std::vector<uint8_t> file = encodeTga(*image);
+                        std::ofstream out(path, std::ios::binary);
+                        out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+                        if (!out) {
+                            std::cerr << "Failed to write " << path << std::endl;
+                        }
+                    });
+                },
+                FRAME_CAPTURE_DEPTH);
+        }
+
+        while (!glfwWindowShouldClose(window)) {
+            statsOverlay.beginFrame();
+            PROFILE_SCOPE("Frame");
+            processInput(window);
+            statsOverlay.setVisible(showStats);
+            bool profileKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+            if (profileKey && !profileKeyDown) {
+                gpuProfiler.print(std::cout);
+                std::vector<TraceEvent> events;
+                appendCpuTrace(events);
+                gpuProfiler.appendTrace(events);
+                std::ofstream trace(TRACE_PATH);
+                writeChromeTrace(trace, events);
+            }
+            profileKeyDown = profileKey;
+
+            gpuProfiler.beginFrame();
+            gpuProfiler.push("Frame");
+            streamBuffer.beginFrame();
+            {
+                GpuProfileScope scope(gpuProfiler, "Uploads");
+                PROFILE_SCOPE("Uploads");
+                assets.update(cameraPos);
+                textureLoader.update();
+                meshPool.defragment(MESH_POOL_DEFRAGMENT_BUDGET);
+            }
+
+            int outputWidth = WINDOW_WIDTH, outputHeight = WINDOW_HEIGHT;
+            if (!offscreenTarget) {
+                glfwGetFramebufferSize(window, &outputWidth, &outputHeight);
+                // Minimized windows report 0 x 0
+                outputWidth = std::max(outputWidth, 1);
+                outputHeight = std::max(outputHeight, 1);
+            }
+            renderTargets.beginFrame();
+            RenderGraph::Resource output = renderGraph.importFramebuffer(
+                "Output", offscreenTarget ? offscreenTarget->ID : 0, uint32_t(outputWidth), uint32_t(outputHeight));
+            RenderGraph::Resource sceneColor = renderGraph.create("Scene color", outputWidth, outputHeight, GL_RGBA8);
+            RenderGraph::Resource sceneDepth =
+                renderGraph.create("Scene depth", outputWidth, outputHeight, GL_DEPTH_COMPONENT24);
+
+            glm::mat4 view, projection;
+            {
+                PROFILE_SCOPE("Matrices");
+                view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+                projection =
+                    glm::perspective(glm::radians(45.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, CAMERA_NEAR, CAMERA_FAR);
+            }
+
+            // The grid's culling and light clusters, whichever path draws it
+            auto prepareGrid = [&] {
+                {
+                    GpuProfileScope cullScope(gpuProfiler, "Cull");
+                    PROFILE_SCOPE("Cull");
+                    gpuScene->cull(view, projection, float(outputHeight));
+                }
+                PROFILE_SCOPE("Light clusters");
+                float time = float(glfwGetTime());
+                for (size_t i = 0; i < pointLights.size(); ++i) {
+                    glm::vec4 orbit = lightOrbits[i];
+                    float angle = time + orbit.w;
+                    pointLights[i].position =
+                        glm::vec3(orbit) + lightOrbitRadius * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+                }
+                clusteredLights->update(pointLights, view, projection, CAMERA_NEAR, CAMERA_FAR);
+            };
+            auto useGridShader = [&](const Shader& gridShader) {
+                gridShader.use();
+                gridShader.setMat4("view", view);
+                gridShader.setMat4("projection", projection);
+                const VertexAttribute* normal = gpuScene->layout().find(2);
+                gridShader.setInt("octahedralNormals", normal && normal->format == VertexFormat::OctahedralSnorm10);
+            };
+
+            // Deferred, the grid goes into a G-buffer and is lit in one
+            // full-screen pass before the rest of the scene is drawn over it.
+            // Both paths show up in the GPU profile under their own passes, so
+            // toggling with F4 and printing it compares them on the same frame
+            bool deferredGrid = gpuScene && deferredShading;
+            if (deferredGrid) {
+                RenderGraph::Resource gbufferAlbedo =
+                    renderGraph.create("G-buffer albedo", outputWidth, outputHeight, DeferredShading::ALBEDO_FORMAT);
+                RenderGraph::Resource gbufferNormal =
+                    renderGraph.create("G-buffer normal", outputWidth, outputHeight, DeferredShading::NORMAL_FORMAT);
+                renderGraph.addPass("G-buffer", [&](RenderGraph&) {
+                    prepareGrid();
+                    GpuProfileScope drawScope(gpuProfiler, "Draw");
+                    PROFILE_SCOPE("Draw");
+                    useGridShader(*gbufferShader);
+                    gpuScene->draw();
+                })
+                    .color(gbufferAlbedo, RenderGraphLoad::DontCare)
+                    .color(gbufferNormal, RenderGraphLoad::DontCare)
+                    .depth(sceneDepth, RenderGraphLoad::Clear);
+                renderGraph.addPass("Deferred lighting", [&, gbufferAlbedo, gbufferNormal](RenderGraph& graph) {
+                    GBufferTextures gbuffer{graph.texture(gbufferAlbedo), graph.texture(gbufferNormal),
+                                            graph.texture(sceneDepth)};
+                    deferredLighting->light(gbuffer, *clusteredLights, view, projection,
+                                            glm::vec2(outputWidth, outputHeight));
+                })
+                    .read(gbufferAlbedo)
+                    .read(gbufferNormal)
+                    .read(sceneDepth)
+                    .color(sceneColor, RenderGraphLoad::Clear, glm::vec4(0.5f));
+            }
+
+            renderGraph.addPass("Scene", [&](RenderGraph&) {
+                shader.use();
+                shader.setMat4("view", view);
+                shader.setMat4("projection", projection);
+
+                // Render Square
+                gpuProfiler.push("Square");
+                // Position the square
+                glm::mat4 squareModel = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -3.0f));
+                if (squareVirtualTexture) {
+                    // Low-resolution pass reporting the pages in view, then the
+                    // square itself from whatever is resident
+                    vtFeedbackShader->use();
+                    vtFeedbackShader->setMat4("view", view);
+                    vtFeedbackShader->setMat4("projection", projection);
+                    vtFeedbackShader->setMat4("model", squareModel * squareQuantization.dequantizeMatrix());
+                    squareVirtualTexture->beginFeedback(vtFeedbackShader->ID);
+                    squareVAO.bind();
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    countDraw(2);
+                    squareVirtualTexture->endFeedback();
+                    squareVirtualTexture->update();
+
+                    vtShader->use();
+                    vtShader->setMat4("view", view);
+                    vtShader->setMat4("projection", projection);
+                    vtShader->setMat4("model", squareModel * squareQuantization.dequantizeMatrix());
+                    squareVirtualTexture->bind(vtShader->ID);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    countDraw(2);
+                    shader.use();
+                } else {
+                    shader.setMat4("model", squareModel * squareQuantization.dequantizeMatrix());
+                    shader.setInt("texture0", 0);
+                    if (squareTexture) {
+                        squareTexture->bind(0);
+                    }
+                    squareVAO.bind();
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                    countDraw(2);
+                }
+                gpuProfiler.pop();
+
+                // Render Mesh
+                if (mesh && mesh->ready()) {
+                    GpuProfileScope scope(gpuProfiler, "Mesh");
+                    PROFILE_SCOPE("Mesh");
+                    shader.setMat4("model", mesh->mesh->positionTransform());
+                    LodSelector lodSelector(projection, float(outputHeight));
+                    mesh->mesh->draw(lodSelector.select(*mesh->mesh, view, meshLod));
+                }
+
+                // Render the GPU-driven grid, unless it was deferred shaded
+                if (gpuScene && !deferredGrid) {
+                    GpuProfileScope scope(gpuProfiler, "Grid");
+                    PROFILE_SCOPE("Grid");
+                    prepareGrid();
+                    GpuProfileScope drawScope(gpuProfiler, "Draw");
+                    PROFILE_SCOPE("Draw");
+                    useGridShader(*indirectShader);
+                    indirectShader->setInt("clusteredLighting", 1);
+                    indirectShader->setVec3("cameraPosition", cameraPos);
+                    clusteredLights->bind(*indirectShader, 0, glm::vec2(outputWidth, outputHeight));
+                    gpuScene->draw();
+                }
+
+                // Render atlas squares
+                if (atlasShader) {
+                    GpuProfileScope scope(gpuProfiler, "Atlas");
+                    PROFILE_SCOPE("Atlas");
+                    StreamAllocation instances =
+                        streamBuffer.allocate(atlasInstances.size(), atlasInstanceLayout.stride());
+                    // Empty when this frame's part of the ring is full; the row
+                    // then skips a frame
+                    if (instances) {
+                        uint8_t* instance = static_cast<uint8_t*>(instances.data);
+                        std::memcpy(instance, atlasInstances.data(), atlasInstances.size());
+                        for (size_t i = 0; i < atlasOffsets.size(); ++i, instance += atlasInstanceLayout.stride()) {
+                            glm::vec4 offset = atlasOffsets[i];
+                            offset.y += 0.1f * std::sin(float(glfwGetTime()) * 2.0f + float(i));
+                            atlasInstanceLayout.write(instance, 2, offset);
+                        }
+                        streamBuffer.flush();
+                        atlasVAO.setVertexBuffer(streamBuffer.ID, 1, instances.offset);
+
+                        atlasShader->use();
+                        atlasShader->setMat4("view", view);
+                        atlasShader->setMat4("projection", projection);
+                        atlasShader->setMat4("model", squareModel * squareQuantization.dequantizeMatrix());
+                        atlasShader->setInt("atlas", 0);
+                        atlasTexture->bind(0);
+                        atlasVAO.bind();
+                        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, atlasInstanceCount);
+                        countDraw(2 * atlasInstanceCount);
+                    }
+                }
+            })
+                .color(sceneColor, deferredGrid ? RenderGraphLoad::Load : RenderGraphLoad::Clear, glm::vec4(0.5f))
+                .depth(sceneDepth, deferredGrid ? RenderGraphLoad::Load : RenderGraphLoad::Clear);
+
+            // Copy the scene to the window or offscreen target; nothing reads
+            // its targets afterwards, so they are dropped rather than stored
+            renderGraph.addPass("Present", [&](RenderGraph& graph) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.framebuffer({sceneColor}));
+                glBlitFramebuffer(0, 0, outputWidth, outputHeight, 0, 0, outputWidth, outputHeight, GL_COLOR_BUFFER_BIT,
+                                  GL_NEAREST);
+                countStateChange();
+            })
+                .read(sceneColor)
+                .color(output, RenderGraphLoad::DontCare);
+
+            if (statsOverlay.visible()) {
+                renderGraph.addPass("Overlay", [&](RenderGraph&) {
+                    statsOverlay.draw(streamBuffer, uint32_t(outputWidth), uint32_t(outputHeight));
+                }).color(output);
+            }
+
+            // Queue this frame's readback and hand over any earlier ones that
+            // have landed, without waiting for either
+            if (frameCapture) {
+                renderGraph.addPass("Readback", [&](RenderGraph& graph) {
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.framebuffer({output}));
+                    countStateChange();
+                    frameCapture->capture();
+                    frameCapture->poll();
+                    if (offscreenFrameLimit && frameCapture->captured() >= offscreenFrameLimit) {
+                        glfwSetWindowShouldClose(window, true);
+                    }
+                })
+                    .read(output)
+                    .sideEffect();
+            }
+            renderGraph.execute();
+            gpuProfiler.pop();
+            gpuProfiler.endFrame();
+
+            checkGlErrors("frame");
+            if (!offscreen) {
+                PROFILE_SCOPE("Swap");
+                glfwSwapBuffers(window);
+            }
+            glfwPollEvents();
+        }
+
+        if (frameCapture) {
+            frameCapture->flush();
+            std::cout << "Captured " << frameCapture->captured() << " frames offscreen, " << frameCapture->stalls()
+                      << " readback stalls" << std::endl;
+        }
     }
 
     glfwTerminate();
@@ -0,0 +1,390 @@
+#include "BlockCompression.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr int BLOCK_PIXELS = 16;
+
+// BC7 4-bit index interpolation weights, in 64ths
+const int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Dominant direction of the points around their mean, by power iteration
+// on the covariance matrix. Falls back to the diagonal for flat blocks.
+glm::vec4 principalAxis(const glm::vec4* points, int count, const glm::vec4& mean) {
+    glm::mat4 covariance(0.0f);
+    for (int i = 0; i < count; ++i) {
+        glm::vec4 d = points[i] - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+    glm::vec4 axis(1.0f, 1.0f, 1.0f, 1.0f);
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        glm::vec4 next = covariance * axis;
+        float length = glm::length(next);
+        if (length < 1e-6f) {
+            break;
+        }
+        axis = next / length;
+    }
+    return axis;
+}
+
+// Endpoints at the extremes of the points' projection onto the axis.
+void axisEndpoints(const glm::vec4* points, int count, glm::vec4& e0, glm::vec4& e1) {
+    glm::vec4 mean(0.0f);
+    for (int i = 0; i < count; ++i) {
+        mean += points[i];
+    }
+    mean /= float(count);
+    glm::vec4 axis = principalAxis(points, count, mean);
+    float lo = std::numeric_limits<float>::max(), hi = -lo;
+    for (int i = 0; i < count; ++i) {
+        float t = glm::dot(points[i] - mean, axis);
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    e0 = glm::clamp(mean + axis * lo, 0.0f, 255.0f);
+    e1 = glm::clamp(mean + axis * hi, 0.0f, 255.0f);
+}
+
+// Least-squares endpoints for points interpolated at weights t in [0, 1].
+// Returns false when all weights are equal and the system is singular.
+bool refineEndpoints(const glm::vec4* points, const float* weights, int count, glm::vec4& e0, glm::vec4& e1) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    glm::vec4 ax(0.0f), bx(0.0f);
+    for (int i = 0; i < count; ++i) {
+        float b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * points[i];
+        bx += b * points[i];
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) {
+        return false;
+    }
+    e0 = glm::clamp((ax * bb - bx * ab) / det, 0.0f, 255.0f);
+    e1 = glm::clamp((bx * aa - ax * ab) / det, 0.0f, 255.0f);
+    return true;
+}
+
+uint16_t packRgb565(const glm::vec4& c) {
+    uint32_t r = uint32_t(std::lround(c.r * 31.0f / 255.0f));
+    uint32_t g = uint32_t(std::lround(c.g * 63.0f / 255.0f));
+    uint32_t b = uint32_t(std::lround(c.b * 31.0f / 255.0f));
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+glm::vec4 unpackRgb565(uint16_t c) {
+    uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    return glm::vec4(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)), 255.0f);
+}
+
+float distanceRgb(const glm::vec4& a, const glm::vec4& b) {
+    glm::vec3 d = glm::vec3(a) - glm::vec3(b);
+    return glm::dot(d, d);
+}
+
+// Picks the nearest palette entry per pixel for a BC1 color block and
+// returns the total squared error. Transparent pixels always take index 3.
+float bc1Indices(const glm::vec4* colors, const bool* transparent, uint16_t c0, uint16_t c1, bool threeColor,
+                 uint8_t* indices) {
+    glm::vec4 palette[4];
+    palette[0] = unpackRgb565(c0);
+    palette[1] = unpackRgb565(c1);
+    if (threeColor) {
+        palette[2] = (palette[0] + palette[1]) * 0.5f;
+    } else {
+        palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+        palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+    }
+    int entries = threeColor ? 3 : 4;
+    float error = 0.0f;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        if (transparent[i]) {
+            indices[i] = 3;
+            continue;
+        }
+        float best = std::numeric_limits<float>::max();
+        for (int k = 0; k < entries; ++k) {
+            float d = distanceRgb(colors[i], palette[k]);
+            if (d < best) {
+                best = d;
+                indices[i] = uint8_t(k);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+void encodeColorBlock(const uint8_t* pixels, uint8_t* out, bool allowTransparent) {
+    glm::vec4 colors[BLOCK_PIXELS];
+    glm::vec4 opaque[BLOCK_PIXELS];
+    bool transparent[BLOCK_PIXELS];
+    int opaqueCount = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        colors[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], 0.0f);
+        transparent[i] = allowTransparent && pixels[i * 4 + 3] < 128;
+        if (!transparent[i]) {
+            opaque[opaqueCount++] = colors[i];
+        }
+    }
+    bool threeColor = opaqueCount < BLOCK_PIXELS;
+
+    uint16_t c0 = 0, c1 = 0;
+    uint8_t indices[BLOCK_PIXELS];
+    if (opaqueCount == 0) {
+        std::fill(indices, indices + BLOCK_PIXELS, uint8_t(3));
+    } else {
+        glm::vec4 e0, e1;
+        axisEndpoints(opaque, opaqueCount, e0, e1);
+        float bestError = std::numeric_limits<float>::max();
+        for (int iteration = 0; iteration < 3; ++iteration) {
+            uint16_t q0 = packRgb565(e0), q1 = packRgb565(e1);
+            // 4-color mode needs c0 > c1 and 3-color mode c0 <= c1
+            if (threeColor ? q0 > q1 : q0 < q1) {
+                std::swap(q0, q1);
+            }
+            uint8_t candidate[BLOCK_PIXELS];
+            float error = bc1Indices(colors, transparent, q0, q1, threeColor || q0 == q1, candidate);
+            if (error < bestError) {
+                bestError = error;
+                c0 = q0;
+                c1 = q1;
+                std::memcpy(indices, candidate, sizeof(indices));
+            }
+            if (error == 0.0f) {
+                break;
+            }
+
+            static const float WEIGHTS4[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+            static const float WEIGHTS3[3] = {0.0f, 1.0f, 0.5f};
+            float weights[BLOCK_PIXELS];
+            int n = 0;
+            for (int i = 0; i < BLOCK_PIXELS; ++i) {
+                if (!transparent[i]) {
+                    opaque[n] = colors[i];
+                    weights[n++] = (threeColor || q0 == q1 ? WEIGHTS3 : WEIGHTS4)[candidate[i]];
+                }
+            }
+            if (!refineEndpoints(opaque, weights, n, e0, e1)) {
+                break;
+            }
+        }
+    }
+
+    out[0] = uint8_t(c0);
+    out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);
+    out[3] = uint8_t(c1 >> 8);
+    uint32_t bits = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        bits |= uint32_t(indices[i]) << (i * 2);
+    }
+    std::memcpy(out + 4, &bits, 4);
+}
+
+// Single-channel block (BC4) in the 8-value mode.
+void encodeChannelBlock(const uint8_t* pixels, int channel, uint8_t* out) {
+    int lo = 255, hi = 0;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        lo = std::min(lo, int(pixels[i * 4 + channel]));
+        hi = std::max(hi, int(pixels[i * 4 + channel]));
+    }
+    out[0] = uint8_t(hi);
+    out[1] = uint8_t(lo);
+    int palette[8] = {hi, lo};
+    for (int k = 2; k < 8; ++k) {
+        palette[k] = ((8 - k) * hi + (k - 1) * lo) / 7;
+    }
+
+    uint64_t bits = 0;
+    if (hi != lo) {
+        for (int i = 0; i < BLOCK_PIXELS; ++i) {
+            int value = pixels[i * 4 + channel];
+            int best = 0;
+            for (int k = 1; k < 8; ++k) {
+                if (std::abs(palette[k] - value) < std::abs(palette[best] - value)) {
+                    best = k;
+                }
+            }
+            bits |= uint64_t(best) << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = uint8_t(bits >> (i * 8));
+    }
+}
+
+// Quantizes an 8-bit endpoint to 7 bits plus a p-bit shared by its
+// channels, picking the p-bit with the lower error.
+void quantizeBC7Endpoint(const glm::vec4& endpoint, uint8_t* q7, uint8_t& pBit) {
+    float bestError = std::numeric_limits<float>::max();
+    for (int p = 0; p < 2; ++p) {
+        uint8_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            int q = int(std::lround((endpoint[c] - p) * 0.5f));
+            q = std::min(std::max(q, 0), 127);
+            candidate[c] = uint8_t(q);
+            float d = float((q << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            std::memcpy(q7, candidate, 4);
+            pBit = uint8_t(p);
+        }
+    }
+}
+
+float bc7Indices(const glm::vec4* colors, const uint8_t (*q7)[4], const uint8_t* pBits, uint8_t* indices) {
+    int endpoints[2][4];
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 4; ++c) {
+            endpoints[e][c] = (q7[e][c] << 1) | pBits[e];
+        }
+    }
+    glm::vec4 palette[16];
+    for (int k = 0; k < 16; ++k) {
+        for (int c = 0; c < 4; ++c) {
+            palette[k][c] = float(((64 - BC7_WEIGHTS4[k]) * endpoints[0][c] + BC7_WEIGHTS4[k] * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    float error = 0.0f;
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        float best = std::numeric_limits<float>::max();
+        for (int k = 0; k < 16; ++k) {
+            glm::vec4 d = colors[i] - palette[k];
+            float e = glm::dot(d, d);
+            if (e < best) {
+                best = e;
+                indices[i] = uint8_t(k);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out(out) { std::memset(out, 0, 16); }
+
+    void write(uint32_t value, int count) {
+        for (int i = 0; i < count; ++i, ++pos) {
+            out[pos >> 3] |= uint8_t(((value >> i) & 1) << (pos & 7));
+        }
+    }
+
+private:
+    uint8_t* out;
+    int pos = 0;
+};
+
+} // namespace
+
+void encodeBC1(const uint8_t* pixels, uint8_t* out) {
+    encodeColorBlock(pixels, out, true);
+}
+
+void encodeBC3(const uint8_t* pixels, uint8_t* out) {
+    encodeChannelBlock(pixels, 3, out);
+    encodeColorBlock(pixels, out + 8, false);
+}
+
+void encodeBC5(const uint8_t* pixels, uint8_t* out) {
+    encodeChannelBlock(pixels, 0, out);
+    encodeChannelBlock(pixels, 1, out + 8);
+}
+
+void encodeBC7(const uint8_t* pixels, uint8_t* out) {
+    glm::vec4 colors[BLOCK_PIXELS];
+    for (int i = 0; i < BLOCK_PIXELS; ++i) {
+        colors[i] = glm::vec4(pixels[i * 4], pixels[i * 4 + 1], pixels[i * 4 + 2], pixels[i * 4 + 3]);
+    }
+    glm::vec4 e0, e1;
+    axisEndpoints(colors, BLOCK_PIXELS, e0, e1);
+
+    uint8_t q7[2][4], pBits[2];
+    uint8_t indices[BLOCK_PIXELS];
+    float bestError = std::numeric_limits<float>::max();
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        uint8_t candidateQ[2][4], candidateP[2], candidate[BLOCK_PIXELS];
+        quantizeBC7Endpoint(e0, candidateQ[0], candidateP[0]);
+        quantizeBC7Endpoint(e1, candidateQ[1], candidateP[1]);
+        float error = bc7Indices(colors, candidateQ, candidateP, candidate);
+        if (error < bestError) {
+            bestError = error;
+            std::memcpy(q7, candidateQ, sizeof(q7));
+            std::memcpy(pBits, candidateP, sizeof(pBits));
+            std::memcpy(indices, candidate, sizeof(indices));
+        }
+        if (error == 0.0f) {
+            break;
+        }
+        float weights[BLOCK_PIXELS];
+        for (int i = 0; i < BLOCK_PIXELS; ++i) {
+            weights[i] = BC7_WEIGHTS4[candidate[i]] / 64.0f;
+        }
+        if (!refineEndpoints(colors, weights, BLOCK_PIXELS, e0, e1)) {
+            break;
+        }
+    }
+
+    // The anchor index is stored without its top bit, so it must be < 8
+    if (indices[0] & 8) {
+        std::swap(q7[0], q7[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint8_t& index : indices) {
+            index = uint8_t(15 - index);
+        }
+    }
+
+    BitWriter writer(out);
+    writer.write(1u << 6, 7);      // Mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(q7[0][c], 7);
+        writer.write(q7[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < BLOCK_PIXELS; ++i) {
+        writer.write(indices[i], 4);
+    }
+}
+
+std::vector<uint8_t> compressImage(const Image& image, BlockFormat format, JobSystem& jobs) {
+    uint32_t blocksX = (image.width + 3) / 4;
+    uint32_t blocksY = (image.height + 3) / 4;
+    uint32_t blockBytes = blockFormatInfo(format).blockBytes;
+    std::vector<uint8_t> out(size_t(blocksX) * blocksY * blockBytes);
+    void (*encode)(const uint8_t*, uint8_t*) = format == BlockFormat::BC1 ? encodeBC1
+                                             : format == BlockFormat::BC3 ? encodeBC3
+                                             : format == BlockFormat::BC5 ? encodeBC5 : encodeBC7;
+
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        jobs.submit([&, by] {
+            uint8_t block[BLOCK_PIXELS * 4];
+            for (uint32_t bx = 0; bx < blocksX; ++bx) {
+                for (uint32_t y = 0; y < 4; ++y) {
+                    uint32_t sy = std::min(by * 4 + y, image.height - 1);
+                    for (uint32_t x = 0; x < 4; ++x) {
+                        uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+                        std::memcpy(&block[(y * 4 + x) * 4], &image.pixels[(size_t(sy) * image.width + sx) * 4], 4);
+                    }
+                }
+                encode(block, &out[(size_t(by) * blocksX + bx) * blockBytes]);
+            }
+        });
+    }
+    jobs.wait();
+    return out;
+}
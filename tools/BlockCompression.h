@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Image.h"
+#include "JobSystem.h"
+#include "TextureFormat.h"
+
+#include <cstdint>
+#include <vector>
+
+// Block encoders used by the texture cooker. Each takes one 4x4 block of
+// RGBA8 pixels in row order and writes blockFormatInfo(format).blockBytes.
+//   BC1  principal-axis endpoints refined by least squares; blocks with
+//        alpha below 128 use the 3-color mode with transparent black
+//   BC3  BC1 color plus a BC4 alpha block
+//   BC5  BC4 blocks for red and green
+//   BC7  mode 6 only: one RGBA subset, 7-bit endpoints with p-bits and
+//        4-bit indices. Not as good as a full mode search, but far better
+//        than BC3 on gradients and much faster to encode.
+void encodeBC1(const uint8_t* pixels, uint8_t* out);
+void encodeBC3(const uint8_t* pixels, uint8_t* out);
+void encodeBC5(const uint8_t* pixels, uint8_t* out);
+void encodeBC7(const uint8_t* pixels, uint8_t* out);
+
+// Compresses one image level, spreading rows of blocks over the job
+// system. Edge blocks of sizes that aren't a multiple of 4 repeat the last
+// row and column.
+std::vector<uint8_t> compressImage(const Image& image, BlockFormat format, JobSystem& jobs);
@@ -0,0 +1,245 @@
+#include "Json.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+class JsonValue::Parser {
+public:
+    explicit Parser(const std::string& text) : text(text) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (pos != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 256;
+
+    const std::string& text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos) + ": " + what);
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    bool consume(const char* literal) {
+        size_t i = 0;
+        while (literal[i] && pos + i < text.size() && text[pos + i] == literal[i]) {
+            ++i;
+        }
+        if (literal[i]) {
+            return false;
+        }
+        pos += i;
+        return true;
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > MAX_DEPTH) {
+            fail("nesting too deep");
+        }
+        skipWhitespace();
+        if (pos >= text.size()) {
+            fail("unexpected end of input");
+        }
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            value.kind = Type::Object;
+            ++pos;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                ++pos;
+                return value;
+            }
+            while (true) {
+                skipWhitespace();
+                if (pos >= text.size() || text[pos] != '"') {
+                    fail("expected object key");
+                }
+                value.keys.push_back(parseString());
+                skipWhitespace();
+                if (pos >= text.size() || text[pos] != ':') {
+                    fail("expected ':'");
+                }
+                ++pos;
+                value.items.push_back(parseValue(depth + 1));
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    ++pos;
+                } else if (pos < text.size() && text[pos] == '}') {
+                    ++pos;
+                    return value;
+                } else {
+                    fail("expected ',' or '}'");
+                }
+            }
+        }
+        if (c == '[') {
+            value.kind = Type::Array;
+            ++pos;
+            skipWhitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                ++pos;
+                return value;
+            }
+            while (true) {
+                value.items.push_back(parseValue(depth + 1));
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    ++pos;
+                } else if (pos < text.size() && text[pos] == ']') {
+                    ++pos;
+                    return value;
+                } else {
+                    fail("expected ',' or ']'");
+                }
+            }
+        }
+        if (c == '"') {
+            value.kind = Type::String;
+            value.stringValue = parseString();
+            return value;
+        }
+        if (consume("true")) {
+            value.kind = Type::Bool;
+            value.boolValue = true;
+            return value;
+        }
+        if (consume("false")) {
+            value.kind = Type::Bool;
+            return value;
+        }
+        if (consume("null")) {
+            return value;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            value.kind = Type::Number;
+            value.numberValue = std::strtod(start, &end);
+            if (end == start) {
+                fail("malformed number");
+            }
+            pos += static_cast<size_t>(end - start);
+            return value;
+        }
+        fail("unexpected character");
+    }
+
+    unsigned parseHex4() {
+        if (pos + 4 > text.size()) {
+            fail("truncated unicode escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char h = text[pos++];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= unsigned(h - '0');
+            else if (h >= 'a' && h <= 'f') code |= unsigned(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') code |= unsigned(h - 'A' + 10);
+            else fail("invalid unicode escape");
+        }
+        return code;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += char(code);
+        } else if (code < 0x800) {
+            out += char(0xC0 | (code >> 6));
+            out += char(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += char(0xE0 | (code >> 12));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        } else {
+            out += char(0xF0 | (code >> 18));
+            out += char(0x80 | ((code >> 12) & 0x3F));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string parseString() {
+        ++pos; // opening quote
+        std::string out;
+        while (true) {
+            if (pos >= text.size()) {
+                fail("unterminated string");
+            }
+            char c = text[pos++];
+            if (c == '"') {
+                return out;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                fail("unterminated escape");
+            }
+            char e = text[pos++];
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned code = parseHex4();
+                if (code >= 0xD800 && code <= 0xDBFF && consume("\\u")) {
+                    unsigned low = parseHex4();
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+                break;
+            }
+            default:
+                fail("invalid escape");
+            }
+        }
+    }
+};
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return Parser(text).parseDocument();
+}
+
+bool JsonValue::has(const std::string& key) const {
+    for (const std::string& k : keys) {
+        if (k == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    static const JsonValue null;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) {
+            return items[i];
+        }
+    }
+    return null;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    static const JsonValue null;
+    return kind == Type::Array && index < items.size() ? items[index] : null;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Minimal JSON DOM, enough for reading glTF documents in the offline tools.
+// Lookups of missing keys or indices return a shared null value instead of
+// throwing, so optional glTF properties can be probed without ceremony.
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    static JsonValue parse(const std::string& text);
+
+    Type type() const { return kind; }
+    bool isNull() const { return kind == Type::Null; }
+    bool isNumber() const { return kind == Type::Number; }
+    bool isString() const { return kind == Type::String; }
+    bool isArray() const { return kind == Type::Array; }
+    bool isObject() const { return kind == Type::Object; }
+
+    bool has(const std::string& key) const;
+    const JsonValue& operator[](const std::string& key) const;
+    const JsonValue& operator[](size_t index) const;
+    size_t size() const { return items.size(); }
+
+    double number(double fallback = 0.0) const { return kind == Type::Number ? numberValue : fallback; }
+    int integer(int fallback = 0) const { return kind == Type::Number ? static_cast<int>(numberValue) : fallback; }
+    bool boolean(bool fallback = false) const { return kind == Type::Bool ? boolValue : fallback; }
+    const std::string& string() const { return stringValue; }
+
+private:
+    class Parser;
+
+    Type kind = Type::Null;
+    bool boolValue = false;
+    double numberValue = 0.0;
+    std::string stringValue;
+    std::vector<std::string> keys;      // Object member names, parallel to items
+    std::vector<JsonValue> items;       // Array elements or object member values
+};
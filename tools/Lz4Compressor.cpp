@@ -0,0 +1,91 @@
+#include "Lz4Compressor.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+// Format rules: the last 5 bytes are always literals, and the last match
+// starts at least 12 bytes before the end
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_LIMIT = 12;
+constexpr int HASH_BITS = 16;
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+uint32_t hash4(const uint8_t* p) {
+    return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void writeLength(std::vector<uint8_t>& out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(uint8_t(length));
+}
+
+void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount,
+                   size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+    out.push_back(uint8_t((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+    if (literalCount >= 15) {
+        writeLength(out, literalCount);
+    }
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(uint8_t(offset));
+    out.push_back(uint8_t(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode);
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> lz4Compress(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 16);
+    size_t anchor = 0;
+    if (size > MATCH_LIMIT) {
+        // Positions are stored plus one, so 0 means empty
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+        size_t matchEnd = size - LAST_LITERALS;
+        size_t pos = 0;
+        while (pos + MATCH_LIMIT <= size) {
+            uint32_t h = hash4(data + pos);
+            size_t candidate = table[h];
+            table[h] = uint32_t(pos + 1);
+            if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+                read32(data + candidate - 1) != read32(data + pos)) {
+                ++pos;
+                continue;
+            }
+            size_t match = candidate - 1;
+            // Extend backwards over literals that match too
+            while (pos > anchor && match > 0 && data[pos - 1] == data[match - 1]) {
+                --pos;
+                --match;
+            }
+            size_t length = MIN_MATCH;
+            while (pos + length < matchEnd && data[pos + length] == data[match + length]) {
+                ++length;
+            }
+            writeSequence(out, data + anchor, pos - anchor, pos - match, length);
+            pos += length;
+            anchor = pos;
+            // Index a position inside the match so runs chain cheaply
+            if (pos + MATCH_LIMIT <= size) {
+                table[hash4(data + pos - 2)] = uint32_t(pos - 2 + 1);
+            }
+        }
+    }
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
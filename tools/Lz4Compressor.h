@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes data as one raw LZ4 block for lz4Decompress (src/Lz4.h). Greedy
+// matching through a hash table of the last position of every 4-byte
+// sequence: close to the reference encoder's fast mode in both speed and
+// ratio, which is all the asset packer needs.
+std::vector<uint8_t> lz4Compress(const uint8_t* data, size_t size);
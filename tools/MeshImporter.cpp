@@ -0,0 +1,555 @@
+#include "MeshImporter.h"
+#include "Json.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+std::string readBinaryFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to read file: " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+std::string lowercaseExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    return ext;
+}
+
+// ---------------------------------------------------------------------------
+// OBJ
+
+// Resolves a 1-based (or negative, relative) OBJ index against a list size.
+int resolveObjIndex(long index, size_t count) {
+    long resolved = index > 0 ? index - 1 : long(count) + index;
+    if (index == 0 || resolved < 0 || size_t(resolved) >= count) {
+        throw std::runtime_error("OBJ face references a missing element");
+    }
+    return int(resolved);
+}
+
+} // namespace
+
+ImportedMesh importObj(const std::string& path) {
+    std::string text = readBinaryFile(path);
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    ImportedMesh mesh;
+
+    struct Corner {
+        int position;
+        int uv;
+        int normal;
+    };
+    std::vector<Corner> polygon;
+
+    const char* cursor = text.c_str();
+    const char* end = cursor + text.size();
+    while (cursor < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', size_t(end - cursor)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        const char* p = cursor;
+        cursor = lineEnd + 1;
+        while (p < lineEnd && (*p == ' ' || *p == '\t')) {
+            ++p;
+        }
+
+        char* next = nullptr;
+        if (p[0] == 'v' && p[1] == ' ') {
+            glm::vec3 v;
+            v.x = std::strtof(p + 2, &next);
+            v.y = std::strtof(next, &next);
+            v.z = std::strtof(next, &next);
+            positions.push_back(v);
+        } else if (p[0] == 'v' && p[1] == 't') {
+            glm::vec2 t;
+            t.x = std::strtof(p + 2, &next);
+            t.y = std::strtof(next, &next);
+            uvs.push_back(t);
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            glm::vec3 n;
+            n.x = std::strtof(p + 2, &next);
+            n.y = std::strtof(next, &next);
+            n.z = std::strtof(next, &next);
+            normals.push_back(n);
+        } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            polygon.clear();
+            const char* q = p + 2;
+            while (q < lineEnd) {
+                while (q < lineEnd && (*q == ' ' || *q == '\t' || *q == '\r')) {
+                    ++q;
+                }
+                if (q >= lineEnd) {
+                    break;
+                }
+                Corner corner{-1, -1, -1};
+                corner.position = resolveObjIndex(std::strtol(q, &next, 10), positions.size());
+                q = next;
+                if (*q == '/') {
+                    ++q;
+                    if (*q != '/') {
+                        corner.uv = resolveObjIndex(std::strtol(q, &next, 10), uvs.size());
+                        q = next;
+                    }
+                    if (*q == '/') {
+                        ++q;
+                        corner.normal = resolveObjIndex(std::strtol(q, &next, 10), normals.size());
+                        q = next;
+                    }
+                }
+                polygon.push_back(corner);
+            }
+
+            // Fan-triangulate; OBJ polygons are expected to be convex.
+            for (size_t i = 0; i < polygon.size(); ++i) {
+                const Corner& c = polygon[i];
+                ImportedVertex vertex;
+                vertex.position = positions[c.position];
+                vertex.uv = c.uv >= 0 ? uvs[c.uv] : glm::vec2(0.0f);
+                vertex.normal = c.normal >= 0 ? normals[c.normal] : glm::vec3(0.0f);
+                vertex.tangent = glm::vec4(0.0f);
+                mesh.hasUVs |= c.uv >= 0;
+                mesh.hasNormals |= c.normal >= 0;
+                mesh.vertices.push_back(vertex);
+            }
+            uint32_t first = uint32_t(mesh.vertices.size() - polygon.size());
+            for (size_t i = 2; i < polygon.size(); ++i) {
+                mesh.indices.push_back(first);
+                mesh.indices.push_back(first + uint32_t(i) - 1);
+                mesh.indices.push_back(first + uint32_t(i));
+            }
+        }
+    }
+
+    if (mesh.indices.empty()) {
+        throw std::runtime_error("OBJ file contains no faces: " + path);
+    }
+    return mesh;
+}
+
+// ---------------------------------------------------------------------------
+// glTF 2.0
+
+namespace {
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+std::string decodeBase64(const std::string& text, size_t start) {
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+' || c == '-') return 62;
+        if (c == '/' || c == '_') return 63;
+        return -1;
+    };
+    std::string out;
+    out.reserve((text.size() - start) * 3 / 4);
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (size_t i = start; i < text.size(); ++i) {
+        int v = value(text[i]);
+        if (v < 0) {
+            continue; // padding or whitespace
+        }
+        accumulator = (accumulator << 6) | uint32_t(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += char((accumulator >> bits) & 0xFF);
+        }
+    }
+    return out;
+}
+
+struct GltfDocument {
+    JsonValue json;
+    std::vector<std::string> buffers;
+};
+
+GltfDocument loadGltfDocument(const std::string& path) {
+    std::string file = readBinaryFile(path);
+    GltfDocument doc;
+    std::string glbBinary;
+
+    uint32_t magic = 0;
+    if (file.size() >= 12) {
+        std::memcpy(&magic, file.data(), 4);
+    }
+    if (magic == GLB_MAGIC) {
+        size_t offset = 12;
+        std::string jsonText;
+        while (offset + 8 <= file.size()) {
+            uint32_t chunkLength;
+            uint32_t chunkType;
+            std::memcpy(&chunkLength, file.data() + offset, 4);
+            std::memcpy(&chunkType, file.data() + offset + 4, 4);
+            offset += 8;
+            if (chunkLength > file.size() - offset) {
+                throw std::runtime_error("GLB chunk is truncated: " + path);
+            }
+            if (chunkType == GLB_CHUNK_JSON) {
+                jsonText.assign(file.data() + offset, chunkLength);
+            } else if (chunkType == GLB_CHUNK_BIN) {
+                glbBinary.assign(file.data() + offset, chunkLength);
+            }
+            offset += (chunkLength + 3) & ~3u;
+        }
+        doc.json = JsonValue::parse(jsonText);
+    } else {
+        doc.json = JsonValue::parse(file);
+    }
+
+    const JsonValue& buffers = doc.json["buffers"];
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const JsonValue& uri = buffers[i]["uri"];
+        if (!uri.isString()) {
+            doc.buffers.push_back(glbBinary);
+        } else if (uri.string().compare(0, 5, "data:") == 0) {
+            size_t comma = uri.string().find(',');
+            if (comma == std::string::npos) {
+                throw std::runtime_error("Malformed data URI in " + path);
+            }
+            doc.buffers.push_back(decodeBase64(uri.string(), comma + 1));
+        } else {
+            doc.buffers.push_back(readBinaryFile(directoryOf(path) + uri.string()));
+        }
+    }
+    return doc;
+}
+
+int componentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    throw std::runtime_error("Unsupported glTF accessor type " + type);
+}
+
+int componentSize(int componentType) {
+    switch (componentType) {
+    case 5120: case 5121: return 1;   // BYTE, UNSIGNED_BYTE
+    case 5122: case 5123: return 2;   // SHORT, UNSIGNED_SHORT
+    case 5125: case 5126: return 4;   // UNSIGNED_INT, FLOAT
+    default: throw std::runtime_error("Unsupported glTF component type");
+    }
+}
+
+double readComponent(const uint8_t* p, int componentType, bool normalized) {
+    switch (componentType) {
+    case 5120: { int8_t v; std::memcpy(&v, p, 1); return normalized ? std::max(v / 127.0, -1.0) : v; }
+    case 5121: return normalized ? p[0] / 255.0 : p[0];
+    case 5122: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0, -1.0) : v; }
+    case 5123: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? v / 65535.0 : v; }
+    case 5125: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+    default: { float v; std::memcpy(&v, p, 4); return v; }
+    }
+}
+
+// Reads an accessor into a tightly packed double array, width components per element.
+std::vector<double> readAccessor(const GltfDocument& doc, int accessorIndex, int& width) {
+    const JsonValue& accessor = doc.json["accessors"][size_t(accessorIndex)];
+    if (accessor.isNull()) {
+        throw std::runtime_error("glTF references a missing accessor");
+    }
+    width = componentCount(accessor["type"].string());
+    size_t count = size_t(accessor["count"].integer());
+    int componentType = accessor["componentType"].integer();
+    bool normalized = accessor["normalized"].boolean();
+    std::vector<double> values(count * width, 0.0);
+
+    if (accessor.has("sparse")) {
+        throw std::runtime_error("Sparse glTF accessors are not supported");
+    }
+    if (!accessor.has("bufferView")) {
+        return values; // All zeros per the specification
+    }
+
+    const JsonValue& view = doc.json["bufferViews"][size_t(accessor["bufferView"].integer())];
+    size_t bufferIndex = size_t(view["buffer"].integer());
+    if (bufferIndex >= doc.buffers.size()) {
+        throw std::runtime_error("glTF buffer view references a missing buffer");
+    }
+    const std::string& buffer = doc.buffers[bufferIndex];
+    size_t elementSize = size_t(componentSize(componentType)) * width;
+    size_t stride = view.has("byteStride") ? size_t(view["byteStride"].integer()) : elementSize;
+    size_t start = size_t(view["byteOffset"].integer()) + size_t(accessor["byteOffset"].integer());
+    if (count > 0 && (start + (count - 1) * stride + elementSize > buffer.size())) {
+        throw std::runtime_error("glTF accessor reads past the end of its buffer");
+    }
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(buffer.data()) + start;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < width; ++c) {
+            values[i * width + c] = readComponent(base + i * stride + c * componentSize(componentType),
+                                                  componentType, normalized);
+        }
+    }
+    return values;
+}
+
+glm::mat4 nodeTransform(const JsonValue& node) {
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        glm::mat4 m;
+        for (int i = 0; i < 16; ++i) {
+            glm::value_ptr(m)[i] = float(matrix[size_t(i)].number());
+        }
+        return m;
+    }
+    glm::vec3 t(0.0f);
+    glm::quat r(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 s(1.0f);
+    if (node["translation"].size() == 3) {
+        t = glm::vec3(node["translation"][0].number(), node["translation"][1].number(), node["translation"][2].number());
+    }
+    if (node["rotation"].size() == 4) {
+        r = glm::quat(float(node["rotation"][3].number()), float(node["rotation"][0].number()),
+                      float(node["rotation"][1].number()), float(node["rotation"][2].number()));
+    }
+    if (node["scale"].size() == 3) {
+        s = glm::vec3(node["scale"][0].number(), node["scale"][1].number(), node["scale"][2].number());
+    }
+    return glm::translate(glm::mat4(1.0f), t) * glm::mat4_cast(r) * glm::scale(glm::mat4(1.0f), s);
+}
+
+void appendGltfMesh(const GltfDocument& doc, int meshIndex, const glm::mat4& transform, ImportedMesh& out) {
+    const JsonValue& primitives = doc.json["meshes"][size_t(meshIndex)]["primitives"];
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    bool flipWinding = glm::determinant(glm::mat3(transform)) < 0.0f;
+
+    for (size_t p = 0; p < primitives.size(); ++p) {
+        const JsonValue& primitive = primitives[p];
+        if (primitive["mode"].integer(4) != 4) {
+            continue; // Only triangle lists are cooked
+        }
+        const JsonValue& attributes = primitive["attributes"];
+        if (!attributes.has("POSITION")) {
+            continue;
+        }
+
+        int width = 0;
+        std::vector<double> positions = readAccessor(doc, attributes["POSITION"].integer(), width);
+        size_t vertexCount = positions.size() / width;
+        std::vector<double> normals;
+        std::vector<double> uvs;
+        int normalWidth = 0;
+        int uvWidth = 0;
+        if (attributes.has("NORMAL")) {
+            normals = readAccessor(doc, attributes["NORMAL"].integer(), normalWidth);
+            out.hasNormals = true;
+        }
+        if (attributes.has("TEXCOORD_0")) {
+            uvs = readAccessor(doc, attributes["TEXCOORD_0"].integer(), uvWidth);
+            out.hasUVs = true;
+        }
+
+        uint32_t base = uint32_t(out.vertices.size());
+        for (size_t i = 0; i < vertexCount; ++i) {
+            ImportedVertex v;
+            glm::vec3 position(positions[i * width], positions[i * width + 1], positions[i * width + 2]);
+            v.position = glm::vec3(transform * glm::vec4(position, 1.0f));
+            v.normal = glm::vec3(0.0f);
+            v.tangent = glm::vec4(0.0f);
+            if (normalWidth == 3 && i * 3 + 2 < normals.size()) {
+                glm::vec3 n(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+                v.normal = glm::normalize(normalMatrix * n);
+            }
+            v.uv = glm::vec2(0.0f);
+            if (uvWidth == 2 && i * 2 + 1 < uvs.size()) {
+                // glTF puts the UV origin at the top left, GL at the bottom left.
+                v.uv = glm::vec2(uvs[i * 2], 1.0 - uvs[i * 2 + 1]);
+            }
+            out.vertices.push_back(v);
+        }
+
+        std::vector<uint32_t> triangle;
+        if (primitive.has("indices")) {
+            int indexWidth = 0;
+            std::vector<double> indices = readAccessor(doc, primitive["indices"].integer(), indexWidth);
+            for (double index : indices) {
+                if (index >= double(vertexCount)) {
+                    throw std::runtime_error("glTF index out of range");
+                }
+                triangle.push_back(uint32_t(index));
+            }
+        } else {
+            for (size_t i = 0; i < vertexCount; ++i) {
+                triangle.push_back(uint32_t(i));
+            }
+        }
+        for (size_t i = 0; i + 2 < triangle.size(); i += 3) {
+            out.indices.push_back(base + triangle[i]);
+            out.indices.push_back(base + triangle[flipWinding ? i + 2 : i + 1]);
+            out.indices.push_back(base + triangle[flipWinding ? i + 1 : i + 2]);
+        }
+    }
+}
+
+void visitGltfNode(const GltfDocument& doc, int nodeIndex, const glm::mat4& parent, ImportedMesh& out, int depth) {
+    const JsonValue& node = doc.json["nodes"][size_t(nodeIndex)];
+    if (node.isNull() || depth > 64) {
+        throw std::runtime_error("glTF node hierarchy is invalid");
+    }
+    glm::mat4 transform = parent * nodeTransform(node);
+    if (node.has("mesh")) {
+        appendGltfMesh(doc, node["mesh"].integer(), transform, out);
+    }
+    const JsonValue& children = node["children"];
+    for (size_t i = 0; i < children.size(); ++i) {
+        visitGltfNode(doc, children[i].integer(), transform, out, depth + 1);
+    }
+}
+
+} // namespace
+
+ImportedMesh importGltf(const std::string& path) {
+    GltfDocument doc = loadGltfDocument(path);
+    ImportedMesh mesh;
+
+    const JsonValue& scenes = doc.json["scenes"];
+    if (scenes.size() > 0) {
+        const JsonValue& scene = scenes[size_t(doc.json["scene"].integer(0))];
+        const JsonValue& roots = scene["nodes"];
+        for (size_t i = 0; i < roots.size(); ++i) {
+            visitGltfNode(doc, roots[i].integer(), glm::mat4(1.0f), mesh, 0);
+        }
+    } else {
+        // No scene graph: take every mesh untransformed.
+        for (size_t i = 0; i < doc.json["meshes"].size(); ++i) {
+            appendGltfMesh(doc, int(i), glm::mat4(1.0f), mesh);
+        }
+    }
+
+    if (mesh.indices.empty()) {
+        throw std::runtime_error("glTF file contains no triangle geometry: " + path);
+    }
+    return mesh;
+}
+
+ImportedMesh importMesh(const std::string& path) {
+    std::string ext = lowercaseExtension(path);
+    if (ext == "obj") {
+        return importObj(path);
+    }
+    if (ext == "gltf" || ext == "glb") {
+        return importGltf(path);
+    }
+    throw std::runtime_error("Unsupported mesh format: " + path);
+}
+
+// ---------------------------------------------------------------------------
+// Cleanup passes
+
+namespace {
+
+template <typename T>
+std::string bitKey(const T& value) {
+    return std::string(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+void weldVertices(ImportedMesh& mesh) {
+    std::unordered_map<std::string, uint32_t> unique;
+    unique.reserve(mesh.vertices.size());
+    std::vector<ImportedVertex> welded;
+    std::vector<uint32_t> remap(mesh.vertices.size());
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        auto inserted = unique.emplace(bitKey(mesh.vertices[i]), uint32_t(welded.size()));
+        if (inserted.second) {
+            welded.push_back(mesh.vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+    for (uint32_t& index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices.swap(welded);
+}
+
+void generateNormals(ImportedMesh& mesh) {
+    std::unordered_map<std::string, glm::vec3> accumulated;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const glm::vec3& a = mesh.vertices[mesh.indices[i]].position;
+        const glm::vec3& b = mesh.vertices[mesh.indices[i + 1]].position;
+        const glm::vec3& c = mesh.vertices[mesh.indices[i + 2]].position;
+        glm::vec3 faceNormal = glm::cross(b - a, c - a); // Length is twice the area
+        for (int k = 0; k < 3; ++k) {
+            accumulated[bitKey(mesh.vertices[mesh.indices[i + k]].position)] += faceNormal;
+        }
+    }
+    for (ImportedVertex& v : mesh.vertices) {
+        glm::vec3 n = accumulated[bitKey(v.position)];
+        float length = glm::length(n);
+        v.normal = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+    mesh.hasNormals = true;
+}
+
+void generateTangents(ImportedMesh& mesh) {
+    std::vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangents(mesh.vertices.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const ImportedVertex& a = mesh.vertices[mesh.indices[i]];
+        const ImportedVertex& b = mesh.vertices[mesh.indices[i + 1]];
+        const ImportedVertex& c = mesh.vertices[mesh.indices[i + 2]];
+        glm::vec3 e1 = b.position - a.position;
+        glm::vec3 e2 = c.position - a.position;
+        glm::vec2 d1 = b.uv - a.uv;
+        glm::vec2 d2 = c.uv - a.uv;
+        float det = d1.x * d2.y - d2.x * d1.y;
+        if (std::abs(det) < 1e-12f) {
+            continue; // Degenerate UV mapping
+        }
+        // Not normalized: larger triangles weigh more, as for normals.
+        float area = glm::length(glm::cross(e1, e2));
+        glm::vec3 t = glm::normalize((e1 * d2.y - e2 * d1.y) / det) * area;
+        glm::vec3 bt = glm::normalize((e2 * d1.x - e1 * d2.x) / det) * area;
+        for (int k = 0; k < 3; ++k) {
+            tangents[mesh.indices[i + k]] += t;
+            bitangents[mesh.indices[i + k]] += bt;
+        }
+    }
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        ImportedVertex& v = mesh.vertices[i];
+        // Gram-Schmidt against the normal; fall back to any perpendicular axis.
+        glm::vec3 t = tangents[i] - v.normal * glm::dot(v.normal, tangents[i]);
+        if (glm::length(t) < 1e-6f) {
+            glm::vec3 axis = std::abs(v.normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            t = glm::cross(v.normal, axis);
+        }
+        t = glm::normalize(t);
+        float handedness = glm::dot(glm::cross(v.normal, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+        v.tangent = glm::vec4(t, handedness);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Source geometry as read from an interchange format, before cooking.
+struct ImportedVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+    glm::vec4 tangent;      // xyz tangent, w bitangent sign
+};
+
+struct ImportedMesh {
+    std::vector<ImportedVertex> vertices;
+    std::vector<uint32_t> indices;      // Triangle list
+    bool hasNormals = false;
+    bool hasUVs = false;
+};
+
+// Loads an .obj, .gltf or .glb file, picking the importer by extension.
+// Throws std::runtime_error on malformed input.
+ImportedMesh importMesh(const std::string& path);
+
+ImportedMesh importObj(const std::string& path);
+ImportedMesh importGltf(const std::string& path);
+
+// Merges bit-identical vertices and rewrites the index buffer.
+void weldVertices(ImportedMesh& mesh);
+
+// Area-weighted smooth normals, shared across vertices at the same position.
+void generateNormals(ImportedMesh& mesh);
+
+// Per-vertex tangent frames from the UV layout, orthogonalized against the
+// normals. Requires normals and UVs.
+void generateTangents(ImportedMesh& mesh);
@@ -0,0 +1,275 @@
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// Vertex -> triangle adjacency in compressed row form.
+struct Adjacency {
+    std::vector<uint32_t> offsets;      // vertexCount + 1 entries
+    std::vector<uint32_t> triangles;
+};
+
+Adjacency buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount) {
+    Adjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacency.offsets[index + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        adjacency.triangles[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+    return adjacency;
+}
+
+// Cache model shared by Tipsify and the overdraw pass: a vertex is a hit
+// while fewer than cacheSize misses have happened since it was loaded.
+struct TimestampCache {
+    std::vector<uint32_t> loadedAt;
+    uint32_t timestamp;
+    unsigned size;
+
+    TimestampCache(size_t vertexCount, unsigned cacheSize)
+        : loadedAt(vertexCount, 0), timestamp(cacheSize + 1), size(cacheSize) {}
+
+    // Returns the number of misses caused by one triangle.
+    unsigned touch(const uint32_t* triangle) {
+        unsigned misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (timestamp - loadedAt[triangle[k]] > size) {
+                loadedAt[triangle[k]] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void flush() { timestamp += size + 1; }
+};
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    std::vector<uint32_t> fifo(cacheSize, ~0u);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t head = 0;
+    size_t misses = 0;
+
+    for (uint32_t index : indices) {
+        referenced[index] = true;
+        if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+            fifo[head] = index;
+            head = (head + 1) % cacheSize;
+            ++misses;
+        }
+    }
+
+    size_t uniqueVertices = size_t(std::count(referenced.begin(), referenced.end(), true));
+    VertexCacheStats stats;
+    stats.acmr = indices.empty() ? 0.0f : float(misses) / float(indices.size() / 3);
+    stats.atvr = uniqueVertices == 0 ? 0.0f : float(misses) / float(uniqueVertices);
+    return stats;
+}
+
+std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> clusters;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    Adjacency adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    uint32_t timestamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    // Pops the dead-end stack, then falls back to scanning input order.
+    auto skipDeadEnd = [&]() -> long {
+        while (!deadEnds.empty()) {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) {
+                return long(v);
+            }
+        }
+        while (cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                return long(cursor);
+            }
+            ++cursor;
+        }
+        return -1;
+    };
+
+    long fanning = skipDeadEnd();
+    clusters.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            uint32_t t = adjacency.triangles[a];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Prefer the candidate that will still be in cache after its
+        // remaining triangles are emitted, oldest first. One that would
+        // drop out has priority 0 and is never picked; the dead-end stack
+        // decides instead.
+        long next = -1;
+        uint32_t best = 0;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            uint32_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timestamp - cacheTime[v];
+            }
+            if (priority > best) {
+                best = priority;
+                next = long(v);
+            }
+        }
+        if (next < 0) {
+            next = skipDeadEnd();
+            if (next >= 0) {
+                clusters.push_back(uint32_t(output.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+    return clusters;
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                      const float* positions, size_t positionStride, size_t vertexCount,
+                      float threshold, unsigned cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    // Soft boundaries: cut a hard cluster wherever the running ACMR already
+    // beats the cluster's own ACMR scaled by the threshold.
+    std::vector<uint32_t> boundaries;
+    TimestampCache cache(vertexCount, cacheSize);
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        uint32_t start = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : uint32_t(triangleCount);
+
+        cache.flush();
+        unsigned clusterMisses = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            clusterMisses += cache.touch(&indices[t * 3]);
+        }
+        float clusterThreshold = threshold * float(clusterMisses) / float(end - start);
+
+        boundaries.push_back(start);
+        cache.flush();
+        unsigned runningMisses = 0;
+        unsigned runningTriangles = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            runningMisses += cache.touch(&indices[t * 3]);
+            runningTriangles++;
+            if (float(runningMisses) / float(runningTriangles) <= clusterThreshold && t + 1 < end) {
+                boundaries.push_back(t + 1);
+                cache.flush();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+
+    auto position = [&](uint32_t v) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Sort key: how far the cluster faces away from the mesh centroid.
+    glm::dvec3 meshCentroid(0.0);
+    double meshArea = 0.0;
+    std::vector<glm::vec3> clusterCentroids(boundaries.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(boundaries.size(), glm::vec3(0.0f));
+    for (size_t c = 0; c < boundaries.size(); ++c) {
+        uint32_t start = boundaries[c];
+        uint32_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : uint32_t(triangleCount);
+        float clusterArea = 0.0f;
+        for (uint32_t t = start; t < end; ++t) {
+            glm::vec3 a = position(indices[t * 3]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 d = position(indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (a + b + d) / 3.0f;
+            clusterCentroids[c] += centroid * area;
+            clusterNormals[c] += normal;
+            clusterArea += area;
+            meshCentroid += glm::dvec3(centroid) * double(area);
+            meshArea += area;
+        }
+        clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : position(indices[start * 3]);
+        float length = glm::length(clusterNormals[c]);
+        clusterNormals[c] = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+    }
+    glm::vec3 centroid = meshArea > 0.0 ? glm::vec3(meshCentroid / meshArea) : glm::vec3(0.0f);
+
+    std::vector<float> sortKeys(boundaries.size());
+    for (size_t c = 0; c < boundaries.size(); ++c) {
+        sortKeys[c] = glm::dot(clusterCentroids[c] - centroid, clusterNormals[c]);
+    }
+    std::vector<uint32_t> order(boundaries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (uint32_t c : order) {
+        uint32_t start = boundaries[c];
+        uint32_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : uint32_t(triangleCount);
+        output.insert(output.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+std::vector<uint32_t> optimizeVertexFetchRemap(std::vector<uint32_t>& indices, size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, ~0u);
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    return remap;
+}
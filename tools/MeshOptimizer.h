@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Index and vertex reordering passes run by the mesh cooker. All passes work
+// on triangle lists; positions are read through a byte stride so they can
+// operate on any interleaved vertex struct.
+
+constexpr unsigned MESH_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    float acmr;     // Average cache miss ratio: transformed vertices per triangle
+    float atvr;     // Average transform to vertex ratio: 1.0 is optimal
+};
+
+// Simulates a FIFO post-transform cache over the index buffer.
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                    unsigned cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007) triangle reordering for post-transform cache
+// locality. Returns the first triangle of every cluster that started at a
+// dead end; these are the hard boundaries used by optimizeOverdraw.
+std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                                          unsigned cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Splits the Tipsify clusters further where that costs at most `threshold`
+// times the cluster's cache efficiency, then sorts the clusters so outward
+// facing ones are drawn first and occlude the rest.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                      const float* positions, size_t positionStride, size_t vertexCount,
+                      float threshold = 1.05f, unsigned cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// Reorders vertices into first-use order so vertex fetch walks memory
+// linearly, dropping unreferenced vertices. Rewrites the indices and
+// returns the remap table (old index -> new index, ~0u for dropped ones).
+std::vector<uint32_t> optimizeVertexFetchRemap(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Applies a remap table from optimizeVertexFetchRemap to the vertices.
+template <typename Vertex>
+void remapVertices(std::vector<Vertex>& vertices, const std::vector<uint32_t>& remap) {
+    size_t used = 0;
+    for (uint32_t target : remap) {
+        used += target != ~0u;
+    }
+    std::vector<Vertex> reordered(used);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        if (remap[i] != ~0u) {
+            reordered[remap[i]] = vertices[i];
+        }
+    }
+    vertices.swap(reordered);
+}
+
+template <typename Vertex>
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    remapVertices(vertices, optimizeVertexFetchRemap(indices, vertices.size()));
+}
@@ -0,0 +1,259 @@
+#include "MeshSimplifier.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Symmetric 4x4 plane quadric plus the total area weight that built it.
+struct Quadric {
+    double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+    double ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+    double weight = 0;
+
+    static Quadric fromPlane(const glm::dvec3& n, double d, double w) {
+        Quadric q;
+        q.a2 = w * n.x * n.x; q.b2 = w * n.y * n.y; q.c2 = w * n.z * n.z; q.d2 = w * d * d;
+        q.ab = w * n.x * n.y; q.ac = w * n.x * n.z; q.ad = w * n.x * d;
+        q.bc = w * n.y * n.z; q.bd = w * n.y * d; q.cd = w * n.z * d;
+        q.weight = w;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2; b2 += o.b2; c2 += o.c2; d2 += o.d2;
+        ab += o.ab; ac += o.ac; ad += o.ad; bc += o.bc; bd += o.bd; cd += o.cd;
+        weight += o.weight;
+        return *this;
+    }
+
+    // Weighted squared distance of p to all accumulated planes.
+    double evaluate(const glm::dvec3& p) const {
+        return a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+               2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+               2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+    }
+};
+
+enum class VertexKind : uint8_t {
+    Interior,   // May collapse onto a neighbour
+    Border,     // On an open edge: may receive collapses, never moves
+    Locked,     // Attribute seam or non-manifold: untouched
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+} // namespace
+
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& indices, const float* positions,
+                                   size_t positionStride, size_t vertexCount, size_t targetIndexCount,
+                                   float targetError, float* resultError) {
+    auto position = [&](uint32_t v) {
+        const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+        return glm::dvec3(p[0], p[1], p[2]);
+    };
+
+    // Vertices that share a position but differ in attributes are wedges of
+    // one canonical vertex; collapses are decided in position space.
+    std::vector<bool> referenced(vertexCount, false);
+    for (uint32_t index : indices) {
+        referenced[index] = true;
+    }
+    std::vector<uint32_t> canonical(vertexCount);
+    std::vector<uint32_t> wedgeCount(vertexCount, 0);
+    {
+        std::unordered_map<std::string, uint32_t> byPosition;
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            canonical[v] = v;
+            if (referenced[v]) {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(positions) + v * positionStride;
+                auto inserted = byPosition.emplace(std::string(reinterpret_cast<const char*>(p), 3 * sizeof(float)), v);
+                canonical[v] = inserted.first->second;
+                wedgeCount[canonical[v]]++;
+            }
+        }
+    }
+
+    std::vector<uint32_t> result = indices;
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        glm::dvec3 p0 = position(result[i]);
+        glm::dvec3 p1 = position(result[i + 1]);
+        glm::dvec3 p2 = position(result[i + 2]);
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        if (area <= 0.0) {
+            continue;
+        }
+        normal /= area;
+        Quadric q = Quadric::fromPlane(normal, -glm::dot(normal, p0), area);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[canonical[result[i + k]]] += q;
+        }
+    }
+
+    double maxCost = double(targetError) * targetError;
+    double acceptedCost = 0.0;
+    std::vector<VertexKind> kind(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<bool> locked(vertexCount);
+    std::vector<Collapse> collapses;
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+
+    while (result.size() > targetIndexCount) {
+        // Classify canonical vertices from the current topology.
+        edgeUse.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t a = canonical[result[i + k]];
+                uint32_t b = canonical[result[i + (k + 1) % 3]];
+                edgeUse[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            kind[v] = wedgeCount[v] > 1 ? VertexKind::Locked : VertexKind::Interior;
+        }
+        for (const auto& edge : edgeUse) {
+            uint32_t a = uint32_t(edge.first >> 32);
+            uint32_t b = uint32_t(edge.first & 0xFFFFFFFFu);
+            VertexKind edgeKind = edge.second == 1 ? VertexKind::Border
+                                : edge.second == 2 ? VertexKind::Interior : VertexKind::Locked;
+            for (uint32_t v : {a, b}) {
+                if (edgeKind > kind[v]) {
+                    kind[v] = edgeKind;
+                }
+            }
+        }
+
+        // Canonical vertex -> triangle adjacency.
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result) {
+            adjacencyOffsets[canonical[index] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[fill[canonical[result[i]]]++] = uint32_t(i / 3);
+        }
+
+        // Rank every allowed directed edge collapse by its quadric error.
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t from = canonical[result[i + k]];
+                uint32_t to = canonical[result[i + (k + 1) % 3]];
+                for (int direction = 0; direction < 2; ++direction) {
+                    if (kind[from] == VertexKind::Interior && kind[to] != VertexKind::Locked && from != to) {
+                        Quadric q = quadrics[from];
+                        q += quadrics[to];
+                        double cost = q.weight > 0.0 ? std::max(q.evaluate(position(to)), 0.0) / q.weight : 0.0;
+                        if (cost <= maxCost) {
+                            collapses.push_back({from, to, cost});
+                        }
+                    }
+                    std::swap(from, to);
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(locked.begin(), locked.end(), false);
+        size_t liveTriangles = result.size() / 3;
+        size_t performed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (liveTriangles * 3 <= targetIndexCount) {
+                break;
+            }
+            if (locked[collapse.from] || locked[collapse.to]) {
+                continue;
+            }
+
+            // Reject collapses that fold a surviving triangle over.
+            bool flips = false;
+            glm::dvec3 target = position(collapse.to);
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; ++a) {
+                const uint32_t* tri = &result[adjacency[a] * 3];
+                glm::dvec3 p[3];
+                bool containsTarget = false;
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = position(tri[k]);
+                    containsTarget |= canonical[tri[k]] == collapse.to;
+                }
+                if (containsTarget) {
+                    continue;
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k) {
+                    if (canonical[tri[k]] == collapse.from) {
+                        p[k] = target;
+                    }
+                }
+                glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                flips = glm::dot(before, after) <= 0.0;
+            }
+            if (flips) {
+                continue;
+            }
+
+            // Interior vertices have a single wedge, so the canonical ids
+            // are also the vertex ids to rewrite.
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a) {
+                uint32_t* tri = &result[adjacency[a] * 3];
+                bool wasLive = canonical[tri[0]] != canonical[tri[1]] && canonical[tri[1]] != canonical[tri[2]] &&
+                               canonical[tri[0]] != canonical[tri[2]];
+                for (int k = 0; k < 3; ++k) {
+                    if (canonical[tri[k]] == collapse.from) {
+                        tri[k] = collapse.to;
+                    }
+                }
+                bool isLive = canonical[tri[0]] != canonical[tri[1]] && canonical[tri[1]] != canonical[tri[2]] &&
+                              canonical[tri[0]] != canonical[tri[2]];
+                if (wasLive && !isLive) {
+                    liveTriangles--;
+                }
+            }
+            quadrics[collapse.to] += quadrics[collapse.from];
+            locked[collapse.from] = true;
+            locked[collapse.to] = true;
+            acceptedCost = std::max(acceptedCost, collapse.cost);
+            performed++;
+        }
+
+        // Drop triangles that became degenerate.
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = canonical[result[i]];
+            uint32_t b = canonical[result[i + 1]];
+            uint32_t c = canonical[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                std::memmove(&result[write], &result[i], 3 * sizeof(uint32_t));
+                write += 3;
+            }
+        }
+        result.resize(write);
+
+        if (performed == 0) {
+            break;
+        }
+    }
+
+    if (resultError) {
+        *resultError = float(std::sqrt(acceptedCost));
+    }
+    return result;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric edge-collapse simplification (Garland & Heckbert).
+// Vertices are only ever collapsed onto other existing vertices, so every
+// LOD keeps using the original vertex buffer and only the index list
+// changes. Mesh borders and attribute seams are kept in place.
+//
+// Stops once the index count reaches targetIndexCount or no collapse stays
+// under targetError (a distance in mesh units). The largest error that was
+// accepted is written to resultError.
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& indices, const float* positions,
+                                   size_t positionStride, size_t vertexCount, size_t targetIndexCount,
+                                   float targetError, float* resultError = nullptr);
@@ -0,0 +1,189 @@
+// Offline asset packer: bundles loose files into one .pack archive (see
+// src/ArchiveFormat.h) that the runtime mounts through FileSystem.
+//
+//   asset_packer [--no-compress] [--threads N] <output.pack> <file|directory>...
+//
+// Directories are packed recursively. Entries keep the path they were given
+// by, e.g. `asset_packer res.pack res` stores res/shaders/x.glsl under that
+// name, which is how the code opens it. Files are LZ4 compressed on a
+// JobSystem with N workers, and stored as-is when that doesn't save at
+// least 1/16 of their size, as with PNG, JPEG or most block-compressed
+// data.
+
+#include "ArchiveFormat.h"
+#include "JobSystem.h"
+#include "Lz4Compressor.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct PackedFile {
+    std::string path;           // Normalized
+    uint64_t hash = 0;
+    uint64_t size = 0;
+    std::vector<uint8_t> stored;
+    ArchiveCompression compression = ArchiveCompression::None;
+    std::string error;
+};
+
+void collectFiles(const std::string& input, const std::filesystem::path& output, std::vector<PackedFile>& files) {
+    namespace fs = std::filesystem;
+    auto add = [&](const fs::path& path) {
+        std::error_code ec;
+        if (fs::equivalent(path, output, ec)) {
+            return;
+        }
+        files.emplace_back();
+        files.back().path = normalizeArchivePath(path.generic_string());
+    };
+    if (!fs::is_directory(input)) {
+        if (!fs::is_regular_file(input)) {
+            throw std::runtime_error("No such file or directory: " + input);
+        }
+        add(input);
+        return;
+    }
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input)) {
+        if (entry.is_regular_file()) {
+            add(entry.path());
+        }
+    }
+}
+
+uint64_t alignUp(uint64_t value) {
+    return (value + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+}
+
+void writeArchive(const std::string& path, std::vector<PackedFile>& files) {
+    std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.path < b.path;
+    });
+    std::vector<ArchiveEntry> entries(files.size());
+    std::string names;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (i > 0 && files[i].path == files[i - 1].path) {
+            throw std::runtime_error("Duplicate path: " + files[i].path);
+        }
+        entries[i].pathHash = files[i].hash;
+        entries[i].storedSize = files[i].stored.size();
+        entries[i].size = files[i].size;
+        entries[i].nameOffset = uint32_t(names.size());
+        entries[i].nameLength = uint32_t(files[i].path.size());
+        entries[i].compression = uint32_t(files[i].compression);
+        names += files[i].path;
+    }
+
+    ArchiveHeader header = {};
+    header.magic = ARCHIVE_FILE_MAGIC;
+    header.version = ARCHIVE_FILE_VERSION;
+    header.entryCount = uint32_t(entries.size());
+    header.indexOffset = sizeof(ArchiveHeader);
+    header.namesOffset = header.indexOffset + entries.size() * sizeof(ArchiveEntry);
+    header.namesSize = names.size();
+    uint64_t offset = alignUp(header.namesOffset + header.namesSize);
+    for (ArchiveEntry& entry : entries) {
+        entry.offset = offset;
+        offset = alignUp(offset + entry.storedSize);
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open output file: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+    out.write(names.data(), names.size());
+    uint64_t written = header.namesOffset + header.namesSize;
+    const char padding[ARCHIVE_ALIGNMENT] = {};
+    for (size_t i = 0; i < files.size(); ++i) {
+        out.write(padding, std::streamsize(entries[i].offset - written));
+        out.write(reinterpret_cast<const char*>(files[i].stored.data()), files[i].stored.size());
+        written = entries[i].offset + entries[i].storedSize;
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write output file: " + path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool compress = true;
+    unsigned threads = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-compress") {
+            compress = false;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = unsigned(std::stoul(argv[++i]));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() < 2) {
+        std::cerr << "Usage: asset_packer [--no-compress] [--threads N] <output.pack> <file|directory>..." << std::endl;
+        return 1;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<PackedFile> files;
+        for (size_t i = 1; i < paths.size(); ++i) {
+            collectFiles(paths[i], paths[0], files);
+        }
+
+        JobSystem jobs(threads);
+        for (PackedFile& file : files) {
+            jobs.submit([&file, compress] {
+                try {
+                    MappedFile source(file.path);
+                    file.hash = archivePathHash(file.path);
+                    file.size = source.size();
+                    if (compress && source.size() > 0) {
+                        std::vector<uint8_t> packed = lz4Compress(source.data(), source.size());
+                        if (packed.size() <= source.size() - source.size() / 16) {
+                            file.stored = std::move(packed);
+                            file.compression = ArchiveCompression::Lz4;
+                            return;
+                        }
+                    }
+                    file.stored.assign(source.data(), source.data() + source.size());
+                } catch (const std::exception& e) {
+                    file.error = e.what();
+                }
+            });
+        }
+        jobs.wait();
+
+        uint64_t sourceSize = 0, storedSize = 0;
+        size_t compressed = 0;
+        for (const PackedFile& file : files) {
+            if (!file.error.empty()) {
+                throw std::runtime_error(file.error);
+            }
+            sourceSize += file.size;
+            storedSize += file.stored.size();
+            compressed += file.compression == ArchiveCompression::Lz4;
+        }
+        writeArchive(paths[0], files);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << paths[0] << ": " << files.size() << " files (" << compressed << " compressed), "
+                  << sourceSize / 1024 << " KB -> " << storedSize / 1024 << " KB in " << seconds << " s on "
+                  << jobs.threadCount() << " threads" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
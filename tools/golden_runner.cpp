@@ -0,0 +1,697 @@
+// Golden-image regression runner: renders a fixed set of scenes through the
+// engine without a GPU or a display, compares each with a PNG golden and
+// times it, so CI catches rendering and performance regressions alike.
+//
+//   golden_runner [--update] [--egl] [--tolerance T] [--max-diff F] [--time-tolerance R]
+//                 [--frames N] [--scene NAME] [--out DIR] <golden directory>
+//
+// The context comes from Mesa through GLFW's null platform, OSMesa by
+// default or EGL with --egl; run with GALLIUM_DRIVER=llvmpipe so every
+// machine rasterizes the same way. Each scene is drawn into a Framebuffer,
+// read back with FrameCapture and compared pixel by pixel in YIQ space, the
+// metric pixelmatch uses: a pixel differs when its weighted distance exceeds
+// T (0.1 by default) of the largest possible one, and a scene fails when
+// more than F (0.001) of its pixels differ, which absorbs the odd rounding
+// change between Mesa versions but not a moved edge. Failing scenes leave
+// the rendered image and a diff in DIR (golden_out by default).
+//
+// Scenes are then drawn N more times (20 by default) and checked against
+// the baseline in timings.txt next to the goldens: the draw calls and
+// triangles per frame must match it exactly, as they don't depend on the
+// machine, and the average frame time must stay within R times (1.5) the
+// baseline's, 0 turning the time check off. Baseline times are only
+// meaningful on the machine that recorded them. A scene without a baseline
+// fails. The results are also written to DIR/timings.txt for the CI log.
+//
+// --update renders the goldens and baselines instead of checking them.
+// Exits with 1 when any scene fails.
+
+#include "Buffers.h"
+#include "ClusteredLights.h"
+#include "DeferredShading.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "GlDebug.h"
+#include "GpuFeatures.h"
+#include "Image.h"
+#include "RenderStats.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "VertexLayout.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SCENE_WIDTH = 256;
+constexpr uint32_t SCENE_HEIGHT = 256;
+constexpr uint32_t WARMUP_FRAMES = 3;
+constexpr const char* TIMINGS_FILE = "timings.txt";
+constexpr const char* LIT_VERTEX_SHADER_PATH = "res/shaders/golden_lit_vertex_shader.glsl";
+constexpr const char* LIT_FRAGMENT_SHADER_PATH = "res/shaders/golden_lit_fragment_shader.glsl";
+constexpr const char* TEXTURED_VERTEX_SHADER_PATH = "res/shaders/golden_textured_vertex_shader.glsl";
+constexpr const char* TEXTURED_FRAGMENT_SHADER_PATH = "res/shaders/golden_textured_fragment_shader.glsl";
+constexpr const char* CLUSTERED_FRAGMENT_SHADER_PATH = "res/shaders/golden_clustered_fragment_shader.glsl";
+constexpr const char* GBUFFER_FRAGMENT_SHADER_PATH = "res/shaders/golden_gbuffer_fragment_shader.glsl";
+// Largest YIQ distance between two colors, black to white
+constexpr float MAX_YIQ_DELTA = 35215.0f;
+
+struct Options {
+    bool update = false;
+    bool egl = false;
+    float tolerance = 0.1f;
+    double maxDiff = 0.001;
+    double timeTolerance = 1.5;
+    uint32_t frames = 20;
+    std::string scene;
+    std::string outDir = "golden_out";
+    std::string goldenDir;
+};
+
+glm::mat4 sceneProjection() {
+    return glm::perspective(glm::radians(45.0f), float(SCENE_WIDTH) / SCENE_HEIGHT, 0.1f, 100.0f);
+}
+
+// Draws one frame into the bound, cleared framebuffer. Scenes are static,
+// so every frame renders the same image.
+class Scene {
+public:
+    virtual ~Scene() = default;
+    virtual void draw() = 0;
+};
+
+// A UV sphere in the compact vertex formats: quantized positions,
+// octahedral normals and 8-bit colors, indexed
+struct Sphere {
+    VertexLayout layout;
+    PositionQuantization quantization{glm::vec3(-1.0f), glm::vec3(1.0f)};
+    std::unique_ptr<VertexBuffer> vertices;
+    std::unique_ptr<IndexBuffer> indices;
+    GLsizei indexCount = 0;
+
+    Sphere(uint32_t rings, uint32_t segments) {
+        layout.add(0, VertexFormat::Unorm16x4).add(1, VertexFormat::OctahedralSnorm10).add(2, VertexFormat::Unorm8x4);
+        std::vector<uint8_t> data((rings + 1) * (segments + 1) * layout.stride());
+        uint8_t* vertex = data.data();
+        for (uint32_t r = 0; r <= rings; ++r) {
+            float theta = glm::pi<float>() * r / rings;
+            for (uint32_t s = 0; s <= segments; ++s, vertex += layout.stride()) {
+                float phi = glm::two_pi<float>() * s / segments;
+                glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                layout.write(vertex, 0, glm::vec4(quantization.normalize(n), 0.0f));
+                layout.write(vertex, 1, glm::vec4(n, 1.0f));
+                layout.write(vertex, 2, glm::vec4(0.5f + 0.5f * n, 1.0f));
+            }
+        }
+        std::vector<uint16_t> triangles;
+        for (uint32_t r = 0; r < rings; ++r) {
+            for (uint32_t s = 0; s < segments; ++s) {
+                uint16_t a = uint16_t(r * (segments + 1) + s);
+                uint16_t b = uint16_t(a + segments + 1);
+                triangles.insert(triangles.end(), {a, b, uint16_t(a + 1), uint16_t(a + 1), b, uint16_t(b + 1)});
+            }
+        }
+        vertices = std::make_unique<VertexBuffer>(data.data(), data.size());
+        indices = std::make_unique<IndexBuffer>(triangles.data(), triangles.size() * sizeof(uint16_t));
+        indexCount = GLsizei(triangles.size());
+    }
+};
+
+// One lit sphere: vertex decoding, indexed drawing and interpolation
+class VertexFormatsScene : public Scene {
+public:
+    VertexFormatsScene() : shader(LIT_VERTEX_SHADER_PATH, LIT_FRAGMENT_SHADER_PATH), sphere(24, 48) {
+        vao.setLayout(*sphere.vertices, sphere.layout);
+        vao.setIndexBuffer(*sphere.indices);
+    }
+
+    void draw() override {
+        shader.use();
+        shader.setMat4("model", sphere.quantization.dequantizeMatrix());
+        shader.setMat4("view", glm::lookAt(glm::vec3(0.0f, 0.5f, 3.2f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        shader.setMat4("projection", sceneProjection());
+        vao.bind();
+        glDrawElements(GL_TRIANGLES, sphere.indexCount, GL_UNSIGNED_SHORT, nullptr);
+        countDraw(uint64_t(sphere.indexCount / 3));
+    }
+
+private:
+    Shader shader;
+    Sphere sphere;
+    VertexArray vao;
+};
+
+// A checkerboard floor receding to the horizon: mip generation, level
+// selection and filtering
+class TextureFilteringScene : public Scene {
+public:
+    TextureFilteringScene() : shader(TEXTURED_VERTEX_SHADER_PATH, TEXTURED_FRAGMENT_SHADER_PATH) {
+        const uint32_t size = 256;
+        std::vector<uint8_t> pixels(size * size * 4);
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                bool light = ((x / 16) + (y / 16)) % 2 == 0;
+                uint8_t* p = &pixels[(y * size + x) * 4];
+                p[0] = light ? 230 : 40;
+                p[1] = light ? 200 : 60;
+                p[2] = light ? 120 : 160;
+                p[3] = 255;
+            }
+        }
+        texture.setLevel(0, size, size, pixels.data());
+        texture.generateMipmaps();
+
+        layout.add(0, VertexFormat::Float3).add(1, VertexFormat::Half2);
+        const float quad[4][5] = {
+            {-1.0f, 0.0f, -1.0f, 0.0f, 0.0f},
+            {1.0f, 0.0f, -1.0f, 16.0f, 0.0f},
+            {-1.0f, 0.0f, 1.0f, 0.0f, 16.0f},
+            {1.0f, 0.0f, 1.0f, 16.0f, 16.0f},
+        };
+        std::vector<uint8_t> data(4 * layout.stride());
+        for (size_t i = 0; i < 4; ++i) {
+            layout.write(&data[i * layout.stride()], 0, glm::vec4(quad[i][0], quad[i][1], quad[i][2], 0.0f));
+            layout.write(&data[i * layout.stride()], 1, glm::vec4(quad[i][3], quad[i][4], 0.0f, 0.0f));
+        }
+        vertices = std::make_unique<VertexBuffer>(data.data(), data.size());
+        vao.setLayout(*vertices, layout);
+    }
+
+    void draw() override {
+        shader.use();
+        shader.setMat4("model", glm::scale(glm::mat4(1.0f), glm::vec3(20.0f)));
+        shader.setMat4("view", glm::lookAt(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.6f, -5.0f),
+                                           glm::vec3(0.0f, 1.0f, 0.0f)));
+        shader.setMat4("projection", sceneProjection());
+        shader.setInt("texture0", 0);
+        texture.bind(0);
+        vao.bind();
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        countDraw(2);
+    }
+
+private:
+    Shader shader;
+    Texture2D texture;
+    VertexLayout layout;
+    std::unique_ptr<VertexBuffer> vertices;
+    VertexArray vao;
+};
+
+// A grid of instanced spheres, mostly there to be timed: vertex throughput
+// and depth testing with 150k triangles
+class InstancedSpheresScene : public Scene {
+public:
+    static constexpr int GRID_SIZE = 16;
+
+    InstancedSpheresScene() : shader(LIT_VERTEX_SHADER_PATH, LIT_FRAGMENT_SHADER_PATH), sphere(12, 24) {
+        instanceLayout.add(3, VertexFormat::Float4);
+        std::vector<glm::vec4> offsets;
+        for (int z = 0; z < GRID_SIZE; ++z) {
+            for (int x = 0; x < GRID_SIZE; ++x) {
+                offsets.push_back(glm::vec4((x - GRID_SIZE / 2) * 2.5f, 0.0f, -z * 2.5f, 0.0f));
+            }
+        }
+        instances = std::make_unique<VertexBuffer>(offsets.data(), offsets.size() * sizeof(glm::vec4));
+        vao.setLayout(*sphere.vertices, sphere.layout);
+        vao.setIndexBuffer(*sphere.indices);
+        vao.setFormat(instanceLayout, 1, 1);
+        vao.setVertexBuffer(instances->ID, 1);
+    }
+
+    void draw() override {
+        shader.use();
+        shader.setMat4("model", sphere.quantization.dequantizeMatrix());
+        shader.setMat4("view", glm::lookAt(glm::vec3(0.0f, 8.0f, 10.0f), glm::vec3(0.0f, 0.0f, -12.0f),
+                                           glm::vec3(0.0f, 1.0f, 0.0f)));
+        shader.setMat4("projection", sceneProjection());
+        vao.bind();
+        glDrawElementsInstanced(GL_TRIANGLES, sphere.indexCount, GL_UNSIGNED_SHORT, nullptr, GRID_SIZE * GRID_SIZE);
+        countDraw(uint64_t(sphere.indexCount / 3) * GRID_SIZE * GRID_SIZE);
+    }
+
+private:
+    Shader shader;
+    Sphere sphere;
+    VertexLayout instanceLayout;
+    std::unique_ptr<VertexBuffer> instances;
+    VertexArray vao;
+};
+
+// The sphere grid lit by 4096 point lights only: cluster assignment on the
+// CPU and the per-cluster light loop in the fragment shader, timed with the
+// upload included
+class ClusteredLightsScene : public Scene {
+public:
+    static constexpr int GRID_SIZE = 16;
+    static constexpr uint32_t LIGHT_COUNT = 4096;
+
+    ClusteredLightsScene() : ClusteredLightsScene(CLUSTERED_FRAGMENT_SHADER_PATH) {}
+
+    void draw() override {
+        clusters.update(lights, view(), sceneProjection(), 0.1f, 100.0f);
+        useShader();
+        shader.setVec3("cameraPosition", CAMERA_POSITION);
+        clusters.bind(shader, 0, glm::vec2(SCENE_WIDTH, SCENE_HEIGHT));
+        drawSpheres();
+    }
+
+protected:
+    static constexpr glm::vec3 CAMERA_POSITION = glm::vec3(0.0f, 8.0f, 10.0f);
+
+    explicit ClusteredLightsScene(const char* fragmentShaderPath)
+        : shader(LIT_VERTEX_SHADER_PATH, fragmentShaderPath), sphere(12, 24) {
+        instanceLayout.add(3, VertexFormat::Float4);
+        std::vector<glm::vec4> offsets;
+        for (int z = 0; z < GRID_SIZE; ++z) {
+            for (int x = 0; x < GRID_SIZE; ++x) {
+                offsets.push_back(glm::vec4((x - GRID_SIZE / 2) * 2.5f, 0.0f, -z * 2.5f, 0.0f));
+            }
+        }
+        instances = std::make_unique<VertexBuffer>(offsets.data(), offsets.size() * sizeof(glm::vec4));
+        vao.setLayout(*sphere.vertices, sphere.layout);
+        vao.setIndexBuffer(*sphere.indices);
+        vao.setFormat(instanceLayout, 1, 1);
+        vao.setVertexBuffer(instances->ID, 1);
+
+        // Seeded, so every run places the same lights
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (uint32_t i = 0; i < LIGHT_COUNT; ++i) {
+            PointLight light;
+            light.position = glm::vec3(-21.0f + 40.0f * unit(random), -1.0f + 3.0f * unit(random),
+                                       2.0f - 42.0f * unit(random));
+            light.radius = 1.0f + unit(random);
+            light.color = glm::vec3(unit(random), unit(random), unit(random));
+            light.intensity = 1.5f;
+            lights.push_back(light);
+        }
+    }
+
+    static glm::mat4 view() {
+        return glm::lookAt(CAMERA_POSITION, glm::vec3(0.0f, 0.0f, -12.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    void useShader() const {
+        shader.use();
+        shader.setMat4("model", sphere.quantization.dequantizeMatrix());
+        shader.setMat4("view", view());
+        shader.setMat4("projection", sceneProjection());
+    }
+
+    void drawSpheres() {
+        vao.bind();
+        glDrawElementsInstanced(GL_TRIANGLES, sphere.indexCount, GL_UNSIGNED_SHORT, nullptr, GRID_SIZE * GRID_SIZE);
+        countDraw(uint64_t(sphere.indexCount / 3) * GRID_SIZE * GRID_SIZE);
+    }
+
+    Shader shader;
+    Sphere sphere;
+    VertexLayout instanceLayout;
+    std::unique_ptr<VertexBuffer> instances;
+    VertexArray vao;
+    std::vector<PointLight> lights;
+    ClusteredLights clusters{LIGHT_COUNT};
+};
+
+// The same spheres and lights through DeferredShading: a G-buffer pass,
+// then the full-screen lighting pass into the scene's target. It should
+// match clustered_lights up to the G-buffer's precision
+class DeferredLightsScene : public ClusteredLightsScene {
+public:
+    DeferredLightsScene()
+        : ClusteredLightsScene(GBUFFER_FRAGMENT_SHADER_PATH),
+          albedo(SCENE_WIDTH, SCENE_HEIGHT, DeferredShading::ALBEDO_FORMAT),
+          normal(SCENE_WIDTH, SCENE_HEIGHT, DeferredShading::NORMAL_FORMAT),
+          depth(SCENE_WIDTH, SCENE_HEIGHT, GL_DEPTH_COMPONENT24), gbuffer({&albedo, &normal}, &depth) {}
+
+    void draw() override {
+        GLint target = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+        gbuffer.bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        useShader();
+        drawSpheres();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, GLuint(target));
+        clusters.update(lights, view(), sceneProjection(), 0.1f, 100.0f);
+        DeferredLightingSettings settings;
+        settings.ambient = 0.05f;
+        settings.sunIntensity = 0.0f;
+        lighting.light({albedo.ID, normal.ID, depth.ID}, clusters, view(), sceneProjection(),
+                       glm::vec2(SCENE_WIDTH, SCENE_HEIGHT), settings);
+    }
+
+private:
+    RenderTarget albedo;
+    RenderTarget normal;
+    RenderTarget depth;
+    Framebuffer gbuffer;
+    DeferredShading lighting;
+};
+
+struct SceneEntry {
+    const char* name;
+    std::unique_ptr<Scene> (*create)();
+};
+
+template <typename T>
+std::unique_ptr<Scene> createScene() {
+    return std::make_unique<T>();
+}
+
+// New scenes go here; their goldens are created with --update --scene NAME
+const SceneEntry SCENES[] = {
+    {"vertex_formats", createScene<VertexFormatsScene>},
+    {"texture_filtering", createScene<TextureFilteringScene>},
+    {"instanced_spheres", createScene<InstancedSpheresScene>},
+    {"clustered_lights", createScene<ClusteredLightsScene>},
+    {"deferred_lights", createScene<DeferredLightsScene>},
+};
+
+struct SceneResult {
+    Image image;
+    double frameMs = 0.0;
+    RenderStats stats;
+};
+
+void drawFrame(Scene& scene, const Framebuffer& target) {
+    target.bind();
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.draw();
+}
+
+SceneResult renderScene(const SceneEntry& entry, uint32_t frames) {
+    std::unique_ptr<Scene> scene = entry.create();
+    Framebuffer target(SCENE_WIDTH, SCENE_HEIGHT, GL_RGBA8);
+    SceneResult result;
+    FrameCapture capture(SCENE_WIDTH, SCENE_HEIGHT, [&result](const CapturedFrame& frame) {
+        result.image.width = frame.width;
+        result.image.height = frame.height;
+        result.image.pixels.assign(frame.pixels, frame.pixels + size_t(frame.width) * frame.height * 4);
+    });
+
+    drawFrame(*scene, target);
+    capture.capture();
+    capture.flush();
+    checkGlErrors(entry.name);
+
+    // Shader compiles and first-use allocations stay out of the timings
+    for (uint32_t i = 0; i < WARMUP_FRAMES; ++i) {
+        drawFrame(*scene, target);
+    }
+    glFinish();
+    takeRenderStats();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frames; ++i) {
+        drawFrame(*scene, target);
+    }
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.frameMs = frames ? ms / frames : 0.0;
+    result.stats = takeRenderStats();
+    if (frames) {
+        result.stats.drawCalls /= frames;
+        result.stats.triangles /= frames;
+    }
+    Framebuffer::unbind();
+    return result;
+}
+
+// Weighted YIQ distance of two RGBA8 pixels, both blended over white first
+float yiqDelta(const uint8_t* a, const uint8_t* b) {
+    auto blend = [](const uint8_t* p, int c) { return 255.0f + (p[c] - 255.0f) * (p[3] / 255.0f); };
+    float r = blend(a, 0) - blend(b, 0);
+    float g = blend(a, 1) - blend(b, 1);
+    float bl = blend(a, 2) - blend(b, 2);
+    float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+    float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+    float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+    return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+}
+
+// Counts the pixels past the tolerance and paints them red over a faded
+// copy of the golden in `diff`
+size_t comparePixels(const Image& golden, const Image& actual, float tolerance, Image& diff) {
+    diff.width = golden.width;
+    diff.height = golden.height;
+    diff.pixels.resize(golden.pixels.size());
+    float threshold = MAX_YIQ_DELTA * tolerance * tolerance;
+    size_t differing = 0;
+    for (size_t i = 0; i < golden.pixels.size(); i += 4) {
+        uint8_t* out = &diff.pixels[i];
+        if (yiqDelta(&golden.pixels[i], &actual.pixels[i]) > threshold) {
+            differing++;
+            out[0] = 255;
+            out[1] = 0;
+            out[2] = 0;
+        } else {
+            uint8_t gray = uint8_t(
+                192 + (golden.pixels[i] * 77 + golden.pixels[i + 1] * 150 + golden.pixels[i + 2] * 29) / 1024);
+            out[0] = out[1] = out[2] = gray;
+        }
+        out[3] = 255;
+    }
+    return differing;
+}
+
+void writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+// Scene name to time and counts per frame, as writeTimings() stores them;
+// the images are left empty
+std::map<std::string, SceneResult> readTimings(const std::filesystem::path& path) {
+    std::map<std::string, SceneResult> timings;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        char name[128];
+        double ms;
+        unsigned draws;
+        unsigned long long triangles;
+        if (!line.empty() && line[0] != '#' &&
+            std::sscanf(line.c_str(), "%127s %lf %u %llu", name, &ms, &draws, &triangles) == 4) {
+            SceneResult& result = timings[name];
+            result.frameMs = ms;
+            result.stats.drawCalls = draws;
+            result.stats.triangles = triangles;
+        }
+    }
+    return timings;
+}
+
+void writeTimings(const std::filesystem::path& path, const std::map<std::string, SceneResult>& results) {
+    std::ofstream out(path);
+    out << "# scene ms/frame draws/frame triangles/frame\n";
+    for (const auto& [name, result] : results) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%s %.3f %u %llu\n", name.c_str(), result.frameMs, result.stats.drawCalls,
+                      static_cast<unsigned long long>(result.stats.triangles));
+        out << line;
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+GLFWwindow* createHeadlessContext(bool egl) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    if (!glfwInit()) {
+        throw std::runtime_error("Failed to initialize GLFW's null platform");
+    }
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, egl ? GLFW_EGL_CONTEXT_API : GLFW_OSMESA_CONTEXT_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GL_DEBUG_ENABLED
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+    GLFWwindow* window = glfwCreateWindow(SCENE_WIDTH, SCENE_HEIGHT, "golden_runner", nullptr, nullptr);
+    if (!window) {
+        glfwTerminate();
+        throw std::runtime_error(std::string("Failed to create an ") + (egl ? "EGL" : "OSMesa") + " context");
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        throw std::runtime_error("Failed to initialize GLAD");
+    }
+    return window;
+}
+
+int run(const Options& options) {
+    namespace fs = std::filesystem;
+    GLFWwindow* window = createHeadlessContext(options.egl);
+    const GpuFeatures& features = detectGpuFeatures();
+    std::cout << "Renderer: " << features.renderer << ", " << features.version << std::endl;
+    if (features.renderer.find("llvmpipe") == std::string::npos) {
+        std::cout << "Warning: goldens are rendered on llvmpipe; other rasterizers may not match them" << std::endl;
+    }
+    installGlDebugOutput();
+    glEnable(GL_DEPTH_TEST);
+
+    fs::path goldenDir = options.goldenDir;
+    fs::path outDir = options.outDir;
+    fs::create_directories(options.update ? goldenDir : outDir);
+    std::map<std::string, SceneResult> baseline = readTimings(goldenDir / TIMINGS_FILE);
+    if (baseline.empty() && !options.update) {
+        std::cout << "Warning: no baselines in " << (goldenDir / TIMINGS_FILE).string()
+                  << "; record them with --update" << std::endl;
+    }
+    std::map<std::string, SceneResult> results;
+    int failures = 0;
+
+    for (const SceneEntry& entry : SCENES) {
+        if (!options.scene.empty() && options.scene != entry.name) {
+            continue;
+        }
+        SceneResult result = renderScene(entry, options.frames);
+        fs::path goldenPath = goldenDir / (std::string(entry.name) + ".png");
+        std::string status;
+        bool failed = false;
+
+        if (options.update) {
+            writeFile(goldenPath, encodePng(result.image));
+            status = "updated";
+        } else if (!fs::exists(goldenPath)) {
+            status = "no golden";
+            failed = true;
+        } else {
+            Image golden = loadImage(goldenPath.string());
+            if (golden.width != result.image.width || golden.height != result.image.height) {
+                status = "size differs";
+                failed = true;
+            } else {
+                Image diff;
+                size_t differing = comparePixels(golden, result.image, options.tolerance, diff);
+                double fraction = double(differing) / (size_t(golden.width) * golden.height);
+                char text[64];
+                std::snprintf(text, sizeof(text), "%.3f%% pixels differ", fraction * 100.0);
+                status = text;
+                if (fraction > options.maxDiff) {
+                    writeFile(outDir / (std::string(entry.name) + ".diff.png"), encodePng(diff));
+                    failed = true;
+                }
+            }
+            if (failed) {
+                writeFile(outDir / (std::string(entry.name) + ".png"), encodePng(result.image));
+            }
+
+            auto previous = baseline.find(entry.name);
+            if (previous == baseline.end()) {
+                status += ", no baseline";
+                failed = true;
+            } else {
+                const SceneResult& expected = previous->second;
+                char text[128];
+                if (result.stats.drawCalls != expected.stats.drawCalls ||
+                    result.stats.triangles != expected.stats.triangles) {
+                    std::snprintf(text, sizeof(text), ", %u draws and %llu triangles instead of %u and %llu",
+                                  result.stats.drawCalls, static_cast<unsigned long long>(result.stats.triangles),
+                                  expected.stats.drawCalls, static_cast<unsigned long long>(expected.stats.triangles));
+                    status += text;
+                    failed = true;
+                }
+                if (options.timeTolerance > 0.0 && expected.frameMs > 0.0) {
+                    double ratio = result.frameMs / expected.frameMs;
+                    std::snprintf(text, sizeof(text), ", %.2fx baseline time", ratio);
+                    status += text;
+                    failed = failed || ratio > options.timeTolerance;
+                }
+            }
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-4s %-20s %8.3f ms  %s", failed ? "FAIL" : "ok", entry.name,
+                      result.frameMs, status.c_str());
+        std::cout << line << std::endl;
+        failures += failed;
+        results[entry.name] = std::move(result);
+    }
+
+    if (results.empty()) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        throw std::runtime_error("No scene named " + options.scene);
+    }
+    if (options.update) {
+        // Keep the baselines of scenes that weren't rendered this time
+        std::map<std::string, SceneResult> merged = std::move(baseline);
+        for (auto& [name, result] : results) {
+            merged[name] = std::move(result);
+        }
+        writeTimings(goldenDir / TIMINGS_FILE, merged);
+    } else {
+        writeTimings(outDir / TIMINGS_FILE, results);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") {
+            options.update = true;
+        } else if (arg == "--egl") {
+            options.egl = true;
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = std::stof(argv[++i]);
+        } else if (arg == "--max-diff" && i + 1 < argc) {
+            options.maxDiff = std::stod(argv[++i]);
+        } else if (arg == "--time-tolerance" && i + 1 < argc) {
+            options.timeTolerance = std::stod(argv[++i]);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = uint32_t(std::stoul(argv[++i]));
+        } else if (arg == "--scene" && i + 1 < argc) {
+            options.scene = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.outDir = argv[++i];
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 1) {
+        std::cerr << "Usage: golden_runner [--update] [--egl] [--tolerance T] [--max-diff F] [--time-tolerance R] "
+                     "[--frames N] [--scene NAME] [--out DIR] <golden directory>"
+                  << std::endl;
+        return 1;
+    }
+    options.goldenDir = paths[0];
+
+    try {
+        return run(options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
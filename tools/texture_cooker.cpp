@@ -0,0 +1,276 @@
+// Offline texture cooker: compresses PNG/JPEG/TGA sources into
+// block-compressed .dds files (see src/TextureFormat.h) that the runtime
+// maps and uploads without decoding.
+//
+//   texture_cooker [--format bc1|bc3|bc5|bc7] [--filter box|kaiser] [--no-mips] [--threads N]
+//                  [--atlas SIZE [--padding P]] <input.png|input.jpg|input.tga>... <output.dds>
+//   texture_cooker [--format ...] [--filter ...] [--threads N] --virtual PAGE <input> <output.vtex>
+//
+// The format defaults to BC7. Mips are built with the Kaiser filter unless
+// --no-mips is given. Rows of blocks are encoded in parallel on a JobSystem
+// with N workers, by default one per hardware thread after the first.
+//
+// With --atlas, any number of inputs are packed into SIZE x SIZE pages (see
+// src/TextureAtlas.h) and written as one texture array, with an .atlas
+// index next to the output that maps each input to its layer and UVs. Mips
+// stop at the levels the padding (default 4) keeps apart.
+//
+// With --virtual, the input is cut into PAGE x PAGE pages at every mip level
+// and written as a tiled .vtex file for VirtualTexture (see
+// src/VirtualTextureFormat.h). PAGE plus the 4-texel border on each side
+// must be a multiple of 4; 120 gives 128-texel tiles.
+
+#include <glad/glad.h>
+#include "BlockCompression.h"
+#include "Image.h"
+#include "JobSystem.h"
+#include "Mipmaps.h"
+#include "TextureAtlas.h"
+#include "TextureFormat.h"
+#include "VirtualTextureFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Levels of one layer, smallest last
+using LayerBlocks = std::vector<std::vector<uint8_t>>;
+
+void writeDds(const std::string& path, BlockFormat format, uint32_t width, uint32_t height,
+              const std::vector<LayerBlocks>& layers) {
+    BlockFormatInfo info = blockFormatInfo(format);
+    uint32_t levelCount = uint32_t(layers[0].size());
+    DdsHeader header = {};
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+    header.height = height;
+    header.width = width;
+    header.pitchOrLinearSize = uint32_t(layers[0][0].size());
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    // BC7 has no legacy code and arrays no legacy header; both need the
+    // DX10 extension header
+    bool dx10 = !info.fourCC || layers.size() > 1;
+    header.pixelFormat.fourCC = dx10 ? DDS_FOURCC_DX10 : info.fourCC;
+    header.caps = DDSCAPS_TEXTURE;
+    if (levelCount > 1) {
+        header.flags |= DDSD_MIPMAPCOUNT;
+        header.mipMapCount = levelCount;
+        header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::ios_base::failure("Failed to open output file: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (dx10) {
+        DdsHeaderDx10 extension = {info.dxgiFormat, DDS_DIMENSION_TEXTURE2D, 0, uint32_t(layers.size()), 0};
+        file.write(reinterpret_cast<const char*>(&extension), sizeof(extension));
+    }
+    for (const LayerBlocks& layer : layers) {
+        for (const std::vector<uint8_t>& level : layer) {
+            file.write(reinterpret_cast<const char*>(level.data()), level.size());
+        }
+    }
+    if (!file) {
+        throw std::ios_base::failure("Failed to write output file: " + path);
+    }
+}
+
+constexpr uint32_t VIRTUAL_TEXTURE_BORDER = 4;
+
+// Cuts every level into bordered tiles and compresses them one by one, so
+// only the source mip chain has to fit in memory.
+void writeVirtualTexture(const std::string& path, BlockFormat format, const std::vector<Image>& levels,
+                         uint32_t pageSize, JobSystem& jobs) {
+    VirtualTextureLayout layout(levels[0].width, levels[0].height, pageSize, VIRTUAL_TEXTURE_BORDER);
+    if (levels.size() < layout.levelCount()) {
+        throw std::runtime_error("Virtual textures need the mip chain");
+    }
+    uint32_t tileSize = layout.tileSize();
+    VirtualTextureHeader header = {};
+    header.magic = VTEX_FILE_MAGIC;
+    header.version = VTEX_FILE_VERSION;
+    header.width = layout.width();
+    header.height = layout.height();
+    header.pageSize = pageSize;
+    header.border = layout.border();
+    header.levelCount = layout.levelCount();
+    header.format = uint32_t(format);
+    header.tileDataOffset = sizeof(header);
+    header.tileBytes = compressedLevelSize(format, tileSize, tileSize);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::ios_base::failure("Failed to open output file: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    Image tile;
+    tile.width = tileSize;
+    tile.height = tileSize;
+    tile.pixels.resize(size_t(tileSize) * tileSize * 4);
+    for (uint32_t level = 0; level < layout.levelCount(); ++level) {
+        const Image& source = levels[level];
+        for (uint32_t pageY = 0; pageY < layout.pagesY(level); ++pageY) {
+            for (uint32_t pageX = 0; pageX < layout.pagesX(level); ++pageX) {
+                int64_t originX = int64_t(pageX) * pageSize - layout.border();
+                int64_t originY = int64_t(pageY) * pageSize - layout.border();
+                for (uint32_t y = 0; y < tileSize; ++y) {
+                    int64_t sourceY = std::min<int64_t>(std::max<int64_t>(originY + y, 0), source.height - 1);
+                    for (uint32_t x = 0; x < tileSize; ++x) {
+                        int64_t sourceX = std::min<int64_t>(std::max<int64_t>(originX + x, 0), source.width - 1);
+                        std::memcpy(&tile.pixels[(size_t(y) * tileSize + x) * 4],
+                                    &source.pixels[(size_t(sourceY) * source.width + sourceX) * 4], 4);
+                    }
+                }
+                std::vector<uint8_t> blocks = compressImage(tile, format, jobs);
+                file.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+            }
+        }
+    }
+    if (!file) {
+        throw std::ios_base::failure("Failed to write output file: " + path);
+    }
+    std::cout << path << ": " << layout.width() << "x" << layout.height() << " " << blockFormatInfo(format).name
+              << ", " << layout.levelCount() << " levels, " << layout.pageCount() << " pages of " << pageSize
+              << " texels, " << (header.tileDataOffset + layout.pageCount() * header.tileBytes) / 1024 << " KB"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BlockFormat format = BlockFormat::BC7;
+    MipFilter filter = MipFilter::Kaiser;
+    bool mips = true;
+    unsigned threads = 0;
+    uint32_t atlasSize = 0;
+    uint32_t padding = 4;
+    uint32_t virtualPage = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "bc1") {
+                format = BlockFormat::BC1;
+            } else if (name == "bc3") {
+                format = BlockFormat::BC3;
+            } else if (name == "bc5") {
+                format = BlockFormat::BC5;
+            } else if (name == "bc7") {
+                format = BlockFormat::BC7;
+            } else {
+                std::cerr << "Unknown format: " << name << std::endl;
+                return 1;
+            }
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = std::strcmp(argv[++i], "box") == 0 ? MipFilter::Box : MipFilter::Kaiser;
+        } else if (arg == "--no-mips") {
+            mips = false;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = unsigned(std::stoul(argv[++i]));
+        } else if (arg == "--atlas" && i + 1 < argc) {
+            atlasSize = uint32_t(std::stoul(argv[++i]));
+        } else if (arg == "--padding" && i + 1 < argc) {
+            padding = uint32_t(std::stoul(argv[++i]));
+        } else if (arg == "--virtual" && i + 1 < argc) {
+            virtualPage = uint32_t(std::stoul(argv[++i]));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() < 2 || (paths.size() > 2 && !atlasSize) || (atlasSize && virtualPage)) {
+        std::cerr << "Usage: texture_cooker [--format bc1|bc3|bc5|bc7] [--filter box|kaiser] [--no-mips] "
+                     "[--threads N] [--atlas SIZE [--padding P] | --virtual PAGE] <input.png|input.jpg|input.tga>... "
+                     "<output.dds|output.vtex>" << std::endl;
+        return 1;
+    }
+    std::string output = paths.back();
+    paths.pop_back();
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        if (virtualPage) {
+            JobSystem jobs(threads);
+            writeVirtualTexture(output, format, buildMipChain(loadImage(paths[0]), filter), virtualPage, jobs);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Cooked in " << seconds << " s on " << jobs.threadCount() << " threads" << std::endl;
+            return 0;
+        }
+        // Mip chains of every layer: the single texture, or each atlas page
+        std::vector<std::vector<Image>> layers;
+        std::vector<AtlasEntry> entries;
+        if (atlasSize) {
+            std::vector<Image> images;
+            for (const std::string& path : paths) {
+                images.push_back(loadImage(path));
+            }
+            // Tallest first packs tightest
+            std::vector<size_t> order(images.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(),
+                             [&](size_t a, size_t b) { return images[a].height > images[b].height; });
+            TextureAtlas atlas(atlasSize, padding);
+            entries.resize(images.size());
+            for (size_t i : order) {
+                entries[i] = {paths[i], atlas.add(images[i])};
+            }
+            layers = atlas.buildMipChains(filter);
+            if (!mips) {
+                for (std::vector<Image>& chain : layers) {
+                    chain.resize(1);
+                }
+            }
+        } else {
+            Image image = loadImage(paths[0]);
+            if (mips) {
+                layers.push_back(buildMipChain(std::move(image), filter));
+            } else {
+                layers.emplace_back();
+                layers.back().push_back(std::move(image));
+            }
+        }
+
+        JobSystem jobs(threads);
+        std::vector<LayerBlocks> blocks;
+        size_t compressedSize = 0, sourceSize = 0;
+        for (const std::vector<Image>& chain : layers) {
+            blocks.emplace_back();
+            for (const Image& level : chain) {
+                blocks.back().push_back(compressImage(level, format, jobs));
+                compressedSize += blocks.back().back().size();
+                sourceSize += level.byteSize();
+            }
+        }
+        const Image& base = layers[0][0];
+        writeDds(output, format, base.width, base.height, blocks);
+        if (atlasSize) {
+            std::string index = output.substr(0, output.rfind('.')) + ".atlas";
+            saveAtlasIndex(index, entries);
+            std::cout << index << ": " << entries.size() << " images on " << layers.size() << " pages" << std::endl;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << output << ": " << base.width << "x" << base.height << " " << blockFormatInfo(format).name
+                  << ", " << layers.size() << (layers.size() == 1 ? " layer, " : " layers, ") << layers[0].size()
+                  << " levels, " << sourceSize / 1024 << " KB -> " << compressedSize / 1024 << " KB in " << seconds
+                  << " s on " << jobs.threadCount() << " threads" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}